@@ -31,6 +31,9 @@
 #include <QPointer>
 #include <QTimer>
 #include <QThread>
+#include <QVarLengthArray>
+
+#include <algorithm>
 
 #include <KConfigGroup>
 #include <KSharedConfig>
@@ -52,6 +55,9 @@
 
 #include <debug.h>
 
+#include <language/duchain/duchainlock.h>
+#include <language/duchain/parsingenvironment.h>
+
 #include "parsejob.h"
 
 using namespace KDevelop;
@@ -60,6 +66,10 @@ namespace {
 
 const bool separateThreadForHighPriority = true;
 
+/// How many queued documents are looked at for a document that can be parsed right away,
+/// before settling for one that still has queued imports.
+const int maxSchedulingLookahead = 128;
+
 /**
  * Elides string in @p path, e.g. "VEEERY/LONG/PATH" -> ".../LONG/PATH"
  * - probably much faster than QFontMetrics::elidedText()
@@ -184,6 +194,169 @@ struct DocumentParsePlan
 Q_DECLARE_TYPEINFO(DocumentParseTarget, Q_MOVABLE_TYPE);
 Q_DECLARE_TYPEINFO(DocumentParsePlan, Q_MOVABLE_TYPE);
 
+/**
+ * The queued documents, ordered by priority, and by the order they were queued in within one priority.
+ *
+ * This is an indexed binary heap: the position of every document in the heap is stored, so the priority
+ * of a queued document can be changed, and a document can be removed, in O(log n).
+ */
+class DocumentPriorityQueue
+{
+public:
+    bool isEmpty() const
+    {
+        return m_heap.isEmpty();
+    }
+
+    int size() const
+    {
+        return m_heap.size();
+    }
+
+    bool contains(const IndexedString& url) const
+    {
+        return m_positions.contains(url);
+    }
+
+    /// Queues @p url with the given priority, or changes its priority if it is queued already
+    void setPriority(const IndexedString& url, int priority)
+    {
+        const auto it = m_positions.constFind(url);
+        if (it == m_positions.constEnd()) {
+            m_heap.append({priority, m_nextSequence++, url});
+            m_positions.insert(url, m_heap.size() - 1);
+            siftUp(m_heap.size() - 1);
+            return;
+        }
+
+        const int position = *it;
+        const int oldPriority = m_heap[position].priority;
+        m_heap[position].priority = priority;
+        if (priority < oldPriority) {
+            siftUp(position);
+        } else if (priority > oldPriority) {
+            siftDown(position);
+        }
+    }
+
+    void remove(const IndexedString& url)
+    {
+        const auto it = m_positions.find(url);
+        if (it == m_positions.end()) {
+            return;
+        }
+
+        const int position = *it;
+        m_positions.erase(it);
+
+        const int last = m_heap.size() - 1;
+        if (position != last) {
+            move(last, position);
+            m_heap.removeLast();
+            siftDown(position);
+            siftUp(position);
+        } else {
+            m_heap.removeLast();
+        }
+    }
+
+    /**
+     * Calls @p visitor(url, priority) for the queued documents in order, until it returns false.
+     *
+     * Visiting the first k documents takes O(k log k), independent of the count of queued documents.
+     * The visitor must not change the queue.
+     */
+    template<class Visitor>
+    void visitInOrder(Visitor visitor) const
+    {
+        if (m_heap.isEmpty()) {
+            return;
+        }
+
+        // A heap of the positions whose parents have been visited, ordered like the entries at these positions
+        const auto visitLater = [this](int lhs, int rhs) {
+            return lessThan(m_heap[rhs], m_heap[lhs]);
+        };
+        QVarLengthArray<int, 128> candidates;
+        candidates.append(0);
+        while (!candidates.isEmpty()) {
+            std::pop_heap(candidates.begin(), candidates.end(), visitLater);
+            const int position = candidates.last();
+            candidates.removeLast();
+
+            const Entry& entry = m_heap[position];
+            if (!visitor(entry.url, entry.priority)) {
+                return;
+            }
+
+            for (int child = position * 2 + 1; child <= position * 2 + 2 && child < m_heap.size(); ++child) {
+                candidates.append(child);
+                std::push_heap(candidates.begin(), candidates.end(), visitLater);
+            }
+        }
+    }
+
+private:
+    struct Entry
+    {
+        int priority;
+        quint64 sequence;
+        IndexedString url;
+    };
+
+    static bool lessThan(const Entry& lhs, const Entry& rhs)
+    {
+        return lhs.priority < rhs.priority || (lhs.priority == rhs.priority && lhs.sequence < rhs.sequence);
+    }
+
+    void move(int from, int to)
+    {
+        m_heap[to] = m_heap[from];
+        m_positions[m_heap[to].url] = to;
+    }
+
+    void siftUp(int position)
+    {
+        const Entry entry = m_heap[position];
+        while (position > 0) {
+            const int parent = (position - 1) / 2;
+            if (!lessThan(entry, m_heap[parent])) {
+                break;
+            }
+            move(parent, position);
+            position = parent;
+        }
+        m_heap[position] = entry;
+        m_positions[entry.url] = position;
+    }
+
+    void siftDown(int position)
+    {
+        const Entry entry = m_heap[position];
+        const int size = m_heap.size();
+        while (true) {
+            int child = position * 2 + 1;
+            if (child >= size) {
+                break;
+            }
+            if (child + 1 < size && lessThan(m_heap[child + 1], m_heap[child])) {
+                ++child;
+            }
+            if (!lessThan(m_heap[child], entry)) {
+                break;
+            }
+            move(child, position);
+            position = child;
+        }
+        m_heap[position] = entry;
+        m_positions[entry.url] = position;
+    }
+
+    QVector<Entry> m_heap;
+    QHash<IndexedString, int> m_positions;
+    quint64 m_nextSequence = 0;
+};
+
 class KDevelop::BackgroundParserPrivate
 {
 public:
@@ -216,15 +389,62 @@ public:
 
     int currentBestRunningPriority() const
     {
-        int bestRunningPriority = BackgroundParser::WorstPriority;
-        for (const auto* decorator : m_parseJobs) {
-            const ParseJob* parseJob = dynamic_cast<const ParseJob*>(decorator->job());
-            Q_ASSERT(parseJob);
-            if (parseJob->respectsSequentialProcessing() && parseJob->parsePriority() < bestRunningPriority) {
-                bestRunningPriority = parseJob->parsePriority();
+        if (m_runningSequentialPriorities.isEmpty()) {
+            return BackgroundParser::WorstPriority;
+        }
+        return qMin<int>(m_runningSequentialPriorities.firstKey(), BackgroundParser::WorstPriority);
+    }
+
+    void addParseJob(const IndexedString& url, ThreadWeaver::QObjectDecorator* decorator)
+    {
+        m_parseJobs.insert(url, decorator);
+
+        const ParseJob* parseJob = dynamic_cast<const ParseJob*>(decorator->job());
+        Q_ASSERT(parseJob);
+        if (parseJob->respectsSequentialProcessing()) {
+            ++m_runningSequentialPriorities[parseJob->parsePriority()];
+        }
+    }
+
+    void removeParseJob(const ParseJob* parseJob)
+    {
+        if (!m_parseJobs.remove(parseJob->document()) || !parseJob->respectsSequentialProcessing()) {
+            return;
+        }
+
+        const auto it = m_runningSequentialPriorities.find(parseJob->parsePriority());
+        Q_ASSERT(it != m_runningSequentialPriorities.end());
+        if (--it.value() == 0) {
+            m_runningSequentialPriorities.erase(it);
+        }
+    }
+
+    enum Readiness {
+        /// None of the known imports is queued or being parsed
+        Ready,
+        /// Some known import is still queued, so it should better be parsed first
+        WaitingForImports,
+        /// Some known import is being parsed right now, so a parse job would only wait for its parse lock
+        Blocked
+    };
+
+    Readiness readiness(const IndexedString& url) const
+    {
+        const auto importsIt = m_imports.constFind(url);
+        if (importsIt == m_imports.constEnd()) {
+            return Ready;
+        }
+
+        Readiness ret = Ready;
+        for (const auto& import : *importsIt) {
+            if (m_parseJobs.contains(import)) {
+                return Blocked;
+            }
+            if (m_documents.contains(import)) {
+                ret = WaitingForImports;
             }
         }
-        return bestRunningPriority;
+        return ret;
     }
 
     IndexedString nextDocumentToParse() const
@@ -232,39 +452,73 @@ public:
         // Before starting a new job, first wait for all higher-priority ones to finish.
         // That way, parse job priorities can be used for dependency handling.
         const int bestRunningPriority = currentBestRunningPriority();
+        int lookahead = 0;
+
+        IndexedString next;
+        IndexedString waitingForImports;
+        bool firstDocument = true;
+        int currentPriority = BackgroundParser::BestPriority;
+        m_queue.visitInOrder([&] (const IndexedString& url, int priority) {
+            if (firstDocument || priority != currentPriority) {
+                if (!waitingForImports.isEmpty()) {
+                    // Import cycles, or imports that are only queued with a worse priority
+                    next = waitingForImports;
+                    return false;
+                }
+                firstDocument = false;
+                currentPriority = priority;
 
-        for (auto it1 = m_documentsForPriority.begin();
-             it1 != m_documentsForPriority.end(); ++it1 )
-        {
-            const auto priority = it1.key();
-            if(priority > m_neededPriority)
-                break; //The priority is not good enough to be processed right now
+                if (priority > m_neededPriority)
+                    return false; //The priority is not good enough to be processed right now
 
-            if (m_parseJobs.count() >= m_threads && priority > BackgroundParser::NormalPriority && !specialParseJob) {
-                break; //The additional parsing thread is reserved for higher priority parsing
+                if (m_parseJobs.count() >= m_threads && priority > BackgroundParser::NormalPriority && !specialParseJob) {
+                    return false; //The additional parsing thread is reserved for higher priority parsing
+                }
             }
 
-            for (const auto& url : it1.value()) {
-                // When a document is scheduled for parsing while it is being parsed, it will be parsed
-                // again once the job finished, but not now.
-                if (m_parseJobs.contains(url)) {
-                    continue;
-                }
+            // When a document is scheduled for parsing while it is being parsed, it will be parsed
+            // again once the job finished, but not now.
+            if (m_parseJobs.contains(url)) {
+                return true;
+            }
 
-                Q_ASSERT(m_documents.contains(url));
-                const auto& parsePlan = m_documents[url];
-                // If the current job requires sequential processing, but not all jobs with a better priority have been
-                // completed yet, it will not be created now.
-                if (    parsePlan.sequentialProcessingFlags() & ParseJob::RequiresSequentialProcessing
-                     && parsePlan.priority() > bestRunningPriority )
-                {
-                    continue;
-                }
+            Q_ASSERT(m_documents.contains(url));
+            const auto& parsePlan = m_documents[url];
+            // If the current job requires sequential processing, but not all jobs with a better priority have been
+            // completed yet, it will not be created now.
+            if (    parsePlan.sequentialProcessingFlags() & ParseJob::RequiresSequentialProcessing
+                 && parsePlan.priority() > bestRunningPriority )
+            {
+                return true;
+            }
+
+            // Within one priority, parse the documents whose imports are done first, and do not start
+            // documents whose imports are being parsed right now, they would occupy a thread just waiting.
+            switch (readiness(url)) {
+                case Ready:
+                    next = url;
+                    return false;
+                case WaitingForImports:
+                    if (waitingForImports.isEmpty()) {
+                        waitingForImports = url;
+                    }
+                    break;
+                case Blocked:
+                    break;
+            }
 
-                return url;
+            if (++lookahead >= maxSchedulingLookahead) {
+                next = waitingForImports;
+                return false;
             }
+            return true;
+        });
+
+        if (next.isEmpty()) {
+            // All queued documents were visited
+            next = waitingForImports;
         }
-        return {};
+        return next;
     }
 
     /**
@@ -314,10 +568,9 @@ public:
             const auto parsePlanIt = m_documents.find(url);
             if (parsePlanIt != m_documents.end()) {
                 // Remove all mentions of this document.
-                for (const auto& target : qAsConst(parsePlanIt->targets)) {
-                    m_documentsForPriority[target.priority].remove(url);
-                }
+                m_queue.remove(url);
                 m_documents.erase(parsePlanIt);
+                m_imports.remove(url);
             } else {
                 qCWarning(LANGUAGE) << "Document got removed during parse job creation:" << url;
             }
@@ -326,7 +579,7 @@ public:
                 if(m_parseJobs.count() == m_threads+1 && !specialParseJob)
                     specialParseJob = decorator; //This parse-job is allocated into the reserved thread
 
-                m_parseJobs.insert(url, decorator);
+                addParseJob(url, decorator);
                 m_weaver.enqueue(ThreadWeaver::JobPointer(decorator));
             } else {
                 --m_maxParseJobs;
@@ -338,11 +591,7 @@ public:
                 QMetaObject::invokeMethod(m_parser, "parseDocuments", Qt::QueuedConnection);
             } else {
                 // make sure we cleaned up properly
-                // TODO: also empty m_documentsForPriority when m_documents is empty? or do we want to keep capacity?
-                Q_ASSERT(std::none_of(m_documentsForPriority.constBegin(), m_documentsForPriority.constEnd(),
-                                        [] (const QSet<IndexedString>& docs) {
-                                        return !docs.isEmpty();
-                                        }));
+                Q_ASSERT(m_queue.isEmpty());
             }
         }
 
@@ -382,6 +631,13 @@ public:
                              m_parser, &BackgroundParser::parseComplete);
             QObject::connect(job, &ParseJob::progress,
                              m_parser, &BackgroundParser::parseProgress, Qt::QueuedConnection);
+            // Executed in the worker thread, before parseComplete() schedules the next jobs
+            QObject::connect(decorator, &ThreadWeaver::QObjectDecorator::done,
+                             m_parser, [this] (const ThreadWeaver::JobPointer& done) {
+                                 auto decorator = dynamic_cast<ThreadWeaver::QObjectDecorator*>(done.data());
+                                 Q_ASSERT(decorator);
+                                 recordImports(dynamic_cast<ParseJob*>(decorator->job()));
+                             }, Qt::DirectConnection);
 
             // TODO more thinking required here to support multiple parse jobs per url (where multiple language plugins want to parse)
             return decorator;
@@ -407,6 +663,49 @@ public:
     }
 
 
+    /**
+     * Remembers the imports of the queued documents among the document parsed by @p job and its recursive
+     * imports, so nextDocumentToParse() can schedule imports before their importers. Only queued imports
+     * whose imports are not known yet are followed. The entries are dropped again when their document
+     * leaves the queue, so only the queued documents are remembered.
+     *
+     * Called in the worker thread, so waiting for the DUChain lock does not block the UI.
+     */
+    void recordImports(const ParseJob* job)
+    {
+        if (!job) {
+            return;
+        }
+
+        DUChainReadLocker duchainLock;
+        const ReferencedTopDUContext top = job->duChain();
+        if (!top || !top->parsingEnvironmentFile()) {
+            return;
+        }
+
+        // the usual lock order: first the duchain, then our mutex
+        QMutexLocker lock(&m_mutex);
+        QVector<ParsingEnvironmentFilePointer> todo{top->parsingEnvironmentFile()};
+        while (!todo.isEmpty()) {
+            const ParsingEnvironmentFilePointer file = todo.takeLast();
+            QVector<IndexedString> fileImports;
+            foreach (const ParsingEnvironmentFilePointer& import, file->imports()) {
+                if (!import || import->url() == file->url()) {
+                    continue;
+                }
+                fileImports.append(import->url());
+                if (m_documents.contains(import->url()) && !m_imports.contains(import->url())) {
+                    m_imports.insert(import->url(), {});
+                    todo.append(import);
+                }
+            }
+            // the parsed document itself may have been queued again meanwhile
+            if (m_documents.contains(file->url())) {
+                m_imports.insert(file->url(), fileImports);
+            }
+        }
+    }
+
     void loadSettings()
     {
         ///@todo re-load settings when they have been changed!
@@ -481,9 +780,13 @@ config.readEntry(entry, oldConfig.readEntry(entry, default))
     // A list of documents that are planned to be parsed, and their priority
     QHash<IndexedString, DocumentParsePlan > m_documents;
     // The documents ordered by priority
-    QMap<int, QSet<IndexedString> > m_documentsForPriority;
-    // Currently running parse jobs
+    DocumentPriorityQueue m_queue;
+    // Currently running parse jobs, only change them through addParseJob() and removeParseJob()
     QHash<IndexedString, ThreadWeaver::QObjectDecorator*> m_parseJobs;
+    // The count of running parse jobs that respect sequential processing, for each priority
+    QMap<int, int> m_runningSequentialPriorities;
+    // The direct imports of queued documents, as of the last time one of their importers was parsed
+    QHash<IndexedString, QVector<IndexedString>> m_imports;
     // The url for each managed document. Those may temporarily differ from the real url.
     QHash<KTextEditor::Document*, IndexedString> m_managedTextDocumentUrls;
     // Projects currently in progress of loading
@@ -565,8 +868,6 @@ void BackgroundParser::revertAllRequests(QObject* notifyWhenReady)
     QMutexLocker lock(&d->m_mutex);
     for (auto it = d->m_documents.begin(); it != d->m_documents.end(); ) {
 
-        d->m_documentsForPriority[it.value().priority()].remove(it.key());
-
         foreach ( const DocumentParseTarget& target, (*it).targets ) {
             if ( notifyWhenReady && target.notifyWhenReady.data() == notifyWhenReady ) {
                 (*it).targets.remove(target);
@@ -574,13 +875,15 @@ void BackgroundParser::revertAllRequests(QObject* notifyWhenReady)
         }
 
         if((*it).targets.isEmpty()) {
+            d->m_queue.remove(it.key());
+            d->m_imports.remove(it.key());
             it = d->m_documents.erase(it);
             --d->m_maxParseJobs;
 
             continue;
         }
 
-        d->m_documentsForPriority[it.value().priority()].insert(it.key());
+        d->m_queue.setPriority(it.key(), it.value().priority());
         ++it;
     }
 }
@@ -603,13 +906,12 @@ void BackgroundParser::addDocument(const IndexedString& url, TopDUContext::Featu
         if (it != d->m_documents.end()) {
             //Update the stored plan
 
-            d->m_documentsForPriority[it.value().priority()].remove(url);
             it.value().targets << target;
-            d->m_documentsForPriority[it.value().priority()].insert(url);
+            d->m_queue.setPriority(url, it.value().priority());
         }else{
 //             qCDebug(LANGUAGE) << "BackgroundParser::addDocument: queuing" << cleanedUrl;
             d->m_documents[url].targets << target;
-            d->m_documentsForPriority[d->m_documents[url].priority()].insert(url);
+            d->m_queue.setPriority(url, d->m_documents[url].priority());
             ++d->m_maxParseJobs; //So the progress-bar waits for this document
         }
 
@@ -628,8 +930,6 @@ void BackgroundParser::removeDocument(const IndexedString& url, QObject* notifyW
 
     if(d->m_documents.contains(url)) {
 
-        d->m_documentsForPriority[d->m_documents[url].priority()].remove(url);
-
         foreach(const DocumentParseTarget& target, d->m_documents[url].targets) {
             if(target.notifyWhenReady.data() == notifyWhenReady) {
                 d->m_documents[url].targets.remove(target);
@@ -637,11 +937,13 @@ void BackgroundParser::removeDocument(const IndexedString& url, QObject* notifyW
         }
 
         if(d->m_documents[url].targets.isEmpty()) {
+            d->m_queue.remove(url);
             d->m_documents.remove(url);
+            d->m_imports.remove(url);
             --d->m_maxParseJobs;
         }else{
-            //Insert with an eventually different priority
-            d->m_documentsForPriority[d->m_documents[url].priority()].insert(url);
+            //Update with an eventually different priority
+            d->m_queue.setPriority(url, d->m_documents[url].priority());
         }
     }
 }
@@ -668,7 +970,7 @@ void BackgroundParser::parseComplete(const ThreadWeaver::JobPointer& job)
     {
         QMutexLocker lock(&d->m_mutex);
 
-        d->m_parseJobs.remove(parseJob->document());
+        d->removeParseJob(parseJob);
 
         d->m_jobProgress.remove(parseJob);
 
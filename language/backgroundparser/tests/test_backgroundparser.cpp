@@ -27,6 +27,7 @@
 #include <QTemporaryFile>
 #include <QApplication>
 #include <QSemaphore>
+#include <QMutex>
 
 #include <KTextEditor/Editor>
 #include <KTextEditor/View>
@@ -37,6 +38,7 @@
 
 #include <language/duchain/duchain.h>
 #include <language/duchain/duchainlock.h>
+#include <language/duchain/parsingenvironment.h>
 #include <language/backgroundparser/backgroundparser.h>
 
 #include <interfaces/ilanguagecontroller.h>
@@ -278,6 +280,74 @@ void TestBackgroundparser::testParseOrdering_simple()
     QVERIFY(m_jobPlan.runJobs(1000));
 }
 
+void TestBackgroundparser::testParseOrdering_imports()
+{
+    // a document that was parsed once is parsed again only after the queued documents it imports
+    const IndexedString importer(QUrl::fromLocalFile(QStringLiteral("/test_imports_importer.txt")));
+    const IndexedString import(QUrl::fromLocalFile(QStringLiteral("/test_imports_import.txt")));
+    const int priority = BackgroundParser::InitialParsePriority;
+
+    ReferencedTopDUContext importTop;
+    {
+        DUChainWriteLocker lock;
+        importTop = new TopDUContext(import, RangeInRevision(), new ParsingEnvironmentFile(import));
+        DUChain::self()->addDocumentChain(importTop);
+    }
+
+    QMutex mutex;
+    QVector<IndexedString> createdJobs;
+    auto connection = connect(m_langSupport, &TestLanguageSupport::parseJobCreated, this, [&](ParseJob* job) {
+        QMutexLocker lock(&mutex);
+        createdJobs << job->document();
+        if (job->document() != importer) {
+            return;
+        }
+        auto testJob = static_cast<TestParseJob*>(job);
+        // long enough to queue the documents again while the importer is parsed for the first time
+        testJob->duration_ms = createdJobs.size() == 1 ? 300 : 0;
+        testJob->run_callback = [testJob, importer, &importTop](const IndexedString&) {
+            DUChainWriteLocker lock;
+            ReferencedTopDUContext top(DUChain::self()->chainForDocument(importer));
+            if (!top) {
+                top = new TopDUContext(importer, RangeInRevision(), new ParsingEnvironmentFile(importer));
+                DUChain::self()->addDocumentChain(top);
+                top->addImportedParentContext(importTop.data());
+            }
+            testJob->setDuChain(top);
+        };
+    }, Qt::DirectConnection);
+
+    auto createdCount = [&]() {
+        QMutexLocker lock(&mutex);
+        return createdJobs.size();
+    };
+
+    auto parser = ICore::self()->languageController()->backgroundParser();
+    // with a single thread, nothing else is started while the first job runs
+    parser->setThreadCount(1);
+
+    parser->addDocument(importer, TopDUContext::Empty, priority);
+    parser->parseDocuments();
+    QTRY_COMPARE(createdCount(), 1);
+
+    // the importer is queued before its import
+    parser->addDocument(importer, TopDUContext::Empty, priority);
+    parser->addDocument(import, TopDUContext::Empty, priority);
+    parser->parseDocuments();
+
+    QTRY_COMPARE_WITH_TIMEOUT(createdCount(), 3, 2000);
+    QTRY_VERIFY(!parser->parseJobForDocument(importer));
+
+    disconnect(connection);
+    parser->setThreadCount(4);
+
+    QCOMPARE(createdJobs, QVector<IndexedString>() << importer << import << importer);
+
+    DUChainWriteLocker lock;
+    DUChain::self()->removeDocumentChain(DUChain::self()->chainForDocument(importer));
+    DUChain::self()->removeDocumentChain(importTop.data());
+}
+
 void TestBackgroundparser::benchmark()
 {
     const int jobs = 10000;
@@ -301,6 +371,87 @@ void TestBackgroundparser::benchmark()
     }
 }
 
+void TestBackgroundparser::benchmarkPriorityQueue_data()
+{
+    QTest::addColumn<QString>("operation");
+
+    // queue all documents
+    QTest::newRow("queue") << QStringLiteral("queue");
+    // queue and remove a single document with a high priority, like a document that is being edited
+    QTest::newRow("highPriorityInsert") << QStringLiteral("highPriorityInsert");
+    // raise the priority of 2000 queued documents
+    QTest::newRow("reprioritize") << QStringLiteral("reprioritize");
+    // create and run 2000 parse jobs
+    QTest::newRow("schedule") << QStringLiteral("schedule");
+}
+
+void TestBackgroundparser::benchmarkPriorityQueue()
+{
+    QFETCH(QString, operation);
+
+    auto parser = ICore::self()->languageController()->backgroundParser();
+    const int queued = 200000;
+    const int scheduled = 2000;
+
+    QVector<IndexedString> urls;
+    urls.reserve(queued);
+    for (int i = 0; i < queued; ++i) {
+        urls << IndexedString("/queued" + QString::number(i) + ".txt");
+    }
+
+    auto queueAll = [&] {
+        for (int i = 0; i < queued; ++i) {
+            parser->addDocument(urls[i], TopDUContext::Empty, BackgroundParser::InitialParsePriority + i % 100);
+        }
+    };
+
+    // nothing may be parsed while the queue is filled
+    parser->disableProcessing();
+
+    if (operation == QLatin1String("queue")) {
+        QBENCHMARK_ONCE {
+            queueAll();
+        }
+    } else {
+        queueAll();
+        QCOMPARE(parser->queuedCount(), queued);
+
+        if (operation == QLatin1String("highPriorityInsert")) {
+            const IndexedString edited(QStringLiteral("/edited.txt"));
+            QBENCHMARK {
+                parser->addDocument(edited, TopDUContext::Empty, BackgroundParser::NormalPriority);
+                parser->removeDocument(edited);
+            }
+        } else if (operation == QLatin1String("reprioritize")) {
+            QBENCHMARK_ONCE {
+                for (int i = 0; i < queued; i += queued / scheduled) {
+                    parser->addDocument(urls[i], TopDUContext::Empty, BackgroundParser::NormalPriority);
+                }
+            }
+        } else {
+            parser->enableProcessing();
+            QBENCHMARK_ONCE {
+                parser->parseDocuments();
+                // poll finely to measure the scheduling, but don't hang if it stalls
+                QElapsedTimer timer;
+                timer.start();
+                while (parser->queuedCount() > queued - scheduled && timer.elapsed() < 30000) {
+                    QTest::qWait(1);
+                }
+            }
+            QVERIFY(parser->queuedCount() <= queued - scheduled);
+            parser->disableProcessing();
+        }
+    }
+
+    foreach (const IndexedString& url, urls) {
+        parser->removeDocument(url);
+    }
+    QCOMPARE(parser->queuedCount(), 0);
+    QVERIFY(parser->waitForIdle());
+    parser->enableProcessing();
+}
+
 void TestBackgroundparser::benchmarkDocumentChanges()
 {
     KTextEditor::Editor* editor = KTextEditor::Editor::instance();
@@ -101,12 +101,15 @@ private Q_SLOTS:
     void testParseOrdering_lockup();
     void testParseOrdering_foregroundThread();
     void testParseOrdering_noSequentialProcessing();
+    void testParseOrdering_imports();
 
     void testNoDeadlockInJobCreation();
 
     void benchmark();
 
     void benchmarkDocumentChanges();
+    void benchmarkPriorityQueue();
+    void benchmarkPriorityQueue_data();
 
 private:
     JobPlan m_jobPlan;
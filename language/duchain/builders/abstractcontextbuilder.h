@@ -33,6 +33,7 @@
 #include "../duchain.h"
 #include "../ducontext.h"
 #include "../identifier.h"
+#include "../indexupdatebatch.h"
 #include "../parsingenvironment.h"
 
 #include <serialization/indexedstring.h>
@@ -86,6 +87,9 @@ public:
     m_compilingContexts = true;
     m_url = url;
 
+    //Groups the changes of the whole build to the global indices, they are applied whenever the write lock is released
+    IndexUpdateBatch batch;
+
     ReferencedTopDUContext top;
     {
       DUChainWriteLocker lock( DUChain::lock() );
@@ -24,6 +24,7 @@
 #include "../topducontext.h"
 #include "../duchain.h"
 #include "../duchainlock.h"
+#include "../indexupdatebatch.h"
 
 #include <util/stack.h>
 
@@ -63,6 +64,9 @@ public:
   {
     TopDUContext* top = dynamic_cast<TopDUContext*>(this->contextFromNode(node));
 
+    //Groups the changes of the whole build to the uses index, they are applied whenever the write lock is released
+    IndexUpdateBatch batch;
+
     if (top) {
       DUChainWriteLocker lock(DUChain::lock());
       top->clearUsedDeclarationIndices();
@@ -22,10 +22,15 @@
 #include <debug.h>
 #include <serialization/itemrepository.h>
 #include "identifier.h"
+#include "indexupdatebatch.h"
 #include <serialization/indexedstring.h>
 #include <serialization/referencecounting.h>
 #include <util/embeddedfreetree.h>
 
+#include <QHash>
+
+#include <algorithm>
+
 #define ifDebug(x)
 
 namespace KDevelop {
@@ -165,6 +170,11 @@ CodeModel::~CodeModel() = default;
 
 void CodeModel::addItem(const IndexedString& file, const IndexedQualifiedIdentifier& id, CodeModelItem::Kind kind)
 {
+  if(IndexUpdateBatch* batch = IndexUpdateBatch::current()) {
+    batch->addCodeModelItem(file, id, kind);
+    return;
+  }
+
   ifDebug( qCDebug(LANGUAGE) << "addItem" << file.str() << id.identifier().toString() << id.index; )
 
   if(!id.isValid())
@@ -229,6 +239,11 @@ void CodeModel::addItem(const IndexedString& file, const IndexedQualifiedIdentif
 
 void CodeModel::updateItem(const IndexedString& file, const IndexedQualifiedIdentifier& id, CodeModelItem::Kind kind)
 {
+  if(IndexUpdateBatch* batch = IndexUpdateBatch::current()) {
+    batch->updateCodeModelItem(file, id, kind);
+    return;
+  }
+
   ifDebug( qCDebug(LANGUAGE) << file.str() << id.identifier().toString() << kind; )
 
   if(!id.isValid())
@@ -268,6 +283,11 @@ void CodeModel::updateItem(const IndexedString& file, const IndexedQualifiedIden
 void CodeModel::removeItem(const IndexedString& file, const IndexedQualifiedIdentifier& id)
 //void CodeModel::removeDeclaration(const QualifiedIdentifier& id, const IndexedDeclaration& declaration)
 {
+  if(IndexUpdateBatch* batch = IndexUpdateBatch::current()) {
+    batch->removeCodeModelItem(file, id);
+    return;
+  }
+
   if(!id.isValid())
     return;
 
@@ -325,8 +345,138 @@ void CodeModel::removeItem(const IndexedString& file, const IndexedQualifiedIden
   }
 }
 
+void CodeModel::changeItems(const IndexedString& file, const QVector<ItemChange>& changes)
+{
+  CodeModelRepositoryItem item;
+  item.file = file;
+  CodeModelRequestItem request(item);
+
+  QMutexLocker lock(d->m_repository.mutex());
+
+  uint index = d->m_repository.findIndex(item);
+  const CodeModelRepositoryItem* oldItem = index ? d->m_repository.itemFromIndex(index) : nullptr;
+
+  //The new state of each changed identifier, and its position in the old list, or -1
+  struct ChangedItem {
+    int listIndex;
+    bool exists;
+    CodeModelItem data;
+  };
+  QHash<IndexedQualifiedIdentifier, ChangedItem> changedItems;
+
+  bool changed = false;
+  for(const ItemChange& change : changes) {
+    if(!change.id.isValid())
+      continue;
+
+    auto it = changedItems.find(change.id);
+    if(it == changedItems.end()) {
+      ChangedItem changedItem;
+      changedItem.data.id = change.id;
+      changedItem.listIndex = -1;
+      if(oldItem) {
+        EmbeddedTreeAlgorithms<CodeModelItem, CodeModelItemHandler> alg(oldItem->items(), oldItem->itemsSize(), oldItem->centralFreeItem);
+        changedItem.listIndex = alg.indexOf(changedItem.data);
+      }
+      changedItem.exists = changedItem.listIndex != -1;
+      if(changedItem.exists)
+        changedItem.data = oldItem->items()[changedItem.listIndex];
+      it = changedItems.insert(change.id, changedItem);
+    }
+
+    switch(change.type) {
+      case ItemChange::Add:
+        if(it->exists) {
+          ++it->data.referenceCount;
+        }else{
+          it->data.referenceCount = 1;
+          it->exists = true;
+        }
+        it->data.kind = change.kind;
+        changed = true;
+        break;
+      case ItemChange::Update:
+        Q_ASSERT(it->exists); //The updated item as not in the symbol table!
+        if(it->exists) {
+          it->data.kind = change.kind;
+          changed = true;
+        }
+        break;
+      case ItemChange::Remove:
+        if(it->exists) {
+          if(--it->data.referenceCount == 0)
+            it->exists = false;
+          changed = true;
+        }
+        break;
+    }
+  }
+
+  if(!changed)
+    return;
+
+  bool identifiersChanged = false;
+  for(const ChangedItem& changedItem : changedItems)
+    identifiersChanged |= changedItem.exists != (changedItem.listIndex != -1);
+
+  if(!identifiersChanged) {
+    //Only reference-counts and kinds changed, which is done in place
+    if(index) {
+      DynamicItem<CodeModelRepositoryItem, true> editableItem = d->m_repository.dynamicItemFromIndex(index);
+      CodeModelItem* items = const_cast<CodeModelItem*>(editableItem->items());
+      for(const ChangedItem& changedItem : changedItems) {
+        if(changedItem.listIndex != -1)
+          items[changedItem.listIndex] = changedItem.data;
+      }
+    }
+    return;
+  }
+
+  //Apply the changes to a copy of the old list, marking removed items as free, and merge the sorted new items into it
+  KDevVarLengthArray<CodeModelItem> oldItems;
+  KDevVarLengthArray<CodeModelItem> newItems;
+  if(oldItem)
+    oldItems.append(oldItem->items(), oldItem->itemsSize());
+  for(const ChangedItem& changedItem : changedItems) {
+    if(changedItem.listIndex != -1) {
+      if(changedItem.exists)
+        oldItems[changedItem.listIndex] = changedItem.data;
+      else
+        oldItems[changedItem.listIndex].id = IndexedQualifiedIdentifier();
+    }else if(changedItem.exists) {
+      newItems.append(changedItem.data);
+    }
+  }
+  std::sort(newItems.begin(), newItems.end());
+
+  if(index)
+    d->m_repository.deleteItem(index);
+
+  //A sorted list without free items is a valid embedded tree
+  auto& items(item.itemsList());
+  items.reserve(oldItems.size() + newItems.size());
+  const CodeModelItem* newIt = newItems.constBegin();
+  for(const CodeModelItem& data : oldItems) {
+    if(CodeModelItemHandler::isFree(data))
+      continue;
+    for(; newIt != newItems.constEnd() && *newIt < data; ++newIt)
+      items.append(*newIt);
+    items.append(data);
+  }
+  for(; newIt != newItems.constEnd(); ++newIt)
+    items.append(*newIt);
+
+  if(items.isEmpty())
+    return;
+
+  //This inserts the changed item
+  d->m_repository.index(request);
+}
+
 void CodeModel::items(const IndexedString& file, uint& count, const CodeModelItem*& items) const
 {
+  IndexUpdateBatch::applyCurrent();
+
   ifDebug( qCDebug(LANGUAGE) << "items" << file.str(); )
 
   CodeModelRepositoryItem item;
@@ -22,6 +22,7 @@
 #include "identifier.h"
 
 #include <QScopedPointer>
+#include <QVector>
 
 namespace KDevelop {
 
@@ -82,6 +83,26 @@ namespace KDevelop {
      */
     void updateItem(const IndexedString& file, const IndexedQualifiedIdentifier& id, CodeModelItem::Kind kind);
 
+    /// One call to addItem(), updateItem() or removeItem(), for changeItems()
+    struct ItemChange
+    {
+      enum Type {
+        Add,
+        Update,
+        Remove
+      };
+      Type type;
+      IndexedQualifiedIdentifier id;
+      CodeModelItem::Kind kind;
+    };
+
+    /**
+     * Applies several changes to the items of one file at once, in the given order.
+     * The list of the file is rewritten at most once, and not at all if only reference-counts and kinds change.
+     * @see IndexUpdateBatch
+     */
+    void changeItems(const IndexedString& file, const QVector<ItemChange>& changes);
+
     /**
      * Retrieves all the global identifiers for a file-name in an efficient way.
      *
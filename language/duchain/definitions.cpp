@@ -22,6 +22,8 @@
 #include "declaration.h"
 #include "declarationid.h"
 #include "duchainpointer.h"
+#include "indexupdatebatch.h"
+#include "indexupdatebatch_p.h"
 #include <serialization/indexedstring.h>
 #include "serialization/itemrepository.h"
 
@@ -148,6 +150,11 @@ Definitions::~Definitions() = default;
 
 void Definitions::addDefinition(const DeclarationId& id, const IndexedDeclaration& definition)
 {
+  if(IndexUpdateBatch* batch = IndexUpdateBatch::current()) {
+    batch->addDefinition(id, definition);
+    return;
+  }
+
   DefinitionsItem item;
   item.declaration = id;
   item.definitionsList().append(definition);
@@ -173,6 +180,11 @@ void Definitions::addDefinition(const DeclarationId& id, const IndexedDeclaratio
 
 void Definitions::removeDefinition(const DeclarationId& id, const IndexedDeclaration& definition)
 {
+  if(IndexUpdateBatch* batch = IndexUpdateBatch::current()) {
+    batch->removeDefinition(id, definition);
+    return;
+  }
+
   DefinitionsItem item;
   item.declaration = id;
   DefinitionsRequestItem request(item);
@@ -195,8 +207,32 @@ void Definitions::removeDefinition(const DeclarationId& id, const IndexedDeclara
   }
 }
 
+void Definitions::changeDefinitions(const DeclarationId& id, const KDevVarLengthArray<IndexedDeclaration>& added, const KDevVarLengthArray<IndexedDeclaration>& removed)
+{
+  QMutexLocker lock(d->m_definitions.mutex());
+
+  DefinitionsItem item;
+  item.declaration = id;
+  DefinitionsRequestItem request(item);
+
+  uint index = d->m_definitions.findIndex(item);
+  const DefinitionsItem* oldItem = index ? d->m_definitions.itemFromIndex(index) : nullptr;
+
+  if(!mergeSetChanges(oldItem ? oldItem->definitions() : nullptr, oldItem ? oldItem->definitionsSize() : 0, added, removed, item.definitionsList()))
+    return;
+
+  if(index)
+    d->m_definitions.deleteItem(index);
+
+  //This inserts the changed item
+  if(item.definitionsSize() != 0)
+    d->m_definitions.index(request);
+}
+
 KDevVarLengthArray<IndexedDeclaration> Definitions::definitions(const DeclarationId& id) const
 {
+  IndexUpdateBatch::applyCurrent();
+
   KDevVarLengthArray<IndexedDeclaration> ret;
 
   DefinitionsItem item;
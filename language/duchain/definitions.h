@@ -49,6 +49,13 @@ namespace KDevelop {
     void addDefinition(const DeclarationId& id, const IndexedDeclaration& definition);
 
     void removeDefinition(const DeclarationId& id, const IndexedDeclaration& definition);
+
+    /**
+     * Adds and removes several definitions of the given id at once, rewriting the list only once.
+     * @p added and @p removed must not overlap. @see IndexUpdateBatch
+     * */
+    void changeDefinitions(const DeclarationId& id, const KDevVarLengthArray<IndexedDeclaration>& added,
+                           const KDevVarLengthArray<IndexedDeclaration>& removed);
     
     ///Gets all the known definitions assigned to @p id
     KDevVarLengthArray<IndexedDeclaration> definitions(const DeclarationId& id) const;
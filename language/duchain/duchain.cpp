@@ -336,6 +336,8 @@ public:
         f.read((char*)m_availableTopContextIndices.data(), f.size());
       }
     }
+
+    PersistentSymbolTable::self().loadCache();
   }
   ~DUChainPrivate() {
     qCDebug(LANGUAGE) << "Destroying";
@@ -732,6 +734,10 @@ public:
 
     QTime startTime = QTime::currentTime();
     PersistentSymbolTable::self().clearCache();
+    //Only the last step stores the symbol table cache. It is written once the duchain is unlocked
+    QByteArray symbolTableCache;
+    if(!retries)
+      symbolTableCache = PersistentSymbolTable::self().serializeCache();
 
     storeAllInformation(!retries, writeLock); //Puts environment-information into a repository
 
@@ -854,9 +860,6 @@ public:
       if(retries)
         writeLock.unlock();
 
-      //This must be the last step, due to the on-disk reference counting
-      globalItemRepositoryRegistry().store(); //Stores all repositories
-
       {
         //Store the static parsing-environment file data
         ///@todo Solve this more elegantly, using a general mechanism to store static duchain-like data
@@ -880,6 +883,12 @@ public:
         f.write((char*)m_availableTopContextIndices.data(), m_availableTopContextIndices.size() * sizeof(uint));
       }
 
+      //This must be the last step, due to the on-disk reference counting.
+      //Once the repositories have committed their journals, a crash is recovered from them, so everything
+      //this cleanup writes into the repository directory has to be written before. The symbol table cache is
+      //the exception, since its entries are validated against the repositories when it is loaded.
+      globalItemRepositoryRegistry().store(); //Stores all repositories
+
 
       if(retries) {
         doMoreCleanup(retries-1, NoLock);
@@ -900,6 +909,11 @@ public:
       foreach(QReadWriteLock* lock, locked)
         lock->unlock();
 
+      if(!retries) {
+        writeLock.unlock();
+        PersistentSymbolTable::writeCache(symbolTableCache);
+      }
+
 #if HAVE_MALLOC_TRIM
     // trim unused memory but keep a pad buffer of about 50 MB
     // this can greatly decrease the perceived memory consumption of kdevelop
@@ -27,6 +27,8 @@
 #include <serialization/indexedstring.h>
 #include "topducontext.h"
 #include "duchainregister.h"
+#include "declaration.h"
+#include "ducontextdynamicdata.h"
 #include <util/foregroundlock.h>
 #include <interfaces/icore.h>
 #include <interfaces/ilanguagecontroller.h>
@@ -226,6 +228,18 @@ KTextEditor::Cursor DUChainBase::transformFromLocalRevision(const KDevelop::Curs
 void DUChainBase::setRange(const RangeInRevision& range)
 {
     d_func_dynamic()->m_range = range;
+    invalidateRangeIndexOfParent();
+}
+
+void DUChainBase::invalidateRangeIndexOfParent()
+{
+    if (Declaration* declaration = dynamic_cast<Declaration*>(this)) {
+        if (DUContext* context = declaration->context())
+            context->m_dynamicData->invalidateLocalDeclarationIndex();
+    } else if (DUContext* context = dynamic_cast<DUContext*>(this)) {
+        if (DUContext* parent = context->parentContext())
+            parent->m_dynamicData->invalidateChildContextIndex();
+    }
 }
 
 QThreadStorage<bool> shouldCreateConstantDataStorage;
@@ -208,7 +208,9 @@ protected:
   /// Data pointer that is shared across all the inheritance hierarchy
   DUChainBaseData* d_ptr;
 private:
-  
+  ///Contexts look up their child contexts and local declarations by range, so the context of a changed one has to re-index them
+  void invalidateRangeIndexOfParent();
+
   mutable QExplicitlySharedDataPointer<DUChainPointerData> m_ptr;
 public:
   DUCHAIN_DECLARE_DATA(DUChainBase)
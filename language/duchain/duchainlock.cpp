@@ -21,17 +21,18 @@
 
 #include "duchainlock.h"
 #include "duchain.h"
+#include "duchainlockstatistics.h"
+#include "indexupdatebatch.h"
 
+#include <util/foregroundlock.h>
+
+#include <QMutex>
 #include <QThread>
 #include <QThreadStorage>
+#include <QWaitCondition>
 #include <QElapsedTimer>
 
-
-///@todo Always prefer exactly that lock that is requested by the thread that has the foreground mutex,
-///           to reduce the amount of UI blocking.
-
-//Microseconds to sleep when waiting for a lock
-const uint uSleepTime = 500;
+#include <climits>
 
 namespace KDevelop
 {
@@ -43,6 +44,9 @@ public:
     : m_writer(nullptr)
     , m_writerRecursion(0)
     , m_totalReaderRecursion(0)
+    , m_waitingWriters(0)
+    , m_waitingForeground(0)
+    , m_waiters(0)
   { }
 
   int ownReaderRecursion() const
@@ -50,11 +54,118 @@ public:
     return m_readerRecursion.localData();
   }
 
-  void changeOwnReaderRecursion(int difference)
+  ///@returns the total reader recursion after the change
+  int changeOwnReaderRecursion(int difference)
   {
     m_readerRecursion.localData() += difference;
     Q_ASSERT(m_readerRecursion.localData() >= 0);
-    m_totalReaderRecursion.fetchAndAddOrdered(difference);
+    return m_totalReaderRecursion.fetchAndAddOrdered(difference) + difference;
+  }
+
+  ///Tries to acquire the write-lock once, without waiting
+  ///@param waitMutexLocked Whether the current thread holds m_waitMutex
+  bool tryLockForWrite(bool waitMutexLocked)
+  {
+    if (m_totalReaderRecursion.load() == 0 && m_writerRecursion.testAndSetOrdered(0, 1)) {
+      //Now we can be sure that there is no other writer, as we have increased m_writerRecursion from 0 to 1
+      m_writer.storeRelease(QThread::currentThread());
+      if (m_totalReaderRecursion.load() == 0) {
+        //There is still no readers, we have successfully acquired a write-lock
+        return true;
+      } else {
+        //There may be readers.. back off, and wake up readers that saw us as writer
+        releaseWriter(waitMutexLocked);
+      }
+    }
+    return false;
+  }
+
+  void releaseWriter(bool waitMutexLocked = false)
+  {
+    //The order is important here, m_writerRecursion protects m_writer
+    m_writer.fetchAndStoreOrdered(nullptr);
+    m_writerRecursion.fetchAndStoreOrdered(0);
+    wakeWaiters(waitMutexLocked);
+  }
+
+  ///Whether the current thread may enter as a reader. Writers waiting for the lock are preferred,
+  ///unless the current thread holds the foreground lock, so the UI never waits behind background threads.
+  ///@param recursive Whether the current thread already holds a read-lock. Such a reader only waits for
+  ///                 the current writer, waiting writers can't get the lock before it is released anyway.
+  bool mayEnterAsReader(bool foreground, bool recursive) const
+  {
+    return m_writer.loadAcquire() == nullptr && (recursive || foreground || m_waitingWriters.loadAcquire() == 0);
+  }
+
+  ///Whether the current thread may try to acquire the write-lock. Foreground waiters are preferred.
+  bool mayTryAsWriter(bool foreground) const
+  {
+    return foreground || m_waitingForeground.loadAcquire() == 0;
+  }
+
+  ///Wakes up all waiting threads, so they re-check whether they can get the lock.
+  ///Must be called after every state change that may allow a waiting thread to proceed.
+  ///@param waitMutexLocked Whether the current thread holds m_waitMutex
+  void wakeWaiters(bool waitMutexLocked = false)
+  {
+    if (waitMutexLocked) {
+      m_waitCondition.wakeAll();
+      return;
+    }
+    //Pairs with the increment of m_waiters in wait(), either we see the waiter, or it sees our state change
+    if (m_waiters.loadAcquire()) {
+      QMutexLocker lock(&m_waitMutex);
+      m_waitCondition.wakeAll();
+    }
+  }
+
+  ///Blocks until @p acquire returns true, or the timeout is reached. @p acquire is called with m_waitMutex locked.
+  ///@param timeout Timeout in milliseconds, or zero to wait forever
+  template<typename Acquire>
+  bool wait(unsigned int timeout, bool foreground, bool writer, const Acquire& acquire)
+  {
+    QElapsedTimer t;
+    if (timeout) {
+      t.start();
+    }
+
+    m_waiters.fetchAndAddOrdered(1);
+    if (writer) {
+      m_waitingWriters.fetchAndAddOrdered(1);
+    }
+    if (foreground) {
+      m_waitingForeground.fetchAndAddOrdered(1);
+    }
+
+    bool success = false;
+    {
+      QMutexLocker lock(&m_waitMutex);
+      while (!(success = acquire())) {
+        unsigned long remaining = ULONG_MAX;
+        if (timeout) {
+          const qint64 elapsed = t.elapsed();
+          if (elapsed >= timeout) {
+            break;
+          }
+          remaining = timeout - elapsed;
+        }
+        m_waitCondition.wait(&m_waitMutex, remaining);
+      }
+    }
+
+    if (foreground) {
+      m_waitingForeground.fetchAndAddOrdered(-1);
+    }
+    if (writer) {
+      m_waitingWriters.fetchAndAddOrdered(-1);
+    }
+    m_waiters.fetchAndAddOrdered(-1);
+
+    //Threads that backed off in favor of us may proceed now
+    if (writer || foreground) {
+      wakeWaiters();
+    }
+    return success;
   }
 
   ///Holds the writer that currently has the write-lock, or zero. Is protected by m_writerRecursion.
@@ -67,6 +178,16 @@ public:
   QAtomicInt m_totalReaderRecursion;
 
   QThreadStorage<int> m_readerRecursion;
+
+  ///Count of threads waiting for the write-lock
+  QAtomicInt m_waitingWriters;
+  ///Count of threads holding the foreground lock that wait for the read- or write-lock
+  QAtomicInt m_waitingForeground;
+  ///Count of all waiting threads
+  QAtomicInt m_waiters;
+
+  QMutex m_waitMutex;
+  QWaitCondition m_waitCondition;
 };
 
 DUChainLock::DUChainLock()
@@ -79,36 +200,48 @@ DUChainLock::~DUChainLock() = default;
 bool DUChainLock::lockForRead(unsigned int timeout)
 {
   ///Step 1: Increase the own reader-recursion. This will make sure no further write-locks will succeed
+  const bool recursive = d->ownReaderRecursion() > 0;
   d->changeOwnReaderRecursion(1);
 
   QThread* w = d->m_writer.loadAcquire();
-  if (w == nullptr || w == QThread::currentThread()) {
-    //Successful lock: Either there is no writer, or we hold the write-lock by ourselves
-  } else {
-    ///Step 2: Start spinning until there is no writer any more
+  if (w == QThread::currentThread() || (w == nullptr && (recursive || d->m_waitingWriters.loadAcquire() == 0))) {
+    //Successful lock: Either there is no writer, or we hold the write-lock by ourselves.
+    //Recursive read-locks never wait for writers, as that would deadlock.
+    return true;
+  }
 
-    QElapsedTimer t;
-    if (timeout) {
-      t.start();
-    }
+  const bool foreground = ForegroundLock::isLockedForThread();
+  if (w == nullptr && foreground) {
+    //The foreground thread is not held back by waiting writers
+    return true;
+  }
 
-    while (d->m_writer.loadAcquire()) {
-      if (!timeout || t.elapsed() < timeout) {
-        QThread::usleep(uSleepTime);
-      } else {
-        //Fail!
-        d->changeOwnReaderRecursion(-1);
-        return false;
-      }
-    }
+  ///Step 2: Back off, so waiting writers can proceed, and block until we may enter
+  if (d->changeOwnReaderRecursion(-1) == 0) {
+    d->wakeWaiters();
   }
 
-  return true;
+  return d->wait(timeout, foreground, false, [&]() {
+    if (!d->mayEnterAsReader(foreground, recursive)) {
+      return false;
+    }
+    d->changeOwnReaderRecursion(1);
+    if (d->m_writer.loadAcquire() == nullptr) {
+      return true;
+    }
+    //A writer got the lock in between
+    if (d->changeOwnReaderRecursion(-1) == 0) {
+      d->wakeWaiters(true);
+    }
+    return false;
+  });
 }
 
 void DUChainLock::releaseReadLock()
 {
-  d->changeOwnReaderRecursion(-1);
+  if (d->changeOwnReaderRecursion(-1) == 0) {
+    d->wakeWaiters();
+  }
 }
 
 bool DUChainLock::currentThreadHasReadLock()
@@ -128,35 +261,14 @@ bool DUChainLock::lockForWrite(uint timeout)
     return true;
   }
 
-  QElapsedTimer t;
-  if (timeout) {
-    t.start();
-  }
-
-  while (1) {
-    //Try acquiring the write-lcok
-    if (d->m_totalReaderRecursion.load() == 0 && d->m_writerRecursion.testAndSetOrdered(0, 1)) {
-      //Now we can be sure that there is no other writer, as we have increased m_writerRecursion from 0 to 1
-      d->m_writer = QThread::currentThread();
-      if (d->m_totalReaderRecursion.load() == 0) {
-        //There is still no readers, we have successfully acquired a write-lock
-        return true;
-      } else {
-        //There may be readers.. we have to continue spinning
-        d->m_writer = nullptr;
-        d->m_writerRecursion = 0;
-      }
-    }
-
-    if (!timeout || t.elapsed() < timeout) {
-      QThread::usleep(uSleepTime);
-    } else {
-      //Fail!
-      return false;
-    }
+  const bool foreground = ForegroundLock::isLockedForThread();
+  if (d->mayTryAsWriter(foreground) && d->tryLockForWrite(false)) {
+    return true;
   }
 
-  return false;
+  return d->wait(timeout, foreground, true, [&]() {
+    return d->mayTryAsWriter(foreground) && d->tryLockForWrite(true);
+  });
 }
 
 void DUChainLock::releaseWriteLock()
@@ -167,8 +279,10 @@ void DUChainLock::releaseWriteLock()
 
   //TODO: could testAndSet here
   if (d->m_writerRecursion.load() == 1) {
-    d->m_writer = nullptr;
-    d->m_writerRecursion = 0;
+    //Other threads must not see the global indices while changes of an IndexUpdateBatch are pending
+    if (this == DUChain::lock())
+      IndexUpdateBatch::applyCurrent();
+    d->releaseWriter();
   } else {
     d->m_writerRecursion.fetchAndAddOrdered(-1);
   }
@@ -179,10 +293,21 @@ bool DUChainLock::currentThreadHasWriteLock()
   return d->m_writer.load() == QThread::currentThread();
 }
 
+#ifdef KDEV_DUCHAIN_LOCK_STATISTICS
+DUChainReadLocker::DUChainReadLocker(DUChainLock* duChainLock, uint timeout, const char* file, int line)
+  : m_lock(duChainLock ? duChainLock : DUChain::lock())
+  , m_locked(false)
+  , m_timeout(timeout)
+  , m_file(file)
+  , m_line(line)
+  , m_waitTime(0)
+  , m_lockedAt(0)
+#else
 DUChainReadLocker::DUChainReadLocker(DUChainLock* duChainLock, uint timeout)
   : m_lock(duChainLock ? duChainLock : DUChain::lock())
   , m_locked(false)
   , m_timeout(timeout)
+#endif
 {
   lock();
 }
@@ -205,7 +330,22 @@ bool DUChainReadLocker::lock()
 
   bool l = false;
   if (m_lock) {
+#ifdef KDEV_DUCHAIN_LOCK_STATISTICS
+    if (DUChainLockStatistics::isEnabled()) {
+      const qint64 start = DUChainLockStatistics::timestamp();
+      l = m_lock->lockForRead(m_timeout);
+      m_lockedAt = DUChainLockStatistics::timestamp();
+      m_waitTime = m_lockedAt - start;
+      if (!l) {
+        DUChainLockStatistics::record(m_file, m_line, DUChainLockStatistics::ReadLock, m_waitTime, -1);
+        m_lockedAt = 0;
+      }
+    } else {
+      l = m_lock->lockForRead(m_timeout);
+    }
+#else
     l = m_lock->lockForRead(m_timeout);
+#endif
     Q_ASSERT(m_timeout || l);
   };
 
@@ -219,13 +359,31 @@ void DUChainReadLocker::unlock()
   if (m_locked && m_lock) {
     m_lock->releaseReadLock();
     m_locked = false;
+#ifdef KDEV_DUCHAIN_LOCK_STATISTICS
+    if (m_lockedAt) {
+      DUChainLockStatistics::record(m_file, m_line, DUChainLockStatistics::ReadLock,
+                                    m_waitTime, DUChainLockStatistics::timestamp() - m_lockedAt);
+      m_lockedAt = 0;
+    }
+#endif
   }
 }
 
+#ifdef KDEV_DUCHAIN_LOCK_STATISTICS
+DUChainWriteLocker::DUChainWriteLocker(DUChainLock* duChainLock, uint timeout, const char* file, int line)
+  : m_lock(duChainLock ? duChainLock : DUChain::lock())
+  , m_locked(false)
+  , m_timeout(timeout)
+  , m_file(file)
+  , m_line(line)
+  , m_waitTime(0)
+  , m_lockedAt(0)
+#else
 DUChainWriteLocker::DUChainWriteLocker(DUChainLock* duChainLock, uint timeout)
   : m_lock(duChainLock ? duChainLock : DUChain::lock())
   , m_locked(false)
   , m_timeout(timeout)
+#endif
 {
   lock();
 }
@@ -243,7 +401,22 @@ bool DUChainWriteLocker::lock()
 
   bool l = false;
   if (m_lock) {
+#ifdef KDEV_DUCHAIN_LOCK_STATISTICS
+    if (DUChainLockStatistics::isEnabled()) {
+      const qint64 start = DUChainLockStatistics::timestamp();
+      l = m_lock->lockForWrite(m_timeout);
+      m_lockedAt = DUChainLockStatistics::timestamp();
+      m_waitTime = m_lockedAt - start;
+      if (!l) {
+        DUChainLockStatistics::record(m_file, m_line, DUChainLockStatistics::WriteLock, m_waitTime, -1);
+        m_lockedAt = 0;
+      }
+    } else {
+      l = m_lock->lockForWrite(m_timeout);
+    }
+#else
     l = m_lock->lockForWrite(m_timeout);
+#endif
     Q_ASSERT(m_timeout || l);
   };
 
@@ -262,6 +435,13 @@ void DUChainWriteLocker::unlock()
   if (m_locked && m_lock) {
     m_lock->releaseWriteLock();
     m_locked = false;
+#ifdef KDEV_DUCHAIN_LOCK_STATISTICS
+    if (m_lockedAt) {
+      DUChainLockStatistics::record(m_file, m_line, DUChainLockStatistics::WriteLock,
+                                    m_waitTime, DUChainLockStatistics::timestamp() - m_lockedAt);
+      m_lockedAt = 0;
+    }
+#endif
   }
 }
 
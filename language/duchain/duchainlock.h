@@ -44,6 +44,31 @@ namespace KDevelop
 #define ENSURE_CHAIN_NOT_LOCKED
 #endif
 
+/**
+ * The call site that is recorded by DUChainReadLocker and DUChainWriteLocker for DUChainLockStatistics.
+ *
+ * Only available when KDevPlatform is built with the KDEV_DUCHAIN_LOCK_STATISTICS option, which adds
+ * the call site to the constructors of the lockers and so changes their ABI.
+ * These expand to compiler builtins that are evaluated at the call site when used as default arguments,
+ * so every locker is attributed to the place it was constructed at, without changing the callers.
+ * Code that wraps a locker can take the same default arguments and forward them.
+ */
+#ifdef KDEV_DUCHAIN_LOCK_STATISTICS
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 8))
+#  define KDEV_DUCHAIN_LOCK_CALLER_FILE __builtin_FILE()
+#  define KDEV_DUCHAIN_LOCK_CALLER_LINE __builtin_LINE()
+#elif defined(__has_builtin)
+#  if __has_builtin(__builtin_FILE) && __has_builtin(__builtin_LINE)
+#    define KDEV_DUCHAIN_LOCK_CALLER_FILE __builtin_FILE()
+#    define KDEV_DUCHAIN_LOCK_CALLER_LINE __builtin_LINE()
+#  endif
+#endif
+#ifndef KDEV_DUCHAIN_LOCK_CALLER_FILE
+#  define KDEV_DUCHAIN_LOCK_CALLER_FILE nullptr
+#  define KDEV_DUCHAIN_LOCK_CALLER_LINE 0
+#endif
+#endif
+
 /**
  * Customized read/write locker for the definition-use chain.
  */
@@ -116,7 +141,13 @@ public:
    * \param duChainLock lock to read-acquire. If this is left zero, DUChain::lock() is used.
    * \param timeout Timeout in milliseconds. If this is not zero, you've got to check locked() to see whether the lock succeeded.
    */
+#ifdef KDEV_DUCHAIN_LOCK_STATISTICS
+  ///\param file, line The call site, recorded by DUChainLockStatistics. Leave them at their defaults.
+  explicit DUChainReadLocker(DUChainLock* duChainLock = nullptr, unsigned int timeout = 0,
+                             const char* file = KDEV_DUCHAIN_LOCK_CALLER_FILE, int line = KDEV_DUCHAIN_LOCK_CALLER_LINE);
+#else
   explicit DUChainReadLocker(DUChainLock* duChainLock = nullptr, unsigned int timeout = 0);
+#endif
 
   /// Destructor.
   ~DUChainReadLocker();
@@ -134,6 +165,13 @@ private:
   DUChainLock* m_lock;
   bool m_locked;
   unsigned int m_timeout;
+#ifdef KDEV_DUCHAIN_LOCK_STATISTICS
+  const char* m_file;
+  int m_line;
+  ///Only used while DUChainLockStatistics is enabled, m_lockedAt is zero otherwise
+  qint64 m_waitTime;
+  qint64 m_lockedAt;
+#endif
 };
 
 /**
@@ -148,7 +186,13 @@ public:
    * \param duChainLock lock to write-acquire. If this is left zero, DUChain::lock() is used.
    * \param timeout Timeout in milliseconds. If this is not zero, you've got to check locked() to see whether the lock succeeded.
    */
+#ifdef KDEV_DUCHAIN_LOCK_STATISTICS
+  ///\param file, line The call site, recorded by DUChainLockStatistics. Leave them at their defaults.
+  explicit DUChainWriteLocker(DUChainLock* duChainLock = nullptr, unsigned int timeout = 0,
+                              const char* file = KDEV_DUCHAIN_LOCK_CALLER_FILE, int line = KDEV_DUCHAIN_LOCK_CALLER_LINE);
+#else
   explicit DUChainWriteLocker(DUChainLock* duChainLock = nullptr, unsigned int timeout = 0);
+#endif
   /// Destructor.
   ~DUChainWriteLocker();
 
@@ -165,6 +209,13 @@ private:
   DUChainLock* m_lock;
   bool m_locked;
   unsigned int m_timeout;
+#ifdef KDEV_DUCHAIN_LOCK_STATISTICS
+  const char* m_file;
+  int m_line;
+  ///Only used while DUChainLockStatistics is enabled, m_lockedAt is zero otherwise
+  qint64 m_waitTime;
+  qint64 m_lockedAt;
+#endif
 };
 
 /**
@@ -0,0 +1,463 @@
+/*
+   This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "duchainlockstatistics.h"
+
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QThread>
+#include <QThreadStorage>
+#include <QVector>
+
+#include <algorithm>
+
+using namespace KDevelop;
+using namespace KDevelop::DUChainLockStatistics;
+
+namespace {
+
+///Bucket 0 counts durations below 1us, bucket n counts durations in [2^(n-1), 2^n) us. The last bucket is open.
+const int HistogramBuckets = 32;
+///Count of distinct call sites that can be recorded per thread, further ones go into an overflow entry.
+const int SitesPerThread = 512;
+const int MaxProbes = 16;
+
+int bucketForDuration(qint64 nsecs)
+{
+  quint64 usecs = nsecs / 1000;
+  int bucket = 0;
+  while (usecs && bucket < HistogramBuckets - 1) {
+    usecs >>= 1;
+    ++bucket;
+  }
+  return bucket;
+}
+
+qint64 bucketUpperBound(int bucket)
+{
+  return qint64(1) << bucket;
+}
+
+///Only the owning thread writes the counters, so a relaxed load and store is enough to count.
+///Other threads read them without locking and may see a slightly stale state.
+template<class T>
+void add(QAtomicInteger<T>& counter, T value)
+{
+  counter.store(counter.load() + value);
+}
+
+struct Histogram
+{
+  QAtomicInteger<quint32> buckets[HistogramBuckets];
+  QAtomicInteger<quint64> count;
+  QAtomicInteger<quint64> total;
+  QAtomicInteger<quint64> max;
+
+  void record(qint64 nsecs)
+  {
+    add<quint32>(buckets[bucketForDuration(nsecs)], 1);
+    add<quint64>(count, 1);
+    add<quint64>(total, nsecs);
+    if (quint64(nsecs) > max.load())
+      max.store(nsecs);
+  }
+
+  void reset()
+  {
+    for (int a = 0; a < HistogramBuckets; ++a)
+      buckets[a].store(0);
+    count.store(0);
+    total.store(0);
+    max.store(0);
+  }
+};
+
+struct Site
+{
+  ///Set with release semantics once file, line and type are filled, so readers in other threads can skip free entries
+  QAtomicInt used;
+  const char* file = nullptr;
+  int line = 0;
+  LockType type = ReadLock;
+  Histogram wait;
+  Histogram hold;
+  QAtomicInteger<quint32> timeouts;
+};
+
+///Owned by the thread it belongs to, and deleted when that thread finishes
+struct ThreadData
+{
+  ~ThreadData();
+
+  quintptr threadId = 0;
+  QString threadName;
+  Site sites[SitesPerThread];
+  ///Collects the call sites that did not fit into the table
+  Site overflow;
+
+  Site& site(const char* file, int line, LockType type)
+  {
+    const uint hash = ((uint(quintptr(file) >> 3) * 31u + uint(line)) << 1) + type;
+    for (int probe = 0; probe < MaxProbes; ++probe) {
+      Site& site = sites[(hash + probe) % SitesPerThread];
+      if (!site.used.load()) {
+        site.file = file;
+        site.line = line;
+        site.type = type;
+        site.used.storeRelease(1);
+        return site;
+      }
+      if (site.file == file && site.line == line && site.type == type)
+        return site;
+    }
+    overflow.type = type;
+    overflow.used.storeRelease(1);
+    return overflow;
+  }
+};
+
+QString typeName(LockType type)
+{
+  return type == WriteLock ? QStringLiteral("write") : QStringLiteral("read");
+}
+
+///A plain copy of a Histogram, which can also sum up the histograms of several threads
+struct HistogramSnapshot
+{
+  quint64 buckets[HistogramBuckets] = {};
+  quint64 count = 0;
+  quint64 total = 0;
+  quint64 max = 0;
+
+  void merge(const Histogram& histogram)
+  {
+    for (int a = 0; a < HistogramBuckets; ++a)
+      buckets[a] += histogram.buckets[a].load();
+    count += histogram.count.load();
+    total += histogram.total.load();
+    max = qMax<quint64>(max, histogram.max.load());
+  }
+
+  void merge(const HistogramSnapshot& other)
+  {
+    for (int a = 0; a < HistogramBuckets; ++a)
+      buckets[a] += other.buckets[a];
+    count += other.count;
+    total += other.total;
+    max = qMax(max, other.max);
+  }
+
+  ///Returns the upper bound in microseconds of the bucket that contains the given quantile
+  qint64 quantileUpperBound(double quantile) const
+  {
+    const quint64 target = qMax<quint64>(1, quint64(count * quantile));
+    quint64 seen = 0;
+    for (int a = 0; a < HistogramBuckets; ++a) {
+      seen += buckets[a];
+      if (seen >= target)
+        return bucketUpperBound(a);
+    }
+    return bucketUpperBound(HistogramBuckets - 1);
+  }
+
+  QJsonObject toJson() const
+  {
+    QJsonArray histogram;
+    for (int a = 0; a < HistogramBuckets; ++a)
+      histogram.append(double(buckets[a]));
+
+    QJsonObject ret;
+    ret.insert(QStringLiteral("count"), double(count));
+    ret.insert(QStringLiteral("totalNs"), double(total));
+    ret.insert(QStringLiteral("maxNs"), double(max));
+    ret.insert(QStringLiteral("histogram"), histogram);
+    return ret;
+  }
+};
+
+struct SiteSnapshot
+{
+  QString file;
+  int line = 0;
+  LockType type = ReadLock;
+  HistogramSnapshot wait;
+  HistogramSnapshot hold;
+  quint64 timeouts = 0;
+
+  void merge(const Site& site)
+  {
+    wait.merge(site.wait);
+    hold.merge(site.hold);
+    timeouts += site.timeouts.load();
+  }
+
+  void merge(const SiteSnapshot& other)
+  {
+    wait.merge(other.wait);
+    hold.merge(other.hold);
+    timeouts += other.timeouts;
+  }
+};
+
+///Returns the snapshots of the used sites of @p thread
+void mergeSite(QHash<QString, SiteSnapshot>* sites, const SiteSnapshot& site)
+{
+  const QString key = QStringLiteral("%1:%2:%3").arg(site.file).arg(site.line).arg(site.type);
+  auto it = sites->find(key);
+  if (it == sites->end())
+    sites->insert(key, site);
+  else
+    it->merge(site);
+}
+
+QVector<SiteSnapshot> snapshot(const ThreadData* thread)
+{
+  QVector<SiteSnapshot> ret;
+  auto addSite = [&ret](const Site& site, bool overflow) {
+    if (!site.used.loadAcquire())
+      return;
+    SiteSnapshot entry;
+    if (overflow)
+      entry.file = QStringLiteral("<overflow>");
+    else if (site.file)
+      entry.file = QString::fromUtf8(site.file);
+    else
+      entry.file = QStringLiteral("<unknown>");
+    entry.line = overflow ? 0 : site.line;
+    entry.type = site.type;
+    entry.merge(site);
+    ret.append(entry);
+  };
+
+  for (int a = 0; a < SitesPerThread; ++a)
+    addSite(thread->sites[a], false);
+  addSite(thread->overflow, true);
+  return ret;
+}
+
+struct Registry
+{
+  QMutex mutex;
+  ///The data of the running threads. It is only deleted while this mutex is locked.
+  QVector<ThreadData*> threads;
+  ///The merged samples of the threads that finished, by call site, so they stay in the dumps
+  QHash<QString, SiteSnapshot> finished;
+};
+
+Q_GLOBAL_STATIC(Registry, registry)
+
+struct MonotonicClock
+{
+  MonotonicClock()
+  {
+    timer.start();
+  }
+  QElapsedTimer timer;
+};
+
+Q_GLOBAL_STATIC(MonotonicClock, monotonicClock)
+
+#ifdef KDEV_DUCHAIN_LOCK_STATISTICS
+QAtomicInt enabled(qEnvironmentVariableIsSet("KDEV_DUCHAIN_LOCK_STATISTICS"));
+#else
+QAtomicInt enabled(0);
+#endif
+
+QThreadStorage<ThreadData*> currentThreadData;
+
+ThreadData* threadData()
+{
+  ThreadData*& data = currentThreadData.localData();
+  if (!data) {
+    data = new ThreadData;
+    data->threadId = quintptr(QThread::currentThreadId());
+    QThread* thread = QThread::currentThread();
+    data->threadName = thread->objectName().isEmpty() ? QString::fromLatin1(thread->metaObject()->className()) : thread->objectName();
+
+    QMutexLocker lock(&registry->mutex);
+    registry->threads.append(data);
+  }
+  return data;
+}
+
+ThreadData::~ThreadData()
+{
+  if (registry.isDestroyed())
+    return;
+
+  QMutexLocker lock(&registry->mutex);
+  registry->threads.removeOne(this);
+  foreach (const SiteSnapshot& site, snapshot(this))
+    mergeSite(&registry->finished, site);
+}
+
+QString milliseconds(quint64 nsecs)
+{
+  return QString::number(nsecs / 1000000.0, 'f', 2);
+}
+
+}
+
+namespace KDevelop
+{
+
+namespace DUChainLockStatistics
+{
+
+bool isAvailable()
+{
+#ifdef KDEV_DUCHAIN_LOCK_STATISTICS
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool isEnabled()
+{
+  return enabled.load();
+}
+
+void setEnabled(bool enable)
+{
+  enabled.store(enable && isAvailable());
+}
+
+void reset()
+{
+  QMutexLocker lock(&registry->mutex);
+  registry->finished.clear();
+  foreach (ThreadData* thread, registry->threads) {
+    for (int a = 0; a < SitesPerThread; ++a) {
+      Site& site = thread->sites[a];
+      site.wait.reset();
+      site.hold.reset();
+      site.timeouts.store(0);
+    }
+    thread->overflow.wait.reset();
+    thread->overflow.hold.reset();
+    thread->overflow.timeouts.store(0);
+  }
+}
+
+qint64 timestamp()
+{
+  return monotonicClock->timer.nsecsElapsed();
+}
+
+void record(const char* file, int line, LockType type, qint64 waitTime, qint64 holdTime)
+{
+  Site& site = threadData()->site(file, line, type);
+  site.wait.record(waitTime);
+  if (holdTime >= 0)
+    site.hold.record(holdTime);
+  else
+    add<quint32>(site.timeouts, 1);
+}
+
+QByteArray toJson()
+{
+  QJsonArray bounds;
+  for (int a = 0; a < HistogramBuckets - 1; ++a)
+    bounds.append(double(bucketUpperBound(a)));
+
+  auto sitesToJson = [](const QVector<SiteSnapshot>& snapshots) -> QJsonArray {
+    QJsonArray sites;
+    foreach (const SiteSnapshot& site, snapshots) {
+      QJsonObject object;
+      object.insert(QStringLiteral("file"), site.file);
+      object.insert(QStringLiteral("line"), site.line);
+      object.insert(QStringLiteral("type"), typeName(site.type));
+      object.insert(QStringLiteral("timeouts"), double(site.timeouts));
+      object.insert(QStringLiteral("wait"), site.wait.toJson());
+      object.insert(QStringLiteral("hold"), site.hold.toJson());
+      sites.append(object);
+    }
+    return sites;
+  };
+
+  QJsonArray threads;
+  QMutexLocker lock(&registry->mutex);
+  foreach (const ThreadData* thread, registry->threads) {
+    QJsonObject object;
+    object.insert(QStringLiteral("id"), QStringLiteral("0x%1").arg(thread->threadId, 0, 16));
+    object.insert(QStringLiteral("name"), thread->threadName);
+    object.insert(QStringLiteral("sites"), sitesToJson(snapshot(thread)));
+    threads.append(object);
+  }
+  if (!registry->finished.isEmpty()) {
+    QJsonObject object;
+    object.insert(QStringLiteral("name"), QStringLiteral("<finished threads>"));
+    object.insert(QStringLiteral("sites"), sitesToJson(registry->finished.values().toVector()));
+    threads.append(object);
+  }
+  lock.unlock();
+
+  QJsonObject root;
+  root.insert(QStringLiteral("enabled"), isEnabled());
+  //Upper bounds of all buckets but the last one, which is open
+  root.insert(QStringLiteral("bucketUpperBoundsUs"), bounds);
+  root.insert(QStringLiteral("threads"), threads);
+  return QJsonDocument(root).toJson();
+}
+
+QString toText(int maxSites)
+{
+  //Merge the sites of all threads
+  QMutexLocker lock(&registry->mutex);
+  const int threadCount = registry->threads.size();
+  QHash<QString, SiteSnapshot> merged = registry->finished;
+  foreach (const ThreadData* thread, registry->threads) {
+    foreach (const SiteSnapshot& site, snapshot(thread))
+      mergeSite(&merged, site);
+  }
+  lock.unlock();
+
+  QVector<SiteSnapshot> sites;
+  sites.reserve(merged.size());
+  foreach (const SiteSnapshot& site, merged)
+    sites.append(site);
+  std::sort(sites.begin(), sites.end(), [](const SiteSnapshot& lhs, const SiteSnapshot& rhs) {
+    return lhs.hold.total > rhs.hold.total;
+  });
+
+  QString ret = QStringLiteral("DUChain lock statistics: %1 running threads, %2 call sites, recording %3\n")
+                  .arg(threadCount).arg(sites.size())
+                  .arg(isEnabled() ? QStringLiteral("enabled") : QStringLiteral("disabled"));
+  for (int a = 0; a < sites.size() && a < maxSites; ++a) {
+    const SiteSnapshot& site = sites[a];
+    ret += QStringLiteral("%1:%2 (%3), %4 times\n").arg(site.file).arg(site.line).arg(typeName(site.type)).arg(site.hold.count);
+    ret += QStringLiteral("  hold: total %1ms, max %2ms, 99% below %3ms\n")
+             .arg(milliseconds(site.hold.total), milliseconds(site.hold.max))
+             .arg(site.hold.count ? site.hold.quantileUpperBound(0.99) / 1000.0 : 0.0);
+    ret += QStringLiteral("  wait: total %1ms, max %2ms, 99% below %3ms, %4 timeouts\n")
+             .arg(milliseconds(site.wait.total), milliseconds(site.wait.max))
+             .arg(site.wait.count ? site.wait.quantileUpperBound(0.99) / 1000.0 : 0.0)
+             .arg(site.timeouts);
+  }
+  return ret;
+}
+
+}
+
+}
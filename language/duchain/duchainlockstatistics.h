@@ -0,0 +1,86 @@
+/*
+   This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef KDEVPLATFORM_DUCHAINLOCKSTATISTICS_H
+#define KDEVPLATFORM_DUCHAINLOCKSTATISTICS_H
+
+#include <language/languageexport.h>
+
+#include <QtGlobal>
+
+class QByteArray;
+class QString;
+
+namespace KDevelop
+{
+
+/**
+ * Opt-in telemetry for DUChainReadLocker and DUChainWriteLocker.
+ *
+ * While enabled, every locker records how long it waited for the DUChain lock and how long it held it,
+ * attributed to the source location that constructed the locker. The samples go into histograms with
+ * power-of-two microsecond buckets. Each thread has its own histograms, so recording takes no lock and
+ * threads do not contend on shared counters. The dump functions read the histograms of all threads
+ * without stopping them.
+ *
+ * The lockers only record their call site when KDevPlatform is built with the KDEV_DUCHAIN_LOCK_STATISTICS
+ * CMake option, see isAvailable(). It is off by default, because it changes the ABI of the lockers.
+ *
+ * Recording is disabled by default. Set the KDEV_DUCHAIN_LOCK_STATISTICS environment variable
+ * to enable it from the start, or call setEnabled().
+ * The samples of a thread are merged into the ones of all finished threads when it finishes.
+ *
+ * Only the lockers are instrumented, direct calls to DUChainLock::lockForRead() and friends are not recorded.
+ */
+namespace DUChainLockStatistics
+{
+  enum LockType {
+    ReadLock,
+    WriteLock
+  };
+
+  ///Returns whether the lockers were built to record statistics. If not, recording can't be enabled.
+  KDEVPLATFORMLANGUAGE_EXPORT bool isAvailable();
+
+  KDEVPLATFORMLANGUAGE_EXPORT bool isEnabled();
+  KDEVPLATFORMLANGUAGE_EXPORT void setEnabled(bool enabled);
+
+  ///Clears the recorded samples of all threads.
+  ///Samples that are recorded at the same time by other threads may survive the reset.
+  KDEVPLATFORMLANGUAGE_EXPORT void reset();
+
+  ///Returns the samples of all threads as a JSON document, one entry per running thread and call site,
+  ///and one per call site for the finished threads.
+  KDEVPLATFORMLANGUAGE_EXPORT QByteArray toJson();
+
+  ///Returns a human readable summary of the @p maxSites call sites with the highest total hold time,
+  ///merged over all threads.
+  KDEVPLATFORMLANGUAGE_EXPORT QString toText(int maxSites = 25);
+
+  ///Monotonic timestamp in nanoseconds, used by the lockers.
+  KDEVPLATFORMLANGUAGE_EXPORT qint64 timestamp();
+
+  ///Records one lock acquisition of the current thread.
+  ///@param file The file of the call site, or zero if it is not known. Must stay valid forever, like a string literal.
+  ///@param holdTime The time the lock was held in nanoseconds, or -1 if the lock could not be acquired in time.
+  KDEVPLATFORMLANGUAGE_EXPORT void record(const char* file, int line, LockType type, qint64 waitTime, qint64 holdTime);
+}
+
+}
+
+#endif // KDEVPLATFORM_DUCHAINLOCKSTATISTICS_H
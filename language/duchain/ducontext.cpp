@@ -40,6 +40,7 @@
 #include "duchainregister.h"
 #include "topducontextdynamicdata.h"
 #include "importers.h"
+#include "indexupdatebatch.h"
 #include "uses.h"
 #include "navigation/abstractdeclarationnavigationcontext.h"
 #include "navigation/abstractnavigationwidget.h"
@@ -114,6 +115,10 @@ void DUContext::rebuildDynamicData(DUContext* parent, uint ownIndex) {
   m_dynamicData->m_parentContext = DUContextPointer(parent);
   m_dynamicData->m_context = this;
 
+  m_dynamicData->invalidateUseIndex();
+  m_dynamicData->invalidateChildContextIndex();
+  m_dynamicData->invalidateLocalDeclarationIndex();
+
   m_dynamicData->m_childContexts.clear();
   m_dynamicData->m_childContexts.reserve(d_func()->m_childContextsSize());
   FOREACH_FUNCTION(const LocalIndexedDUContext& ctx, d_func()->m_childContexts) {
@@ -166,6 +171,110 @@ DUContextDynamicData::DUContextDynamicData(DUContext* d)
 {
 }
 
+DUContextDynamicData::~DUContextDynamicData()
+{
+  delete m_useIndex.loadAcquire();
+  delete m_childContextIndex.loadAcquire();
+  delete m_localDeclarationIndex.loadAcquire();
+}
+
+int DUContextDynamicData::RangeIndex::find(const CursorInRevision& position, RangeInRevision::ContainsBehavior behavior,
+                                           Match match) const
+{
+  return find(position, position, behavior == RangeInRevision::IncludeBackEdge, match);
+}
+
+int DUContextDynamicData::RangeIndex::find(const RangeInRevision& range, Match match) const
+{
+  return find(range.start, range.end, true, match);
+}
+
+int DUContextDynamicData::RangeIndex::find(const CursorInRevision& start, const CursorInRevision& end,
+                                           bool includeEnd, Match match) const
+{
+  auto reaches = [&end, includeEnd] (const CursorInRevision& itemEnd) {
+    return includeEnd ? end <= itemEnd : end < itemEnd;
+  };
+
+  auto it = std::upper_bound(m_entries.begin(), m_entries.end(), start, [] (const CursorInRevision& start, const Entry& entry) {
+    return start < entry.start;
+  });
+  int ret = -1;
+  // everything before the first entry that ends too early, counting the ones before it, ends too early as well
+  while (it != m_entries.begin()) {
+    --it;
+    if (!reaches(it->maxEnd)) {
+      break;
+    }
+    if (reaches(it->end) && (ret == -1 || (match == FirstMatch ? it->index < ret : it->index > ret))) {
+      ret = it->index;
+    }
+  }
+  return ret;
+}
+
+namespace {
+// below this, looking at all items is about as fast as a lookup in the index
+const int minIndexedItems = 16;
+
+template<typename Range>
+const DUContextDynamicData::RangeIndex* rangeIndex(QAtomicPointer<DUContextDynamicData::RangeIndex>& index, int count, Range range)
+{
+  if (count < minIndexedItems) {
+    return nullptr;
+  }
+  auto ret = index.loadAcquire();
+  if (!ret) {
+    auto created = new DUContextDynamicData::RangeIndex(count, range);
+    if (index.testAndSetOrdered(nullptr, created)) {
+      ret = created;
+    } else {
+      // another reader was faster
+      delete created;
+      ret = index.loadAcquire();
+    }
+  }
+  return ret;
+}
+}
+
+const DUContextDynamicData::RangeIndex* DUContextDynamicData::useIndex() const
+{
+  const Use* uses = d_func()->m_uses();
+  return rangeIndex(m_useIndex, d_func()->m_usesSize(), [uses] (int i) {
+    return uses[i].m_range;
+  });
+}
+
+const DUContextDynamicData::RangeIndex* DUContextDynamicData::childContextIndex() const
+{
+  return rangeIndex(m_childContextIndex, m_childContexts.size(), [this] (int i) {
+    return m_childContexts[i]->range();
+  });
+}
+
+const DUContextDynamicData::RangeIndex* DUContextDynamicData::localDeclarationIndex() const
+{
+  return rangeIndex(m_localDeclarationIndex, m_localDeclarations.size(), [this] (int i) {
+    return m_localDeclarations[i]->range();
+  });
+}
+
+void DUContextDynamicData::invalidateUseIndex()
+{
+  delete m_useIndex.fetchAndStoreOrdered(nullptr);
+}
+
+void DUContextDynamicData::invalidateChildContextIndex()
+{
+  delete m_childContextIndex.fetchAndStoreOrdered(nullptr);
+}
+
+void DUContextDynamicData::invalidateLocalDeclarationIndex()
+{
+  delete m_localDeclarationIndex.fetchAndStoreOrdered(nullptr);
+}
+
 void DUContextDynamicData::scopeIdentifier(bool includeClasses, QualifiedIdentifier& target) const {
   if (m_parentContext)
     m_parentContext->m_dynamicData->scopeIdentifier(includeClasses, target);
@@ -206,6 +315,8 @@ void DUContextDynamicData::addDeclaration( Declaration * newDeclaration )
   //If this context is temporary, added declarations should be as well, and viceversa
   Q_ASSERT(isContextTemporary(m_indexInTopContext) == isContextTemporary(newDeclaration->ownIndex()));
 
+  invalidateLocalDeclarationIndex();
+
   CursorInRevision start = newDeclaration->range().start;
 
   bool inserted = false;
@@ -237,6 +348,8 @@ void DUContextDynamicData::addDeclaration( Declaration * newDeclaration )
 
 bool DUContextDynamicData::removeDeclaration(Declaration* declaration)
 {
+  invalidateLocalDeclarationIndex();
+
   const int idx = m_localDeclarations.indexOf(declaration);
   if (idx != -1) {
     Q_ASSERT(d_func()->m_localDeclarations()[idx].data(m_topContext) == declaration);
@@ -255,6 +368,8 @@ void DUContextDynamicData::addChildContext( DUContext * context )
   Q_ASSERT(!context->m_dynamicData->m_parentContext
            || context->m_dynamicData->m_parentContext.data()->m_dynamicData == this );
 
+  invalidateChildContextIndex();
+
   LocalIndexedDUContext indexed(context->m_dynamicData->m_indexInTopContext);
 
   //If this context is temporary, added declarations should be as well, and viceversa
@@ -288,6 +403,8 @@ void DUContextDynamicData::addChildContext( DUContext * context )
 bool DUContextDynamicData::removeChildContext( DUContext* context ) {
 //   ENSURE_CAN_WRITE
 
+  invalidateChildContextIndex();
+
   const int idx = m_childContexts.indexOf(context);
   if (idx != -1) {
     m_childContexts.remove(idx);
@@ -889,7 +1006,18 @@ DUContext * DUContext::findContext( const CursorInRevision& position, DUContext*
   if (!parent)
     parent = const_cast<DUContext*>(this);
 
-  foreach (DUContext* context, parent->m_dynamicData->m_childContexts) {
+  const auto& childContexts = parent->m_dynamicData->m_childContexts;
+  if (const auto index = parent->m_dynamicData->childContextIndex()) {
+    const int found = index->find(position, RangeInRevision::Default, DUContextDynamicData::RangeIndex::FirstMatch);
+    if (found == -1) {
+      return nullptr;
+    }
+    DUContext* context = childContexts[found];
+    DUContext* ret = findContext(position, context);
+    return ret ? ret : context;
+  }
+
+  foreach (DUContext* context, childContexts) {
     if (context->range().contains(position)) {
       DUContext* ret = findContext(position, context);
       if (!ret) {
@@ -1128,6 +1256,7 @@ void DUContext::deleteUse(int index)
   ENSURE_CAN_WRITE
   DUCHAIN_D_DYNAMIC(DUContext);
   d->m_usesList().remove(index);
+  m_dynamicData->invalidateUseIndex();
 }
 
 void DUContext::deleteUses()
@@ -1136,6 +1265,7 @@ void DUContext::deleteUses()
 
   DUCHAIN_D_DYNAMIC(DUContext);
   d->m_usesList().clear();
+  m_dynamicData->invalidateUseIndex();
 }
 
 void DUContext::deleteUsesRecursively()
@@ -1321,6 +1451,7 @@ int DUContext::createUse(int declarationIndex, const RangeInRevision& range, int
   }
 
   d->m_usesList().insert(insertBefore, use);
+  m_dynamicData->invalidateUseIndex();
 
   return insertBefore;
 }
@@ -1329,6 +1460,7 @@ void DUContext::changeUseRange(int useIndex, const RangeInRevision& range)
 {
   ENSURE_CAN_WRITE
   d_func_dynamic()->m_usesList()[useIndex].m_range = range;
+  m_dynamicData->invalidateUseIndex();
 }
 
 void DUContext::setUseDeclaration(int useNumber, int declarationIndex)
@@ -1349,7 +1481,16 @@ DUContext * DUContext::findContextAt(const CursorInRevision & position, bool inc
     return nullptr;
   }
 
-  const auto childContexts = m_dynamicData->m_childContexts;
+  const auto& childContexts = m_dynamicData->m_childContexts;
+  if (const auto index = m_dynamicData->childContextIndex()) {
+    const int found = index->find(position, includeRightBorder ? RangeInRevision::IncludeBackEdge : RangeInRevision::Default,
+                                  DUContextDynamicData::RangeIndex::LastMatch);
+    if (found != -1) {
+      return childContexts[found]->findContextAt(position, includeRightBorder);
+    }
+    return const_cast<DUContext*>(this);
+  }
+
   for(int a = childContexts.size() - 1; a >= 0; --a) {
     if (DUContext* specific = childContexts[a]->findContextAt(position, includeRightBorder)) {
       return specific;
@@ -1366,6 +1507,11 @@ Declaration * DUContext::findDeclarationAt(const CursorInRevision & position) co
   if (!range().contains(position))
     return nullptr;
 
+  if (const auto index = m_dynamicData->localDeclarationIndex()) {
+    const int found = index->find(position, RangeInRevision::Default, DUContextDynamicData::RangeIndex::FirstMatch);
+    return found == -1 ? nullptr : m_dynamicData->m_localDeclarations[found];
+  }
+
   foreach (Declaration* child, m_dynamicData->m_localDeclarations) {
     if (child->range().contains(position)) {
       return child;
@@ -1382,6 +1528,14 @@ DUContext* DUContext::findContextIncluding(const RangeInRevision& range) const
   if (!this->range().contains(range))
     return nullptr;
 
+  if (const auto index = m_dynamicData->childContextIndex()) {
+    const int found = index->find(range, DUContextDynamicData::RangeIndex::FirstMatch);
+    if (found != -1) {
+      return m_dynamicData->m_childContexts[found]->findContextIncluding(range);
+    }
+    return const_cast<DUContext*>(this);
+  }
+
   foreach (DUContext* child, m_dynamicData->m_childContexts) {
     if (DUContext* specific = child->findContextIncluding(range)) {
       return specific;
@@ -1398,6 +1552,10 @@ int DUContext::findUseAt(const CursorInRevision & position) const
   if (!range().contains(position))
     return -1;
 
+  if (const auto index = m_dynamicData->useIndex()) {
+    return index->find(position, RangeInRevision::Default, DUContextDynamicData::RangeIndex::FirstMatch);
+  }
+
   for(unsigned int a = 0; a < d_func()->m_usesSize(); ++a)
     if (d_func()->m_uses()[a].m_range.contains(position))
       return a;
@@ -1434,6 +1592,9 @@ void DUContext::cleanIfNotEncountered(const QSet<DUChainBase*>& encountered)
 {
   ENSURE_CAN_WRITE
 
+  //Remove the deleted items from the global indices together
+  IndexUpdateBatch batch;
+
   // It may happen that the deletion of one declaration triggers the deletion of another one
   // Therefore we copy the list of indexed declarations and work on those. Indexed declarations
   // will return zero for already deleted declarations.
@@ -1681,6 +1842,7 @@ void DUContext::resortLocalDeclarations()
   ENSURE_CAN_WRITE
 
   std::sort(m_dynamicData->m_localDeclarations.begin(), m_dynamicData->m_localDeclarations.end(), sortByRange);
+  m_dynamicData->invalidateLocalDeclarationIndex();
 
   auto top = topContext();
   auto& declarations = d_func_dynamic()->m_localDeclarationsList();
@@ -1695,6 +1857,7 @@ void DUContext::resortChildContexts()
   ENSURE_CAN_WRITE
 
   std::sort(m_dynamicData->m_childContexts.begin(), m_dynamicData->m_childContexts.end(), sortByRange);
+  m_dynamicData->invalidateChildContextIndex();
 
   auto top = topContext();
   auto& contexts = d_func_dynamic()->m_childContextsList();
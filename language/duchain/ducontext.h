@@ -73,6 +73,7 @@ typedef DUChainPointer<DUContext> DUContextPointer;
 class KDEVPLATFORMLANGUAGE_EXPORT DUContext : public DUChainBase
 {
   friend class Use;
+  friend class DUChainBase;
   friend class Declaration;
   friend class DeclarationData;
   friend class DUContextData;
@@ -24,6 +24,10 @@
 
 #include "ducontextdata.h"
 
+#include <QAtomicPointer>
+
+#include <algorithm>
+
 namespace KDevelop {
 
 ///This class contains data that is only runtime-dependant and does not need to be stored to disk
@@ -36,7 +40,57 @@ private:
     static inline DUContextDynamicData* ctx_dynamicData(DUContext* ctx) { return ctx->m_dynamicData; }
 
 public:
+  /**
+   * Finds the items of a context whose range contains a position, looking only at the items
+   * that start before it and may reach it. Built on demand for contexts with many items.
+   */
+  class RangeIndex
+  {
+  public:
+    enum Match {
+      FirstMatch,
+      LastMatch
+    };
+
+    /// @p range returns the range of item @p index, for each index below @p count
+    template<typename Range>
+    RangeIndex(int count, Range range)
+      : m_entries(count)
+    {
+      for (int i = 0; i < count; ++i) {
+        const RangeInRevision itemRange = range(i);
+        m_entries[i] = {itemRange.start, itemRange.end, itemRange.end, i};
+      }
+      std::sort(m_entries.begin(), m_entries.end(), [] (const Entry& lhs, const Entry& rhs) {
+        return lhs.start < rhs.start;
+      });
+      for (int i = 1; i < count; ++i) {
+        m_entries[i].maxEnd = qMax(m_entries[i].end, m_entries[i - 1].maxEnd);
+      }
+    }
+
+    /// @return the first or last index of an item whose range contains @p position, -1 if there is none
+    int find(const CursorInRevision& position, RangeInRevision::ContainsBehavior behavior, Match match) const;
+    /// @return the first or last index of an item whose range contains @p range, -1 if there is none
+    int find(const RangeInRevision& range, Match match) const;
+
+  private:
+    struct Entry
+    {
+      CursorInRevision start;
+      CursorInRevision end;
+      // the largest end of all entries up to this one
+      CursorInRevision maxEnd;
+      int index;
+    };
+
+    int find(const CursorInRevision& start, const CursorInRevision& end, bool includeEnd, Match match) const;
+
+    QVector<Entry> m_entries;
+  };
+
   explicit DUContextDynamicData( DUContext* );
+  ~DUContextDynamicData();
   DUContextPointer m_parentContext;
 
   TopDUContext* m_topContext;
@@ -50,6 +104,23 @@ public:
   // cache of unserialized local declarations
   QVector<Declaration*> m_localDeclarations;
 
+  // indices by range, built on the first lookup under the read lock, so readers race to set them
+  mutable QAtomicPointer<RangeIndex> m_useIndex;
+  mutable QAtomicPointer<RangeIndex> m_childContextIndex;
+  mutable QAtomicPointer<RangeIndex> m_localDeclarationIndex;
+
+  /// @return the index of the uses by range, or nullptr if there are too few uses to need one
+  const RangeIndex* useIndex() const;
+  /// @return the index of m_childContexts by range, or nullptr if there are too few to need one
+  const RangeIndex* childContextIndex() const;
+  /// @return the index of m_localDeclarations by range, or nullptr if there are too few to need one
+  const RangeIndex* localDeclarationIndex() const;
+
+  // to be called with the write lock held whenever the ranges or the order of the items change
+  void invalidateUseIndex();
+  void invalidateChildContextIndex();
+  void invalidateLocalDeclarationIndex();
+
    /**
    * Adds a child context.
    *
@@ -78,7 +78,7 @@ public:
 
   int m_unique;
   IndexedString m_identifier;
-  uint m_refCount;
+  QAtomicInteger<uint> m_refCount;
 
   START_APPENDED_LISTS_STATIC(IdentifierPrivate)
 
@@ -141,7 +141,7 @@ struct IdentifierItemRequest
 
   static bool persistent(const ConstantIdentifierPrivate* item)
   {
-    return (bool)item->m_refCount;
+    return (bool)item->m_refCount.load();
   }
 
   static void destroy(ConstantIdentifierPrivate* item, AbstractItemRepository&)
@@ -220,7 +220,7 @@ public:
   bool m_explicitlyGlobal:1;
   bool m_isExpression:1;
   mutable uint m_hash;
-  uint m_refCount;
+  QAtomicInteger<uint> m_refCount;
 
   START_APPENDED_LISTS_STATIC(QualifiedIdentifierPrivate)
 
@@ -310,7 +310,7 @@ struct QualifiedIdentifierItemRequest
 
   static bool persistent(const ConstantQualifiedIdentifierPrivate* item)
   {
-    return (bool)item->m_refCount;
+    return (bool)item->m_refCount.load();
   }
 
   static void destroy(ConstantQualifiedIdentifierPrivate* item, AbstractItemRepository&)
@@ -339,6 +339,15 @@ static QualifiedIdentifierRepository& qualifiedidentifierRepository()
   return repo;
 }
 
+///Calls @p change with the reference count of the item with the given index. The reference counts are atomic,
+///so the repository mutex is only locked if the bucket of the item was not changed since the last store.
+template<class Repository, class Change>
+static void changeReferenceCount(Repository& repository, uint index, const Change& change)
+{
+  typedef decltype(repository->dynamicItemFromIndexSimple(index)) ItemPointer;
+  repository->changeItemLockFree(index, [&change](ItemPointer item) { change(item->m_refCount); });
+}
+
 static uint emptyConstantQualifiedIdentifierPrivateIndex()
 {
   static const uint index = qualifiedidentifierRepository()->index(DynamicQualifiedIdentifierPrivate());
@@ -1293,8 +1302,7 @@ IndexedIdentifier::IndexedIdentifier()
   : index(emptyConstantIdentifierPrivateIndex())
 {
   if(shouldDoDUChainReferenceCounting(this)) {
-    QMutexLocker lock(identifierRepository()->mutex());
-    increase(identifierRepository()->dynamicItemFromIndexSimple(index)->m_refCount, index);
+    changeReferenceCount(identifierRepository(), index, [&](QAtomicInteger<uint>& refCount) { increase(refCount, index); });
   }
 }
 
@@ -1302,8 +1310,7 @@ IndexedIdentifier::IndexedIdentifier(const Identifier& id)
   : index(id.index())
 {
   if(shouldDoDUChainReferenceCounting(this)) {
-    QMutexLocker lock(identifierRepository()->mutex());
-    increase(identifierRepository()->dynamicItemFromIndexSimple(index)->m_refCount, index);
+    changeReferenceCount(identifierRepository(), index, [&](QAtomicInteger<uint>& refCount) { increase(refCount, index); });
   }
 }
 
@@ -1311,8 +1318,7 @@ IndexedIdentifier::IndexedIdentifier(const IndexedIdentifier& rhs)
   : index(rhs.index)
 {
   if(shouldDoDUChainReferenceCounting(this)) {
-    QMutexLocker lock(identifierRepository()->mutex());
-    increase(identifierRepository()->dynamicItemFromIndexSimple(index)->m_refCount, index);
+    changeReferenceCount(identifierRepository(), index, [&](QAtomicInteger<uint>& refCount) { increase(refCount, index); });
   }
 }
 
@@ -1325,23 +1331,20 @@ IndexedIdentifier::IndexedIdentifier(IndexedIdentifier&& rhs) Q_DECL_NOEXCEPT
 IndexedIdentifier::~IndexedIdentifier()
 {
   if(shouldDoDUChainReferenceCounting(this)) {
-    QMutexLocker lock(identifierRepository()->mutex());
-    decrease(identifierRepository()->dynamicItemFromIndexSimple(index)->m_refCount, index);
+    changeReferenceCount(identifierRepository(), index, [&](QAtomicInteger<uint>& refCount) { decrease(refCount, index); });
   }
 }
 
 IndexedIdentifier& IndexedIdentifier::operator=(const Identifier& id)
 {
   if(shouldDoDUChainReferenceCounting(this)) {
-    QMutexLocker lock(identifierRepository()->mutex());
-    decrease(identifierRepository()->dynamicItemFromIndexSimple(index)->m_refCount, index);
+    changeReferenceCount(identifierRepository(), index, [&](QAtomicInteger<uint>& refCount) { decrease(refCount, index); });
   }
 
   index = id.index();
 
   if(shouldDoDUChainReferenceCounting(this)) {
-    QMutexLocker lock(identifierRepository()->mutex());
-    increase(identifierRepository()->dynamicItemFromIndexSimple(index)->m_refCount, index);
+    changeReferenceCount(identifierRepository(), index, [&](QAtomicInteger<uint>& refCount) { increase(refCount, index); });
   }
   return *this;
 }
@@ -1349,25 +1352,22 @@ IndexedIdentifier& IndexedIdentifier::operator=(const Identifier& id)
 IndexedIdentifier& IndexedIdentifier::operator=(IndexedIdentifier&& rhs) Q_DECL_NOEXCEPT
 {
   if(shouldDoDUChainReferenceCounting(this)) {
-    QMutexLocker lock(identifierRepository()->mutex());
     ifDebug( qCDebug(LANGUAGE) << "decreasing"; )
 
-    decrease(identifierRepository()->dynamicItemFromIndexSimple(index)->m_refCount, index);
+    changeReferenceCount(identifierRepository(), index, [&](QAtomicInteger<uint>& refCount) { decrease(refCount, index); });
   } else if (shouldDoDUChainReferenceCounting(&rhs)) {
-    QMutexLocker lock(identifierRepository()->mutex());
     ifDebug( qCDebug(LANGUAGE) << "decreasing"; )
 
-    decrease(identifierRepository()->dynamicItemFromIndexSimple(rhs.index)->m_refCount, rhs.index);
+    changeReferenceCount(identifierRepository(), rhs.index, [&](QAtomicInteger<uint>& refCount) { decrease(refCount, rhs.index); });
   }
 
   index = rhs.index;
   rhs.index = emptyConstantIdentifierPrivateIndex();
 
   if(shouldDoDUChainReferenceCounting(this) && !(shouldDoDUChainReferenceCounting(&rhs))) {
-    QMutexLocker lock(identifierRepository()->mutex());
     ifDebug( qCDebug(LANGUAGE) << "increasing"; )
 
-    increase(identifierRepository()->dynamicItemFromIndexSimple(index)->m_refCount, index);
+    changeReferenceCount(identifierRepository(), index, [&](QAtomicInteger<uint>& refCount) { increase(refCount, index); });
   }
 
   return *this;
@@ -1376,15 +1376,13 @@ IndexedIdentifier& IndexedIdentifier::operator=(IndexedIdentifier&& rhs) Q_DECL_
 IndexedIdentifier& IndexedIdentifier::operator=(const IndexedIdentifier& id)
 {
   if(shouldDoDUChainReferenceCounting(this)) {
-    QMutexLocker lock(identifierRepository()->mutex());
-    decrease(identifierRepository()->dynamicItemFromIndexSimple(index)->m_refCount, index);
+    changeReferenceCount(identifierRepository(), index, [&](QAtomicInteger<uint>& refCount) { decrease(refCount, index); });
   }
 
   index = id.index;
 
   if(shouldDoDUChainReferenceCounting(this)) {
-    QMutexLocker lock(identifierRepository()->mutex());
-    increase(identifierRepository()->dynamicItemFromIndexSimple(index)->m_refCount, index);
+    changeReferenceCount(identifierRepository(), index, [&](QAtomicInteger<uint>& refCount) { increase(refCount, index); });
   }
   return *this;
 }
@@ -1446,8 +1444,7 @@ IndexedQualifiedIdentifier::IndexedQualifiedIdentifier()
     ifDebug( qCDebug(LANGUAGE) << "increasing"; )
 
     //qCDebug(LANGUAGE) << "(" << ++cnt << ")" << this << identifier().toString() << "inc" << index;
-    QMutexLocker lock(qualifiedidentifierRepository()->mutex());
-    increase(qualifiedidentifierRepository()->dynamicItemFromIndexSimple(index)->m_refCount, index);
+    changeReferenceCount(qualifiedidentifierRepository(), index, [&](QAtomicInteger<uint>& refCount) { increase(refCount, index); });
   }
 }
 
@@ -1458,8 +1455,7 @@ IndexedQualifiedIdentifier::IndexedQualifiedIdentifier(const QualifiedIdentifier
 
   if(shouldDoDUChainReferenceCounting(this)) {
     ifDebug( qCDebug(LANGUAGE) << "increasing"; )
-    QMutexLocker lock(qualifiedidentifierRepository()->mutex());
-    increase(qualifiedidentifierRepository()->dynamicItemFromIndexSimple(index)->m_refCount, index);
+    changeReferenceCount(qualifiedidentifierRepository(), index, [&](QAtomicInteger<uint>& refCount) { increase(refCount, index); });
   }
 }
 
@@ -1471,8 +1467,7 @@ IndexedQualifiedIdentifier::IndexedQualifiedIdentifier(const IndexedQualifiedIde
   if(shouldDoDUChainReferenceCounting(this)) {
     ifDebug( qCDebug(LANGUAGE) << "increasing"; )
 
-    QMutexLocker lock(qualifiedidentifierRepository()->mutex());
-    increase(qualifiedidentifierRepository()->dynamicItemFromIndexSimple(index)->m_refCount, index);
+    changeReferenceCount(qualifiedidentifierRepository(), index, [&](QAtomicInteger<uint>& refCount) { increase(refCount, index); });
   }
 }
 
@@ -1487,15 +1482,13 @@ IndexedQualifiedIdentifier& IndexedQualifiedIdentifier::operator=(const Qualifie
   ifDebug( qCDebug(LANGUAGE) << "(" << ++cnt << ")" << identifier().toString() << index; )
 
   if(shouldDoDUChainReferenceCounting(this)) {
-    QMutexLocker lock(qualifiedidentifierRepository()->mutex());
-
     ifDebug( qCDebug(LANGUAGE) << "decreasing"; )
-    decrease(qualifiedidentifierRepository()->dynamicItemFromIndexSimple(index)->m_refCount, index);
+    changeReferenceCount(qualifiedidentifierRepository(), index, [&](QAtomicInteger<uint>& refCount) { decrease(refCount, index); });
 
     index = id.index();
 
     ifDebug( qCDebug(LANGUAGE) << index << "increasing"; )
-    increase(qualifiedidentifierRepository()->dynamicItemFromIndexSimple(index)->m_refCount, index);
+    changeReferenceCount(qualifiedidentifierRepository(), index, [&](QAtomicInteger<uint>& refCount) { increase(refCount, index); });
   } else {
     index = id.index();
   }
@@ -1509,15 +1502,14 @@ IndexedQualifiedIdentifier& IndexedQualifiedIdentifier::operator=(const IndexedQ
   ifDebug( qCDebug(LANGUAGE) << "(" << ++cnt << ")" << identifier().toString() << index; )
 
   if(shouldDoDUChainReferenceCounting(this)) {
-    QMutexLocker lock(qualifiedidentifierRepository()->mutex());
     ifDebug( qCDebug(LANGUAGE) << "decreasing"; )
 
-    decrease(qualifiedidentifierRepository()->dynamicItemFromIndexSimple(index)->m_refCount, index);
+    changeReferenceCount(qualifiedidentifierRepository(), index, [&](QAtomicInteger<uint>& refCount) { decrease(refCount, index); });
 
     index = rhs.index;
 
     ifDebug( qCDebug(LANGUAGE) << index << "increasing"; )
-    increase(qualifiedidentifierRepository()->dynamicItemFromIndexSimple(index)->m_refCount, index);
+    changeReferenceCount(qualifiedidentifierRepository(), index, [&](QAtomicInteger<uint>& refCount) { increase(refCount, index); });
   } else {
     index = rhs.index;
   }
@@ -1528,25 +1520,22 @@ IndexedQualifiedIdentifier& IndexedQualifiedIdentifier::operator=(const IndexedQ
 IndexedQualifiedIdentifier& IndexedQualifiedIdentifier::operator=(IndexedQualifiedIdentifier&& rhs) Q_DECL_NOEXCEPT
 {
   if(shouldDoDUChainReferenceCounting(this)) {
-    QMutexLocker lock(qualifiedidentifierRepository()->mutex());
     ifDebug( qCDebug(LANGUAGE) << "decreasing"; )
 
-    decrease(qualifiedidentifierRepository()->dynamicItemFromIndexSimple(index)->m_refCount, index);
+    changeReferenceCount(qualifiedidentifierRepository(), index, [&](QAtomicInteger<uint>& refCount) { decrease(refCount, index); });
   } else if (shouldDoDUChainReferenceCounting(&rhs)) {
-    QMutexLocker lock(qualifiedidentifierRepository()->mutex());
     ifDebug( qCDebug(LANGUAGE) << "decreasing"; )
 
-    decrease(qualifiedidentifierRepository()->dynamicItemFromIndexSimple(rhs.index)->m_refCount, rhs.index);
+    changeReferenceCount(qualifiedidentifierRepository(), rhs.index, [&](QAtomicInteger<uint>& refCount) { decrease(refCount, rhs.index); });
   }
 
   index = rhs.index;
   rhs.index = emptyConstantQualifiedIdentifierPrivateIndex();
 
   if(shouldDoDUChainReferenceCounting(this) && !(shouldDoDUChainReferenceCounting(&rhs))) {
-    QMutexLocker lock(qualifiedidentifierRepository()->mutex());
     ifDebug( qCDebug(LANGUAGE) << "increasing"; )
 
-    increase(qualifiedidentifierRepository()->dynamicItemFromIndexSimple(index)->m_refCount, index);
+    changeReferenceCount(qualifiedidentifierRepository(), index, [&](QAtomicInteger<uint>& refCount) { increase(refCount, index); });
   }
 
   return *this;
@@ -1557,8 +1546,7 @@ IndexedQualifiedIdentifier::~IndexedQualifiedIdentifier()
   ifDebug( qCDebug(LANGUAGE) << "(" << ++cnt << ")" << identifier().toString() << index; )
   if(shouldDoDUChainReferenceCounting(this)) {
     ifDebug( qCDebug(LANGUAGE) << index << "decreasing"; )
-    QMutexLocker lock(qualifiedidentifierRepository()->mutex());
-    decrease(qualifiedidentifierRepository()->dynamicItemFromIndexSimple(index)->m_refCount, index);
+    changeReferenceCount(qualifiedidentifierRepository(), index, [&](QAtomicInteger<uint>& refCount) { decrease(refCount, index); });
   }
 }
 
@@ -20,6 +20,8 @@
 
 #include "declarationid.h"
 #include "duchainpointer.h"
+#include "indexupdatebatch.h"
+#include "indexupdatebatch_p.h"
 #include "serialization/itemrepository.h"
 #include "topducontext.h"
 
@@ -117,6 +119,11 @@ Importers::~Importers() = default;
 
 void Importers::addImporter(const DeclarationId& id, const IndexedDUContext& use)
 {
+  if(IndexUpdateBatch* batch = IndexUpdateBatch::current()) {
+    batch->addImporter(id, use);
+    return;
+  }
+
   ImportersItem item;
   item.declaration = id;
   item.importersList().append(use);
@@ -142,6 +149,11 @@ void Importers::addImporter(const DeclarationId& id, const IndexedDUContext& use
 
 void Importers::removeImporter(const DeclarationId& id, const IndexedDUContext& use)
 {
+  if(IndexUpdateBatch* batch = IndexUpdateBatch::current()) {
+    batch->removeImporter(id, use);
+    return;
+  }
+
   ImportersItem item;
   item.declaration = id;
   ImportersRequestItem request(item);
@@ -164,8 +176,32 @@ void Importers::removeImporter(const DeclarationId& id, const IndexedDUContext&
   }
 }
 
+void Importers::changeImporters(const DeclarationId& id, const KDevVarLengthArray<IndexedDUContext>& added, const KDevVarLengthArray<IndexedDUContext>& removed)
+{
+  QMutexLocker lock(d->m_importers.mutex());
+
+  ImportersItem item;
+  item.declaration = id;
+  ImportersRequestItem request(item);
+
+  uint index = d->m_importers.findIndex(item);
+  const ImportersItem* oldItem = index ? d->m_importers.itemFromIndex(index) : nullptr;
+
+  if(!mergeSetChanges(oldItem ? oldItem->importers() : nullptr, oldItem ? oldItem->importersSize() : 0, added, removed, item.importersList()))
+    return;
+
+  if(index)
+    d->m_importers.deleteItem(index);
+
+  //This inserts the changed item
+  if(item.importersSize() != 0)
+    d->m_importers.index(request);
+}
+
 KDevVarLengthArray<IndexedDUContext> Importers::importers(const DeclarationId& id) const
 {
+  IndexUpdateBatch::applyCurrent();
+
   KDevVarLengthArray<IndexedDUContext> ret;
 
   ImportersItem item;
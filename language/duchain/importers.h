@@ -52,6 +52,12 @@ namespace KDevelop {
      * Removes the given top-context from the list of uses
      * */
     void removeImporter(const DeclarationId& id, const IndexedDUContext& use);
+    /**
+     * Adds and removes several importers of the given id at once, rewriting the list only once.
+     * @p added and @p removed must not overlap. @see IndexUpdateBatch
+     * */
+    void changeImporters(const DeclarationId& id, const KDevVarLengthArray<IndexedDUContext>& added,
+                         const KDevVarLengthArray<IndexedDUContext>& removed);
 
     ///Gets the top-contexts of all users assigned to the declaration-id
     KDevVarLengthArray<IndexedDUContext> importers(const DeclarationId& id) const;
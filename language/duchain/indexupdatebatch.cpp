@@ -0,0 +1,244 @@
+/*
+   This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "indexupdatebatch.h"
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QThreadStorage>
+#include <QVector>
+
+#include "declarationid.h"
+#include "definitions.h"
+#include "duchain.h"
+#include "importers.h"
+#include "indexedducontext.h"
+#include "indexedtopducontext.h"
+#include "persistentsymboltable.h"
+#include "uses.h"
+
+using namespace KDevelop;
+
+namespace {
+
+struct CurrentBatch {
+  IndexUpdateBatch* batch = nullptr;
+};
+
+QThreadStorage<CurrentBatch> currentBatch;
+
+///Count of threads that currently have a batch, so threads without one can skip the thread-storage lookup
+QAtomicInt activeBatches;
+
+///Pending additions and removals for one key. Since the lists are sets, only the last change of each value matters.
+template<class Value>
+class SetChanges
+{
+public:
+  void add(const Value& value)
+  {
+    m_changes[value] = true;
+  }
+
+  void remove(const Value& value)
+  {
+    m_changes[value] = false;
+  }
+
+  void split(KDevVarLengthArray<Value>& added, KDevVarLengthArray<Value>& removed) const
+  {
+    for (auto it = m_changes.constBegin(); it != m_changes.constEnd(); ++it) {
+      if (it.value())
+        added.append(it.key());
+      else
+        removed.append(it.key());
+    }
+  }
+
+private:
+  QHash<Value, bool> m_changes;
+};
+
+template<class Key, class Value, class Apply>
+void applySetChanges(const QHash<Key, SetChanges<Value> >& changes, Apply apply)
+{
+  for (auto it = changes.constBegin(); it != changes.constEnd(); ++it) {
+    KDevVarLengthArray<Value> added;
+    KDevVarLengthArray<Value> removed;
+    it->split(added, removed);
+    apply(it.key(), added, removed);
+  }
+}
+
+}
+
+namespace KDevelop {
+
+class IndexUpdateBatchPrivate
+{
+public:
+  bool isEmpty() const
+  {
+    return m_declarations.isEmpty() && m_codeModel.isEmpty() && m_uses.isEmpty()
+        && m_definitions.isEmpty() && m_importers.isEmpty();
+  }
+
+  //False if this batch is nested into another one of the same thread
+  bool m_outermost = false;
+
+  QHash<IndexedQualifiedIdentifier, SetChanges<IndexedDeclaration> > m_declarations;
+  //The code model counts references, so its changes have to be applied in order
+  QHash<IndexedString, QVector<CodeModel::ItemChange> > m_codeModel;
+  QHash<DeclarationId, SetChanges<IndexedTopDUContext> > m_uses;
+  QHash<DeclarationId, SetChanges<IndexedDeclaration> > m_definitions;
+  QHash<DeclarationId, SetChanges<IndexedDUContext> > m_importers;
+};
+
+}
+
+IndexUpdateBatch::IndexUpdateBatch()
+  : d(new IndexUpdateBatchPrivate)
+{
+  CurrentBatch& current = currentBatch.localData();
+  if (!current.batch) {
+    current.batch = this;
+    d->m_outermost = true;
+    activeBatches.ref();
+  }
+}
+
+IndexUpdateBatch::~IndexUpdateBatch()
+{
+  if (!d->m_outermost)
+    return;
+
+  apply();
+
+  currentBatch.localData().batch = nullptr;
+  activeBatches.deref();
+}
+
+IndexUpdateBatch* IndexUpdateBatch::current()
+{
+  if (!activeBatches.load() || !currentBatch.hasLocalData())
+    return nullptr;
+  return currentBatch.localData().batch;
+}
+
+void IndexUpdateBatch::applyCurrent()
+{
+  if (IndexUpdateBatch* batch = current())
+    batch->apply();
+}
+
+void IndexUpdateBatch::apply()
+{
+  if (!d->m_outermost) {
+    applyCurrent();
+    return;
+  }
+
+  if (d->isEmpty())
+    return;
+
+  //Take the changes out first, so reads made while applying do not apply them again
+  IndexUpdateBatchPrivate changes;
+  changes.m_declarations.swap(d->m_declarations);
+  changes.m_codeModel.swap(d->m_codeModel);
+  changes.m_uses.swap(d->m_uses);
+  changes.m_definitions.swap(d->m_definitions);
+  changes.m_importers.swap(d->m_importers);
+
+  applySetChanges(changes.m_declarations, [](const IndexedQualifiedIdentifier& id, const KDevVarLengthArray<IndexedDeclaration>& added,
+                                             const KDevVarLengthArray<IndexedDeclaration>& removed) {
+    PersistentSymbolTable::self().changeDeclarations(id, added, removed);
+  });
+
+  for (auto it = changes.m_codeModel.constBegin(); it != changes.m_codeModel.constEnd(); ++it)
+    CodeModel::self().changeItems(it.key(), *it);
+
+  applySetChanges(changes.m_uses, [](const DeclarationId& id, const KDevVarLengthArray<IndexedTopDUContext>& added,
+                                     const KDevVarLengthArray<IndexedTopDUContext>& removed) {
+    DUChain::uses()->changeUses(id, added, removed);
+  });
+
+  applySetChanges(changes.m_definitions, [](const DeclarationId& id, const KDevVarLengthArray<IndexedDeclaration>& added,
+                                            const KDevVarLengthArray<IndexedDeclaration>& removed) {
+    DUChain::definitions()->changeDefinitions(id, added, removed);
+  });
+
+  applySetChanges(changes.m_importers, [](const DeclarationId& id, const KDevVarLengthArray<IndexedDUContext>& added,
+                                          const KDevVarLengthArray<IndexedDUContext>& removed) {
+    Importers::self().changeImporters(id, added, removed);
+  });
+}
+
+void IndexUpdateBatch::addDeclaration(const IndexedQualifiedIdentifier& id, const IndexedDeclaration& declaration)
+{
+  d->m_declarations[id].add(declaration);
+}
+
+void IndexUpdateBatch::removeDeclaration(const IndexedQualifiedIdentifier& id, const IndexedDeclaration& declaration)
+{
+  d->m_declarations[id].remove(declaration);
+}
+
+void IndexUpdateBatch::addCodeModelItem(const IndexedString& file, const IndexedQualifiedIdentifier& id, CodeModelItem::Kind kind)
+{
+  d->m_codeModel[file].append({CodeModel::ItemChange::Add, id, kind});
+}
+
+void IndexUpdateBatch::updateCodeModelItem(const IndexedString& file, const IndexedQualifiedIdentifier& id, CodeModelItem::Kind kind)
+{
+  d->m_codeModel[file].append({CodeModel::ItemChange::Update, id, kind});
+}
+
+void IndexUpdateBatch::removeCodeModelItem(const IndexedString& file, const IndexedQualifiedIdentifier& id)
+{
+  d->m_codeModel[file].append({CodeModel::ItemChange::Remove, id, CodeModelItem::Unknown});
+}
+
+void IndexUpdateBatch::addUse(const DeclarationId& id, const IndexedTopDUContext& use)
+{
+  d->m_uses[id].add(use);
+}
+
+void IndexUpdateBatch::removeUse(const DeclarationId& id, const IndexedTopDUContext& use)
+{
+  d->m_uses[id].remove(use);
+}
+
+void IndexUpdateBatch::addDefinition(const DeclarationId& id, const IndexedDeclaration& definition)
+{
+  d->m_definitions[id].add(definition);
+}
+
+void IndexUpdateBatch::removeDefinition(const DeclarationId& id, const IndexedDeclaration& definition)
+{
+  d->m_definitions[id].remove(definition);
+}
+
+void IndexUpdateBatch::addImporter(const DeclarationId& id, const IndexedDUContext& importer)
+{
+  d->m_importers[id].add(importer);
+}
+
+void IndexUpdateBatch::removeImporter(const DeclarationId& id, const IndexedDUContext& importer)
+{
+  d->m_importers[id].remove(importer);
+}
@@ -0,0 +1,95 @@
+/*
+   This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef KDEVPLATFORM_INDEXUPDATEBATCH_H
+#define KDEVPLATFORM_INDEXUPDATEBATCH_H
+
+#include <language/languageexport.h>
+
+#include "codemodel.h"
+
+#include <QScopedPointer>
+
+namespace KDevelop {
+
+class DeclarationId;
+class IndexedDeclaration;
+class IndexedDUContext;
+class IndexedTopDUContext;
+class IndexedQualifiedIdentifier;
+class IndexedString;
+
+/**
+ * Collects changes to the global DUChain indices made by the current thread, and applies them grouped by key.
+ *
+ * While a batch exists, the changes that the current thread makes to PersistentSymbolTable, CodeModel, Uses,
+ * Definitions and Importers are recorded instead of being applied. When the batch is destroyed, all changes
+ * to the same key are applied together, so each list is locked and rewritten once instead of once per item.
+ * If the current thread reads one of these indices, the pending changes are applied first.
+ *
+ * Changes may only be recorded while the DUChain is write-locked. The pending changes are also applied when the
+ * current thread releases its outermost write lock, so other threads never see the indices while changes are
+ * pending. A batch may therefore span a whole build that locks the DUChain several times, and groups the changes
+ * made under each lock.
+ *
+ * Batches can be nested. The changes are then collected and applied by the outermost batch.
+ */
+class KDEVPLATFORMLANGUAGE_EXPORT IndexUpdateBatch
+{
+public:
+  IndexUpdateBatch();
+  ~IndexUpdateBatch();
+
+  ///Applies the pending changes now, the batch stays active.
+  void apply();
+
+  ///Returns the outermost batch of the current thread, or zero if there is none.
+  static IndexUpdateBatch* current();
+
+  ///Applies the pending changes of the current thread, if any.
+  ///The indices call this before they are read.
+  static void applyCurrent();
+
+  ///@name Recording
+  ///The indices call these on current() instead of changing their lists.
+  ///@{
+  void addDeclaration(const IndexedQualifiedIdentifier& id, const IndexedDeclaration& declaration);
+  void removeDeclaration(const IndexedQualifiedIdentifier& id, const IndexedDeclaration& declaration);
+
+  void addCodeModelItem(const IndexedString& file, const IndexedQualifiedIdentifier& id, CodeModelItem::Kind kind);
+  void updateCodeModelItem(const IndexedString& file, const IndexedQualifiedIdentifier& id, CodeModelItem::Kind kind);
+  void removeCodeModelItem(const IndexedString& file, const IndexedQualifiedIdentifier& id);
+
+  void addUse(const DeclarationId& id, const IndexedTopDUContext& use);
+  void removeUse(const DeclarationId& id, const IndexedTopDUContext& use);
+
+  void addDefinition(const DeclarationId& id, const IndexedDeclaration& definition);
+  void removeDefinition(const DeclarationId& id, const IndexedDeclaration& definition);
+
+  void addImporter(const DeclarationId& id, const IndexedDUContext& importer);
+  void removeImporter(const DeclarationId& id, const IndexedDUContext& importer);
+  ///@}
+
+private:
+  Q_DISABLE_COPY(IndexUpdateBatch)
+  const QScopedPointer<class IndexUpdateBatchPrivate> d;
+};
+
+}
+
+#endif // KDEVPLATFORM_INDEXUPDATEBATCH_H
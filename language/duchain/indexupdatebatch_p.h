@@ -0,0 +1,104 @@
+/*
+   This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef KDEVPLATFORM_INDEXUPDATEBATCH_P_H
+#define KDEVPLATFORM_INDEXUPDATEBATCH_P_H
+
+#include <util/kdevvarlengtharray.h>
+
+#include <algorithm>
+
+namespace KDevelop {
+
+/**
+ * Applies a batch of changes to a list that is used as a set.
+ *
+ * Appends the values of @p oldValues that are not free and not in @p removed, together with the values of
+ * @p added, to the empty list @p result, sorted and without duplicates. Values for which @p isFree returns
+ * true are skipped, which allows passing the data of an embedded free tree.
+ *
+ * Old values that are not sorted yet are sorted first. Apart from that, the merge is linear in the size of the
+ * list, plus sorting the changes.
+ *
+ * @returns whether the set was changed
+ */
+template<class Value, class List, class IsFree>
+bool mergeSetChanges(const Value* oldValues, uint oldSize, KDevVarLengthArray<Value> added,
+                     KDevVarLengthArray<Value> removed, List& result, IsFree isFree)
+{
+  Q_ASSERT(result.isEmpty());
+
+  std::sort(removed.begin(), removed.end());
+  std::sort(added.begin(), added.end());
+
+  result.reserve(oldSize + added.size());
+  for (uint a = 0; a < oldSize; ++a) {
+    if (!isFree(oldValues[a]))
+      result.append(oldValues[a]);
+  }
+  if (!std::is_sorted(result.begin(), result.end()))
+    std::sort(result.begin(), result.end());
+
+  bool changed = false;
+
+  //Drop the removed values in one pass over both sorted ranges
+  if (!removed.isEmpty()) {
+    const Value* removedIt = removed.constBegin();
+    int kept = 0;
+    for (int a = 0; a < result.size(); ++a) {
+      while (removedIt != removed.constEnd() && *removedIt < result[a])
+        ++removedIt;
+      if (removedIt != removed.constEnd() && !(result[a] < *removedIt))
+        changed = true;
+      else
+        result[kept++] = result[a];
+    }
+    result.resize(kept);
+  }
+
+  //Append the added values that are not there yet, and merge them into the sorted list
+  const int oldCount = result.size();
+  int position = 0;
+  for (const Value& value : added) {
+    while (position < oldCount && result[position] < value)
+      ++position;
+    if (position < oldCount && !(value < result[position]))
+      continue;
+    if (result.size() > oldCount && !(result[result.size() - 1] < value))
+      continue;
+    result.append(value);
+  }
+  if (result.size() != oldCount) {
+    std::inplace_merge(result.begin(), result.begin() + oldCount, result.end());
+    changed = true;
+  }
+
+  return changed;
+}
+
+///Overload for plain lists without free items
+template<class Value, class List>
+bool mergeSetChanges(const Value* oldValues, uint oldSize, const KDevVarLengthArray<Value>& added,
+                     const KDevVarLengthArray<Value>& removed, List& result)
+{
+  return mergeSetChanges(oldValues, oldSize, added, removed, result, [](const Value&) { return false; });
+}
+
+}
+
+#endif // KDEVPLATFORM_INDEXUPDATEBATCH_P_H
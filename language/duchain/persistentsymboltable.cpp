@@ -18,8 +18,12 @@
 
 #include "persistentsymboltable.h"
 
+#include <QFile>
+#include <QSaveFile>
 #include <QHash>
 
+#include <algorithm>
+
 #include "declaration.h"
 #include "declarationid.h"
 #include "appendedlist.h"
@@ -29,13 +33,58 @@
 #include "topducontext.h"
 #include "duchain.h"
 #include "duchainlock.h"
+#include "indexupdatebatch.h"
+#include "indexupdatebatch_p.h"
+#include <debug.h>
 #include <util/embeddedfreetree.h>
 
 //For now, just _always_ use the cache
 const uint MinimumCountForCache = 1;
 
+//clearCache() evicts the least recently used filtered declaration lists and converted import sets beyond these counts
+const int MaxCachedDeclarationLists = 20000;
+const int MaxCachedImports = 500;
+
+const uint CacheFileMagic = 0x53594d43; // "SYMC"
+const uint CacheFileVersion = 2;
+
 namespace {
 QDebug fromTextStream(const QTextStream& out) { if (out.device()) return {out.device()}; return {out.string()}; }
+
+QString cacheFileName()
+{
+  return KDevelop::globalItemRepositoryRegistry().path() + QLatin1String("/symbol_table_cache");
+}
+
+///A checksum of the contents of a visibility set, so a stored set-index can be recognized when it was reused for another set
+uint computeVisibilityFingerprint(const std::set<uint>& indices)
+{
+  uint ret = 2166136261u;
+  for (uint index : indices)
+    ret = (ret ^ index) * 16777619u;
+  return (ret ^ uint(indices.size())) * 16777619u;
+}
+
+///A checksum of the declarations of an identifier, so a persisted filtered list is only used when it was filtered from the same declarations
+uint computeDeclarationsHash(const KDevelop::PersistentSymbolTable::Declarations& declarations)
+{
+  uint ret = 2166136261u;
+  uint count = 0;
+  for (auto it = declarations.iterator(); it; ++it, ++count) {
+    ret = (ret ^ it->topContextIndex()) * 16777619u;
+    ret = (ret ^ it->localIndex()) * 16777619u;
+  }
+  return (ret ^ count) * 16777619u;
+}
+
+///Returns the last-use stamp up to which entries have to be dropped, so @p keep of the given stamps remain
+quint64 evictionThreshold(QVector<quint64> stamps, int keep)
+{
+  const int drop = stamps.size() - keep;
+  Q_ASSERT(drop > 0);
+  std::nth_element(stamps.begin(), stamps.begin() + drop - 1, stamps.end());
+  return stamps[drop - 1];
+}
 }
 
 namespace KDevelop {
@@ -122,12 +171,30 @@ class PersistentSymbolTableRequestItem {
 template<class ValueType>
 struct CacheEntry {
   
-  typedef KDevVarLengthArray<ValueType> Data;
+  struct Data {
+    KDevVarLengthArray<ValueType> values;
+    uint visibilityFingerprint = 0;
+    quint64 lastUse = 0;
+  };
   typedef QHash<TopDUContext::IndexedRecursiveImports, Data > DataHash;
   
   DataHash m_hash;
 };
 
+struct ImportsCacheEntry {
+  PersistentSymbolTable::CachedIndexedRecursiveImports imports;
+  uint visibilityFingerprint = 0;
+  quint64 lastUse = 0;
+};
+
+///A filtered declaration list read from the cache file, which is only trusted once it is validated on first use
+struct PersistedCacheEntry {
+  uint identifierHash = 0;
+  uint declarationsHash = 0;
+  uint visibilityFingerprint = 0;
+  QVector<IndexedDeclaration> declarations;
+};
+
 class PersistentSymbolTablePrivate
 {
 public:
@@ -139,9 +206,135 @@ public:
   
   
   QHash<IndexedQualifiedIdentifier, CacheEntry<IndexedDeclaration> > m_declarationsCache;
+  int m_cachedDeclarationLists = 0;
   
   //We cache the imports so the currently used nodes are very close in memory, which leads to much better CPU cache utilization
-  QHash<TopDUContext::IndexedRecursiveImports, PersistentSymbolTable::CachedIndexedRecursiveImports> m_importsCache;
+  QHash<TopDUContext::IndexedRecursiveImports, ImportsCacheEntry> m_importsCache;
+
+  //Filtered declaration lists from the previous session, by identifier index and visibility set index
+  QHash<uint, QHash<uint, PersistedCacheEntry> > m_persistedCache;
+
+  quint64 m_useCounter = 0;
+
+  //Statistics for dump()
+  quint64 m_cacheHits = 0;
+  quint64 m_persistedCacheHits = 0;
+  quint64 m_cacheMisses = 0;
+  quint64 m_cacheInvalidations = 0;
+  quint64 m_cacheEvictions = 0;
+
+  const ImportsCacheEntry& cachedImports(const TopDUContext::IndexedRecursiveImports& visibility) {
+    auto it = m_importsCache.find(visibility);
+    if(it == m_importsCache.end()) {
+      const std::set<uint> indices = visibility.set().stdSet();
+      it = m_importsCache.insert(visibility, ImportsCacheEntry());
+      it->imports = PersistentSymbolTable::CachedIndexedRecursiveImports(indices);
+      it->visibilityFingerprint = computeVisibilityFingerprint(indices);
+    }
+    it->lastUse = ++m_useCounter;
+    return *it;
+  }
+
+  ///Drops the cached declaration lists of @p id that @p declaration is visible in, the others stay valid.
+  void invalidateCache(const IndexedQualifiedIdentifier& id, const IndexedDeclaration& declaration) {
+    //Whether the declaration is visible cannot be checked for persisted entries, the stored set-index may be outdated
+    m_persistedCache.remove(id.getIndex());
+
+    auto it = m_declarationsCache.find(id);
+    if(it == m_declarationsCache.end())
+      return;
+
+    const IndexedTopDUContext top = declaration.indexedTopContext();
+    for(auto cacheIt = it->m_hash.begin(); cacheIt != it->m_hash.end(); ) {
+      if(cacheIt.key().contains(top)) {
+        cacheIt = it->m_hash.erase(cacheIt);
+        --m_cachedDeclarationLists;
+        ++m_cacheInvalidations;
+      }else{
+        ++cacheIt;
+      }
+    }
+
+    if(it->m_hash.isEmpty())
+      m_declarationsCache.erase(it);
+  }
+
+  PersistentSymbolTable::Declarations declarations(const IndexedQualifiedIdentifier& id) const {
+    PersistentSymbolTableItem item;
+    item.id = id;
+    const uint index = m_declarations.findIndex(item);
+    if(!index)
+      return PersistentSymbolTable::Declarations();
+    const PersistentSymbolTableItem* repositoryItem = m_declarations.itemFromIndex(index);
+    return PersistentSymbolTable::Declarations(repositoryItem->declarations(), repositoryItem->declarationsSize(), repositoryItem->centralFreeItem);
+  }
+
+  ///Moves the persisted declaration list for @p id and @p visibility into @p target, if there is one and it is still valid.
+  ///The list is valid if it was filtered from the same @p declarations with a visibility set of the same contents.
+  bool takePersistedDeclarations(const IndexedQualifiedIdentifier& id, const TopDUContext::IndexedRecursiveImports& visibility,
+                                 uint fingerprint, const PersistentSymbolTable::Declarations& declarations,
+                                 KDevVarLengthArray<IndexedDeclaration>& target) {
+    auto idIt = m_persistedCache.find(id.getIndex());
+    if(idIt == m_persistedCache.end())
+      return false;
+    auto it = idIt->find(visibility.set().setIndex());
+    if(it == idIt->end())
+      return false;
+
+    const bool valid = it->visibilityFingerprint == fingerprint && it->identifierHash == id.identifier().hash()
+                       && it->declarationsHash == computeDeclarationsHash(declarations);
+    if(valid) {
+      for(const IndexedDeclaration& declaration : it->declarations)
+        target.append(declaration);
+    }
+
+    idIt->erase(it);
+    if(idIt->isEmpty())
+      m_persistedCache.erase(idIt);
+    return valid;
+  }
+
+  void evictLeastRecentlyUsed() {
+    if(m_cachedDeclarationLists > MaxCachedDeclarationLists) {
+      QVector<quint64> stamps;
+      stamps.reserve(m_cachedDeclarationLists);
+      for(const auto& entry : m_declarationsCache)
+        for(const auto& data : entry.m_hash)
+          stamps.append(data.lastUse);
+
+      const quint64 threshold = evictionThreshold(stamps, MaxCachedDeclarationLists);
+      for(auto it = m_declarationsCache.begin(); it != m_declarationsCache.end(); ) {
+        for(auto cacheIt = it->m_hash.begin(); cacheIt != it->m_hash.end(); ) {
+          if(cacheIt->lastUse <= threshold) {
+            cacheIt = it->m_hash.erase(cacheIt);
+            --m_cachedDeclarationLists;
+            ++m_cacheEvictions;
+          }else{
+            ++cacheIt;
+          }
+        }
+        if(it->m_hash.isEmpty())
+          it = m_declarationsCache.erase(it);
+        else
+          ++it;
+      }
+    }
+
+    if(m_importsCache.size() > MaxCachedImports) {
+      QVector<quint64> stamps;
+      stamps.reserve(m_importsCache.size());
+      for(const auto& entry : m_importsCache)
+        stamps.append(entry.lastUse);
+
+      const quint64 threshold = evictionThreshold(stamps, MaxCachedImports);
+      for(auto it = m_importsCache.begin(); it != m_importsCache.end(); ) {
+        if(it->lastUse <= threshold)
+          it = m_importsCache.erase(it);
+        else
+          ++it;
+      }
+    }
+  }
 };
 
 void PersistentSymbolTable::clearCache()
@@ -149,8 +342,96 @@ void PersistentSymbolTable::clearCache()
   ENSURE_CHAIN_WRITE_LOCKED
   {
     QMutexLocker lock(d->m_declarations.mutex());
-    d->m_importsCache.clear();
-    d->m_declarationsCache.clear();
+    d->evictLeastRecentlyUsed();
+  }
+}
+
+QByteArray PersistentSymbolTable::serializeCache() const
+{
+  ENSURE_CHAIN_READ_LOCKED
+  QMutexLocker lock(d->m_declarations.mutex());
+
+  QVector<uint> data;
+  data << CacheFileMagic << CacheFileVersion << 0;
+  uint entries = 0;
+
+  auto appendEntry = [&data, &entries](uint idIndex, uint idHash, uint declarationsHash, uint visibilityIndex, uint fingerprint,
+                                       const IndexedDeclaration* declarations, int count) {
+    data << idIndex << idHash << declarationsHash << visibilityIndex << fingerprint << count;
+    for(int a = 0; a < count; ++a)
+      data << declarations[a].topContextIndex() << declarations[a].localIndex();
+    ++entries;
+  };
+
+  for(auto it = d->m_declarationsCache.constBegin(); it != d->m_declarationsCache.constEnd(); ++it) {
+    const uint idHash = it.key().identifier().hash();
+    //The cached lists are up to date with the current declarations, as changes of visible declarations drop them
+    const uint declarationsHash = computeDeclarationsHash(d->declarations(it.key()));
+    for(auto cacheIt = it->m_hash.constBegin(); cacheIt != it->m_hash.constEnd(); ++cacheIt)
+      appendEntry(it.key().getIndex(), idHash, declarationsHash, cacheIt.key().set().setIndex(), cacheIt->visibilityFingerprint,
+                  cacheIt->values.constData(), cacheIt->values.size());
+  }
+
+  //Keep the entries from the previous session that were not needed yet, as far as they fit
+  for(auto it = d->m_persistedCache.constBegin(); it != d->m_persistedCache.constEnd() && entries < (uint)MaxCachedDeclarationLists; ++it) {
+    for(auto cacheIt = it->constBegin(); cacheIt != it->constEnd(); ++cacheIt)
+      appendEntry(it.key(), cacheIt->identifierHash, cacheIt->declarationsHash, cacheIt.key(), cacheIt->visibilityFingerprint,
+                  cacheIt->declarations.constData(), cacheIt->declarations.size());
+  }
+  data[2] = entries;
+
+  return QByteArray(reinterpret_cast<const char*>(data.constData()), data.size() * sizeof(uint));
+}
+
+void PersistentSymbolTable::writeCache(const QByteArray& cache)
+{
+  //The cache is not covered by the item-repository journal. It is replaced atomically, so it is never torn, and since
+  //each entry is validated against the declarations it was filtered from, it cannot disagree with recovered repositories.
+  QSaveFile f(cacheFileName());
+  if(!f.open(QIODevice::WriteOnly)) {
+    qCWarning(LANGUAGE) << "cannot write the symbol table cache to" << f.fileName() << f.errorString();
+    return;
+  }
+  f.write(cache);
+  if(!f.commit())
+    qCWarning(LANGUAGE) << "cannot write the symbol table cache to" << f.fileName() << f.errorString();
+}
+
+void PersistentSymbolTable::loadCache()
+{
+  QMutexLocker lock(d->m_declarations.mutex());
+  d->m_persistedCache.clear();
+
+  QFile f(cacheFileName());
+  if(!f.open(QIODevice::ReadOnly))
+    return;
+
+  QVector<uint> data(int(f.size() / sizeof(uint)));
+  if(f.read(reinterpret_cast<char*>(data.data()), data.size() * sizeof(uint)) != qint64(data.size() * sizeof(uint))
+     || data.size() < 3 || data[0] != CacheFileMagic || data[1] != CacheFileVersion) {
+    qCDebug(LANGUAGE) << "ignoring invalid symbol table cache" << f.fileName();
+    return;
+  }
+
+  const uint entries = data[2];
+  int pos = 3;
+  for(uint a = 0; a < entries; ++a) {
+    if(pos + 6 > data.size())
+      break;
+    const uint idIndex = data[pos];
+    const uint visibilityIndex = data[pos + 3];
+    PersistedCacheEntry entry;
+    entry.identifierHash = data[pos + 1];
+    entry.declarationsHash = data[pos + 2];
+    entry.visibilityFingerprint = data[pos + 4];
+    const uint count = data[pos + 5];
+    pos += 6;
+    if(uint(data.size() - pos) / 2 < count)
+      break;
+    entry.declarations.reserve(count);
+    for(uint b = 0; b < count; ++b, pos += 2)
+      entry.declarations.append(IndexedDeclaration(data[pos], data[pos + 1]));
+    d->m_persistedCache[idIndex].insert(visibilityIndex, entry);
   }
 }
 
@@ -168,10 +449,16 @@ PersistentSymbolTable::~PersistentSymbolTable()
 
 void PersistentSymbolTable::addDeclaration(const IndexedQualifiedIdentifier& id, const IndexedDeclaration& declaration)
 {
+  if(IndexUpdateBatch* batch = IndexUpdateBatch::current()) {
+    ENSURE_CHAIN_WRITE_LOCKED
+    batch->addDeclaration(id, declaration);
+    return;
+  }
+
   QMutexLocker lock(d->m_declarations.mutex());
   ENSURE_CHAIN_WRITE_LOCKED
   
-  d->m_declarationsCache.remove(id);
+  d->invalidateCache(id, declaration);
   
   PersistentSymbolTableItem item;
   item.id = id;
@@ -214,11 +501,16 @@ void PersistentSymbolTable::addDeclaration(const IndexedQualifiedIdentifier& id,
 
 void PersistentSymbolTable::removeDeclaration(const IndexedQualifiedIdentifier& id, const IndexedDeclaration& declaration)
 {
+  if(IndexUpdateBatch* batch = IndexUpdateBatch::current()) {
+    ENSURE_CHAIN_WRITE_LOCKED
+    batch->removeDeclaration(id, declaration);
+    return;
+  }
+
   QMutexLocker lock(d->m_declarations.mutex());
   ENSURE_CHAIN_WRITE_LOCKED
   
-  d->m_declarationsCache.remove(id);
-  Q_ASSERT(!d->m_declarationsCache.contains(id));
+  d->invalidateCache(id, declaration);
   
   PersistentSymbolTableItem item;
   item.id = id;
@@ -258,6 +550,40 @@ void PersistentSymbolTable::removeDeclaration(const IndexedQualifiedIdentifier&
     d->m_declarations.index(request);
 }
 
+void PersistentSymbolTable::changeDeclarations(const IndexedQualifiedIdentifier& id, const KDevVarLengthArray<IndexedDeclaration>& added,
+                                               const KDevVarLengthArray<IndexedDeclaration>& removed)
+{
+  QMutexLocker lock(d->m_declarations.mutex());
+  ENSURE_CHAIN_WRITE_LOCKED
+  
+  for(const IndexedDeclaration& declaration : added)
+    d->invalidateCache(id, declaration);
+  for(const IndexedDeclaration& declaration : removed)
+    d->invalidateCache(id, declaration);
+  
+  PersistentSymbolTableItem item;
+  item.id = id;
+  PersistentSymbolTableRequestItem request(item);
+  
+  uint index = d->m_declarations.findIndex(item);
+  const PersistentSymbolTableItem* oldItem = index ? d->m_declarations.itemFromIndex(index) : nullptr;
+  
+  //Build a new sorted list without free items, which is a valid embedded tree as well
+  auto& declarations(item.declarationsList());
+  if(!mergeSetChanges(oldItem ? oldItem->declarations() : nullptr, oldItem ? oldItem->declarationsSize() : 0, added, removed, declarations,
+                      &IndexedDeclarationHandler::isFree))
+    return;
+  
+  if(index) {
+    d->m_declarations.deleteItem(index);
+    Q_ASSERT(!d->m_declarations.findIndex(request));
+  }
+  
+  //This inserts the changed item
+  if(!declarations.isEmpty())
+    d->m_declarations.index(request);
+}
+
 struct DeclarationCacheVisitor {
   explicit DeclarationCacheVisitor(KDevVarLengthArray<IndexedDeclaration>& _cache) : cache(_cache) {
   }
@@ -272,34 +598,37 @@ struct DeclarationCacheVisitor {
 
 PersistentSymbolTable::FilteredDeclarationIterator PersistentSymbolTable::getFilteredDeclarations(const IndexedQualifiedIdentifier& id, const TopDUContext::IndexedRecursiveImports& visibility) const {
   
+  IndexUpdateBatch::applyCurrent();
   QMutexLocker lock(d->m_declarations.mutex());
   ENSURE_CHAIN_READ_LOCKED
   
   Declarations decls = getDeclarations(id).iterator();
   
-  CachedIndexedRecursiveImports cachedImports;
-  
-  QHash<TopDUContext::IndexedRecursiveImports, CachedIndexedRecursiveImports>::const_iterator it = d->m_importsCache.constFind(visibility);
-  if(it != d->m_importsCache.constEnd()) {
-    cachedImports = *it;
-  }else{
-    cachedImports = CachedIndexedRecursiveImports(visibility.set().stdSet());
-    d->m_importsCache.insert(visibility, cachedImports);
-  }
+  const ImportsCacheEntry& importsEntry = d->cachedImports(visibility);
+  const CachedIndexedRecursiveImports cachedImports = importsEntry.imports;
   
   if(decls.dataSize() > MinimumCountForCache)
   {
     //Do visibility caching
     CacheEntry<IndexedDeclaration>& cached(d->m_declarationsCache[id]);
-    CacheEntry<IndexedDeclaration>::DataHash::const_iterator cacheIt = cached.m_hash.constFind(visibility);
-    if(cacheIt != cached.m_hash.constEnd())
-      return FilteredDeclarationIterator(Declarations::Iterator(cacheIt->constData(), cacheIt->size(), -1), cachedImports);
+    CacheEntry<IndexedDeclaration>::DataHash::iterator cacheIt = cached.m_hash.find(visibility);
+    if(cacheIt != cached.m_hash.end()) {
+      ++d->m_cacheHits;
+      cacheIt->lastUse = ++d->m_useCounter;
+      return FilteredDeclarationIterator(Declarations::Iterator(cacheIt->values.constData(), cacheIt->values.size(), -1), cachedImports);
+    }
 
-    CacheEntry<IndexedDeclaration>::DataHash::iterator insertIt = cached.m_hash.insert(visibility, KDevVarLengthArray<IndexedDeclaration>());
+    CacheEntry<IndexedDeclaration>::DataHash::iterator insertIt = cached.m_hash.insert(visibility, CacheEntry<IndexedDeclaration>::Data());
+    ++d->m_cachedDeclarationLists;
+    insertIt->visibilityFingerprint = importsEntry.visibilityFingerprint;
+    insertIt->lastUse = ++d->m_useCounter;
     
-    KDevVarLengthArray<IndexedDeclaration>& cache(*insertIt);
+    KDevVarLengthArray<IndexedDeclaration>& cache(insertIt->values);
     
-    {
+    if(d->takePersistedDeclarations(id, visibility, insertIt->visibilityFingerprint, decls, cache)) {
+      ++d->m_persistedCacheHits;
+    }else{
+      ++d->m_cacheMisses;
       typedef ConvenientEmbeddedSetTreeFilterVisitor<IndexedDeclaration, IndexedDeclarationHandler, IndexedTopDUContext, CachedIndexedRecursiveImports, DeclarationTopContextExtractor, DeclarationCacheVisitor> FilteredDeclarationCacheVisitor;
     
       //The visitor visits all the declarations from within its constructor
@@ -314,24 +643,16 @@ PersistentSymbolTable::FilteredDeclarationIterator PersistentSymbolTable::getFil
 }
 
 PersistentSymbolTable::Declarations PersistentSymbolTable::getDeclarations(const IndexedQualifiedIdentifier& id) const {
+  IndexUpdateBatch::applyCurrent();
   QMutexLocker lock(d->m_declarations.mutex());
   ENSURE_CHAIN_READ_LOCKED
   
-  PersistentSymbolTableItem item;
-  item.id = id;
-  
-  uint index = d->m_declarations.findIndex(item);
-  
-  if(index) {
-    const PersistentSymbolTableItem* repositoryItem = d->m_declarations.itemFromIndex(index);
-    return PersistentSymbolTable::Declarations(repositoryItem->declarations(), repositoryItem->declarationsSize(), repositoryItem->centralFreeItem);
-  }else{
-    return PersistentSymbolTable::Declarations();
-  }
+  return d->declarations(id);
 }
 
 void PersistentSymbolTable::declarations(const IndexedQualifiedIdentifier& id, uint& countTarget, const IndexedDeclaration*& declarationsTarget) const
 {
+  IndexUpdateBatch::applyCurrent();
   QMutexLocker lock(d->m_declarations.mutex());
   ENSURE_CHAIN_READ_LOCKED
   
@@ -411,6 +732,10 @@ void PersistentSymbolTable::dump(const QTextStream& out)
 
     qout << "Statistics:" << endl;
     qout << d->m_declarations.statistics() << endl;
+
+    qout << "Filtered declarations cache:" << d->m_cachedDeclarationLists << "lists," << d->m_importsCache.size() << "import sets,"
+         << "hits:" << d->m_cacheHits << "hits from the previous session:" << d->m_persistedCacheHits << "misses:" << d->m_cacheMisses
+         << "invalidations:" << d->m_cacheInvalidations << "evictions:" << d->m_cacheEvictions << endl;
   }
 }
 
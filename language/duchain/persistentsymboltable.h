@@ -104,6 +104,12 @@ struct KDEVPLATFORMLANGUAGE_EXPORT RecursiveImportCacheRepository {
     ///@warning DUChain must be write locked
     void removeDeclaration(const IndexedQualifiedIdentifier& id, const IndexedDeclaration& declaration);
 
+    ///Adds and removes several declarations with id @p id at once, rewriting the list only once.
+    ///@p added and @p removed must not overlap. @see IndexUpdateBatch
+    ///@warning DUChain must be write locked
+    void changeDeclarations(const IndexedQualifiedIdentifier& id, const KDevVarLengthArray<IndexedDeclaration>& added,
+                            const KDevVarLengthArray<IndexedDeclaration>& removed);
+    
     ///Retrieves all the declarations for a given IndexedQualifiedIdentifier in an efficient way.
     ///@param id The IndexedQualifiedIdentifier for which the declarations should be retrieved
     ///@param count A reference that will be filled with the count of retrieved declarations
@@ -132,9 +138,20 @@ struct KDEVPLATFORMLANGUAGE_EXPORT RecursiveImportCacheRepository {
     //Very expensive: Checks for problems in the symbol table
     void dump(const QTextStream& out);
     
-    //Clears the internal cache. Should be called regularly to save memory
-    //The duchain must be read-locked
+    //Shrinks the internal cache by dropping the least recently used entries. Should be called regularly to save memory
+    //The duchain must be write-locked, since iterators returned by getFilteredDeclarations() may point into the cache
     void clearCache();
+
+    //Returns the cached filtered declarations in the form writeCache() stores them
+    //The duchain must be read-locked
+    QByteArray serializeCache() const;
+
+    //Writes a cache returned by serializeCache() next to the item-repositories, so the next session can reuse it
+    //Needs no lock, so the file can be written after the duchain was unlocked
+    static void writeCache(const QByteArray& cache);
+
+    //Reads the cache written by writeCache(). Each entry is validated against the current repositories before it is used
+    void loadCache();
     
     private:
       // cannot use QScopedPointer yet, see comment in ~PersistentSymbolTable()
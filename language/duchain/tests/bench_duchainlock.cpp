@@ -0,0 +1,92 @@
+/*
+ * This file is part of KDevelop
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "bench_duchainlock.h"
+
+#include <language/duchain/duchainlock.h>
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QTest>
+
+#include <thread>
+#include <vector>
+
+QTEST_GUILESS_MAIN(BenchDUChainLock);
+
+using namespace KDevelop;
+
+void BenchDUChainLock::contention_data()
+{
+  QTest::addColumn<int>("readers");
+  QTest::addColumn<int>("writers");
+
+  QTest::newRow("readers-only") << 8 << 0;
+  QTest::newRow("writers-only") << 0 << 8;
+  QTest::newRow("1-writer") << 8 << 1;
+  QTest::newRow("4-writers") << 8 << 4;
+  QTest::newRow("many-readers") << 32 << 2;
+}
+
+void BenchDUChainLock::contention()
+{
+  QFETCH(int, readers);
+  QFETCH(int, writers);
+
+  const int iterations = 20000;
+
+  DUChainLock lock;
+  // the data protected by the lock, a plain int so a broken lock shows up as lost increments
+  int protectedValue = 0;
+  QAtomicInt observedWrites;
+
+  auto read = [&]() {
+    for (int i = 0; i < iterations; ++i) {
+      DUChainReadLocker locker(&lock);
+      if (protectedValue) {
+        observedWrites.ref();
+      }
+    }
+  };
+  auto write = [&]() {
+    for (int i = 0; i < iterations; ++i) {
+      DUChainWriteLocker locker(&lock);
+      ++protectedValue;
+    }
+  };
+
+  QElapsedTimer timer;
+  QBENCHMARK_ONCE {
+    timer.start();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < readers; ++i) {
+      threads.emplace_back(read);
+    }
+    for (int i = 0; i < writers; ++i) {
+      threads.emplace_back(write);
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+
+  const qint64 elapsed = qMax(timer.elapsed(), qint64(1));
+  qDebug() << readers << "readers" << writers << "writers:" << (qint64(readers + writers) * iterations / elapsed) << "acquisitions/ms";
+  QCOMPARE(protectedValue, writers * iterations);
+}
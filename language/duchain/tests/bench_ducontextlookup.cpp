@@ -0,0 +1,112 @@
+/*
+ * This file is part of KDevelop
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "bench_ducontextlookup.h"
+
+#include <language/duchain/duchain.h>
+#include <language/duchain/duchainlock.h>
+#include <language/duchain/declaration.h>
+#include <language/duchain/topducontext.h>
+#include <serialization/indexedstring.h>
+
+#include <tests/testcore.h>
+#include <tests/autotestshell.h>
+
+#include <QTest>
+
+QTEST_GUILESS_MAIN(BenchDUContextLookup);
+
+using namespace KDevelop;
+
+namespace {
+
+// like a large generated file, with everything directly in the top context
+const int lines = 50000;
+const int contextEvery = 10;
+const int lookups = 1000;
+
+CursorInRevision lookupPosition(int i)
+{
+  return {int(qint64(i) * 7919 % lines), 5};
+}
+
+}
+
+void BenchDUContextLookup::initTestCase()
+{
+  AutoTestShell::init();
+  TestCore::initialize(Core::NoUi);
+
+  DUChainWriteLocker lock;
+  m_top = new TopDUContext(IndexedString(QStringLiteral("/tmp/bench_ducontextlookup.cpp")), {0, 0, lines, 0});
+  DUChain::self()->addDocumentChain(m_top);
+  for (int line = 0; line < lines; ++line) {
+    if (line % contextEvery == 0) {
+      new DUContext({line, 0, line + contextEvery - 1, 0}, m_top);
+    } else if (line % contextEvery == contextEvery - 1) {
+      new Declaration({line, 0, line, 10}, m_top);
+    }
+    m_top->createUse(-1, {line, 4, line, 8});
+  }
+}
+
+void BenchDUContextLookup::cleanupTestCase()
+{
+  {
+    DUChainWriteLocker lock;
+    DUChain::self()->removeDocumentChain(m_top);
+  }
+  TestCore::shutdown();
+}
+
+void BenchDUContextLookup::findUseAt()
+{
+  DUChainReadLocker lock;
+  int found = 0;
+  QBENCHMARK {
+    for (int i = 0; i < lookups; ++i) {
+      found += m_top->findUseAt(lookupPosition(i)) != -1;
+    }
+  }
+  QVERIFY(found > 0);
+}
+
+void BenchDUContextLookup::findContextAt()
+{
+  DUChainReadLocker lock;
+  int found = 0;
+  QBENCHMARK {
+    for (int i = 0; i < lookups; ++i) {
+      found += m_top->findContextAt(lookupPosition(i)) != m_top;
+    }
+  }
+  QVERIFY(found > 0);
+}
+
+void BenchDUContextLookup::findDeclarationAt()
+{
+  DUChainReadLocker lock;
+  int found = 0;
+  QBENCHMARK {
+    for (int i = 0; i < lookups; ++i) {
+      found += m_top->findDeclarationAt(lookupPosition(i)) != nullptr;
+    }
+  }
+  QVERIFY(found > 0);
+}
@@ -313,3 +313,96 @@ void BenchHashes::typeRepo_data()
   QTest::newRow("unordered_map") << 5;
   QTest::newRow("nested-vector") << 6;
 }
+
+/// paths like the ones of a medium sized C++ project
+static QVector<QByteArray> pathCorpus()
+{
+  const QVector<QByteArray> directories = {
+    "/home/developer/projects/kdevelop/kdevplatform/language/duchain/",
+    "/home/developer/projects/kdevelop/kdevplatform/language/backgroundparser/",
+    "/home/developer/projects/kdevelop/kdevplatform/plugins/projectmanagerview/",
+    "/usr/include/x86_64-linux-gnu/qt5/QtCore/",
+    "/usr/include/c++/6/bits/"
+  };
+  QVector<QByteArray> ret;
+  for (int i = 0; i < 2000; ++i) {
+    ret << directories.at(i % directories.size()) + "source_file_" + QByteArray::number(i) + (i % 2 ? ".cpp" : ".h");
+  }
+  return ret;
+}
+
+/// qualified identifiers and member names as they occur in the symbol table
+static QVector<QByteArray> identifierCorpus()
+{
+  const QVector<QByteArray> scopes = {"", "KDevelop::", "KDevelop::DUChainPointer<Declaration>::", "std::", "m_"};
+  QVector<QByteArray> ret;
+  for (int i = 0; i < 2000; ++i) {
+    ret << scopes.at(i % scopes.size()) + "identifier" + QByteArray::number(i);
+  }
+  return ret;
+}
+
+void BenchHashes::hashString()
+{
+  QFETCH(QVector<QByteArray>, corpus);
+  QFETCH(bool, reference);
+
+  uint sum = 0;
+  if (reference) {
+    // the byte-wise RunningHash that hashString has to stay compatible with
+    QBENCHMARK {
+      foreach (const QByteArray& text, corpus) {
+        IndexedString::RunningHash running;
+        for (char c : text) {
+          running.append(c);
+        }
+        sum += running.hash;
+      }
+    }
+  } else {
+    QBENCHMARK {
+      foreach (const QByteArray& text, corpus) {
+        sum += IndexedString::hashString(text.constData(), text.size());
+      }
+    }
+  }
+  QVERIFY(sum);
+}
+
+void BenchHashes::hashString_data()
+{
+  QTest::addColumn<QVector<QByteArray>>("corpus");
+  QTest::addColumn<bool>("reference");
+
+  QTest::newRow("paths-reference") << pathCorpus() << true;
+  QTest::newRow("paths-hashString") << pathCorpus() << false;
+  QTest::newRow("identifiers-reference") << identifierCorpus() << true;
+  QTest::newRow("identifiers-hashString") << identifierCorpus() << false;
+}
+
+void BenchHashes::indexedStringLookup()
+{
+  QFETCH(QVector<QByteArray>, corpus);
+
+  // keep the strings referenced, so the benchmark only looks up existing items
+  QVector<IndexedString> strings;
+  foreach (const QByteArray& text, corpus) {
+    strings << IndexedString(text.constData(), text.size());
+  }
+
+  uint sum = 0;
+  QBENCHMARK {
+    foreach (const QByteArray& text, corpus) {
+      sum += IndexedString::indexForString(text.constData(), text.size());
+    }
+  }
+  QVERIFY(sum);
+}
+
+void BenchHashes::indexedStringLookup_data()
+{
+  QTest::addColumn<QVector<QByteArray>>("corpus");
+
+  QTest::newRow("paths") << pathCorpus();
+  QTest::newRow("identifiers") << identifierCorpus();
+}
@@ -44,6 +44,10 @@ private Q_SLOTS:
   void remove_data();
   void typeRepo();
   void typeRepo_data();
+  void hashString();
+  void hashString_data();
+  void indexedStringLookup();
+  void indexedStringLookup_data();
 };
 
 #endif // KDEVPLATFORM_BENCH_HASHES_H
@@ -0,0 +1,139 @@
+/*
+ * This file is part of KDevelop
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "bench_referencecounting.h"
+
+#include <language/duchain/identifier.h>
+#include <serialization/indexedstring.h>
+#include <serialization/referencecounting.h>
+
+#include <tests/testcore.h>
+#include <tests/autotestshell.h>
+
+#include <QElapsedTimer>
+#include <QTest>
+#include <QVector>
+
+#include <new>
+#include <thread>
+#include <vector>
+
+QTEST_GUILESS_MAIN(BenchReferenceCounting);
+
+using namespace KDevelop;
+
+namespace {
+
+const int threadCount = 16;
+const int totalCopies = 10000000;
+const int poolSize = 1000;
+
+/**
+ * Copies items from @p pool into a range with reference counting enabled, like the data of DUChain items.
+ * Every assignment decreases the reference count of the old item and increases the one of the new item.
+ */
+template<typename T>
+void copyReferenced(const QVector<T>& pool, int copies)
+{
+  const int slots = 64;
+  alignas(T) char storage[slots * sizeof(T)];
+  T* items = reinterpret_cast<T*>(storage);
+
+  enableDUChainReferenceCounting(storage, sizeof(storage));
+  for (int i = 0; i < slots; ++i) {
+    new (items + i) T(pool[i % pool.size()]);
+  }
+
+  for (int i = 0; i < copies; ++i) {
+    items[i % slots] = pool[i % pool.size()];
+  }
+
+  for (int i = 0; i < slots; ++i) {
+    items[i].~T();
+  }
+  disableDUChainReferenceCounting(storage);
+}
+
+template<typename T>
+void benchmarkCopies(const QVector<T>& pool)
+{
+  QElapsedTimer timer;
+  QBENCHMARK_ONCE {
+    timer.start();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; ++i) {
+      threads.emplace_back([&pool]() { copyReferenced(pool, totalCopies / threadCount); });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+
+  const qint64 elapsed = qMax(timer.elapsed(), qint64(1));
+  qDebug() << threadCount << "threads:" << (totalCopies / elapsed) << "copies/ms";
+}
+
+}
+
+void BenchReferenceCounting::initTestCase()
+{
+  AutoTestShell::init();
+  TestCore::initialize(Core::NoUi);
+}
+
+void BenchReferenceCounting::cleanupTestCase()
+{
+  TestCore::shutdown();
+}
+
+void BenchReferenceCounting::copyIndexedIdentifier()
+{
+  QVector<IndexedIdentifier> pool;
+  for (int i = 0; i < poolSize; ++i) {
+    pool << IndexedIdentifier(Identifier(QStringLiteral("identifier%1").arg(i)));
+  }
+
+  benchmarkCopies(pool);
+
+  QCOMPARE(pool.last().identifier().toString(), QStringLiteral("identifier%1").arg(poolSize - 1));
+}
+
+void BenchReferenceCounting::copyIndexedQualifiedIdentifier()
+{
+  QVector<IndexedQualifiedIdentifier> pool;
+  for (int i = 0; i < poolSize; ++i) {
+    pool << IndexedQualifiedIdentifier(QualifiedIdentifier(QStringLiteral("ns::Class%1::member").arg(i)));
+  }
+
+  benchmarkCopies(pool);
+
+  QCOMPARE(pool.last().identifier().toString(), QStringLiteral("ns::Class%1::member").arg(poolSize - 1));
+}
+
+void BenchReferenceCounting::copyIndexedString()
+{
+  QVector<IndexedString> pool;
+  for (int i = 0; i < poolSize; ++i) {
+    pool << IndexedString(QStringLiteral("/usr/include/kdevelop/file%1.h").arg(i));
+  }
+
+  benchmarkCopies(pool);
+
+  QCOMPARE(pool.last().str(), QStringLiteral("/usr/include/kdevelop/file%1.h").arg(poolSize - 1));
+}
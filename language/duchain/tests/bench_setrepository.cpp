@@ -0,0 +1,139 @@
+/*
+ * This file is part of KDevelop
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "bench_setrepository.h"
+
+#include <language/util/basicsetrepository.h>
+
+#include <tests/testcore.h>
+#include <tests/autotestshell.h>
+
+#include <QElapsedTimer>
+#include <QTest>
+
+#include <thread>
+#include <vector>
+
+QTEST_GUILESS_MAIN(BenchSetRepository);
+
+using namespace KDevelop;
+using namespace Utils;
+
+namespace {
+
+typedef BasicSetRepository::Index Index;
+
+const int setCount = 200;
+const int totalOperations = 400000;
+
+/**
+ * Sets like the recursive imports of files: runs of neighbouring indices, with a few added
+ * by each set on top of the ones of an earlier set.
+ */
+std::vector<Set> createSets(BasicSetRepository& repository)
+{
+  std::vector<Set> sets;
+  for (int i = 0; i < setCount; ++i) {
+    std::set<Index> indices;
+    const Index start = 1 + (i * 37) % 5000;
+    for (Index index = start; index < start + 50 + i % 30; ++index) {
+      indices.insert(index);
+    }
+    Set set = repository.createSet(indices);
+    if (i) {
+      set += sets[(i * 7) % i];
+    }
+    set.staticRef();
+    sets.push_back(set);
+  }
+  return sets;
+}
+
+/// Combines pairs of @p sets, the same pairs come up again after a while
+uint combine(const std::vector<Set>& sets, int first, int operations)
+{
+  uint ret = 0;
+  for (int i = first; i < first + operations; ++i) {
+    const Set& lhs = sets[i % setCount];
+    const Set& rhs = sets[(i * 13 + i / setCount) % setCount];
+    ret += (lhs + rhs).count();
+    ret += (lhs & rhs).count();
+  }
+  return ret;
+}
+
+}
+
+void BenchSetRepository::initTestCase()
+{
+  AutoTestShell::init();
+  TestCore::initialize(Core::NoUi);
+}
+
+void BenchSetRepository::cleanupTestCase()
+{
+  TestCore::shutdown();
+}
+
+void BenchSetRepository::unionAndIntersect_data()
+{
+  QTest::addColumn<int>("threadCount");
+
+  QTest::newRow("1") << 1;
+  QTest::newRow("4") << 4;
+  QTest::newRow("16") << 16;
+}
+
+void BenchSetRepository::unionAndIntersect()
+{
+  QFETCH(int, threadCount);
+
+  BasicSetRepository repository(QStringLiteral("bench set repository %1").arg(threadCount));
+  const std::vector<Set> sets = createSets(repository);
+  const uint expected = combine(sets, 0, totalOperations);
+
+  QElapsedTimer timer;
+  std::vector<uint> results(threadCount);
+  QBENCHMARK_ONCE {
+    timer.start();
+    std::vector<std::thread> threads;
+    const int operations = totalOperations / threadCount;
+    for (int i = 0; i < threadCount; ++i) {
+      threads.emplace_back([&sets, &results, i, operations]() {
+        results[i] = combine(sets, i * operations, operations);
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+
+  const qint64 elapsed = qMax(timer.elapsed(), qint64(1));
+  qDebug() << threadCount << "threads:" << (totalOperations / elapsed) << "operations/ms";
+
+  uint sum = 0;
+  for (uint result : results) {
+    sum += result;
+  }
+  QCOMPARE(sum, expected);
+
+  for (Set set : sets) {
+    set.staticUnref();
+  }
+}
@@ -25,14 +25,20 @@
 
 #include <QTest>
 #include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 
 #include <tests/autotestshell.h>
 #include <tests/testcore.h>
 
 #include <language/duchain/duchain.h>
 #include <language/duchain/duchainlock.h>
+#include <language/duchain/duchainlockstatistics.h>
 #include <language/duchain/persistentsymboltable.h>
 #include <language/duchain/codemodel.h>
+#include <language/duchain/indexupdatebatch.h>
+#include <language/duchain/uses.h>
 #include <language/duchain/types/typesystemdata.h>
 #include <language/duchain/types/integraltype.h>
 #include <language/duchain/types/typeregister.h>
@@ -46,12 +52,17 @@
 #include <language/util/setrepository.h>
 #include <language/util/basicsetrepository.h>
 
+#include <util/foregroundlock.h>
+
 // #include <typeinfo>
 #include <set>
 #include <algorithm>
 #include <iterator> // needed for std::insert_iterator on windows
 #include <QThread>
 
+#include <atomic>
+#include <thread>
+
 //Extremely slow
 // #define TEST_NORMAL_IMPORTS
 
@@ -364,11 +375,237 @@ void TestDUChain::testStringSets() {
 }
 #endif
 
+void TestDUChain::testSetOperationCache()
+{
+  BasicSetRepository rep(QStringLiteral("test operation cache repository"));
+
+  Set a = rep.createSet(std::set<Index>{1, 2, 3, 10, 11});
+  Set b = rep.createSet(std::set<Index>{3, 4, 20});
+  a.staticRef();
+  b.staticRef();
+
+  const std::set<Index> expectedUnion{1, 2, 3, 4, 10, 11, 20};
+  QVERIFY((a + b).stdSet() == expectedUnion);
+  QCOMPARE((b + a).setIndex(), (a + b).setIndex());
+  QVERIFY((a & b).stdSet() == std::set<Index>{3});
+  QCOMPARE((a - b).count(), 4u);
+  QCOMPARE((b - a).count(), 2u);
+
+  // the nodes of the union are deleted, and their indices may be reused by other sets
+  Set sum = a + b;
+  sum.staticRef();
+  sum.staticUnref();
+  Set other = rep.createSet(std::set<Index>{1, 4, 100, 101, 200});
+  other.staticRef();
+
+  QVERIFY((a + b).stdSet() == expectedUnion);
+  QCOMPARE((a + b).count(), 7u);
+  QVERIFY((a & other).stdSet() == std::set<Index>{1});
+  QCOMPARE(other.count(), 5u);
+
+  a.staticUnref();
+  b.staticUnref();
+  other.staticUnref();
+}
+
 void TestDUChain::testSymbolTableValid() {
   DUChainReadLocker lock(DUChain::lock());
   PersistentSymbolTable::self().dump(QTextStream(stdout));
 }
 
+void TestDUChain::testSymbolTableCacheInvalidation()
+{
+  DUChainWriteLocker lock;
+  PersistentSymbolTable& table = PersistentSymbolTable::self();
+  const IndexedQualifiedIdentifier id(QualifiedIdentifier(QStringLiteral("testSymbolTableCacheInvalidation")));
+
+  //Top-context indices that are not used by any real context
+  const uint firstTop = 1000001;
+  const uint secondTop = 1000002;
+  const TopDUContext::IndexedRecursiveImports firstVisibility(std::set<uint>{firstTop});
+  const TopDUContext::IndexedRecursiveImports secondVisibility(std::set<uint>{secondTop});
+
+  auto filtered = [&](const TopDUContext::IndexedRecursiveImports& visibility) {
+    QVector<IndexedDeclaration> ret;
+    for (auto it = table.getFilteredDeclarations(id, visibility); it; ++it)
+      ret << *it;
+    return ret;
+  };
+
+  table.addDeclaration(id, IndexedDeclaration(firstTop, 1));
+  table.addDeclaration(id, IndexedDeclaration(secondTop, 1));
+  QCOMPARE(filtered(firstVisibility).size(), 1);
+  QCOMPARE(filtered(secondVisibility).size(), 1);
+
+  //Only the cached list that can see the new declaration may change
+  table.addDeclaration(id, IndexedDeclaration(secondTop, 2));
+  QCOMPARE(filtered(firstVisibility), QVector<IndexedDeclaration>() << IndexedDeclaration(firstTop, 1));
+  QCOMPARE(filtered(secondVisibility).size(), 2);
+
+  table.removeDeclaration(id, IndexedDeclaration(firstTop, 1));
+  QVERIFY(filtered(firstVisibility).isEmpty());
+  QCOMPARE(filtered(secondVisibility).size(), 2);
+
+  table.removeDeclaration(id, IndexedDeclaration(secondTop, 1));
+  table.removeDeclaration(id, IndexedDeclaration(secondTop, 2));
+  QVERIFY(filtered(secondVisibility).isEmpty());
+
+  //Trimming the cache must not change any result
+  table.clearCache();
+  QVERIFY(filtered(firstVisibility).isEmpty());
+}
+
+void TestDUChain::testSymbolTablePersistedCache()
+{
+  DUChainWriteLocker lock;
+  PersistentSymbolTable& table = PersistentSymbolTable::self();
+  const IndexedQualifiedIdentifier id(QualifiedIdentifier(QStringLiteral("testSymbolTablePersistedCache")));
+
+  const uint firstTop = 1000011;
+  const uint secondTop = 1000012;
+  const TopDUContext::IndexedRecursiveImports visibility(std::set<uint>{firstTop});
+
+  auto filtered = [&]() {
+    QVector<IndexedDeclaration> ret;
+    for (auto it = table.getFilteredDeclarations(id, visibility); it; ++it)
+      ret << *it;
+    return ret;
+  };
+
+  table.addDeclaration(id, IndexedDeclaration(firstTop, 1));
+  table.addDeclaration(id, IndexedDeclaration(secondTop, 1));
+  QCOMPARE(filtered(), QVector<IndexedDeclaration>() << IndexedDeclaration(firstTop, 1));
+  //The cache is serialized under the lock, and written after it was released
+  const QByteArray cache = table.serializeCache();
+  lock.unlock();
+  PersistentSymbolTable::writeCache(cache);
+  lock.lock();
+
+  //The declarations change behind the stored cache without changing their count, like after a crash
+  table.removeDeclaration(id, IndexedDeclaration(firstTop, 1));
+  table.addDeclaration(id, IndexedDeclaration(firstTop, 2));
+  table.loadCache();
+  QCOMPARE(filtered(), QVector<IndexedDeclaration>() << IndexedDeclaration(firstTop, 2));
+
+
+  table.removeDeclaration(id, IndexedDeclaration(firstTop, 2));
+  table.removeDeclaration(id, IndexedDeclaration(secondTop, 1));
+  QVERIFY(filtered().isEmpty());
+}
+
+void TestDUChain::testIndexUpdateBatch()
+{
+  DUChainWriteLocker lock;
+  const IndexedString file(QStringLiteral("/test/indexupdatebatch.cpp"));
+  const IndexedQualifiedIdentifier first(QualifiedIdentifier(QStringLiteral("testIndexUpdateBatch::first")));
+  const IndexedQualifiedIdentifier second(QualifiedIdentifier(QStringLiteral("testIndexUpdateBatch::second")));
+  const DeclarationId usedId(first, 1);
+  const IndexedTopDUContext user(1000003);
+
+  auto codeModelItems = [&]() {
+    QMap<IndexedQualifiedIdentifier, uint> ret;
+    uint count;
+    const CodeModelItem* items;
+    CodeModel::self().items(file, count, items);
+    for (uint a = 0; a < count; ++a) {
+      if (items[a].id.isValid())
+        ret[items[a].id] = items[a].referenceCount;
+    }
+    return ret;
+  };
+
+  {
+    IndexUpdateBatch batch;
+    QCOMPARE(IndexUpdateBatch::current(), &batch);
+    {
+      IndexUpdateBatch nested;
+      QCOMPARE(IndexUpdateBatch::current(), &batch);
+      CodeModel::self().addItem(file, first, CodeModelItem::Class);
+      CodeModel::self().addItem(file, first, CodeModelItem::Class);
+      CodeModel::self().addItem(file, second, CodeModelItem::Function);
+      PersistentSymbolTable::self().addDeclaration(first, IndexedDeclaration(1000003, 1));
+      PersistentSymbolTable::self().addDeclaration(first, IndexedDeclaration(1000003, 2));
+      PersistentSymbolTable::self().removeDeclaration(first, IndexedDeclaration(1000003, 2));
+      DUChain::uses()->addUse(usedId, user);
+    }
+    //Reading applies the pending changes
+    QCOMPARE(PersistentSymbolTable::self().getDeclarations(first).dataSize(), 1u);
+    QVERIFY(DUChain::uses()->hasUses(usedId));
+
+    CodeModel::self().removeItem(file, first);
+    CodeModel::self().removeItem(file, second);
+    DUChain::uses()->removeUse(usedId, user);
+    PersistentSymbolTable::self().removeDeclaration(first, IndexedDeclaration(1000003, 1));
+  }
+  QVERIFY(!IndexUpdateBatch::current());
+
+  QMap<IndexedQualifiedIdentifier, uint> expected;
+  expected[first] = 1;
+  QCOMPARE(codeModelItems(), expected);
+  QVERIFY(!DUChain::uses()->hasUses(usedId));
+  QCOMPARE(PersistentSymbolTable::self().getDeclarations(first).dataSize(), 0u);
+
+  CodeModel::self().removeItem(file, first);
+  QVERIFY(codeModelItems().isEmpty());
+
+  //All changes of one list are merged into it at once
+  {
+    IndexUpdateBatch batch;
+    for (uint a = 10; a > 0; --a)
+      DUChain::uses()->addUse(usedId, IndexedTopDUContext(1000010 + a));
+  }
+  {
+    IndexUpdateBatch batch;
+    DUChain::uses()->removeUse(usedId, IndexedTopDUContext(1000015));
+    DUChain::uses()->addUse(usedId, IndexedTopDUContext(1000011));
+    DUChain::uses()->addUse(usedId, IndexedTopDUContext(1000030));
+  }
+  KDevVarLengthArray<IndexedTopDUContext> uses = DUChain::uses()->uses(usedId);
+  QCOMPARE(uses.size(), 10);
+  QVERIFY(!uses.contains(IndexedTopDUContext(1000015)));
+  QVERIFY(uses.contains(IndexedTopDUContext(1000030)));
+  {
+    IndexUpdateBatch batch;
+    for (const IndexedTopDUContext& use : uses)
+      DUChain::uses()->removeUse(usedId, use);
+  }
+  QVERIFY(!DUChain::uses()->hasUses(usedId));
+}
+
+void TestDUChain::testIndexUpdateBatchAppliedOnUnlock()
+{
+  const DeclarationId usedId(IndexedQualifiedIdentifier(QualifiedIdentifier(QStringLiteral("testIndexUpdateBatchAppliedOnUnlock"))), 1);
+  const IndexedTopDUContext user(1000003);
+
+  //Other threads have no batch, so reading there does not apply the pending changes
+  auto hasUsesInOtherThread = [&]() {
+    bool ret = false;
+    std::thread reader([&]() {
+      DUChainReadLocker lock;
+      ret = DUChain::uses()->hasUses(usedId);
+    });
+    reader.join();
+    return ret;
+  };
+
+  IndexUpdateBatch batch;
+  {
+    DUChainWriteLocker lock;
+    DUChain::uses()->addUse(usedId, user);
+    {
+      DUChainWriteLocker nested;
+    }
+    QVERIFY(IndexUpdateBatch::current());
+  }
+  QVERIFY(hasUsesInOtherThread());
+
+  {
+    DUChainWriteLocker lock;
+    DUChain::uses()->removeUse(usedId, user);
+  }
+  QVERIFY(!hasUsesInOtherThread());
+}
+
 void TestDUChain::testIndexedStrings() {
 
   int testCount  = 600000;
@@ -710,6 +947,198 @@ void TestDUChain::testLockForReadWrite()
   QVERIFY(threads.join(1000));
 }
 
+void TestDUChain::testLockRecursiveReadWithWaitingWriter()
+{
+  DUChainLock lock;
+
+  //A writer waits while we hold a read-lock, a recursive read-lock must not wait for it
+  QVERIFY(lock.lockForRead());
+  std::atomic<bool> written(false);
+  std::thread writer([&]() {
+    lock.lockForWrite();
+    written = true;
+    lock.releaseWriteLock();
+  });
+  QThread::msleep(50);
+  const bool writtenWhileReading = written;
+  const bool recursiveLocked = lock.lockForRead(5000);
+  if (recursiveLocked) {
+    lock.releaseReadLock();
+  }
+  lock.releaseReadLock();
+  writer.join();
+  QVERIFY(!writtenWhileReading);
+  QVERIFY(recursiveLocked);
+  QVERIFY(written);
+
+  //Writers that keep acquiring the lock and backing off from readers, so recursive read-locks
+  //race with a writer that is about to wait
+  std::atomic<bool> stop(false);
+  writer = std::thread([&]() {
+    while (!stop) {
+      lock.lockForWrite();
+      lock.releaseWriteLock();
+      std::this_thread::yield();
+    }
+  });
+  bool allLocked = true;
+  for (int i = 0; i < 1000 && allLocked; ++i) {
+    lock.lockForRead();
+    allLocked = lock.lockForRead(5000);
+    if (allLocked) {
+      lock.releaseReadLock();
+    }
+    lock.releaseReadLock();
+  }
+  stop = true;
+  writer.join();
+  QVERIFY(allLocked);
+}
+
+void TestDUChain::testLockForegroundPreference()
+{
+  DUChainLock lock;
+
+  std::atomic<bool> readerLocked(false);
+  std::atomic<bool> releaseReader(false);
+  std::thread reader([&]() {
+    lock.lockForRead();
+    readerLocked = true;
+    while (!releaseReader) {
+      QThread::msleep(1);
+    }
+    lock.releaseReadLock();
+  });
+  while (!readerLocked) {
+    QThread::msleep(1);
+  }
+
+  std::atomic<bool> written(false);
+  std::thread writer([&]() {
+    lock.lockForWrite();
+    written = true;
+    lock.releaseWriteLock();
+  });
+  QThread::msleep(50);
+
+  //New background readers wait behind the waiting writer
+  bool backgroundLocked = true;
+  std::thread lateReader([&]() {
+    backgroundLocked = lock.lockForRead(100);
+    if (backgroundLocked) {
+      lock.releaseReadLock();
+    }
+  });
+  lateReader.join();
+
+  //The thread holding the foreground lock does not
+  bool foregroundLocked = false;
+  {
+    ForegroundLock foreground;
+    foregroundLocked = lock.lockForRead(100);
+    if (foregroundLocked) {
+      lock.releaseReadLock();
+    }
+  }
+
+  const bool writtenWhileReading = written;
+  releaseReader = true;
+  reader.join();
+  writer.join();
+
+  QVERIFY(!backgroundLocked);
+  QVERIFY(foregroundLocked);
+  QVERIFY(!writtenWhileReading);
+  QVERIFY(written);
+}
+
+void TestDUChain::testLockTimeout()
+{
+  DUChainLock lock;
+
+  std::atomic<bool> locked(false);
+  std::atomic<bool> release(false);
+  std::thread writer([&]() {
+    lock.lockForWrite();
+    locked = true;
+    while (!release) {
+      QThread::msleep(1);
+    }
+    lock.releaseWriteLock();
+  });
+  while (!locked) {
+    QThread::msleep(1);
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+  const bool readLocked = lock.lockForRead(50);
+  const qint64 readWait = timer.elapsed();
+  const bool hasReadLock = lock.currentThreadHasReadLock();
+  timer.restart();
+  const bool writeLocked = lock.lockForWrite(50);
+  const qint64 writeWait = timer.elapsed();
+
+  release = true;
+  writer.join();
+
+  QVERIFY(!readLocked);
+  QVERIFY(readWait >= 50);
+  QVERIFY(!hasReadLock);
+  QVERIFY(!writeLocked);
+  QVERIFY(writeWait >= 50);
+
+  //The lock is usable after the timeouts
+  QVERIFY(lock.lockForRead(50));
+  lock.releaseReadLock();
+  QVERIFY(lock.lockForWrite(50));
+  lock.releaseWriteLock();
+}
+
+void TestDUChain::testLockStatistics()
+{
+  if (!DUChainLockStatistics::isAvailable())
+    QSKIP("Built without KDEV_DUCHAIN_LOCK_STATISTICS");
+
+  DUChainLockStatistics::setEnabled(true);
+  DUChainLockStatistics::reset();
+
+  int writeLine, readLine;
+  {
+    writeLine = __LINE__; DUChainWriteLocker lock;
+  }
+  {
+    readLine = __LINE__; DUChainReadLocker lock;
+    QThread::msleep(2);
+  }
+  DUChainLockStatistics::setEnabled(false);
+
+  const QJsonObject root = QJsonDocument::fromJson(DUChainLockStatistics::toJson()).object();
+  QJsonObject writeSite, readSite;
+  foreach (const QJsonValue& thread, root.value(QStringLiteral("threads")).toArray()) {
+    foreach (const QJsonValue& value, thread.toObject().value(QStringLiteral("sites")).toArray()) {
+      const QJsonObject site = value.toObject();
+      if (site.value(QStringLiteral("file")).toString() == QLatin1String("<unknown>"))
+        QSKIP("The compiler does not provide the call site of the lockers");
+      if (!site.value(QStringLiteral("file")).toString().endsWith(QLatin1String("test_duchain.cpp")))
+        continue;
+      if (site.value(QStringLiteral("line")).toInt() == writeLine)
+        writeSite = site;
+      else if (site.value(QStringLiteral("line")).toInt() == readLine)
+        readSite = site;
+    }
+  }
+
+  QCOMPARE(writeSite.value(QStringLiteral("type")).toString(), QStringLiteral("write"));
+  QCOMPARE(writeSite.value(QStringLiteral("hold")).toObject().value(QStringLiteral("count")).toInt(), 1);
+  QCOMPARE(writeSite.value(QStringLiteral("wait")).toObject().value(QStringLiteral("count")).toInt(), 1);
+  QCOMPARE(readSite.value(QStringLiteral("type")).toString(), QStringLiteral("read"));
+  QCOMPARE(readSite.value(QStringLiteral("hold")).toObject().value(QStringLiteral("count")).toInt(), 1);
+  QVERIFY(readSite.value(QStringLiteral("hold")).toObject().value(QStringLiteral("maxNs")).toDouble() >= 2000000);
+
+  QVERIFY(DUChainLockStatistics::toText().contains(QStringLiteral("test_duchain.cpp:%1 (read)").arg(readLine)));
+}
+
 void TestDUChain::testProblemSerialization()
 {
   DUChain::self()->disablePersistentStorage(false);
@@ -903,6 +1332,51 @@ void TestDUChain::testImportCache()
 
 #endif
 
+void TestDUChain::testFindAt()
+{
+  DUChainWriteLocker lock;
+  auto top = new TopDUContext(IndexedString(QStringLiteral("/tmp/findat.cpp")), {0, 0, 1000, 0});
+  DUChain::self()->addDocumentChain(top);
+
+  // enough of each for the lookups to use an index
+  QVector<DUContext*> contexts;
+  QVector<Declaration*> declarations;
+  for (int i = 0; i < 50; ++i) {
+    contexts << new DUContext({i * 10, 0, i * 10 + 5, 0}, top);
+    declarations << new Declaration({i * 10 + 6, 0, i * 10 + 6, 5}, top);
+    top->createUse(i, {i * 10 + 7, 0, i * 10 + 7, 3});
+  }
+
+  QCOMPARE(top->findContextAt({20, 3}), contexts[2]);
+  QCOMPARE(top->findContextAt({25, 0}), top);
+  QCOMPARE(top->findContextAt({25, 0}, true), contexts[2]);
+  QCOMPARE(top->findContext({31, 0}), contexts[3]);
+  QCOMPARE(top->findContextIncluding({41, 0, 42, 0}), contexts[4]);
+  QCOMPARE(top->findContextIncluding({41, 0, 52, 0}), static_cast<DUContext*>(top));
+  QCOMPARE(top->findDeclarationAt({16, 2}), declarations[1]);
+  QCOMPARE(top->findDeclarationAt({16, 5}), static_cast<Declaration*>(nullptr));
+  QCOMPARE(top->findUseAt({37, 1}), 3);
+  QCOMPARE(top->findUseAt({37, 3}), -1);
+
+  // the lookups follow changed ranges
+  contexts[2]->setRange({600, 0, 610, 0});
+  declarations[1]->setRange({700, 0, 700, 5});
+  top->changeUseRange(3, {800, 0, 800, 3});
+  QCOMPARE(top->findContextAt({20, 3}), top);
+  QCOMPARE(top->findContextAt({605, 0}), contexts[2]);
+  QCOMPARE(top->findDeclarationAt({16, 2}), static_cast<Declaration*>(nullptr));
+  QCOMPARE(top->findDeclarationAt({700, 2}), declarations[1]);
+  QCOMPARE(top->findUseAt({37, 1}), -1);
+  QCOMPARE(top->findUseAt({800, 1}), 3);
+
+  // overlapping children are looked up like before, the last one wins in findContextAt
+  auto overlapping = new DUContext({600, 0, 620, 0}, top);
+  QCOMPARE(top->findContextAt({605, 0}), overlapping);
+  QCOMPARE(top->findContext({605, 0}), contexts[2]);
+
+  DUChain::self()->removeDocumentChain(top);
+}
+
 void TestDUChain::benchCodeModel()
 {
   const IndexedString file("testFile");
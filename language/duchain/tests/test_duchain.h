@@ -38,14 +38,24 @@ private Q_SLOTS:
 	// Causes stack overflow on Windows (MSVC2015)
     void testStringSets();
 #endif
+    void testSetOperationCache();
     void testSymbolTableValid();
+    void testSymbolTableCacheInvalidation();
+    void testSymbolTablePersistedCache();
+    void testIndexUpdateBatch();
+    void testIndexUpdateBatchAppliedOnUnlock();
     void testIndexedStrings();
     void testImportStructure();
     void testLockForWrite();
     void testLockForRead();
     void testLockForReadWrite();
+    void testLockRecursiveReadWithWaitingWriter();
+    void testLockForegroundPreference();
+    void testLockTimeout();
+    void testLockStatistics();
     void testProblemSerialization();
     void testIdentifiers();
+    void testFindAt();
     ///NOTE: these are not "automated"!
 //     void testImportCache();
 
@@ -33,6 +33,7 @@
 #include "namespacealiasdeclaration.h"
 #include "aliasdeclaration.h"
 #include "uses.h"
+#include "indexupdatebatch.h"
 #include "topducontextdata.h"
 #include "duchainregister.h"
 #include "topducontextdynamicdata.h"
@@ -545,6 +546,9 @@ TopDUContext::~TopDUContext( )
 {
   m_dynamicData->m_deleting = true;
 
+  //Remove all declarations, uses and imports of this context from the global indices together
+  IndexUpdateBatch batch;
+
   //Clear the AST, so that the 'feature satisfaction' cache is eventually updated
   clearAst();
 
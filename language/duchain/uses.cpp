@@ -20,6 +20,8 @@
 
 #include "declarationid.h"
 #include "duchainpointer.h"
+#include "indexupdatebatch.h"
+#include "indexupdatebatch_p.h"
 #include "serialization/itemrepository.h"
 #include "topducontext.h"
 
@@ -117,6 +119,11 @@ Uses::~Uses() = default;
 
 void Uses::addUse(const DeclarationId& id, const IndexedTopDUContext& use)
 {
+  if(IndexUpdateBatch* batch = IndexUpdateBatch::current()) {
+    batch->addUse(id, use);
+    return;
+  }
+
   UsesItem item;
   item.declaration = id;
   item.usesList().append(use);
@@ -142,6 +149,11 @@ void Uses::addUse(const DeclarationId& id, const IndexedTopDUContext& use)
 
 void Uses::removeUse(const DeclarationId& id, const IndexedTopDUContext& use)
 {
+  if(IndexUpdateBatch* batch = IndexUpdateBatch::current()) {
+    batch->removeUse(id, use);
+    return;
+  }
+
   UsesItem item;
   item.declaration = id;
   UsesRequestItem request(item);
@@ -164,8 +176,32 @@ void Uses::removeUse(const DeclarationId& id, const IndexedTopDUContext& use)
   }
 }
 
+void Uses::changeUses(const DeclarationId& id, const KDevVarLengthArray<IndexedTopDUContext>& added, const KDevVarLengthArray<IndexedTopDUContext>& removed)
+{
+  QMutexLocker lock(d->m_uses.mutex());
+
+  UsesItem item;
+  item.declaration = id;
+  UsesRequestItem request(item);
+
+  uint index = d->m_uses.findIndex(item);
+  const UsesItem* oldItem = index ? d->m_uses.itemFromIndex(index) : nullptr;
+
+  if(!mergeSetChanges(oldItem ? oldItem->uses() : nullptr, oldItem ? oldItem->usesSize() : 0, added, removed, item.usesList()))
+    return;
+
+  if(index)
+    d->m_uses.deleteItem(index);
+
+  //This inserts the changed item
+  if(item.usesSize() != 0)
+    d->m_uses.index(request);
+}
+
 bool Uses::hasUses(const DeclarationId& id) const
 {
+  IndexUpdateBatch::applyCurrent();
+
   UsesItem item;
   item.declaration = id;
   return (bool) d->m_uses.findIndex(item);
@@ -173,6 +209,8 @@ bool Uses::hasUses(const DeclarationId& id) const
 
 KDevVarLengthArray<IndexedTopDUContext> Uses::uses(const DeclarationId& id) const
 {
+  IndexUpdateBatch::applyCurrent();
+
   KDevVarLengthArray<IndexedTopDUContext> ret;
 
   UsesItem item;
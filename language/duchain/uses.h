@@ -48,6 +48,12 @@ namespace KDevelop {
      * Removes the given top-context from the list of uses
      * */
     void removeUse(const DeclarationId& id, const IndexedTopDUContext& use);
+    /**
+     * Adds and removes several top-contexts of the given id at once, rewriting the list only once.
+     * @p added and @p removed must not overlap. @see IndexUpdateBatch
+     * */
+    void changeUses(const DeclarationId& id, const KDevVarLengthArray<IndexedTopDUContext>& added,
+                    const KDevVarLengthArray<IndexedTopDUContext>& removed);
     /**
      * Checks whether the given DeclarationID is is used
      * */
@@ -24,12 +24,22 @@
 #include "codehighlighting.h"
 
 #include <KTextEditor/Document>
+#include <KTextEditor/View>
+
+#include <QScopedPointer>
+#include <QThread>
+#include <QTimer>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <limits>
 
 #include "../../interfaces/icore.h"
 #include "../../interfaces/ilanguagecontroller.h"
 #include "../../interfaces/icompletionsettings.h"
 #include "../../util/foregroundlock.h"
 #include <debug.h>
+#include <highlightingdebug.h>
 
 #include "../duchain/declaration.h"
 #include "../duchain/types/functiontype.h"
@@ -50,15 +60,64 @@
 using namespace KTextEditor;
 
 static const float highlightingZDepth = -500;
+// Highlighted ranges that are applied at once, and milliseconds spent applying before returning to the event loop
+static const int highlightingPartSize = 1000;
+static const int highlightingTimeSlice = 10;
+// Child contexts a context needs before they are highlighted in parallel, and the least that are highlighted together
+static const int minParallelContexts = 64;
+static const int minContextGroupSize = 16;
 
 #define ifDebug(x)
 
+namespace {
+
+/// Returns the lines around the cursors of the visible views of @p document, which is roughly what is on screen
+KTextEditor::Range visibleLines(KTextEditor::Document* document)
+{
+  KTextEditor::Range visible = KTextEditor::Range::invalid();
+  foreach(KTextEditor::View* view, document->views()) {
+    if(!view->isVisible())
+      continue;
+
+    const int lines = qMax(1, view->height() / qMax(1, view->fontMetrics().height()));
+    const int line = view->cursorPosition().line();
+    const KTextEditor::Range around(qMax(0, line - lines), 0, line + lines, 0);
+    visible = visible.isValid() ? visible.encompass(around) : around;
+  }
+  return visible;
+}
+
+/// Merges the sorted @p parts into one sorted vector, pairwise so that every range is moved only a few times
+QVector<KDevelop::HighlightedRange> mergeSorted(QVector<QVector<KDevelop::HighlightedRange>> parts)
+{
+  if(parts.isEmpty())
+    return {};
+
+  while(parts.size() > 1) {
+    QVector<QVector<KDevelop::HighlightedRange>> merged;
+    merged.reserve((parts.size() + 1) / 2);
+    for(int i = 0; i + 1 < parts.size(); i += 2) {
+      const auto& first = parts[i];
+      const auto& second = parts[i + 1];
+      QVector<KDevelop::HighlightedRange> both(first.size() + second.size());
+      std::merge(first.begin(), first.end(), second.begin(), second.end(), both.begin());
+      merged << both;
+    }
+    if(parts.size() % 2)
+      merged << parts.last();
+    parts = merged;
+  }
+  return parts.first();
+}
+
+}
+
 namespace KDevelop {
 
 ///@todo Don't highlighting everything, only what is visible on-demand
 
 CodeHighlighting::CodeHighlighting( QObject * parent )
-  : QObject(parent), m_localColorization(true), m_globalColorization(true), m_dataMutex(QMutex::Recursive)
+  : QObject(parent), m_localColorization(true), m_globalColorization(true), m_dataMutex(QMutex::Recursive), m_applyScheduled(false)
 {
   qRegisterMetaType<KDevelop::IndexedString>("KDevelop::IndexedString");
 
@@ -81,78 +140,78 @@ void CodeHighlighting::adaptToColorChanges()
   // disable global highlighting if the ratio is set to 0
   m_globalColorization = ICore::self()->languageController()->completionSettings()->globalColorizationLevel() > 0;
 
+  m_depthAttributes.clear();
+
+  QWriteLocker attributesLock(&m_attributesLock);
   m_declarationAttributes.clear();
   m_definitionAttributes.clear();
-  m_depthAttributes.clear();
   m_referenceAttributes.clear();
 }
 
-KTextEditor::Attribute::Ptr CodeHighlighting::attributeForType( Types type, Contexts context, const QColor &color ) const
+QHash<CodeHighlighting::Types, KTextEditor::Attribute::Ptr>& CodeHighlighting::cachedAttributes(Contexts context) const
 {
-  QMutexLocker lock(&m_dataMutex);
-  KTextEditor::Attribute::Ptr a;
   switch (context) {
     case DefinitionContext:
-      a = m_definitionAttributes[type];
-      break;
-
+      return m_definitionAttributes;
     case DeclarationContext:
-      a = m_declarationAttributes[type];
-      break;
-
+      return m_declarationAttributes;
     case ReferenceContext:
-      a = m_referenceAttributes[type];
       break;
   }
+  return m_referenceAttributes;
+}
 
-  if ( !a || color.isValid() ) {
+KTextEditor::Attribute::Ptr CodeHighlighting::attributeForType( Types type, Contexts context, const QColor &color ) const
+{
+  if ( !color.isValid() ) {
+    QReadLocker lock(&m_attributesLock);
+    const KTextEditor::Attribute::Ptr a = cachedAttributes(context).value(type);
+    if ( a )
+      return a;
+  }
 
-    a = KTextEditor::Attribute::Ptr(new KTextEditor::Attribute(*ColorCache::self()->defaultColors()->getAttribute(type)));
+  // Build the attribute without holding a lock, colored attributes are not cached
+  KTextEditor::Attribute::Ptr a(new KTextEditor::Attribute(*ColorCache::self()->defaultColors()->getAttribute(type)));
 
-    if ( context == DefinitionContext || context == DeclarationContext ) {
-      if (ICore::self()->languageController()->completionSettings()->boldDeclarations()) {
-        a->setFontBold();
-      }
+  if ( context == DefinitionContext || context == DeclarationContext ) {
+    if (ICore::self()->languageController()->completionSettings()->boldDeclarations()) {
+      a->setFontBold();
     }
+  }
 
-    if( color.isValid() ) {
-      a->setForeground(color);
-//       a->setBackground(QColor(mix(0xffffff-color, backgroundColor(), 255-backgroundTinting)));
-    } else {
-      switch (context) {
-        case DefinitionContext:
-          m_definitionAttributes.insert(type, a);
-          break;
-        case DeclarationContext:
-          m_declarationAttributes.insert(type, a);
-          break;
-        case ReferenceContext:
-          m_referenceAttributes.insert(type, a);
-          break;
-      }
-    }
+  if( color.isValid() ) {
+    a->setForeground(color);
+//     a->setBackground(QColor(mix(0xffffff-color, backgroundColor(), 255-backgroundTinting)));
+    return a;
   }
 
+  QWriteLocker lock(&m_attributesLock);
+  QHash<Types, KTextEditor::Attribute::Ptr>& attributes = cachedAttributes(context);
+  // Another thread may have cached it meanwhile
+  const auto it = attributes.constFind(type);
+  if ( it != attributes.constEnd() )
+    return *it;
+  attributes.insert(type, a);
   return a;
 }
 
-ColorMap emptyColorMap() {
- ColorMap ret(ColorCache::self()->validColorCount()+1, nullptr);
- return ret;
-}
-
 CodeHighlightingInstance* CodeHighlighting::createInstance() const
 {
   return new CodeHighlightingInstance(this);
 }
 
+bool CodeHighlighting::supportsParallelHighlighting() const
+{
+  return false;
+}
+
 bool CodeHighlighting::hasHighlighting(IndexedString url) const
 {
   DocumentChangeTracker* tracker = ICore::self()->languageController()->backgroundParser()->trackerForUrl(url);
   if(tracker)
   {
     QMutexLocker lock(&m_dataMutex);
-    return m_highlights.contains(tracker) && !m_highlights[tracker]->m_highlightedRanges.isEmpty();
+    return m_highlights.contains(tracker) && !m_highlights[tracker]->movingRanges().isEmpty();
   }
   return false;
 }
@@ -195,30 +254,71 @@ void CodeHighlighting::highlightDUChain(ReferencedTopDUContext context)
   DocumentHighlighting* highlighting = new DocumentHighlighting;
   highlighting->m_document = url;
   highlighting->m_waitingRevision = revision;
+  // The instance returns the ranges sorted already
   highlighting->m_waiting = instance->m_highlight;
-  std::sort(highlighting->m_waiting.begin(), highlighting->m_waiting.end());
 
   QMetaObject::invokeMethod(this, "applyHighlighting", Qt::QueuedConnection, Q_ARG(void*, highlighting));
 
   delete instance;
 }
 
+class CodeHighlightingInstancePrivate
+{
+public:
+  // Whether large contexts are split up, which is only done by the instance that highlights the top context
+  bool m_parallel = false;
+  // The sorted highlights of the groups highlighted in parallel, which still have to be merged into m_highlight
+  QVector<QVector<HighlightedRange>> m_parallelHighlights;
+  // The attributes used so far, by type and context, and color
+  QHash<QPair<int, QRgb>, KTextEditor::Attribute::Ptr> m_attributes;
+};
+
+CodeHighlightingInstance::CodeHighlightingInstance(const CodeHighlighting* highlighting)
+  : d(new CodeHighlightingInstancePrivate)
+  , m_useClassCache(false)
+  , m_highlighting(highlighting)
+{
+}
+
+CodeHighlightingInstance::~CodeHighlightingInstance()
+{
+}
+
 void CodeHighlightingInstance::highlightDUChain(TopDUContext* context)
 {
   m_contextClasses.clear();
   m_useClassCache = true;
+  d->m_parallel = m_highlighting->supportsParallelHighlighting();
 
   //Highlight
-  highlightDUChain(context, QHash<Declaration*, uint>(), emptyColorMap());
+  highlightDUChain(context, DeclarationColors::Ptr(new DeclarationColors(ColorCache::self()->validColorCount() + 1)));
 
-  m_functionColorsForDeclarations.clear();
-  m_functionDeclarationsForColors.clear();
+  std::sort(m_highlight.begin(), m_highlight.end());
+  if(!d->m_parallelHighlights.isEmpty()) {
+    d->m_parallelHighlights << m_highlight;
+    m_highlight = mergeSorted(d->m_parallelHighlights);
+    d->m_parallelHighlights.clear();
+  }
+
+  m_functionColors.clear();
 
+  d->m_parallel = false;
   m_useClassCache = false;
   m_contextClasses.clear();
 }
 
 void CodeHighlightingInstance::highlightDUChain(DUContext* context, QHash<Declaration*, uint> colorsForDeclarations, ColorMap declarationsForColors)
+{
+  DeclarationColors* colors = new DeclarationColors(qMax(int(ColorCache::self()->validColorCount() + 1), declarationsForColors.size()));
+  colors->colors = colorsForDeclarations;
+  for(int colorNum = 0; colorNum < declarationsForColors.size(); ++colorNum) {
+    if(declarationsForColors[colorNum])
+      colors->usedColors.setBit(colorNum);
+  }
+  highlightDUChain(context, DeclarationColors::Ptr(colors));
+}
+
+void CodeHighlightingInstance::highlightDUChain(DUContext* context, DeclarationColors::Ptr colors)
 {
   DUChainReadLocker lock;
 
@@ -226,15 +326,17 @@ void CodeHighlightingInstance::highlightDUChain(DUContext* context, QHash<Declar
 
   //Merge the colors from the function arguments
   foreach( const DUContext::Import &imported, context->importedParentContexts() ) {
-    if(!imported.context(top) || (imported.context(top)->type() != DUContext::Other && imported.context(top)->type() != DUContext::Function))
+    DUContext* importedContext = imported.context(top);
+    if(!importedContext || (importedContext->type() != DUContext::Other && importedContext->type() != DUContext::Function))
       continue;
-    //For now it's enough simply copying them, because we only pass on colors within function bodies.
-    if (m_functionColorsForDeclarations.contains(imported.context(top)))
-      colorsForDeclarations = m_functionColorsForDeclarations[imported.context(top)];
-    if (m_functionDeclarationsForColors.contains(imported.context(top)))
-      declarationsForColors = m_functionDeclarationsForColors[imported.context(top)];
+    //For now it's enough simply taking them over, because we only pass on colors within function bodies.
+    const auto it = m_functionColors.constFind(IndexedDUContext(importedContext));
+    if (it != m_functionColors.constEnd())
+      colors = *it;
   }
 
+  // The colors given out here are added on top of the ones of the parent, which stay shared
+  QScopedPointer<DeclarationColors> localColors(new DeclarationColors(colors));
   QList<Declaration*> takeFreeColors;
 
   foreach (Declaration* dec, context->localDeclarations()) {
@@ -245,13 +347,12 @@ void CodeHighlightingInstance::highlightDUChain(DUContext* context, QHash<Declar
     //Initially pick a color using the hash, so the chances are good that the same identifier gets the same color always.
     uint colorNum = dec->identifier().hash() % ColorCache::self()->primaryColorCount();
 
-    if( declarationsForColors[colorNum] ) {
+    if( localColors->isUsed(colorNum) ) {
       takeFreeColors << dec; //Use one of the colors that stays free
       continue;
     }
 
-    colorsForDeclarations[dec] = colorNum;
-    declarationsForColors[colorNum] = dec;
+    localColors->setColor(dec, colorNum);
 
     highlightDeclaration(dec, ColorCache::self()->generatedColor(colorNum));
   }
@@ -259,7 +360,7 @@ void CodeHighlightingInstance::highlightDUChain(DUContext* context, QHash<Declar
     foreach (Declaration* dec, takeFreeColors) {
         uint colorNum = dec->identifier().hash() % ColorCache::self()->primaryColorCount();
         uint oldColorNum = colorNum;
-        while (declarationsForColors[colorNum]) {
+        while (localColors->isUsed(colorNum)) {
             colorNum = (colorNum + 1) % ColorCache::self()->primaryColorCount();
             if (colorNum == oldColorNum) {
                 colorNum = ColorCache::self()->primaryColorCount();
@@ -269,13 +370,12 @@ void CodeHighlightingInstance::highlightDUChain(DUContext* context, QHash<Declar
 
         if (colorNum < ColorCache::self()->primaryColorCount()) {
            // Use primary color
-            colorsForDeclarations[dec] = colorNum;
-            declarationsForColors[colorNum] = dec;
+            localColors->setColor(dec, colorNum);
             highlightDeclaration(dec, ColorCache::self()->generatedColor(colorNum));
         } else {
             // Try to use supplementary color
             colorNum = ColorCache::self()->primaryColorCount();
-            while (declarationsForColors[colorNum]) {
+            while (localColors->isUsed(colorNum)) {
                 colorNum++;
                 if (colorNum == ColorCache::self()->validColorCount()) {
                     //If no color could be found, use default color
@@ -285,33 +385,93 @@ void CodeHighlightingInstance::highlightDUChain(DUContext* context, QHash<Declar
             }
             if (colorNum < ColorCache::self()->validColorCount()) {
                 // Use supplementary color
-                colorsForDeclarations[dec] = colorNum;
-                declarationsForColors[colorNum] = dec;
+                localColors->setColor(dec, colorNum);
                 highlightDeclaration(dec, ColorCache::self()->generatedColor(colorNum));
             }
 
         }
     }
 
+  if(!localColors->colors.isEmpty())
+    colors = DeclarationColors::Ptr(localColors.take());
+
   for(int a = 0; a < context->usesCount(); ++a) {
     Declaration* decl = context->topContext()->usedDeclarationForIndex(context->uses()[a].m_declarationIndex);
     QColor color(QColor::Invalid);
-    if( colorsForDeclarations.contains(decl) )
-      color = ColorCache::self()->generatedColor(colorsForDeclarations[decl]);
+    const int colorNum = colors->color(decl);
+    if( colorNum != -1 )
+      color = ColorCache::self()->generatedColor(colorNum);
     highlightUse(context, a, color);
   }
 
-  if(context->type() == DUContext::Other || context->type() == DUContext::Function) {
-    m_functionColorsForDeclarations[IndexedDUContext(context)] = colorsForDeclarations;
-    m_functionDeclarationsForColors[IndexedDUContext(context)] = declarationsForColors;
-  }
+  if(context->type() == DUContext::Other || context->type() == DUContext::Function)
+    m_functionColors[IndexedDUContext(context)] = colors;
 
   QVector< DUContext* > children = context->childContexts();
 
   lock.unlock(); // Periodically release the lock, so that the UI won't be blocked too much
 
+  if(d->m_parallel && children.size() >= minParallelContexts) {
+    highlightInParallel(children, colors);
+    return;
+  }
+
   foreach (DUContext* child, children)
-    highlightDUChain(child,  colorsForDeclarations, declarationsForColors );
+    highlightDUChain(child, colors);
+}
+
+void CodeHighlightingInstance::highlightInParallel(const QVector<DUContext*>& children, const DeclarationColors::Ptr& colors)
+{
+  // A function body takes over the colors of the function context it imports, which usually is the sibling
+  // right before it, so the groups are not split between a context and a later sibling that imports it
+  QVector<bool> canSplitBefore(children.size(), true);
+  {
+    DUChainReadLocker lock;
+    QHash<DUContext*, int> indices;
+    indices.reserve(children.size());
+    for(int i = 0; i < children.size(); ++i)
+      indices.insert(children[i], i);
+
+    TopDUContext* top = children.first()->topContext();
+    for(int i = 0; i < children.size(); ++i) {
+      foreach( const DUContext::Import &imported, children[i]->importedParentContexts() ) {
+        const int importedIndex = indices.value(imported.context(top), -1);
+        for(int j = importedIndex + 1; importedIndex != -1 && j <= i; ++j)
+          canSplitBefore[j] = false;
+      }
+    }
+  }
+
+  // A few groups per thread, so threads that finish early can help out
+  const int groupSize = qMax(minContextGroupSize, children.size() / (qMax(1, QThread::idealThreadCount()) * 4));
+  QVector<QVector<DUContext*>> groups;
+  QVector<DUContext*> group;
+  for(int i = 0; i < children.size(); ++i) {
+    if(group.size() >= groupSize && canSplitBefore[i]) {
+      groups << group;
+      group.clear();
+    }
+    group << children[i];
+  }
+  groups << group;
+
+  QVector<QVector<HighlightedRange>> highlights(groups.size());
+  QVector<int> indices(groups.size());
+  for(int i = 0; i < groups.size(); ++i)
+    indices[i] = i;
+
+  QtConcurrent::blockingMap(indices, [&](int i) {
+    // Each group gets its own instance, so the caches and results are not shared between threads
+    QScopedPointer<CodeHighlightingInstance> instance(m_highlighting->createInstance());
+    instance->m_useClassCache = true;
+    instance->m_functionColors = m_functionColors;
+    foreach (DUContext* child, groups[i])
+      instance->highlightDUChain(child, colors);
+    std::sort(instance->m_highlight.begin(), instance->m_highlight.end());
+    highlights[i] = instance->m_highlight;
+  });
+
+  d->m_parallelHighlights << highlights;
 }
 
 KTextEditor::Attribute::Ptr CodeHighlighting::attributeForDepth(int depth) const
@@ -458,11 +618,20 @@ bool CodeHighlightingInstance::useRainbowColor(Declaration* dec) const
   return dec->context()->type() == DUContext::Function || (dec->context()->type() == DUContext::Other && dec->context()->owner());
 }
 
+KTextEditor::Attribute::Ptr CodeHighlightingInstance::attributeForType(Types type, Contexts context, const QColor& color)
+{
+  const QPair<int, QRgb> key((type * 3 + context) * 2 + color.isValid(), color.isValid() ? color.rgba() : 0);
+  KTextEditor::Attribute::Ptr& attribute = d->m_attributes[key];
+  if (!attribute)
+    attribute = m_highlighting->attributeForType(type, context, color);
+  return attribute;
+}
+
 void CodeHighlightingInstance::highlightDeclaration(Declaration * declaration, const QColor &color)
 {
   HighlightedRange h;
   h.range = declaration->range();
-  h.attribute = m_highlighting->attributeForType(typeForDeclaration(declaration, nullptr), DeclarationContext, color);
+  h.attribute = attributeForType(typeForDeclaration(declaration, nullptr), DeclarationContext, color);
   m_highlight.push_back(h);
 }
 
@@ -477,7 +646,7 @@ void CodeHighlightingInstance::highlightUse(DUContext* context, int index, const
   {
     HighlightedRange h;
     h.range = context->uses()[index].m_range;
-    h.attribute = m_highlighting->attributeForType(type, ReferenceContext, color);
+    h.attribute = attributeForType(type, ReferenceContext, color);
     m_highlight.push_back(h);
   }
 }
@@ -497,7 +666,7 @@ void CodeHighlighting::clearHighlightingForDocument(IndexedString document)
   if(m_highlights.contains(tracker))
   {
     disconnect(tracker, &DocumentChangeTracker::destroyed, this, &CodeHighlighting::trackerDestroyed);
-    qDeleteAll(m_highlights[tracker]->m_highlightedRanges);
+    qDeleteAll(m_highlights[tracker]->movingRanges());
     delete m_highlights[tracker];
     m_highlights.remove(tracker);
   }
@@ -525,11 +694,13 @@ void CodeHighlighting::applyHighlighting(void* _highlighting)
     return;
   }
 
-  QVector< MovingRange* > oldHighlightedRanges;
+  QElapsedTimer timer;
+  timer.start();
 
   if(m_highlights.contains(tracker))
   {
-    oldHighlightedRanges = m_highlights[tracker]->m_highlightedRanges;
+    // This may still be applied partly, then the previous ranges are what is in place right now
+    highlighting->m_oldRanges = m_highlights[tracker]->movingRanges();
     delete m_highlights[tracker];
   }else{
     // we newly add this tracker, so add the connection
@@ -543,54 +714,194 @@ void CodeHighlighting::applyHighlighting(void* _highlighting)
 
   m_highlights[tracker] = highlighting;
 
-  // Now create MovingRanges (match old ones with the incoming ranges)
+  // Split the highlighting into parts, each replacing the previous moving ranges in front of the next part
+  const QVector<MovingRange*>& oldRanges = highlighting->m_oldRanges;
+  const int count = highlighting->m_waiting.size();
+  const int partCount = qMax(1, (count + highlightingPartSize - 1) / highlightingPartSize);
+  highlighting->m_parts.resize(partCount);
+  for(int i = 0; i < partCount; ++i)
+  {
+    DocumentHighlighting::Part& part = highlighting->m_parts[i];
+    part.begin = i * highlightingPartSize;
+    part.end = qMin(count, part.begin + highlightingPartSize);
+    part.oldBegin = i ? highlighting->m_parts[i - 1].oldEnd : 0;
+    part.applied = false;
+    if(i == partCount - 1) {
+      part.oldEnd = oldRanges.size();
+    } else {
+      const KTextEditor::Cursor next = tracker->transformToCurrentRevision(highlighting->m_waiting[part.end].range.start, highlighting->m_waitingRevision);
+      part.oldEnd = std::lower_bound(oldRanges.begin() + part.oldBegin, oldRanges.end(), next,
+                                     [] (MovingRange* range, const KTextEditor::Cursor& cursor) {
+                                       return range->start().toCursor() < cursor;
+                                     }) - oldRanges.begin();
+    }
+  }
 
-  KTextEditor::Range tempRange;
+  // The parts on screen are applied right away, the others follow in time slices
+  int visibleParts = 0;
+  const KTextEditor::Range visible = visibleLines(tracker->document());
+  if(visible.isValid())
+  {
+    const RangeInRevision visibleInRevision = tracker->transformToRevision(visible, highlighting->m_waitingRevision);
+    for(int i = 0; i < partCount; ++i)
+    {
+      const DocumentHighlighting::Part& part = highlighting->m_parts[i];
+      const int firstLine = i ? highlighting->m_waiting[part.begin].range.start.line : 0;
+      const int lastLine = i < partCount - 1 ? highlighting->m_waiting[part.end].range.start.line : std::numeric_limits<int>::max();
+      if(firstLine <= visibleInRevision.end.line && lastLine >= visibleInRevision.start.line)
+        highlighting->m_pendingParts.append(i);
+    }
+    visibleParts = highlighting->m_pendingParts.size();
+  }
+  for(int i = 0; i < partCount; ++i)
+  {
+    if(!highlighting->m_pendingParts.contains(i))
+      highlighting->m_pendingParts.append(i);
+  }
+
+  if(applyParts(tracker, highlighting, timer, qMax(1, visibleParts)))
+    scheduleApplying();
+}
 
-  QVector<MovingRange*>::iterator movingIt = oldHighlightedRanges.begin();
-  QVector<HighlightedRange>::iterator rangeIt = highlighting->m_waiting.begin();
+void CodeHighlighting::applyPart(DocumentChangeTracker* tracker, DocumentHighlighting* highlighting, DocumentHighlighting::Part* part)
+{
+  // Match the previous moving ranges with the incoming ranges, both are sorted by their start
+  QVector<MovingRange*>& oldRanges = highlighting->m_oldRanges;
+  int oldIndex = part->oldBegin;
+  part->ranges.reserve(part->end - part->begin);
 
-  while(rangeIt != highlighting->m_waiting.end())
+  for(int i = part->begin; i < part->end; ++i)
   {
+    const HighlightedRange& highlight = highlighting->m_waiting[i];
+
     // Translate the range into the current revision
-    KTextEditor::Range transformedRange = tracker->transformToCurrentRevision(rangeIt->range, highlighting->m_waitingRevision);
+    const KTextEditor::Range range = tracker->transformToCurrentRevision(highlight.range, highlighting->m_waitingRevision);
 
-    while(movingIt != oldHighlightedRanges.end() &&
-      ((*movingIt)->start().line() < transformedRange.start().line() ||
-      ((*movingIt)->start().line() == transformedRange.start().line() && (*movingIt)->start().column() < transformedRange.start().column())))
+    while(oldIndex < part->oldEnd && (!oldRanges[oldIndex] || oldRanges[oldIndex]->start().toCursor() < range.start()))
     {
-      delete *movingIt; // Skip ranges that are in front of the current matched range
-      ++movingIt;
+      delete oldRanges[oldIndex]; // Skip ranges that are in front of the current matched range
+      oldRanges[oldIndex] = nullptr;
+      ++oldIndex;
     }
 
-
-    tempRange = transformedRange;
-
-    if(movingIt == oldHighlightedRanges.end() ||
-      transformedRange.start().line() != (*movingIt)->start().line() ||
-      transformedRange.start().column() != (*movingIt)->start().column() ||
-      transformedRange.end().line() != (*movingIt)->end().line() ||
-      transformedRange.end().column() != (*movingIt)->end().column())
+    if(oldIndex == part->oldEnd || oldRanges[oldIndex]->toRange() != range)
     {
-      Q_ASSERT(rangeIt->attribute);
+      Q_ASSERT(highlight.attribute);
       // The moving range is behind or unequal, create a new range
-      highlighting->m_highlightedRanges.push_back(tracker->documentMovingInterface()->newMovingRange(tempRange));
-      highlighting->m_highlightedRanges.back()->setAttribute(rangeIt->attribute);
-      highlighting->m_highlightedRanges.back()->setZDepth(highlightingZDepth);
+      MovingRange* movingRange = tracker->documentMovingInterface()->newMovingRange(range);
+      movingRange->setAttribute(highlight.attribute);
+      movingRange->setZDepth(highlightingZDepth);
+      part->ranges.push_back(movingRange);
+      ++highlighting->m_createdRanges;
     }
     else
     {
-      // Update the existing moving range
-      (*movingIt)->setAttribute(rangeIt->attribute);
-      (*movingIt)->setRange(tempRange);
-      highlighting->m_highlightedRanges.push_back(*movingIt);
-      ++movingIt;
+      // Keep the existing moving range, it only has to be repainted if its attribute changed
+      MovingRange* movingRange = oldRanges[oldIndex];
+      if(movingRange->attribute() != highlight.attribute && !(movingRange->attribute() && *movingRange->attribute() == *highlight.attribute))
+        movingRange->setAttribute(highlight.attribute);
+      part->ranges.push_back(movingRange);
+      oldRanges[oldIndex] = nullptr;
+      ++oldIndex;
     }
-    ++rangeIt;
   }
 
-  for(; movingIt != oldHighlightedRanges.end(); ++movingIt)
-    delete *movingIt; // Delete unmatched moving ranges behind
+  for(; oldIndex < part->oldEnd; ++oldIndex)
+  {
+    delete oldRanges[oldIndex]; // Delete unmatched moving ranges behind
+    oldRanges[oldIndex] = nullptr;
+  }
+
+  part->applied = true;
+}
+
+bool CodeHighlighting::applyParts(DocumentChangeTracker* tracker, DocumentHighlighting* highlighting, const QElapsedTimer& timer, int minimumParts)
+{
+  const qint64 start = timer.nsecsElapsed();
+
+  for(int applied = 0; !highlighting->m_pendingParts.isEmpty() && (applied < minimumParts || timer.elapsed() < highlightingTimeSlice); ++applied)
+    applyPart(tracker, highlighting, &highlighting->m_parts[highlighting->m_pendingParts.takeFirst()]);
+
+  highlighting->m_applyTime += timer.nsecsElapsed() - start;
+  ++highlighting->m_applySlices;
+
+  if(!highlighting->m_pendingParts.isEmpty())
+    return true;
+
+  finishHighlighting(highlighting);
+  return false;
+}
+
+void CodeHighlighting::finishHighlighting(DocumentHighlighting* highlighting)
+{
+  highlighting->m_highlightedRanges = highlighting->movingRanges();
+  highlighting->m_parts.clear();
+  highlighting->m_pendingParts.clear();
+  highlighting->m_oldRanges.clear();
+
+  qCDebug(HIGHLIGHTING) << "applied highlighting of" << highlighting->m_document.str() << "in"
+                        << highlighting->m_applyTime / 1000000.0 << "ms," << highlighting->m_applySlices << "slices,"
+                        << highlighting->m_createdRanges << "of" << highlighting->m_highlightedRanges.size() << "moving ranges created";
+}
+
+void CodeHighlighting::scheduleApplying()
+{
+  if(m_applyScheduled)
+    return;
+
+  m_applyScheduled = true;
+  QTimer::singleShot(0, this, &CodeHighlighting::applyPendingHighlighting);
+}
+
+void CodeHighlighting::applyPendingHighlighting()
+{
+  VERIFY_FOREGROUND_LOCKED
+  QMutexLocker lock(&m_dataMutex);
+  m_applyScheduled = false;
+
+  QElapsedTimer timer;
+  timer.start();
+
+  bool pending = false;
+  for(auto it = m_highlights.constBegin(); it != m_highlights.constEnd(); ++it)
+  {
+    DocumentHighlighting* highlighting = it.value();
+    if(highlighting->m_pendingParts.isEmpty())
+      continue;
+
+    if(!it.key()->holdingRevision(highlighting->m_waitingRevision)) {
+      qCDebug(HIGHLIGHTING) << "not holding revision" << highlighting->m_waitingRevision << "anymore, stopped applying the highlighting of"
+                            << highlighting->m_document.str();
+      finishHighlighting(highlighting);
+      continue;
+    }
+
+    // Each document gets at least one part per slice
+    if(applyParts(it.key(), highlighting, timer, 1))
+      pending = true;
+  }
+
+  if(pending)
+    scheduleApplying();
+}
+
+QVector<MovingRange*> CodeHighlighting::DocumentHighlighting::movingRanges() const
+{
+  if(m_parts.isEmpty())
+    return m_highlightedRanges;
+
+  QVector<MovingRange*> ranges;
+  foreach(const Part& part, m_parts) {
+    if(part.applied) {
+      ranges += part.ranges;
+      continue;
+    }
+    for(int i = part.oldBegin; i < part.oldEnd; ++i) {
+      if(m_oldRanges[i])
+        ranges += m_oldRanges[i];
+    }
+  }
+  return ranges;
 }
 
 void CodeHighlighting::trackerDestroyed(QObject* object)
@@ -623,14 +934,28 @@ void CodeHighlighting::aboutToRemoveText( const KTextEditor::Range& range )
                                       ->trackerForUrl(IndexedString(doc->url()));
   if(m_highlights.contains(tracker))
   {
-    QVector<MovingRange*>& ranges = m_highlights.value(tracker)->m_highlightedRanges;
-    QVector<MovingRange*>::iterator it = ranges.begin();
-    while(it != ranges.end()) {
-      if (range.contains((*it)->toRange())) {
-        delete (*it);
-        it = ranges.erase(it);
-      } else {
-        ++it;
+    DocumentHighlighting* highlighting = m_highlights.value(tracker);
+    auto removeContained = [&range] (QVector<MovingRange*>& ranges) {
+      QVector<MovingRange*>::iterator it = ranges.begin();
+      while(it != ranges.end()) {
+        if (range.contains((*it)->toRange())) {
+          delete (*it);
+          it = ranges.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    };
+
+    removeContained(highlighting->m_highlightedRanges);
+    for(DocumentHighlighting::Part& part : highlighting->m_parts)
+      removeContained(part.ranges);
+
+    // The previous ranges are only zeroed, so the parts can still find theirs by index
+    for(MovingRange*& oldRange : highlighting->m_oldRanges) {
+      if (oldRange && range.contains(oldRange->toRange())) {
+        delete oldRange;
+        oldRange = nullptr;
       }
     }
   }
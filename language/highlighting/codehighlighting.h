@@ -25,7 +25,12 @@
 #define KDEVPLATFORM_CODEHIGHLIGHTING_H
 
 #include <QObject>
+#include <QBitArray>
 #include <QHash>
+#include <QElapsedTimer>
+#include <QReadWriteLock>
+#include <QScopedPointer>
+#include <QSharedPointer>
 
 #include <ktexteditor/attribute.h>
 #include <ktexteditor/movingrange.h>
@@ -96,23 +101,67 @@ struct HighlightedRange
   }
 };
 
+/**
+ * The rainbow colors given to the declarations of a context and of the contexts around it.
+ *
+ * A context that gives out colors puts them on top of the colors of its parent context, which
+ * are shared by all child contexts and never changed afterwards, instead of copying them.
+ * */
+struct DeclarationColors
+{
+  typedef QSharedPointer<const DeclarationColors> Ptr;
+
+  explicit DeclarationColors(int colorCount) : usedColors(colorCount) {
+  }
+  explicit DeclarationColors(const Ptr& parent) : parent(parent), usedColors(parent->usedColors) {
+  }
+
+  /// Returns the color number of @p declaration, or -1 if it has none
+  int color(KDevelop::Declaration* declaration) const {
+    for (const DeclarationColors* colors = this; colors; colors = colors->parent.data()) {
+      const auto it = colors->colors.constFind(declaration);
+      if (it != colors->colors.constEnd())
+        return *it;
+    }
+    return -1;
+  }
+
+  bool isUsed(uint color) const {
+    return usedColors.testBit(color);
+  }
+
+  void setColor(KDevelop::Declaration* declaration, uint color) {
+    colors.insert(declaration, color);
+    usedColors.setBit(color);
+  }
+
+  Ptr parent;
+  QHash<KDevelop::Declaration*, uint> colors;
+  // Bit n is set if color n is given to a declaration here or in a parent
+  QBitArray usedColors;
+};
+
 /**
  * Code highlighting instance that is used to apply code highlighting to one specific top context
+ *
+ * If CodeHighlighting::supportsParallelHighlighting() returns true, large contexts are highlighted in parallel:
+ * their child contexts are split into groups that are highlighted by separate instances, created through
+ * CodeHighlighting::createInstance().
  * */
 
 class KDEVPLATFORMLANGUAGE_EXPORT CodeHighlightingInstance : public HighlightingEnumContainer {
   public:
-    explicit CodeHighlightingInstance(const CodeHighlighting* highlighting) : m_useClassCache(false), m_highlighting(highlighting) {
-    }
-    virtual ~CodeHighlightingInstance() {
-    }
+    explicit CodeHighlightingInstance(const CodeHighlighting* highlighting);
+    virtual ~CodeHighlightingInstance();
 
     virtual void highlightDeclaration(KDevelop::Declaration* declaration, const QColor &color);
     virtual void highlightUse(KDevelop::DUContext* context, int index, const QColor &color);
     virtual void highlightUses(KDevelop::DUContext* context);
 
+    /// Fills m_highlight, sorted by range start
     void highlightDUChain(KDevelop::TopDUContext* context);
-    void highlightDUChain(KDevelop::DUContext* context, QHash<KDevelop::Declaration*, uint> colorsForDeclarations, ColorMap);
+    void highlightDUChain(KDevelop::DUContext* context, DeclarationColors::Ptr colors);
+    void highlightDUChain(KDevelop::DUContext* context, QHash<KDevelop::Declaration*, uint> colorsForDeclarations, ColorMap declarationsForColors);
 
     KDevelop::Declaration* localClassFromCodeContext(KDevelop::DUContext* context) const;
     /**
@@ -125,17 +174,31 @@ class KDEVPLATFORMLANGUAGE_EXPORT CodeHighlightingInstance : public Highlighting
      */
     virtual bool useRainbowColor(KDevelop::Declaration* dec) const;
 
+    /**
+     * Returns CodeHighlighting::attributeForType(), which is only asked once per attribute this instance uses.
+     * The ranges highlighted with the same attribute share it.
+     */
+    KTextEditor::Attribute::Ptr attributeForType(Types type, Contexts context, const QColor& color);
+
     //A temporary hash for speedup
     mutable QHash<KDevelop::DUContext*, KDevelop::Declaration*> m_contextClasses;
 
     //Here the colors of function context are stored until they are merged into the function body
-    mutable QMap<KDevelop::IndexedDUContext, QHash<KDevelop::Declaration*, uint> > m_functionColorsForDeclarations;
-    mutable QMap<KDevelop::IndexedDUContext, ColorMap> m_functionDeclarationsForColors;
+    mutable QMap<KDevelop::IndexedDUContext, DeclarationColors::Ptr> m_functionColors;
 
+  private:
+    // Takes the place of the second map of function colors, so the following members keep their offsets
+    const QScopedPointer<class CodeHighlightingInstancePrivate> d;
+
+  public:
     mutable bool m_useClassCache;
     const CodeHighlighting* m_highlighting;
 
     QVector<HighlightedRange> m_highlight;
+
+  private:
+    /// Highlights @p children, which have the colors @p colors, in groups on the global thread pool
+    void highlightInParallel(const QVector<KDevelop::DUContext*>& children, const DeclarationColors::Ptr& colors);
 };
 
 /**
@@ -164,6 +227,9 @@ class KDEVPLATFORMLANGUAGE_EXPORT CodeHighlighting : public QObject, public KDev
     bool hasHighlighting(IndexedString url) const override;
 
   private:
+    /// The cached attributes without color for @p context, m_attributesLock has to be held
+    QHash<Types, KTextEditor::Attribute::Ptr>& cachedAttributes(Contexts context) const;
+
     //Returns whether the given attribute was set by the code highlighting, and not by something else
     //Always returns true when the attribute is zero
     bool isCodeHighlight(KTextEditor::Attribute::Ptr attr) const;
@@ -172,18 +238,61 @@ class KDEVPLATFORMLANGUAGE_EXPORT CodeHighlighting : public QObject, public KDev
     //Can be overridden to create an own instance type
     virtual CodeHighlightingInstance* createInstance() const;
 
+    /**
+     * Whether large contexts may be highlighted by several instances on different threads at once.
+     * Only return true if the instances created by createInstance() can be used concurrently.
+     * The default implementation returns false.
+     */
+    virtual bool supportsParallelHighlighting() const;
+
   private:
 
     /// Highlighting of one specific document
     struct DocumentHighlighting
     {
+      /// A slice of m_waiting that is applied at once, together with the moving ranges of the previous highlighting it replaces
+      struct Part
+      {
+        int begin;
+        int end;
+        int oldBegin;
+        int oldEnd;
+        bool applied;
+        QVector<KTextEditor::MovingRange*> ranges;
+      };
+
+      DocumentHighlighting() : m_waitingRevision(0), m_applyTime(0), m_applySlices(0), m_createdRanges(0) {
+      }
+
+      /// Returns the moving ranges in document order, including the ones of the previous highlighting that are not replaced yet
+      QVector<KTextEditor::MovingRange*> movingRanges() const;
+
       IndexedString m_document;
       qint64 m_waitingRevision;
       // The ranges are sorted by range start, so they can easily be matched
       QVector<HighlightedRange> m_waiting;
       QVector<KTextEditor::MovingRange*> m_highlightedRanges;
+
+      // While the highlighting is applied: all parts in document order, the ones still to apply in the order
+      // they are applied, and the moving ranges of the previous highlighting, which are zeroed once they are taken care of
+      QVector<Part> m_parts;
+      QVector<int> m_pendingParts;
+      QVector<KTextEditor::MovingRange*> m_oldRanges;
+
+      // Nanoseconds spent applying, in how many slices, and how many moving ranges had to be created
+      qint64 m_applyTime;
+      int m_applySlices;
+      int m_createdRanges;
     };
 
+    /// Replaces the moving ranges of the previous highlighting in @p part
+    void applyPart(DocumentChangeTracker* tracker, DocumentHighlighting* highlighting, DocumentHighlighting::Part* part);
+    /// Applies at least @p minimumParts pending parts, and more until @p timer reaches the time slice. Returns whether parts are left.
+    bool applyParts(DocumentChangeTracker* tracker, DocumentHighlighting* highlighting, const QElapsedTimer& timer, int minimumParts);
+    /// Takes the applied parts over into m_highlightedRanges
+    void finishHighlighting(DocumentHighlighting* highlighting);
+    void scheduleApplying();
+
     QMap<DocumentChangeTracker*, DocumentHighlighting*> m_highlights;
 
 
@@ -199,10 +308,16 @@ class KDEVPLATFORMLANGUAGE_EXPORT CodeHighlighting : public QObject, public KDev
     bool m_globalColorization;
 
     mutable QMutex m_dataMutex;
+    // Protects the cached attributes without color, which are looked up by the threads that highlight
+    mutable QReadWriteLock m_attributesLock;
+    // Whether applyPendingHighlighting() is going to be called
+    bool m_applyScheduled;
 
   private Q_SLOTS:
     void clearHighlightingForDocument(KDevelop::IndexedString document);
     void applyHighlighting(void* highlighting);
+    /// Applies the next parts of highlightings that are too large to be applied at once
+    void applyPendingHighlighting();
 
     void trackerDestroyed(QObject* object);
 
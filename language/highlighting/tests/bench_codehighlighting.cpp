@@ -0,0 +1,133 @@
+/*
+ * This file is part of KDevelop
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "bench_codehighlighting.h"
+
+#include <language/duchain/duchain.h>
+#include <language/duchain/duchainlock.h>
+#include <language/duchain/declaration.h>
+#include <language/duchain/topducontext.h>
+#include <language/highlighting/codehighlighting.h>
+#include <serialization/indexedstring.h>
+
+#include <tests/testcore.h>
+#include <tests/autotestshell.h>
+
+#include <QTest>
+#include <QThread>
+#include <QThreadPool>
+
+QTEST_GUILESS_MAIN(BenchCodeHighlighting);
+
+using namespace KDevelop;
+
+namespace {
+
+// like a large source file full of small functions
+const int functions = 5000;
+const int argumentsPerFunction = 3;
+const int localsPerFunction = 5;
+const int linesPerFunction = localsPerFunction + 2;
+
+// The default instances only use the duchain and the color cache, so they can highlight in parallel
+class ParallelCodeHighlighting : public CodeHighlighting
+{
+public:
+  using CodeHighlighting::CodeHighlighting;
+
+protected:
+  bool supportsParallelHighlighting() const override
+  {
+    return true;
+  }
+};
+
+}
+
+void BenchCodeHighlighting::initTestCase()
+{
+  AutoTestShell::init();
+  TestCore::initialize(Core::NoUi);
+
+  DUChainWriteLocker lock;
+  m_top = new TopDUContext(IndexedString(QStringLiteral("/tmp/bench_codehighlighting.cpp")), {0, 0, functions * linesPerFunction, 0});
+  DUChain::self()->addDocumentChain(m_top);
+  for (int i = 0; i < functions; ++i) {
+    const int line = i * linesPerFunction;
+    auto function = new Declaration({line, 0, line, 10}, m_top);
+    function->setIdentifier(Identifier(QStringLiteral("function%1").arg(i)));
+
+    // the arguments get rainbow colors, which the body takes over
+    auto arguments = new DUContext({line, 11, line, 80}, m_top);
+    arguments->setType(DUContext::Function);
+    function->setInternalContext(arguments);
+    QVector<Declaration*> argumentDeclarations;
+    for (int a = 0; a < argumentsPerFunction; ++a) {
+      auto argument = new Declaration({line, 12 + a * 20, line, 20 + a * 20}, arguments);
+      argument->setIdentifier(Identifier(QStringLiteral("argument%1").arg(a)));
+      argumentDeclarations << argument;
+    }
+
+    auto body = new DUContext({line + 1, 0, line + linesPerFunction - 1, 0}, m_top);
+    body->setType(DUContext::Other);
+    body->addImportedParentContext(arguments);
+    for (int l = 0; l < localsPerFunction; ++l) {
+      auto local = new Declaration({line + 1 + l, 4, line + 1 + l, 10}, body);
+      local->setIdentifier(Identifier(QStringLiteral("local%1").arg(l)));
+      body->createUse(m_top->indexForUsedDeclaration(argumentDeclarations[l % argumentsPerFunction]), {line + 1 + l, 13, line + 1 + l, 21});
+      body->createUse(m_top->indexForUsedDeclaration(function), {line + 1 + l, 24, line + 1 + l, 34});
+    }
+  }
+}
+
+void BenchCodeHighlighting::cleanupTestCase()
+{
+  {
+    DUChainWriteLocker lock;
+    DUChain::self()->removeDocumentChain(m_top);
+  }
+  TestCore::shutdown();
+}
+
+void BenchCodeHighlighting::highlightDUChain_data()
+{
+  QTest::addColumn<int>("threads");
+
+  QTest::newRow("one thread") << 1;
+  QTest::newRow("ideal thread count") << qMax(1, QThread::idealThreadCount());
+}
+
+void BenchCodeHighlighting::highlightDUChain()
+{
+  QFETCH(int, threads);
+
+  const int maxThreadCount = QThreadPool::globalInstance()->maxThreadCount();
+  QThreadPool::globalInstance()->setMaxThreadCount(threads);
+
+  ParallelCodeHighlighting highlighting(this);
+  int ranges = 0;
+  QBENCHMARK {
+    CodeHighlightingInstance instance(&highlighting);
+    instance.highlightDUChain(m_top);
+    ranges = instance.m_highlight.size();
+  }
+  QThreadPool::globalInstance()->setMaxThreadCount(maxThreadCount);
+
+  QCOMPARE(ranges, functions * (1 + argumentsPerFunction + localsPerFunction * 3));
+}
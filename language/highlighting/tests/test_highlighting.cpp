@@ -25,13 +25,36 @@
 #include <tests/autotestshell.h>
 #include <tests/testcore.h>
 #include <language/duchain/duchain.h>
+#include <language/duchain/duchainlock.h>
+#include <language/duchain/declaration.h>
+#include <language/duchain/topducontext.h>
 #include <language/codegen/coderepresentation.h>
 #include <language/highlighting/codehighlighting.h>
+#include <language/highlighting/colorcache.h>
+
+#include <algorithm>
 
 QTEST_MAIN(TestHighlighting)
 
 using namespace KDevelop;
 
+namespace {
+
+// The default instances only use the duchain and the color cache, so they can highlight in parallel
+class ParallelCodeHighlighting : public CodeHighlighting
+{
+public:
+    using CodeHighlighting::CodeHighlighting;
+
+protected:
+    bool supportsParallelHighlighting() const override
+    {
+        return true;
+    }
+};
+
+}
+
 void TestHighlighting::initTestCase()
 {
     AutoTestShell::init();
@@ -53,3 +76,62 @@ void TestHighlighting::testInitialization()
 }
 
 
+
+void TestHighlighting::testParallelHighlighting()
+{
+    // enough functions for the top context to be split up
+    const int functions = 200;
+
+    TopDUContext* top = nullptr;
+    {
+        DUChainWriteLocker lock;
+        top = new TopDUContext(IndexedString(QStringLiteral("/tmp/test_highlighting.cpp")), {0, 0, functions * 3, 0});
+        DUChain::self()->addDocumentChain(top);
+        for (int i = 0; i < functions; ++i) {
+            const int line = i * 3;
+            auto function = new Declaration({line, 0, line, 5}, top);
+            auto arguments = new DUContext({line, 6, line, 20}, top);
+            arguments->setType(DUContext::Function);
+            function->setInternalContext(arguments);
+            auto argument = new Declaration({line, 7, line, 12}, arguments);
+            argument->setIdentifier(Identifier(QStringLiteral("argument")));
+
+            auto body = new DUContext({line + 1, 0, line + 2, 0}, top);
+            body->setType(DUContext::Other);
+            body->addImportedParentContext(arguments);
+            new Declaration({line + 1, 4, line + 1, 9}, body);
+            body->createUse(top->indexForUsedDeclaration(argument), {line + 1, 12, line + 1, 17});
+        }
+    }
+
+    ParallelCodeHighlighting highlighting(this);
+    CodeHighlightingInstance instance(&highlighting);
+    instance.highlightDUChain(top);
+
+    const auto& highlight = instance.m_highlight;
+    QCOMPARE(highlight.size(), functions * 4);
+    QVERIFY(std::is_sorted(highlight.begin(), highlight.end()));
+    for (int i = 0; i < functions; ++i) {
+        // the use of the argument in the body gets the color of the argument
+        const HighlightedRange& argument = highlight[i * 4 + 1];
+        const HighlightedRange& use = highlight[i * 4 + 3];
+        QCOMPARE(argument.range, RangeInRevision(i * 3, 7, i * 3, 12));
+        QCOMPARE(use.range, RangeInRevision(i * 3 + 1, 12, i * 3 + 1, 17));
+        QCOMPARE(use.attribute->foreground(), argument.attribute->foreground());
+    }
+
+    // highlighting the top context sequentially gives the same result
+    CodeHighlightingInstance sequential(&highlighting);
+    sequential.m_useClassCache = true;
+    sequential.highlightDUChain(top, DeclarationColors::Ptr(new DeclarationColors(ColorCache::self()->validColorCount() + 1)));
+    auto expected = sequential.m_highlight;
+    std::sort(expected.begin(), expected.end());
+    QCOMPARE(highlight.size(), expected.size());
+    for (int i = 0; i < highlight.size(); ++i) {
+        QCOMPARE(highlight[i].range, expected[i].range);
+        QVERIFY(*highlight[i].attribute == *expected[i].attribute);
+    }
+
+    DUChainWriteLocker lock;
+    DUChain::self()->removeDocumentChain(top);
+}
@@ -152,4 +152,47 @@ bool matchesAbbreviationMulti(const QString &word, const QStringList &typedFragm
   return matchedFragments == typedFragments.size();
 }
 
+namespace {
+// ASCII letters and digits get a bit of their own, other characters share the rest
+inline quint64 characterBit(ushort c)
+{
+  if ( c >= 'a' && c <= 'z' ) {
+    return quint64(1) << (c - 'a');
+  }
+  if ( c >= '0' && c <= '9' ) {
+    return quint64(1) << (26 + c - '0');
+  }
+  return quint64(1) << (36 + c % 28);
+}
+}
+
+quint64 wordCharacterMask(const QString &word)
+{
+  quint64 mask = 0;
+  foreach ( const QChar c, word ) {
+    // the matching functions compare lower case characters, QString::indexOf() case folded ones
+    const QChar lower = c.toLower();
+    if ( lower.unicode() < 128 ) {
+      mask |= characterBit(lower.unicode());
+    }
+    const QChar folded = c.toCaseFolded();
+    if ( folded.unicode() < 128 ) {
+      mask |= characterBit(folded.unicode());
+    }
+  }
+  return mask;
+}
+
+quint64 typedCharacterMask(const QString &typed)
+{
+  quint64 mask = 0;
+  foreach ( const QChar c, typed ) {
+    // other characters may match in ways the masks cannot tell
+    if ( c.unicode() < 128 ) {
+      mask |= characterBit(c.toLower().unicode());
+    }
+  }
+  return mask;
+}
+
 // kate: space-indent on; indent-width 2
@@ -48,6 +48,20 @@ KDEVPLATFORMLANGUAGE_EXPORT bool matchesPath(const QString& path, const QString&
  */
 KDEVPLATFORMLANGUAGE_EXPORT bool matchesAbbreviationMulti(const QString& word, const QStringList& typedFragments);
 
+/**
+ * @brief Computes a mask of the characters in a word, to rule out matches quickly.
+ * A word can only match the typed text with the functions above or a case insensitive
+ * QString::indexOf() if its mask contains all bits of typedCharacterMask(typed).
+ * @param word the word to search in, its masks can be combined by or if it has several parts
+ */
+KDEVPLATFORMLANGUAGE_EXPORT quint64 wordCharacterMask(const QString& word);
+
+/**
+ * @brief Computes a mask of the characters that every match of the typed text contains.
+ * @see wordCharacterMask()
+ */
+KDEVPLATFORMLANGUAGE_EXPORT quint64 typedCharacterMask(const QString& typed);
+
 #endif
 
 // kate: space-indent on; indent-width 2
@@ -0,0 +1,55 @@
+/*
+ * This file is part of KDevelop
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "quickopenfilter.h"
+
+#include <QThread>
+#include <QtConcurrentMap>
+
+namespace {
+// below this, starting threads costs more than it saves
+const int minChunkSize = 5000;
+}
+
+namespace KDevelop {
+
+int filterChunkCount(int count)
+{
+    // a few chunks per thread, so threads that finish early can help out
+    return qBound(1, count / minChunkSize, qMax(1, QThread::idealThreadCount()) * 4);
+}
+
+void forEachFilterChunk(int count, const std::function<void(int chunk, int begin, int end)>& function)
+{
+    const int chunks = filterChunkCount(count);
+    if (chunks == 1) {
+        function(0, 0, count);
+        return;
+    }
+
+    QVector<int> indices(chunks);
+    for (int chunk = 0; chunk < chunks; ++chunk) {
+        indices[chunk] = chunk;
+    }
+    QtConcurrent::blockingMap(indices, [count, chunks, &function](int chunk) {
+        function(chunk, qint64(count) * chunk / chunks, qint64(count) * (chunk + 1) / chunks);
+    });
+}
+
+}
@@ -23,13 +23,29 @@
 #define KDEVPLATFORM_QUICKOPEN_FILTER_H
 
 #include <QStringList>
+#include <QVector>
 
 #include "abbreviations.h"
 
+#include <language/languageexport.h>
 #include <util/path.h>
 
+#include <functional>
+
 namespace KDevelop {
 
+/**
+ * @return the number of chunks forEachFilterChunk() splits @p count items into
+ */
+KDEVPLATFORMLANGUAGE_EXPORT int filterChunkCount(int count);
+
+/**
+ * Calls @p function for consecutive ranges of items that cover the @p count items,
+ * on several threads at once if there are enough items to make that worthwhile.
+ * The chunks are numbered from 0 to filterChunkCount(count) - 1, in the order of their ranges.
+ */
+KDEVPLATFORMLANGUAGE_EXPORT void forEachFilterChunk(int count, const std::function<void(int chunk, int begin, int end)>& function);
+
 /**
  * This is a simple filter-implementation that helps you implementing own quickopen data-providers.
  * You should use it when possible, because that way additional features(like regexp filtering) can
@@ -143,6 +159,15 @@ private:
 
 namespace KDevelop {
 
+/**
+ * Filters items by their path, like the quickopen file lists do.
+ *
+ * Parent has to provide @code KDevelop::Path itemPath(const Item& data) const @endcode,
+ * which is called from several threads at once for large numbers of items.
+ *
+ * A mask of the characters in each path is kept along with the items, most items
+ * can be ruled out by comparing it with the typed characters before looking at the path.
+ */
 template<class Item, class Parent>
 class PathFilter
 {
@@ -151,6 +176,7 @@ public:
     void clearFilter()
     {
         m_filtered = m_items;
+        m_filteredMasks = m_itemMasks;
         m_oldFilterText.clear();
     }
 
@@ -158,6 +184,8 @@ public:
     void setItems( const QList<Item>& data )
     {
         m_items = data;
+        // computed along with the first filtering
+        m_itemMasks.clear();
         clearFilter();
     }
 
@@ -186,9 +214,11 @@ public:
         const QString joinedText = text.join(QString());
 
         QList<Item> filterBase = m_filtered;
+        QVector<quint64> filterBaseMasks = m_filteredMasks;
 
         if ( m_oldFilterText.isEmpty()) {
             filterBase = m_items;
+            filterBaseMasks = m_itemMasks;
         } else if (m_oldFilterText.mid(0, m_oldFilterText.count() - 1) == text.mid(0, text.count() - 1)
                    && text.last().startsWith(m_oldFilterText.last())) {
             //Good, the prefix is the same, and the last item has been extended
@@ -197,82 +227,138 @@ public:
         } else {
             //Start filtering based on the whole data, there was a big change to the filter
             filterBase = m_items;
+            filterBaseMasks = m_itemMasks;
         }
 
+        if (filterBaseMasks.size() != filterBase.size()) {
+            // the masks are not known yet, which only happens right after setItems()
+            computeItemMasks();
+            filterBase = m_items;
+            filterBaseMasks = m_itemMasks;
+        }
+
+        const quint64 textMask = typedCharacterMask(joinedText);
+
         // filterBase is correctly sorted, to keep it that way we add
         // exact matches to this list in sorted way and then prepend the whole list in one go.
-        QList<Item> exactMatches;
-        // similar for starting matches
-        QList<Item> startMatches;
-        // all other matches
-        QList<Item> otherMatches;
-        foreach( const Item& data, filterBase ) {
-            const Path toFilter = static_cast<Parent*>(this)->itemPath(data);
-            const QVector<QString>& segments = toFilter.segments();
+        // similar for starting matches and all other matches
+        struct Matches
+        {
+            QVector<int> exactMatches;
+            QVector<int> startMatches;
+            QVector<int> otherMatches;
+        };
+        QVector<Matches> chunkMatches(filterChunkCount(filterBase.size()));
+        forEachFilterChunk(filterBase.size(), [&](int chunk, int begin, int end) {
+            Matches& matches = chunkMatches[chunk];
+            for (int index = begin; index < end; ++index) {
+                if ((filterBaseMasks.at(index) & textMask) != textMask) {
+                    // some typed character is not in the path
+                    continue;
+                }
+                const Item& data = filterBase.at(index);
+                const Path toFilter = static_cast<const Parent*>(this)->itemPath(data);
+                const QVector<QString>& segments = toFilter.segments();
 
-            if (text.count() > segments.count()) {
-                // number of segments mismatches, thus item cannot match
-                continue;
-            }
-            {
-                bool allMatched = true;
-                // try to put exact matches up front
-                for(int i = segments.count() - 1, j = text.count() - 1;
-                    i >= 0 && j >= 0; --i, --j)
+                if (text.count() > segments.count()) {
+                    // number of segments mismatches, thus item cannot match
+                    continue;
+                }
                 {
-                    if (segments.at(i) != text.at(j)) {
-                        allMatched = false;
-                        break;
+                    bool allMatched = true;
+                    // try to put exact matches up front
+                    for(int i = segments.count() - 1, j = text.count() - 1;
+                        i >= 0 && j >= 0; --i, --j)
+                    {
+                        if (segments.at(i) != text.at(j)) {
+                            allMatched = false;
+                            break;
+                        }
+                    }
+                    if (allMatched) {
+                        matches.exactMatches << index;
+                        continue;
                     }
                 }
-                if (allMatched) {
-                    exactMatches << data;
-                    continue;
-                }
-            }
 
-            int searchIndex = 0;
-            int pathIndex = 0;
-            int lastMatchIndex = -1;
-            // stop early if more search fragments remain than available after path index
-            while (pathIndex < segments.size() && searchIndex < text.size()
-                    && (pathIndex + text.size() - searchIndex - 1) < segments.size() )
-            {
-                const QString& segment = segments.at(pathIndex);
-                const QString& typedSegment = text.at(searchIndex);
-                lastMatchIndex = segment.indexOf(typedSegment, 0, Qt::CaseInsensitive);
-                if (lastMatchIndex == -1 && !matchesAbbreviation(segment.midRef(0), typedSegment)) {
-                    // no match, try with next path segment
+                int searchIndex = 0;
+                int pathIndex = 0;
+                int lastMatchIndex = -1;
+                // stop early if more search fragments remain than available after path index
+                while (pathIndex < segments.size() && searchIndex < text.size()
+                        && (pathIndex + text.size() - searchIndex - 1) < segments.size() )
+                {
+                    const QString& segment = segments.at(pathIndex);
+                    const QString& typedSegment = text.at(searchIndex);
+                    lastMatchIndex = segment.indexOf(typedSegment, 0, Qt::CaseInsensitive);
+                    if (lastMatchIndex == -1 && !matchesAbbreviation(segment.midRef(0), typedSegment)) {
+                        // no match, try with next path segment
+                        ++pathIndex;
+                        continue;
+                    }
+                    // else we matched
+                    ++searchIndex;
                     ++pathIndex;
-                    continue;
                 }
-                // else we matched
-                ++searchIndex;
-                ++pathIndex;
-            }
 
-            if (searchIndex != text.size()) {
-                if ( ! matchesPath(segments.last(), joinedText) ) {
-                    continue;
+                if (searchIndex != text.size()) {
+                    if ( ! matchesPath(segments.last(), joinedText) ) {
+                        continue;
+                    }
+                }
+
+                // prefer matches whose last element starts with the filter
+                if (pathIndex == segments.size() && lastMatchIndex == 0) {
+                    matches.startMatches << index;
+                } else {
+                    matches.otherMatches << index;
                 }
             }
+        });
 
-            // prefer matches whose last element starts with the filter
-            if (pathIndex == segments.size() && lastMatchIndex == 0) {
-                startMatches << data;
-            } else {
-                otherMatches << data;
+        m_filtered.clear();
+        m_filteredMasks.clear();
+        auto append = [&](const QVector<int>& indices) {
+            foreach (int index, indices) {
+                m_filtered << filterBase.at(index);
+                m_filteredMasks << filterBaseMasks.at(index);
             }
+        };
+        foreach (const Matches& matches, chunkMatches) {
+            append(matches.exactMatches);
+        }
+        foreach (const Matches& matches, chunkMatches) {
+            append(matches.startMatches);
+        }
+        foreach (const Matches& matches, chunkMatches) {
+            append(matches.otherMatches);
         }
-
-        m_filtered = exactMatches + startMatches + otherMatches;
         m_oldFilterText = text;
     }
 
 private:
+    void computeItemMasks()
+    {
+        m_itemMasks.resize(m_items.size());
+        quint64* masks = m_itemMasks.data();
+        forEachFilterChunk(m_items.size(), [this, masks](int /*chunk*/, int begin, int end) {
+            for (int index = begin; index < end; ++index) {
+                quint64 mask = 0;
+                foreach (const QString& segment, static_cast<const Parent*>(this)->itemPath(m_items.at(index)).segments()) {
+                    mask |= wordCharacterMask(segment);
+                }
+                masks[index] = mask;
+            }
+        });
+    }
+
     QStringList m_oldFilterText;
     QList<Item> m_filtered;
+    /// The wordCharacterMask() of the path of each item in m_filtered
+    QVector<quint64> m_filteredMasks;
     QList<Item> m_items;
+    /// The wordCharacterMask() of the path of each item in m_items
+    QVector<quint64> m_itemMasks;
 };
 
 }
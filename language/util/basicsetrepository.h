@@ -16,6 +16,8 @@
 
 #include <set>
 #include <vector>
+
+#include <QScopedPointer>
 #include <language/languageexport.h>
 #include <language/util/kdevhash.h>
 #include <serialization/itemrepository.h>
@@ -56,6 +58,8 @@ delayedDeletionByDefault = 0
 class SetNode;
 class BasicSetRepository;
 class SetNodeDataRequest;
+class SetOperationCache;
+struct SetRepositoryAlgorithms;
 
 ///Internal node representation, exported here for performance reason.
 struct KDEVPLATFORMLANGUAGE_EXPORT SetNodeData {
@@ -318,6 +322,10 @@ public:
 private:
   friend class Set;
   friend class Set::Iterator;
+  friend class SetNodeDataRequest;
+  friend struct SetRepositoryAlgorithms;
+  ///Results of recent set operations, declared first so it outlives the nodes it refers to
+  const QScopedPointer<SetOperationCache> m_operationCache;
   SetDataRepository dataRepository;
   QMutex* m_mutex;
   bool m_delayedDeletion;
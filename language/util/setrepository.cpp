@@ -85,6 +85,81 @@ uint splitPositionForRange(uint start, uint end) {
 
 class SetNodeDataRequest;
 
+/**
+ * Remembers the results of recent set operations by the nodes they were applied to, so operations
+ * that are repeated over and over, like merging the same imports again, are looked up instead.
+ *
+ * Node indices are reused once nodes are deleted, so all results are dropped whenever a node is deleted.
+ * Must only be used with the mutex of the repository locked.
+ */
+class SetOperationCache
+{
+public:
+  enum Operation : uint {
+    Union = 1,
+    Intersection,
+    Subtraction,
+    Count
+  };
+
+  SetOperationCache()
+  {
+    std::fill(m_entries, m_entries + size, Entry());
+  }
+
+  bool find(Operation operation, uint lhs, uint rhs, uint* result) const
+  {
+    const Entry& entry = m_entries[slot(operation, lhs, rhs)];
+    if(entry.generation != m_generation || entry.operation != operation || entry.lhs != lhs || entry.rhs != rhs)
+      return false;
+    *result = entry.result;
+    return true;
+  }
+
+  void insert(Operation operation, uint lhs, uint rhs, uint result)
+  {
+    Entry& entry = m_entries[slot(operation, lhs, rhs)];
+    entry.lhs = lhs;
+    entry.rhs = rhs;
+    entry.result = result;
+    entry.generation = m_generation;
+    entry.operation = operation;
+  }
+
+  void clear()
+  {
+    if(++m_generation == 0) {
+      //Entries of the previous round of generations would be valid again
+      std::fill(m_entries, m_entries + size, Entry());
+      m_generation = 1;
+    }
+  }
+
+private:
+  enum {
+    sizeBits = 12,
+    size = 1 << sizeBits
+  };
+
+  static uint slot(Operation operation, uint lhs, uint rhs)
+  {
+    //The upper bits of a product depend on all bits of the factors
+    return ((lhs ^ (rhs * 0x85ebca77u) ^ (operation << 29)) * 0x9e3779b1u) >> (32 - sizeBits);
+  }
+
+  struct Entry
+  {
+    uint lhs;
+    uint rhs;
+    uint result;
+    uint generation;
+    uint operation;
+  };
+
+  Entry m_entries[size];
+  uint m_generation = 1;
+};
+
     #define getLeftNode(node) repository.itemFromIndex(node->leftNode())
     #define getRightNode(node) repository.itemFromIndex(node->rightNode())
     #define nodeFromIndex(index) repository.itemFromIndex(index)
@@ -95,6 +170,13 @@ struct SetRepositoryAlgorithms {
   ///Expensive
   Index count(const SetNodeData* node) const;
 
+  ///Like count(), with the result remembered in the operation cache of the repository
+  Index cachedCount(uint node);
+
+  ///Applies set_union(), set_intersect() or set_subtract() to the given non-zero nodes,
+  ///with the result remembered in the operation cache of the repository
+  uint cachedOperation(SetOperationCache::Operation operation, uint firstNode, uint secondNode);
+
   void localCheck(const SetNodeData* node);
 
   void check(uint node);
@@ -150,6 +232,9 @@ private:
 void SetNodeDataRequest::destroy(SetNodeData* data, KDevelop::AbstractItemRepository& _repository) {
     SetDataRepository& repository(static_cast<SetDataRepository&>(_repository));
 
+    //The index of the node may be reused for another one
+    repository.setRepository->m_operationCache->clear();
+
     if(repository.setRepository->delayedDeletion()) {
 
         if(data->leftNode()){
@@ -226,7 +311,7 @@ unsigned int Set::count() const {
   QMutexLocker lock(m_repository->m_mutex);
 
   SetRepositoryAlgorithms alg(m_repository->dataRepository, m_repository);
-  return alg.count(m_repository->dataRepository.itemFromIndex(m_tree));
+  return alg.cachedCount(m_tree);
 }
 
 Set::Set(uint treeNode, BasicSetRepository* repository) : m_tree(treeNode), m_repository(repository) {
@@ -261,6 +346,47 @@ Index SetRepositoryAlgorithms::count(const SetNodeData* node) const {
     return node->end() - node->start();
 }
 
+Index SetRepositoryAlgorithms::cachedCount(uint node) {
+  SetOperationCache& cache(*setRepository->m_operationCache);
+  uint ret;
+  if(!cache.find(SetOperationCache::Count, node, 0, &ret)) {
+    ret = count(nodeFromIndex(node));
+    cache.insert(SetOperationCache::Count, node, 0, ret);
+  }
+  return ret;
+}
+
+uint SetRepositoryAlgorithms::cachedOperation(SetOperationCache::Operation operation, uint firstNode, uint secondNode) {
+  //The nodes of equal sets are equal, so the order of the operands does not matter for these
+  if(operation != SetOperationCache::Subtraction && firstNode > secondNode)
+    std::swap(firstNode, secondNode);
+
+  SetOperationCache& cache(*setRepository->m_operationCache);
+  uint ret;
+  if(cache.find(operation, firstNode, secondNode, &ret))
+    return ret;
+
+  const SetNodeData* first = nodeFromIndex(firstNode);
+  const SetNodeData* second = nodeFromIndex(secondNode);
+  switch(operation) {
+    case SetOperationCache::Union:
+      ret = set_union(firstNode, secondNode, first, second);
+      break;
+    case SetOperationCache::Intersection:
+      ret = set_intersect(firstNode, secondNode, first, second);
+      break;
+    case SetOperationCache::Subtraction:
+      ret = set_subtract(firstNode, secondNode, first, second);
+      break;
+    case SetOperationCache::Count:
+      Q_ASSERT(0);
+      return 0;
+  }
+
+  cache.insert(operation, firstNode, secondNode, ret);
+  return ret;
+}
+
 void SetRepositoryAlgorithms::localCheck(const SetNodeData* ifDebug(node) ) {
 //   Q_ASSERT(node->start() > 0);
   Q_ASSERT(node->start() < node->end());
@@ -340,6 +466,7 @@ public:
     : nodeStackData(rhs.nodeStackData)
     , nodeStackSize(rhs.nodeStackSize)
     , currentIndex(rhs.currentIndex)
+    , currentEnd(rhs.currentEnd)
     , repository(rhs.repository)
   {
     nodeStack = nodeStackData.data();
@@ -350,6 +477,7 @@ public:
     nodeStackData = rhs.nodeStackData;
     nodeStackSize = rhs.nodeStackSize;
     currentIndex = rhs.currentIndex;
+    currentEnd = rhs.currentEnd;
     repository = rhs.repository;
     nodeStack = nodeStackData.data();
 
@@ -365,6 +493,8 @@ public:
   const SetNodeData** nodeStack;
   int nodeStackSize = 0;
   Index currentIndex = 0;
+  ///The end of the node on top of the stack, so the iterator can move within it without the repository
+  Index currentEnd = 0;
   BasicSetRepository* repository = nullptr;
 
   /**
@@ -384,6 +514,7 @@ public:
         break; //We need no finer granularity, because the range is contiguous
       node = Set::Iterator::getDataRepository(repository).itemFromIndex(node->leftNode());
     } while(node);
+    currentEnd = nodeStack[nodeStackSize - 1]->end();
     Q_ASSERT(currentIndex >= nodeStack[0]->start());
   }
 };
@@ -428,13 +559,12 @@ Set::Iterator& Set::Iterator::operator++() {
 
   Q_ASSERT(d->nodeStackSize);
 
-  if(d->repository->m_mutex)
-    d->repository->m_mutex->lock();
-
   ++d->currentIndex;
 
-  //const SetNodeData** currentNode = &d->nodeStack[d->nodeStackSize - 1];
-  if(d->currentIndex >= d->nodeStack[d->nodeStackSize - 1]->end()) {
+  //Only moving on to the next node needs the repository
+  if(d->currentIndex >= d->currentEnd) {
+    QMutexLocker lock(d->repository->m_mutex);
+
     //Advance to the next node
     while(d->nodeStackSize && d->currentIndex >= d->nodeStack[d->nodeStackSize - 1]->end()) {
       --d->nodeStackSize;
@@ -453,10 +583,7 @@ Set::Iterator& Set::Iterator::operator++() {
     }
   }
 
-  Q_ASSERT(d->nodeStackSize == 0 || d->currentIndex < d->nodeStack[0]->end());
-
-  if(d->repository->m_mutex)
-    d->repository->m_mutex->unlock();
+  Q_ASSERT(d->nodeStackSize == 0 || d->currentIndex < d->currentEnd);
 
   return *this;
 }
@@ -895,7 +1022,8 @@ Set BasicSetRepository::createSet(const std::set<Index>& indices) {
 }
 
 BasicSetRepository::BasicSetRepository(const QString& name, KDevelop::ItemRepositoryRegistry* registry, bool delayedDeletion)
-    : dataRepository(this, name, registry)
+    : m_operationCache(new SetOperationCache)
+    , dataRepository(this, name, registry)
     , m_mutex(nullptr)
     , m_delayedDeletion(delayedDeletion)
 {
@@ -962,7 +1090,7 @@ Set Set::operator +(const Set& first) const
 
   SetRepositoryAlgorithms alg(m_repository->dataRepository, m_repository);
 
-  uint retNode = alg.set_union(m_tree, first.m_tree, m_repository->dataRepository.itemFromIndex(m_tree), m_repository->dataRepository.itemFromIndex(first.m_tree));
+  uint retNode = alg.cachedOperation(SetOperationCache::Union, m_tree, first.m_tree);
 
   ifDebug(alg.check(retNode));
 
@@ -982,7 +1110,7 @@ Set& Set::operator +=(const Set& first) {
 
   SetRepositoryAlgorithms alg(m_repository->dataRepository, m_repository);
 
-  m_tree = alg.set_union(m_tree, first.m_tree, m_repository->dataRepository.itemFromIndex(m_tree), m_repository->dataRepository.itemFromIndex(first.m_tree));
+  m_tree = alg.cachedOperation(SetOperationCache::Union, m_tree, first.m_tree);
 
   ifDebug(alg.check(m_tree));
   return *this;
@@ -998,7 +1126,7 @@ Set Set::operator &(const Set& first) const {
 
   SetRepositoryAlgorithms alg(m_repository->dataRepository, m_repository);
 
-  Set ret( alg.set_intersect(m_tree, first.m_tree, m_repository->dataRepository.itemFromIndex(m_tree), m_repository->dataRepository.itemFromIndex(first.m_tree)), m_repository );
+  Set ret( alg.cachedOperation(SetOperationCache::Intersection, m_tree, first.m_tree), m_repository );
 
   ifDebug(alg.check(ret.m_tree));
 
@@ -1017,7 +1145,7 @@ Set& Set::operator &=(const Set& first) {
 
   SetRepositoryAlgorithms alg(m_repository->dataRepository, m_repository);
 
-  m_tree = alg.set_intersect(m_tree, first.m_tree, m_repository->dataRepository.itemFromIndex(m_tree), m_repository->dataRepository.itemFromIndex(first.m_tree));
+  m_tree = alg.cachedOperation(SetOperationCache::Intersection, m_tree, first.m_tree);
   ifDebug(alg.check(m_tree));
   return *this;
 }
@@ -1032,7 +1160,7 @@ Set Set::operator -(const Set& rhs) const {
 
   SetRepositoryAlgorithms alg(m_repository->dataRepository, m_repository);
 
-  Set ret( alg.set_subtract(m_tree, rhs.m_tree, m_repository->dataRepository.itemFromIndex(m_tree), m_repository->dataRepository.itemFromIndex(rhs.m_tree)), m_repository );
+  Set ret( alg.cachedOperation(SetOperationCache::Subtraction, m_tree, rhs.m_tree), m_repository );
   ifDebug( alg.check(ret.m_tree) );
   return ret;
 }
@@ -1047,7 +1175,7 @@ Set& Set::operator -=(const Set& rhs) {
 
   SetRepositoryAlgorithms alg(m_repository->dataRepository, m_repository);
 
-  m_tree = alg.set_subtract(m_tree, rhs.m_tree, m_repository->dataRepository.itemFromIndex(m_tree), m_repository->dataRepository.itemFromIndex(rhs.m_tree));
+  m_tree = alg.cachedOperation(SetOperationCache::Subtraction, m_tree, rhs.m_tree);
 
   ifDebug(alg.check(m_tree));
   return *this;
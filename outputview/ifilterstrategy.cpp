@@ -38,4 +38,8 @@ IFilterStrategy::Progress IFilterStrategy::progressInLine(const QString& line)
     return {};
 }
 
+ICloneableFilterStrategy::~ICloneableFilterStrategy()
+{
+}
+
 }
@@ -81,6 +81,25 @@ public:
 
 };
 
+/**
+* Optional interface for filter strategies whose results for a line do not depend on the lines examined before.
+*
+* OutputModel examines batches of lines of strategies that also implement this interface on several threads
+* at once, while all other strategies see every line in order on a single thread.
+*/
+class KDEVPLATFORMOUTPUTVIEW_EXPORT ICloneableFilterStrategy
+{
+public:
+    virtual ~ICloneableFilterStrategy();
+
+    /**
+     * Create a strategy that examines lines exactly like this one does, for use on another thread
+     *
+     * @return A new strategy owned by the caller
+     */
+    virtual IFilterStrategy* clone() const = 0;
+};
+
 } // namespace KDevelop
 
 Q_DECLARE_METATYPE(KDevelop::IFilterStrategy*)
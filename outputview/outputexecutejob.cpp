@@ -69,6 +69,8 @@ public:
     QString m_jobName;
     bool m_outputStarted;
     bool m_executeOnHost = false;
+    // long running jobs easily produce millions of lines, which we do not want to keep in memory
+    int m_maxMemoryLines = 100000;
 };
 
 OutputExecuteJobPrivate::OutputExecuteJobPrivate( OutputExecuteJob* owner ) :
@@ -235,6 +237,7 @@ void OutputExecuteJob::start()
     } else {
         model()->setFilteringStrategy(d->m_filteringStrategy);
     }
+    model()->setMaxMemoryLines(d->m_maxMemoryLines);
 
     setDelegate( new OutputDelegate );
 
@@ -432,6 +435,14 @@ void OutputExecuteJob::setFilteringStrategy(IFilterStrategy* filterStrategy)
     d->m_filteringStrategy = OutputModel::NoFilter;
 }
 
+void OutputExecuteJob::setMaxMemoryLines(int lines)
+{
+    d->m_maxMemoryLines = lines;
+    if (model()) {
+        model()->setMaxMemoryLines(lines);
+    }
+}
+
 OutputExecuteJob::JobProperties OutputExecuteJob::properties() const
 {
     return d->m_properties;
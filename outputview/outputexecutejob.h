@@ -159,6 +159,15 @@ public:
      */
     void setFilteringStrategy(IFilterStrategy* filterStrategy);
 
+    /**
+     * Set how many lines of output the output model keeps in memory, older lines are moved to a temporary file.
+     * Defaults to 100000 lines.
+     *
+     * @param lines the maximum number of lines in memory; 0 to keep all lines in memory.
+     * @see OutputModel::setMaxMemoryLines()
+     */
+    void setMaxMemoryLines(int lines);
+
     /**
      * Get the current properties of the job.
      *
@@ -23,12 +23,165 @@
 
 #include <KLocalizedString>
 
+#include <QDir>
 #include <QFileInfo>
+#include <QSet>
 
 #include <algorithm>
+#include <initializer_list>
 
 namespace KDevelop
 {
+
+namespace {
+
+/**
+ * Finds all occurrences of a fixed set of literals in a line in a single pass, using an Aho-Corasick automaton.
+ *
+ * Only ASCII literals are supported, other characters never continue a match.
+ */
+class LiteralScanner
+{
+public:
+    /// @p literals contains each literal together with the bits scan() sets if it occurs
+    explicit LiteralScanner(const QVector<QPair<QString, quint64>>& literals)
+    {
+        m_states.append(State());
+
+        // Build the trie
+        for (const auto& literal : literals) {
+            int state = 0;
+            for (const QChar c : literal.first) {
+                Q_ASSERT(c.unicode() < AlphabetSize);
+                int next = m_states[state].next[c.unicode()];
+                if (!next) {
+                    next = m_states.size();
+                    m_states.append(State());
+                    m_states[state].next[c.unicode()] = next;
+                }
+                state = next;
+            }
+            m_states[state].output |= literal.second;
+        }
+
+        // Turn it into a deterministic automaton: missing transitions follow the longest suffix that is in the trie
+        QVector<int> fail(m_states.size(), 0);
+        QVector<int> queue;
+        for (int c = 0; c < AlphabetSize; ++c) {
+            if (const int next = m_states[0].next[c]) {
+                queue.append(next);
+            }
+        }
+        for (int i = 0; i < queue.size(); ++i) {
+            const int state = queue[i];
+            m_states[state].output |= m_states[fail[state]].output;
+            for (int c = 0; c < AlphabetSize; ++c) {
+                const int next = m_states[state].next[c];
+                if (next) {
+                    fail[next] = m_states[fail[state]].next[c];
+                    queue.append(next);
+                } else {
+                    m_states[state].next[c] = m_states[fail[state]].next[c];
+                }
+            }
+        }
+    }
+
+    /// Returns the bits of all literals that occur in @p line
+    quint64 scan(const QString& line) const
+    {
+        quint64 found = 0;
+        int state = 0;
+        for (const QChar c : line) {
+            state = c.unicode() < AlphabetSize ? m_states[state].next[c.unicode()] : 0;
+            found |= m_states[state].output;
+        }
+        return found;
+    }
+
+private:
+    enum {
+        AlphabetSize = 128
+    };
+
+    struct State
+    {
+        ushort next[AlphabetSize] = {};
+        quint64 output = 0;
+    };
+
+    QVector<State> m_states;
+};
+
+/**
+ * A list of formats that are tried in order, like a plain array of formats.
+ *
+ * Each format comes with literals of which at least one has to occur in a line for its expression to match.
+ * The literals of all formats are searched at once, and the expressions of formats whose literals are missing
+ * are not run at all. Most build output lines are therefore only matched against few of the expressions.
+ */
+template<typename Format>
+class PrefilteredFormats
+{
+public:
+    struct Entry
+    {
+        Format format;
+        /// Formats without literals are always tried
+        QStringList literals;
+    };
+
+    PrefilteredFormats(std::initializer_list<Entry> entries)
+        : m_scanner(literals(entries))
+    {
+        Q_ASSERT(entries.size() <= 64);
+        for (const Entry& entry : entries) {
+            if (entry.literals.isEmpty()) {
+                m_alwaysTried |= quint64(1) << m_formats.size();
+            }
+            m_formats.append(entry.format);
+        }
+    }
+
+    /// Returns the first format whose expression matches @p line and stores its match in @p match, or nullptr
+    const Format* match(const QString& line, QRegularExpressionMatch& match) const
+    {
+        const quint64 candidates = m_scanner.scan(line) | m_alwaysTried;
+        for (int i = 0; i < m_formats.size() && (candidates >> i); ++i) {
+            if (!(candidates & (quint64(1) << i))) {
+                continue;
+            }
+
+            const Format& format = m_formats[i];
+            match = format.expression.match(line);
+            if (match.hasMatch()) {
+                return &format;
+            }
+        }
+        return nullptr;
+    }
+
+private:
+    static QVector<QPair<QString, quint64>> literals(std::initializer_list<Entry> entries)
+    {
+        QVector<QPair<QString, quint64>> ret;
+        quint64 bit = 1;
+        for (const Entry& entry : entries) {
+            for (const QString& literal : entry.literals) {
+                ret.append(qMakePair(literal, bit));
+            }
+            bit <<= 1;
+        }
+        return ret;
+    }
+
+    QVector<Format> m_formats;
+    quint64 m_alwaysTried = 0;
+    LiteralScanner m_scanner;
+};
+
+}
+
 void initializeFilteredItem(FilteredItem& item, const ErrorFormat& filter, const QRegularExpressionMatch& match)
 {
     item.lineNo = match.captured( filter.lineGroup ).toInt() - 1;
@@ -69,6 +222,11 @@ FilteredItem NoFilterStrategy::actionInLine(const QString& line)
     return FilteredItem( line );
 }
 
+IFilterStrategy* NoFilterStrategy::clone() const
+{
+    return new NoFilterStrategy;
+}
+
 FilteredItem NoFilterStrategy::errorInLine(const QString& line)
 {
     return FilteredItem( line );
@@ -82,6 +240,7 @@ class CompilerFilterStrategyPrivate
 public:
     explicit CompilerFilterStrategyPrivate(const QUrl& buildDir);
     Path pathForFile( const QString& ) const;
+    bool fileExists(const Path& path) const;
     bool isMultiLineCase(const ErrorFormat& curErrFilter) const;
     void putDirAtEnd(const Path& pathToInsert);
 
@@ -90,6 +249,10 @@ public:
 
     using PositionMap = QHash<Path, int>;
     PositionMap m_positionInCurrentDirs;
+
+    // The candidates tried by pathForFile that were found to exist.
+    // Missing files are not remembered, they may still be generated during the build.
+    mutable QSet<Path> m_existingFiles;
 };
 
 CompilerFilterStrategyPrivate::CompilerFilterStrategyPrivate(const QUrl& buildDir)
@@ -99,9 +262,8 @@ CompilerFilterStrategyPrivate::CompilerFilterStrategyPrivate(const QUrl& buildDi
 
 Path CompilerFilterStrategyPrivate::pathForFile(const QString& filename) const
 {
-    QFileInfo fi( filename );
     Path currentPath;
-    if( fi.isRelative() ) {
+    if( QDir::isRelativePath( filename ) ) {
         if( m_currentDirs.isEmpty() ) {
             return Path(m_buildDir, filename );
         }
@@ -109,7 +271,7 @@ Path CompilerFilterStrategyPrivate::pathForFile(const QString& filename) const
         auto it = m_currentDirs.constEnd() - 1;
         do {
             currentPath = Path(*it, filename);
-        } while( (it-- !=  m_currentDirs.constBegin()) && !QFileInfo::exists(currentPath.toLocalFile()) );
+        } while( (it-- !=  m_currentDirs.constBegin()) && !fileExists(currentPath) );
 
         return currentPath;
     } else {
@@ -118,6 +280,18 @@ Path CompilerFilterStrategyPrivate::pathForFile(const QString& filename) const
     return currentPath;
 }
 
+bool CompilerFilterStrategyPrivate::fileExists(const Path& path) const
+{
+    if (m_existingFiles.contains(path)) {
+        return true;
+    }
+    if (!QFileInfo::exists(path.toLocalFile())) {
+        return false;
+    }
+    m_existingFiles.insert(path);
+    return true;
+}
+
 bool CompilerFilterStrategyPrivate::isMultiLineCase(const KDevelop::ErrorFormat& curErrFilter) const
 {
     if(curErrFilter.compiler == QLatin1String("gfortran") || curErrFilter.compiler == QLatin1String("cmake")) {
@@ -160,69 +334,75 @@ QVector<QString> CompilerFilterStrategy::getCurrentDirs()
 
 FilteredItem CompilerFilterStrategy::actionInLine(const QString& line)
 {
-    // A list of filters for possible compiler, linker, and make actions
-    static const ActionFormat ACTION_FILTERS[] = {
-        ActionFormat( 2,
+    // A list of filters for possible compiler, linker, and make actions,
+    // each with the literals of which one must occur in a line it matches
+    static const PrefilteredFormats<ActionFormat> ACTION_FILTERS = {
+        { ActionFormat( 2,
                       QStringLiteral("(?:^|[^=])\\b(gcc|CC|cc|distcc|c\\+\\+|g\\+\\+|clang(?:\\+\\+)|mpicc|icc|icpc)\\s+.*-c.*[/ '\\\\]+(\\w+\\.(?:cpp|CPP|c|C|cxx|CXX|cs|java|hpf|f|F|f90|F90|f95|F95))")),
+          { QStringLiteral("-c") } },
         //moc and uic
-        ActionFormat( 2, QStringLiteral("/(moc|uic)\\b.*\\s-o\\s([^\\s;]+)")),
+        { ActionFormat( 2, QStringLiteral("/(moc|uic)\\b.*\\s-o\\s([^\\s;]+)")), { QStringLiteral("-o") } },
         //libtool linking
-        ActionFormat( QStringLiteral("libtool"), QStringLiteral("/bin/sh\\s.*libtool.*--mode=link\\s.*\\s-o\\s([^\\s;]+)"), 1 ),
+        { ActionFormat( QStringLiteral("libtool"), QStringLiteral("/bin/sh\\s.*libtool.*--mode=link\\s.*\\s-o\\s([^\\s;]+)"), 1 ),
+          { QStringLiteral("--mode=link") } },
         //unsermake
-        ActionFormat( 1, QStringLiteral("^compiling (.*)") ),
-        ActionFormat( 2, QStringLiteral("^generating (.*)") ),
-        ActionFormat( 2, QStringLiteral("(gcc|cc|c\\+\\+|g\\+\\+|clang(?:\\+\\+)|mpicc|icc|icpc)\\S* (?:\\S* )*-o ([^\\s;]+)")),
-        ActionFormat( 2, QStringLiteral("^linking (.*)") ),
+        { ActionFormat( 1, QStringLiteral("^compiling (.*)") ), { QStringLiteral("compiling ") } },
+        { ActionFormat( 2, QStringLiteral("^generating (.*)") ), { QStringLiteral("generating ") } },
+        { ActionFormat( 2, QStringLiteral("(gcc|cc|c\\+\\+|g\\+\\+|clang(?:\\+\\+)|mpicc|icc|icpc)\\S* (?:\\S* )*-o ([^\\s;]+)")),
+          { QStringLiteral("-o ") } },
+        { ActionFormat( 2, QStringLiteral("^linking (.*)") ), { QStringLiteral("linking ") } },
         //cmake
-        ActionFormat( 1, QStringLiteral("\\[.+%\\] Built target (.*)") ),
-        ActionFormat( QStringLiteral("cmake"),
-                      QStringLiteral("\\[.+%\\] Building .* object (.*)"), 1 ),
-        ActionFormat( 1, QStringLiteral("\\[.+%\\] Generating (.*)") ),
-        ActionFormat( 1, QStringLiteral("^Linking (.*)") ),
-        ActionFormat( QStringLiteral("cmake"),
+        { ActionFormat( 1, QStringLiteral("\\[.+%\\] Built target (.*)") ), { QStringLiteral("] Built target ") } },
+        { ActionFormat( QStringLiteral("cmake"),
+                      QStringLiteral("\\[.+%\\] Building .* object (.*)"), 1 ), { QStringLiteral("] Building ") } },
+        { ActionFormat( 1, QStringLiteral("\\[.+%\\] Generating (.*)") ), { QStringLiteral("] Generating ") } },
+        { ActionFormat( 1, QStringLiteral("^Linking (.*)") ), { QStringLiteral("Linking ") } },
+        { ActionFormat( QStringLiteral("cmake"),
                       QStringLiteral("(-- Configuring (done|incomplete)|-- Found|-- Adding|-- Enabling)"), -1 ),
-        ActionFormat( 1, QStringLiteral("-- Installing (.*)") ),
+          { QStringLiteral("-- ") } },
+        { ActionFormat( 1, QStringLiteral("-- Installing (.*)") ), { QStringLiteral("-- Installing ") } },
         //libtool install
-        ActionFormat( {},
+        { ActionFormat( {},
                       QStringLiteral("/(?:bin/sh\\s.*mkinstalldirs).*\\s([^\\s;]+)"), 1 ),
-        ActionFormat( {},
+          { QStringLiteral("mkinstalldirs") } },
+        { ActionFormat( {},
                       QStringLiteral("/(?:usr/bin/install|bin/sh\\s.*mkinstalldirs|bin/sh\\s.*libtool.*--mode=install).*\\s([^\\s;]+)"), 1 ),
+          { QStringLiteral("usr/bin/install"), QStringLiteral("mkinstalldirs"), QStringLiteral("--mode=install") } },
         //dcop
-        ActionFormat( QStringLiteral("dcopidl"),
-                      QStringLiteral("dcopidl .* > ([^\\s;]+)"), 1 ),
-        ActionFormat( QStringLiteral("dcopidl2cpp"),
-                      QStringLiteral("dcopidl2cpp (?:\\S* )*([^\\s;]+)"), 1 ),
+        { ActionFormat( QStringLiteral("dcopidl"),
+                      QStringLiteral("dcopidl .* > ([^\\s;]+)"), 1 ), { QStringLiteral("dcopidl ") } },
+        { ActionFormat( QStringLiteral("dcopidl2cpp"),
+                      QStringLiteral("dcopidl2cpp (?:\\S* )*([^\\s;]+)"), 1 ), { QStringLiteral("dcopidl2cpp ") } },
         // match against Entering directory to update current build dir
-        ActionFormat( QStringLiteral("cd"),
+        { ActionFormat( QStringLiteral("cd"),
                       QStringLiteral("make\\[\\d+\\]: Entering directory (\\`|\\')(.+)'"), 2),
+          { QStringLiteral(": Entering directory ") } },
         // waf and scons use the same basic convention as make
-        ActionFormat( QStringLiteral("cd"),
-                      QStringLiteral("(Waf|scons): Entering directory (\\`|\\')(.+)'"), 3)
+        { ActionFormat( QStringLiteral("cd"),
+                      QStringLiteral("(Waf|scons): Entering directory (\\`|\\')(.+)'"), 3),
+          { QStringLiteral(": Entering directory ") } }
     };
 
     FilteredItem item(line);
-    for (const auto& curActFilter : ACTION_FILTERS) {
-        const auto match = curActFilter.expression.match(line);
-        if( match.hasMatch() ) {
-            item.type = FilteredItem::ActionItem;
-
-            if( curActFilter.tool == QLatin1String("cd") ) {
-                const Path path(match.captured(curActFilter.fileGroup));
-                d->m_currentDirs.push_back( path );
-                d->m_positionInCurrentDirs.insert( path , d->m_currentDirs.size() - 1 );
-            }
+    QRegularExpressionMatch match;
+    if (const ActionFormat* curActFilter = ACTION_FILTERS.match(line, match)) {
+        item.type = FilteredItem::ActionItem;
+
+        if( curActFilter->tool == QLatin1String("cd") ) {
+            const Path path(match.captured(curActFilter->fileGroup));
+            d->m_currentDirs.push_back( path );
+            d->m_positionInCurrentDirs.insert( path , d->m_currentDirs.size() - 1 );
+        }
 
-            // Special case for cmake: we parse the "Compiling <objectfile>" expression
-            // and use it to find out about the build paths encountered during a build.
-            // They are later searched by pathForFile to find source files corresponding to
-            // compiler errors.
-            // Note: CMake objectfile has the format: "/path/to/four/CMakeFiles/file.o"
-            if ( curActFilter.fileGroup != -1 && curActFilter.tool == QLatin1String("cmake") && line.contains(QStringLiteral("Building"))) {
-                const auto objectFile = match.captured(curActFilter.fileGroup);
-                const auto dir = objectFile.section(QStringLiteral("CMakeFiles/"), 0, 0);
-                d->putDirAtEnd(Path(d->m_buildDir, dir));
-            }
-            break;
+        // Special case for cmake: we parse the "Compiling <objectfile>" expression
+        // and use it to find out about the build paths encountered during a build.
+        // They are later searched by pathForFile to find source files corresponding to
+        // compiler errors.
+        // Note: CMake objectfile has the format: "/path/to/four/CMakeFiles/file.o"
+        if ( curActFilter->fileGroup != -1 && curActFilter->tool == QLatin1String("cmake") && line.contains(QStringLiteral("Building"))) {
+            const auto objectFile = match.captured(curActFilter->fileGroup);
+            const auto dir = objectFile.section(QStringLiteral("CMakeFiles/"), 0, 0);
+            d->putDirAtEnd(Path(d->m_buildDir, dir));
         }
     }
     return item;
@@ -249,98 +429,103 @@ FilteredItem CompilerFilterStrategy::errorInLine(const QString& line)
         Indicator(QStringLiteral("note"), FilteredItem::InformationItem),
     };
 
-    // A list of filters for possible compiler, linker, and make errors
-    static const ErrorFormat ERROR_FILTERS[] = {
+    // A list of filters for possible compiler, linker, and make errors,
+    // each with the literals of which one must occur in a line it matches
+    static const PrefilteredFormats<ErrorFormat> ERROR_FILTERS = {
 #ifdef Q_OS_WIN
         // MSVC
-        ErrorFormat( QStringLiteral("^([a-zA-Z]:\\\\.+)\\(([1-9][0-9]*)\\): ((?:error|warning) .+\\:).*$"), 1, 2, 3 ),
+        { ErrorFormat( QStringLiteral("^([a-zA-Z]:\\\\.+)\\(([1-9][0-9]*)\\): ((?:error|warning) .+\\:).*$"), 1, 2, 3 ), { QStringLiteral("): ") } },
 #endif
         // GCC - another case, eg. for #include "pixmap.xpm" which does not exists
-        ErrorFormat( QStringLiteral("^([^:\\t]+):([0-9]+):([0-9]+):([^0-9]+)"), 1, 2, 4, 3 ),
+        { ErrorFormat( QStringLiteral("^([^:\\t]+):([0-9]+):([0-9]+):([^0-9]+)"), 1, 2, 4, 3 ), { QStringLiteral(":") } },
         // ant
-        ErrorFormat( QStringLiteral("\\[javac\\][\\s]+([^:\\t]+):([0-9]+): (warning: .*|error: .*)"), 1, 2, 3, QStringLiteral("javac")),
+        { ErrorFormat( QStringLiteral("\\[javac\\][\\s]+([^:\\t]+):([0-9]+): (warning: .*|error: .*)"), 1, 2, 3, QStringLiteral("javac")),
+          { QStringLiteral("[javac]") } },
         // GCC
-        ErrorFormat( QStringLiteral("^([^:\\t]+):([0-9]+):([^0-9]+)"), 1, 2, 3 ),
+        { ErrorFormat( QStringLiteral("^([^:\\t]+):([0-9]+):([^0-9]+)"), 1, 2, 3 ), { QStringLiteral(":") } },
         // GCC
-        ErrorFormat( QStringLiteral("^(In file included from |[ ]+from )([^:\\t]+):([0-9]+)(:|,)(|[0-9]+)"), 2, 3, 5 ),
+        { ErrorFormat( QStringLiteral("^(In file included from |[ ]+from )([^:\\t]+):([0-9]+)(:|,)(|[0-9]+)"), 2, 3, 5 ), { QStringLiteral("from ") } },
         // ICC
-        ErrorFormat( QStringLiteral("^([^:\\t]+)\\(([0-9]+)\\):([^0-9]+)"), 1, 2, 3, QStringLiteral("intel") ),
+        { ErrorFormat( QStringLiteral("^([^:\\t]+)\\(([0-9]+)\\):([^0-9]+)"), 1, 2, 3, QStringLiteral("intel") ), { QStringLiteral("):") } },
         //libtool link
-        ErrorFormat( QStringLiteral("^(libtool):( link):( warning): "), 0, 0, 0 ),
+        { ErrorFormat( QStringLiteral("^(libtool):( link):( warning): "), 0, 0, 0 ), { QStringLiteral("libtool: link: warning: ") } },
         // make
-        ErrorFormat( QStringLiteral("No rule to make target"), 0, 0, 0 ),
+        { ErrorFormat( QStringLiteral("No rule to make target"), 0, 0, 0 ), { QStringLiteral("No rule to make target") } },
         // cmake
-        ErrorFormat( QStringLiteral("^([^:\\t]+):([0-9]+):"), 1, 2, 0, QStringLiteral("cmake") ),
+        { ErrorFormat( QStringLiteral("^([^:\\t]+):([0-9]+):"), 1, 2, 0, QStringLiteral("cmake") ), { QStringLiteral(":") } },
         // cmake
-        ErrorFormat( QStringLiteral("CMake (Error|Warning) (|\\([a-zA-Z]+\\) )(in|at) ([^:]+):($|[0-9]+)"), 4, 5, 1, QStringLiteral("cmake") ),
+        { ErrorFormat( QStringLiteral("CMake (Error|Warning) (|\\([a-zA-Z]+\\) )(in|at) ([^:]+):($|[0-9]+)"), 4, 5, 1, QStringLiteral("cmake") ),
+          { QStringLiteral("CMake ") } },
         // cmake/automoc
         // example: AUTOMOC: error: /foo/bar.cpp The file includes (...),
         // example: AUTOMOC: error: /foo/bar.cpp: The file includes (...)
         // note: ':' after file name isn't always appended, see http://cmake.org/gitweb?p=cmake.git;a=commitdiff;h=317d8498aa02c9f486bf5071963bb2034777cdd6
         // example: AUTOGEN: error: /foo/bar.cpp: The file includes (...)
         // note: AUTOMOC got renamed to AUTOGEN at some point
-        ErrorFormat( QStringLiteral("^(AUTOMOC|AUTOGEN): error: ([^:]+):? (The file .*)$"), 2, 0, 0 ),
+        { ErrorFormat( QStringLiteral("^(AUTOMOC|AUTOGEN): error: ([^:]+):? (The file .*)$"), 2, 0, 0 ), { QStringLiteral(": error: ") } },
         // via qt4_automoc
         // example: automoc4: The file "/foo/bar.cpp" includes the moc file "bar1.moc", but ...
-        ErrorFormat( QStringLiteral("^automoc4: The file \"([^\"]+)\" includes the moc file"), 1, 0, 0 ),
+        { ErrorFormat( QStringLiteral("^automoc4: The file \"([^\"]+)\" includes the moc file"), 1, 0, 0 ), { QStringLiteral("automoc4: ") } },
         // Fortran
-        ErrorFormat( QStringLiteral("\"(.*)\", line ([0-9]+):(.*)"), 1, 2, 3 ),
+        { ErrorFormat( QStringLiteral("\"(.*)\", line ([0-9]+):(.*)"), 1, 2, 3 ), { QStringLiteral("\", line ") } },
         // GFortran
-        ErrorFormat( QStringLiteral("^(.*):([0-9]+)\\.([0-9]+):(.*)"), 1, 2, 4, QStringLiteral("gfortran"), 3 ),
+        { ErrorFormat( QStringLiteral("^(.*):([0-9]+)\\.([0-9]+):(.*)"), 1, 2, 4, QStringLiteral("gfortran"), 3 ), { QStringLiteral(":") } },
         // Jade
-        ErrorFormat( QStringLiteral("^[a-zA-Z]+:([^:\\t]+):([0-9]+):[0-9]+:[a-zA-Z]:(.*)"), 1, 2, 3 ),
+        { ErrorFormat( QStringLiteral("^[a-zA-Z]+:([^:\\t]+):([0-9]+):[0-9]+:[a-zA-Z]:(.*)"), 1, 2, 3 ), { QStringLiteral(":") } },
         // ifort
-        ErrorFormat( QStringLiteral("^fortcom: (.*): (.*), line ([0-9]+):(.*)"), 2, 3, 1, QStringLiteral("intel") ),
+        { ErrorFormat( QStringLiteral("^fortcom: (.*): (.*), line ([0-9]+):(.*)"), 2, 3, 1, QStringLiteral("intel") ), { QStringLiteral("fortcom: ") } },
         // PGI
-        ErrorFormat( QStringLiteral("PGF9(.*)-(.*)-(.*)-(.*) \\((.*): ([0-9]+)\\)"), 5, 6, 4, QStringLiteral("pgi") ),
+        { ErrorFormat( QStringLiteral("PGF9(.*)-(.*)-(.*)-(.*) \\((.*): ([0-9]+)\\)"), 5, 6, 4, QStringLiteral("pgi") ), { QStringLiteral("PGF9") } },
         // PGI (2)
-        ErrorFormat( QStringLiteral("PGF9(.*)-(.*)-(.*)-Symbol, (.*) \\((.*)\\)"), 5, 5, 4, QStringLiteral("pgi") ),
+        { ErrorFormat( QStringLiteral("PGF9(.*)-(.*)-(.*)-Symbol, (.*) \\((.*)\\)"), 5, 5, 4, QStringLiteral("pgi") ), { QStringLiteral("PGF9") } },
     };
 
     FilteredItem item(line);
-    for (const auto& curErrFilter : ERROR_FILTERS) {
-        const auto match = curErrFilter.expression.match(line);
-        if( match.hasMatch() && !( line.contains( QLatin1String("Each undeclared identifier is reported only once") )
-                               || line.contains( QLatin1String("for each function it appears in.") ) ) )
-        {
-            if(curErrFilter.fileGroup > 0) {
-                if( curErrFilter.compiler == QLatin1String("cmake") ) { // Unfortunately we cannot know if an error or an action comes first in cmake, and therefore we need to do this
-                    if( d->m_currentDirs.empty() ) {
-                        d->putDirAtEnd( d->m_buildDir.parent() );
-                    }
+    // These gcc notes repeat an error without a position of their own
+    if (line.contains(QLatin1String("Each undeclared identifier is reported only once"))
+        || line.contains(QLatin1String("for each function it appears in."))) {
+        return item;
+    }
+
+    QRegularExpressionMatch match;
+    if (const ErrorFormat* format = ERROR_FILTERS.match(line, match)) {
+        const ErrorFormat& curErrFilter = *format;
+        if(curErrFilter.fileGroup > 0) {
+            if( curErrFilter.compiler == QLatin1String("cmake") ) { // Unfortunately we cannot know if an error or an action comes first in cmake, and therefore we need to do this
+                if( d->m_currentDirs.empty() ) {
+                    d->putDirAtEnd( d->m_buildDir.parent() );
                 }
-                item.url = d->pathForFile( match.captured( curErrFilter.fileGroup ) ).toUrl();
             }
-            initializeFilteredItem(item, curErrFilter, match);
+            item.url = d->pathForFile( match.captured( curErrFilter.fileGroup ) ).toUrl();
+        }
+        initializeFilteredItem(item, curErrFilter, match);
 
-            const QString txt = match.captured(curErrFilter.textGroup);
+        const QString txt = match.captured(curErrFilter.textGroup);
 
-            // Find the indicator which happens most early.
-            int earliestIndicatorIdx = txt.length();
-            for (const auto& curIndicator : INDICATORS) {
-                int curIndicatorIdx = txt.indexOf(curIndicator.first, 0, Qt::CaseInsensitive);
-                if((curIndicatorIdx >= 0) && (earliestIndicatorIdx > curIndicatorIdx)) {
-                    earliestIndicatorIdx = curIndicatorIdx;
-                    item.type = curIndicator.second;
-                }
+        // Find the indicator which happens most early.
+        int earliestIndicatorIdx = txt.length();
+        for (const auto& curIndicator : INDICATORS) {
+            int curIndicatorIdx = txt.indexOf(curIndicator.first, 0, Qt::CaseInsensitive);
+            if((curIndicatorIdx >= 0) && (earliestIndicatorIdx > curIndicatorIdx)) {
+                earliestIndicatorIdx = curIndicatorIdx;
+                item.type = curIndicator.second;
             }
+        }
 
-            // Make the item clickable if it comes with the necessary file information
-            if (item.url.isValid()) {
-                item.isActivatable = true;
-                if(item.type == FilteredItem::InvalidItem) {
-                    // If there are no error indicators in the line
-                    // maybe this is a multiline case
-                    if(d->isMultiLineCase(curErrFilter)) {
-                        item.type = FilteredItem::ErrorItem;
-                    } else {
-                        // Okay so we couldn't find anything to indicate an error, but we have file and lineGroup
-                        // Lets keep this item clickable and indicate this to the user.
-                        item.type = FilteredItem::InformationItem;
-                    }
+        // Make the item clickable if it comes with the necessary file information
+        if (item.url.isValid()) {
+            item.isActivatable = true;
+            if(item.type == FilteredItem::InvalidItem) {
+                // If there are no error indicators in the line
+                // maybe this is a multiline case
+                if(d->isMultiLineCase(curErrFilter)) {
+                    item.type = FilteredItem::ErrorItem;
+                } else {
+                    // Okay so we couldn't find anything to indicate an error, but we have file and lineGroup
+                    // Lets keep this item clickable and indicate this to the user.
+                    item.type = FilteredItem::InformationItem;
                 }
             }
-            break;
         }
     }
     return item;
@@ -358,6 +543,11 @@ FilteredItem ScriptErrorFilterStrategy::actionInLine(const QString& line)
     return FilteredItem(line);
 }
 
+IFilterStrategy* ScriptErrorFilterStrategy::clone() const
+{
+    return new ScriptErrorFilterStrategy;
+}
+
 FilteredItem ScriptErrorFilterStrategy::errorInLine(const QString& line)
 {
     // A list of filters for possible Python and PHP errors
@@ -381,6 +571,11 @@ FilteredItem NativeAppErrorFilterStrategy::actionInLine(const QString& line)
     return FilteredItem(line);
 }
 
+IFilterStrategy* NativeAppErrorFilterStrategy::clone() const
+{
+    return new NativeAppErrorFilterStrategy;
+}
+
 FilteredItem NativeAppErrorFilterStrategy::errorInLine(const QString& line)
 {
     static const ErrorFormat NATIVE_APPLICATION_ERROR_FILTERS[] = {
@@ -437,6 +632,11 @@ FilteredItem StaticAnalysisFilterStrategy::actionInLine(const QString& line)
     return FilteredItem(line);
 }
 
+IFilterStrategy* StaticAnalysisFilterStrategy::clone() const
+{
+    return new StaticAnalysisFilterStrategy;
+}
+
 FilteredItem StaticAnalysisFilterStrategy::errorInLine(const QString& line)
 {
     // A list of filters for static analysis tools (krazy2, cppcheck)
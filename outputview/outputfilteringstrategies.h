@@ -41,7 +41,7 @@ namespace KDevelop
  * This filter strategy is for not applying any filtering at all. Implementation of the
  * interface methods are basically noops
  **/
-class KDEVPLATFORMOUTPUTVIEW_EXPORT NoFilterStrategy : public IFilterStrategy
+class KDEVPLATFORMOUTPUTVIEW_EXPORT NoFilterStrategy : public IFilterStrategy, public ICloneableFilterStrategy
 {
 
 public:
@@ -51,6 +51,8 @@ public:
 
     FilteredItem actionInLine(const QString& line) override;
 
+    IFilterStrategy* clone() const override;
+
 };
 
 /**
@@ -77,7 +79,7 @@ private:
 /**
  * This filter stategy filters out errors (no actions) from Python and PHP scripts.
  **/
-class KDEVPLATFORMOUTPUTVIEW_EXPORT ScriptErrorFilterStrategy : public IFilterStrategy
+class KDEVPLATFORMOUTPUTVIEW_EXPORT ScriptErrorFilterStrategy : public IFilterStrategy, public ICloneableFilterStrategy
 {
 
 public:
@@ -87,6 +89,8 @@ public:
 
     FilteredItem actionInLine(const QString& line) override;
 
+    IFilterStrategy* clone() const override;
+
 };
 
 /**
@@ -95,19 +99,20 @@ public:
  * This is especially useful for runtime output of Qt applications, for example lines such as:
  * "ASSERT: "errors().isEmpty()" in file /tmp/foo/bar.cpp", line 49"
  */
-class KDEVPLATFORMOUTPUTVIEW_EXPORT NativeAppErrorFilterStrategy : public IFilterStrategy
+class KDEVPLATFORMOUTPUTVIEW_EXPORT NativeAppErrorFilterStrategy : public IFilterStrategy, public ICloneableFilterStrategy
 {
 public:
     NativeAppErrorFilterStrategy();
 
     FilteredItem errorInLine(const QString& line) override;
     FilteredItem actionInLine(const QString& line) override;
+    IFilterStrategy* clone() const override;
 };
 
 /**
  * This filter stategy filters out errors (no actions) from Static code analysis tools (Cppcheck,)
  **/
-class KDEVPLATFORMOUTPUTVIEW_EXPORT StaticAnalysisFilterStrategy : public IFilterStrategy
+class KDEVPLATFORMOUTPUTVIEW_EXPORT StaticAnalysisFilterStrategy : public IFilterStrategy, public ICloneableFilterStrategy
 {
 
 public:
@@ -117,6 +122,8 @@ public:
 
     FilteredItem actionInLine(const QString& line) override;
 
+    IFilterStrategy* clone() const override;
+
 };
 
 } // namespace KDevelop
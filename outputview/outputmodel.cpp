@@ -29,12 +29,19 @@
 #include <interfaces/idocumentcontroller.h>
 #include <util/kdevstringhandler.h>
 
+#include <QDataStream>
+#include <QDir>
+#include <QFuture>
 #include <QStringList>
+#include <QTemporaryFile>
+#include <QThreadPool>
 #include <QTimer>
 #include <QThread>
 #include <QFont>
 #include <QFontDatabase>
+#include <QtConcurrentRun>
 
+#include <algorithm>
 #include <functional>
 #include <set>
 
@@ -57,6 +64,103 @@ static const int BATCH_SIZE = 50;
  */
 static const int BATCH_AGGREGATE_TIME_DELAY = 50;
 
+/**
+ * Number of lines that one thread of the parsing pool prepares in one go.
+ * Fewer cached lines than this are handled on the parse worker's own thread.
+ */
+static const int CHUNK_SIZE = 256;
+
+/**
+ * Number of items of which the file offset is remembered once they have been
+ * moved out of memory, see FilteredItemStore.
+ */
+static const int SPILL_BLOCK_SIZE = 64;
+
+class ParsingThread
+{
+public:
+    ParsingThread()
+    {
+        m_thread.setObjectName(QStringLiteral("OutputFilterThread"));
+        m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+    }
+    virtual ~ParsingThread()
+    {
+        m_pool.waitForDone();
+        if (m_thread.isRunning()) {
+            m_thread.quit();
+            m_thread.wait();
+        }
+    }
+    void addWorker(QObject* worker)
+    {
+        if (!m_thread.isRunning()) {
+            m_thread.start();
+        }
+        worker->moveToThread(&m_thread);
+    }
+    QThreadPool* pool()
+    {
+        return &m_pool;
+    }
+private:
+    QThread m_thread;
+    QThreadPool m_pool;
+};
+
+Q_GLOBAL_STATIC(ParsingThread, s_parsingThread);
+
+/**
+ * Result of preparing one chunk of lines on a thread of the parsing pool
+ */
+struct ParsedChunk
+{
+    QStringList lines;
+    /// Only filled if the chunk was classified with a copy of the filter strategy
+    QVector<FilteredItem> items;
+    QVector<IFilterStrategy::Progress> progress;
+};
+
+/**
+ * Applies the pre-filtering functions to @p lines and, if @p filter is set, classifies them.
+ */
+static ParsedChunk parseChunk(const QStringList& lines, const QSharedPointer<IFilterStrategy>& filter)
+{
+    ParsedChunk chunk;
+    chunk.lines = lines;
+    std::transform(chunk.lines.constBegin(), chunk.lines.constEnd(),
+                   chunk.lines.begin(), &KDevelop::stripAnsiSequences);
+
+    if (!filter) {
+        return chunk;
+    }
+
+    chunk.items.reserve(chunk.lines.size());
+    int lastPercent = -1;
+    foreach(const QString& line, chunk.lines) {
+        FilteredItem item = filter->errorInLine(line);
+        if( item.type == FilteredItem::InvalidItem ) {
+            item = filter->actionInLine(line);
+        }
+        chunk.items << item;
+
+        auto progress = filter->progressInLine(line);
+        if (progress.percent >= 0 && progress.percent != lastPercent) {
+            lastPercent = progress.percent;
+            chunk.progress << progress;
+        }
+    }
+    return chunk;
+}
+
+/**
+ * Classifies the lines of an OutputModel.
+ *
+ * The cached lines are split into chunks that are prepared on the threads of the parsing pool.
+ * Strategies that implement ICloneableFilterStrategy classify the lines of each chunk there as well, all others
+ * classify them in order on the thread of the worker. Either way the results are delivered
+ * in the order in which the lines were added.
+ */
 class ParseWorker : public QObject
 {
     Q_OBJECT
@@ -64,7 +168,9 @@ public:
     ParseWorker()
         : QObject(nullptr)
         , m_filter(new NoFilterStrategy)
+        , m_cloneableFilter(dynamic_cast<ICloneableFilterStrategy*>(m_filter.data()))
         , m_timer(new QTimer(this))
+        , m_processPending(false)
     {
         m_timer->setInterval(BATCH_AGGREGATE_TIME_DELAY);
         m_timer->setSingleShot(true);
@@ -75,6 +181,7 @@ public Q_SLOTS:
     void changeFilterStrategy( KDevelop::IFilterStrategy* newFilterStrategy )
     {
         m_filter = QSharedPointer<IFilterStrategy>( newFilterStrategy );
+        m_cloneableFilter = dynamic_cast<ICloneableFilterStrategy*>(newFilterStrategy);
     }
 
     void addLines( const QStringList& lines )
@@ -82,9 +189,13 @@ public Q_SLOTS:
         m_cachedLines << lines;
 
         if (m_cachedLines.size() >= BATCH_SIZE) {
-            // if enough lines were added, process immediately
+            // if enough lines were added, process once the lines that are already
+            // queued for this worker have been added as well
             m_timer->stop();
-            process();
+            if (!m_processPending) {
+                m_processPending = true;
+                QMetaObject::invokeMethod(this, "process", Qt::QueuedConnection);
+            }
         } else if (!m_timer->isActive()) {
             m_timer->start();
         }
@@ -108,15 +219,58 @@ private Q_SLOTS:
      */
     void process()
     {
-        QVector<KDevelop::FilteredItem> filteredItems;
-        filteredItems.reserve(qMin(BATCH_SIZE, m_cachedLines.size()));
+        m_processPending = false;
+        if (m_cachedLines.isEmpty()) {
+            return;
+        }
+
+        if (m_cachedLines.size() <= CHUNK_SIZE) {
+            deliver(parseChunk(m_cachedLines, m_cloneableFilter ? m_filter : QSharedPointer<IFilterStrategy>()));
+            m_cachedLines.clear();
+            return;
+        }
+
+        QVector<QFuture<ParsedChunk>> chunks;
+        chunks.reserve(m_cachedLines.size() / CHUNK_SIZE + 1);
+        for (int start = 0; start < m_cachedLines.size(); start += CHUNK_SIZE) {
+            QSharedPointer<IFilterStrategy> filter;
+            if (m_cloneableFilter) {
+                filter = QSharedPointer<IFilterStrategy>(m_cloneableFilter->clone());
+            }
+            chunks << QtConcurrent::run(s_parsingThread->pool(), &parseChunk,
+                                        m_cachedLines.mid(start, CHUNK_SIZE), filter);
+        }
+        m_cachedLines.clear();
+
+        // the chunks finish in any order, but are delivered in the order of the lines
+        foreach(const QFuture<ParsedChunk>& chunk, chunks) {
+            deliver(chunk.result());
+        }
+    }
+
+private:
+    void deliver(const ParsedChunk& chunk)
+    {
+        if (!m_cloneableFilter) {
+            classify(chunk.lines);
+            return;
+        }
+
+        foreach(const auto& progress, chunk.progress) {
+            reportProgress(progress);
+        }
+        for (int start = 0; start < chunk.items.size(); start += BATCH_SIZE) {
+            emit parsedBatch(chunk.items.mid(start, BATCH_SIZE));
+        }
+    }
 
-        // apply pre-filtering functions
-        std::transform(m_cachedLines.constBegin(), m_cachedLines.constEnd(),
-                       m_cachedLines.begin(), &KDevelop::stripAnsiSequences);
+    void classify(const QStringList& lines)
+    {
+        QVector<KDevelop::FilteredItem> filteredItems;
+        filteredItems.reserve(qMin(BATCH_SIZE, lines.size()));
 
         // apply filtering strategy
-        foreach(const QString& line, m_cachedLines) {
+        foreach(const QString& line, lines) {
             FilteredItem item = m_filter->errorInLine(line);
             if( item.type == FilteredItem::InvalidItem ) {
                 item = m_filter->actionInLine(line);
@@ -124,16 +278,12 @@ private Q_SLOTS:
 
             filteredItems << item;
 
-            auto progress = m_filter->progressInLine(line);
-            if (progress.percent >= 0 && m_progress.percent != progress.percent) {
-                m_progress = progress;
-                emit this->progress(m_progress);
-            }
+            reportProgress(m_filter->progressInLine(line));
 
             if( filteredItems.size() == BATCH_SIZE ) {
                 emit parsedBatch(filteredItems);
                 filteredItems.clear();
-                filteredItems.reserve(qMin(BATCH_SIZE, m_cachedLines.size()));
+                filteredItems.reserve(qMin(BATCH_SIZE, lines.size()));
             }
         }
 
@@ -141,43 +291,188 @@ private Q_SLOTS:
         if( !filteredItems.isEmpty() ) {
             emit parsedBatch(filteredItems);
         }
-        m_cachedLines.clear();
     }
 
-private:
+    void reportProgress(const IFilterStrategy::Progress& progress)
+    {
+        if (progress.percent >= 0 && m_progress.percent != progress.percent) {
+            m_progress = progress;
+            emit this->progress(m_progress);
+        }
+    }
+
     QSharedPointer<IFilterStrategy> m_filter;
+    /// m_filter, if it can be cloned for the threads of the parsing pool
+    ICloneableFilterStrategy* m_cloneableFilter;
     QStringList m_cachedLines;
 
     QTimer* m_timer;
+    bool m_processPending;
     IFilterStrategy::Progress m_progress;
 };
 
-class ParsingThread
+/**
+ * Keeps the filtered items of an OutputModel.
+ *
+ * Without a limit all items stay in memory. With a limit only the newest items are kept in a ring buffer
+ * of that size, and every item that drops out of it is appended to a temporary file. Those items are read
+ * back from the file in blocks of SPILL_BLOCK_SIZE when they are needed again.
+ */
+class FilteredItemStore
 {
 public:
-    ParsingThread()
+    int size() const
     {
-        m_thread.setObjectName(QStringLiteral("OutputFilterThread"));
+        return m_spilledCount + m_ring.size();
     }
-    virtual ~ParsingThread()
+
+    FilteredItem at(int row) const
     {
-        if (m_thread.isRunning()) {
-            m_thread.quit();
-            m_thread.wait();
+        if (row >= m_spilledCount) {
+            return m_ring.at((m_ringStart + row - m_spilledCount) % m_ring.size());
+        }
+
+        const int block = row / SPILL_BLOCK_SIZE;
+        if (block != m_cachedBlock) {
+            readBlock(block);
         }
+        return m_cachedItems.value(row % SPILL_BLOCK_SIZE);
     }
-    void addWorker(ParseWorker* worker)
+
+    void append(const FilteredItem& item)
     {
-        if (!m_thread.isRunning()) {
-            m_thread.start();
+        if (m_maxLines <= 0 || m_ring.size() < m_maxLines) {
+            m_ring.append(item);
+            return;
         }
-        worker->moveToThread(&m_thread);
+
+        if (!spill(m_ring.at(m_ringStart))) {
+            // keep everything in memory rather than losing output
+            setMaxLines(0);
+            m_ring.append(item);
+            return;
+        }
+        m_ring[m_ringStart] = item;
+        m_ringStart = (m_ringStart + 1) % m_ring.size();
     }
+
+    int maxLines() const
+    {
+        return m_maxLines;
+    }
+
+    void setMaxLines(int maxLines)
+    {
+        std::rotate(m_ring.begin(), m_ring.begin() + m_ringStart, m_ring.end());
+        m_ringStart = 0;
+        m_maxLines = maxLines;
+
+        if (m_maxLines <= 0 || m_ring.size() <= m_maxLines) {
+            return;
+        }
+
+        const int excess = m_ring.size() - m_maxLines;
+        for (int i = 0; i < excess; ++i) {
+            if (!spill(m_ring.at(i))) {
+                m_ring.remove(0, i);
+                m_maxLines = 0;
+                return;
+            }
+        }
+        m_ring.remove(0, excess);
+    }
+
+    void clear()
+    {
+        m_ring.clear();
+        m_ringStart = 0;
+        m_spilledCount = 0;
+        m_blockOffsets.clear();
+        m_spillEnd = 0;
+        m_spillPositionMoved = false;
+        m_cachedBlock = -1;
+        m_cachedItems.clear();
+        m_spillFile.reset();
+    }
+
 private:
-    QThread m_thread;
-};
+    bool spill(const FilteredItem& item)
+    {
+        if (!m_spillFile) {
+            m_spillFile.reset(new QTemporaryFile(QDir::tempPath() + QLatin1String("/kdevelop-output-XXXXXX")));
+            if (!m_spillFile->open()) {
+                qCWarning(OUTPUTVIEW) << "could not create file for output lines:" << m_spillFile->errorString();
+                m_spillFile.reset();
+                return false;
+            }
+        }
 
-Q_GLOBAL_STATIC(ParsingThread, s_parsingThread);
+        if (m_spillPositionMoved) {
+            m_spillFile->seek(m_spillEnd);
+            m_spillPositionMoved = false;
+        }
+
+        if (m_spilledCount % SPILL_BLOCK_SIZE == 0) {
+            m_blockOffsets << m_spillEnd;
+        }
+
+        QDataStream stream(m_spillFile.data());
+        stream << static_cast<qint32>(item.type) << item.isActivatable
+               << static_cast<qint32>(item.lineNo) << static_cast<qint32>(item.columnNo)
+               << item.url << item.originalLine;
+        m_spillEnd = m_spillFile->pos();
+        if (m_cachedBlock == m_spilledCount / SPILL_BLOCK_SIZE) {
+            // the cached block does not contain this item yet
+            m_cachedBlock = -1;
+        }
+        ++m_spilledCount;
+        return true;
+    }
+
+    void readBlock(int block) const
+    {
+        m_cachedItems.clear();
+        m_cachedBlock = block;
+        m_spillFile->seek(m_blockOffsets.at(block));
+        m_spillPositionMoved = true;
+
+        const int count = qMin(SPILL_BLOCK_SIZE, m_spilledCount - block * SPILL_BLOCK_SIZE);
+        m_cachedItems.reserve(count);
+
+        QDataStream stream(m_spillFile.data());
+        for (int i = 0; i < count; ++i) {
+            FilteredItem item;
+            qint32 type, lineNo, columnNo;
+            stream >> type >> item.isActivatable >> lineNo >> columnNo >> item.url >> item.originalLine;
+            item.type = static_cast<FilteredItem::FilteredOutputItemType>(type);
+            item.lineNo = lineNo;
+            item.columnNo = columnNo;
+            m_cachedItems << item;
+        }
+        if (stream.status() != QDataStream::Ok) {
+            qCWarning(OUTPUTVIEW) << "could not read output lines from" << m_spillFile->fileName();
+        }
+    }
+
+    /// Maximum number of items kept in memory, 0 for no limit
+    int m_maxLines = 0;
+    /// The newest items, the oldest of them is at m_ringStart
+    QVector<FilteredItem> m_ring;
+    int m_ringStart = 0;
+
+    /// Number of items that were moved to m_spillFile, they are the first items of the store
+    int m_spilledCount = 0;
+    QScopedPointer<QTemporaryFile> m_spillFile;
+    /// File offset of every SPILL_BLOCK_SIZE-th spilled item
+    QVector<qint64> m_blockOffsets;
+    /// File offset behind the last spilled item
+    qint64 m_spillEnd = 0;
+    /// Whether readBlock() moved the position of m_spillFile away from m_spillEnd
+    mutable bool m_spillPositionMoved = false;
+
+    mutable int m_cachedBlock = -1;
+    mutable QVector<FilteredItem> m_cachedItems;
+};
 
 class OutputModelPrivate
 {
@@ -189,7 +484,7 @@ public:
     OutputModel* model;
     ParseWorker* worker;
 
-    QVector<FilteredItem> m_filteredItems;
+    FilteredItemStore m_filteredItems;
     // We use std::set because that is ordered
     std::set<int> m_errorItems; // Indices of all items that we want to move to using previous and next
     QUrl m_buildDir;
@@ -202,7 +497,7 @@ public:
             if( item.type == FilteredItem::ErrorItem ) {
                 m_errorItems.insert(m_filteredItems.size());
             }
-            m_filteredItems << item;
+            m_filteredItems.append(item);
         }
 
         model->endInsertRows();
@@ -276,7 +571,7 @@ QVariant OutputModel::data(const QModelIndex& idx , int role ) const
 int OutputModel::rowCount( const QModelIndex& parent ) const
 {
     if( !parent.isValid() )
-        return d->m_filteredItems.count();
+        return d->m_filteredItems.size();
     return 0;
 }
 
@@ -402,6 +697,16 @@ QModelIndex OutputModel::lastHighlightIndex()
     return QModelIndex();
 }
 
+int OutputModel::maxMemoryLines() const
+{
+    return d->m_filteredItems.maxLines();
+}
+
+void OutputModel::setMaxMemoryLines(int lines)
+{
+    d->m_filteredItems.setMaxLines(lines);
+}
+
 void OutputModel::setFilteringStrategy(const OutputFilterStrategy& currentStrategy)
 {
     // TODO: Turn into factory, decouple from OutputModel
@@ -464,6 +769,7 @@ void OutputModel::clear()
     ensureAllDone();
     beginResetModel();
     d->m_filteredItems.clear();
+    d->m_errorItems.clear();
     endResetModel();
 }
 
@@ -70,6 +70,17 @@ public:
     void setFilteringStrategy(const OutputFilterStrategy& currentStrategy);
     void setFilteringStrategy(IFilterStrategy* filterStrategy);
 
+    /**
+     * Limit the number of lines that are kept in memory
+     *
+     * Once the model contains more lines than that, the oldest lines are moved to a temporary file
+     * and read back from there when they are shown or activated. The model keeps all its rows.
+     *
+     * @param lines the maximum number of lines in memory, 0 (the default) for no limit
+     */
+    void setMaxMemoryLines(int lines);
+    int maxMemoryLines() const;
+
 public Q_SLOTS:
     void appendLine( const QString& );
     void appendLines( const QStringList& );
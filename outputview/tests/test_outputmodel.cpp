@@ -19,7 +19,12 @@
 #include "test_outputmodel.h"
 #include "testlinebuilderfunctions.h"
 #include "../outputmodel.h"
+#include "../filtereditem.h"
 
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryFile>
+#include <QTextStream>
 #include <QTest>
 
 QTEST_MAIN(KDevelop::TestOutputModel)
@@ -116,4 +121,129 @@ void TestOutputModel::bench_data()
     QTest::newRow("static-analysis-filter-longline") << OutputModel::StaticAnalysisFilter << longLine;
 }
 
+/**
+ * Writes a log that resembles the output of a parallel build of a CMake project to @p file:
+ * progress lines, compiler invocations, and occasional diagnostics with relative paths.
+ */
+static void writeBuildLog(QFile* file, int targetLines)
+{
+    QTextStream stream(file);
+    const QString sourceDir = QStringLiteral("/home/user/src/project");
+    for (int line = 0; line < targetLines; ) {
+        const int target = line % 97;
+        const int percent = (line * 100) / targetLines;
+        stream << "[" << percent << "%] Building CXX object src/lib" << target << "/CMakeFiles/lib" << target
+               << ".dir/file" << line << ".cpp.o\n";
+        stream << "/usr/bin/c++ -DQT_CORE_LIB -DQT_NO_DEBUG -I" << sourceDir << "/src/lib" << target
+               << " -isystem /usr/include/qt5 -isystem /usr/include/qt5/QtCore -O2 -g -fPIC -std=c++11"
+               << " -o CMakeFiles/lib" << target << ".dir/file" << line << ".cpp.o -c " << sourceDir << "/src/lib"
+               << target << "/file" << line << ".cpp\n";
+        line += 2;
+        if (line % 20 == 0) {
+            stream << "In file included from ../../src/lib" << target << "/file" << line << ".h:12:0,\n";
+            stream << "../../src/lib" << target << "/file" << line << ".cpp:42:13: warning: unused variable 'x' [-Wunused-variable]\n";
+            stream << "     int x = 0;\n";
+            stream << "             ^\n";
+            line += 4;
+        }
+        if (line % 50 == 0) {
+            stream << "[" << percent << "%] Linking CXX shared library liblib" << target << ".so\n";
+            stream << "[" << percent << "%] Built target lib" << target << "\n";
+            line += 2;
+        }
+    }
+}
+
+void TestOutputModel::benchBuildLog()
+{
+    // Set KDEV_BENCH_BUILD_LOG to replay a recorded build log, e.g. the output of a parallel build of a large tree
+    QScopedPointer<QFile> log;
+    const QString recordedLog = QString::fromLocal8Bit(qgetenv("KDEV_BENCH_BUILD_LOG"));
+    if (!recordedLog.isEmpty()) {
+        log.reset(new QFile(recordedLog));
+    } else {
+        auto* generated = new QTemporaryFile;
+        log.reset(generated);
+        QVERIFY(generated->open());
+        writeBuildLog(generated, 200000);
+        generated->close();
+    }
+    QVERIFY(log->open(QIODevice::ReadOnly | QIODevice::Text));
+
+    OutputModel testee(QUrl::fromLocalFile(QStringLiteral("/home/user/build/project")));
+    testee.setFilteringStrategy(OutputModel::CompilerFilter);
+    QSignalSpy allDone(&testee, &OutputModel::allDone);
+
+    int lineCount = 0;
+    QBENCHMARK_ONCE {
+        QStringList lines;
+        while (!log->atEnd()) {
+            QString line = QString::fromUtf8(log->readLine());
+            line.chop(1);
+            lines << line;
+            if (lines.size() == 1000) {
+                lineCount += lines.size();
+                testee.appendLines(lines);
+                lines.clear();
+                QCoreApplication::processEvents();
+            }
+        }
+        lineCount += lines.size();
+        testee.appendLines(lines);
+        testee.ensureAllDone();
+        while (allDone.isEmpty()) {
+            QVERIFY(allDone.wait(60000));
+        }
+    }
+    QCOMPARE(testee.rowCount(), lineCount);
+}
+
+void TestOutputModel::testMaxMemoryLines()
+{
+    OutputModel testee;
+    testee.setFilteringStrategy(OutputModel::ScriptErrorFilter);
+    testee.setMaxMemoryLines(100);
+    QSignalSpy allDone(&testee, &OutputModel::allDone);
+
+    // enough lines to be classified on several threads, and with errors in the lines that are moved to disk
+    QStringList lines;
+    for (int i = 0; i < 5000; ++i) {
+        if (i % 1000 == 10) {
+            lines << QStringLiteral("  File \"/tmp/script%1.py\", line %2, in foo").arg(i).arg(i + 1);
+        } else {
+            lines << QStringLiteral("\x1b[1mline %1\x1b[0m").arg(i);
+        }
+    }
+    testee.appendLines(lines.mid(0, 1234));
+    testee.appendLines(lines.mid(1234));
+    testee.ensureAllDone();
+    QVERIFY(allDone.wait());
+    QCOMPARE(testee.rowCount(), lines.size());
+
+    for (int i = 0; i < lines.size(); ++i) {
+        const QModelIndex index = testee.index(i);
+        const bool isError = i % 1000 == 10;
+        QCOMPARE(testee.data(index).toString(), isError ? lines.at(i) : QStringLiteral("line %1").arg(i));
+        QCOMPARE(testee.data(index, OutputModel::OutputItemTypeRole).toInt(),
+                 static_cast<int>(isError ? FilteredItem::ErrorItem : FilteredItem::InvalidItem));
+    }
+
+    QCOMPARE(testee.firstHighlightIndex().row(), 10);
+    QCOMPARE(testee.nextHighlightIndex(testee.index(10)).row(), 1010);
+    QCOMPARE(testee.lastHighlightIndex().row(), 4010);
+
+    // lifting the limit keeps the lines that were moved to disk
+    testee.setMaxMemoryLines(0);
+    testee.appendLine(QStringLiteral("last line"));
+    testee.ensureAllDone();
+    QVERIFY(allDone.wait());
+    QCOMPARE(testee.rowCount(), lines.size() + 1);
+    QCOMPARE(testee.data(testee.index(3)).toString(), QStringLiteral("line 3"));
+    QCOMPARE(testee.data(testee.index(lines.size())).toString(), QStringLiteral("last line"));
+
+    testee.clear();
+    QCOMPARE(testee.rowCount(), 0);
+    QVERIFY(!testee.firstHighlightIndex().isValid());
+}
+
 }
@@ -34,6 +34,8 @@ public:
 private Q_SLOTS:
     void bench();
     void bench_data();
+    void benchBuildLog();
+    void testMaxMemoryLines();
 };
 
 }
@@ -0,0 +1,415 @@
+/*
+ * This file is part of KDevelop
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "gitcache.h"
+
+#include <QDir>
+#include <QFileInfo>
+
+#include <KDirWatch>
+
+#include <interfaces/icore.h>
+#include <interfaces/idocument.h>
+#include <interfaces/idocumentcontroller.h>
+#include <vcs/dvcs/dvcsjob.h>
+
+using namespace KDevelop;
+
+namespace
+{
+
+/// How long a status is trusted without a change of the index, for changes made outside of KDevelop
+const qint64 statusLifetime = 60 * 1000; // ms
+
+/// The maximum number of annotated lines that are kept
+const int maxAnnotationLines = 200000;
+
+bool isInFolder(const QString& path, const QString& folder)
+{
+    return path.size() > folder.size() && path.startsWith(folder) && path[folder.size()] == QLatin1Char('/');
+}
+
+QString localPath(const QUrl& url)
+{
+    return url.adjusted(QUrl::StripTrailingSlash).toLocalFile();
+}
+
+}
+
+GitCachedJob::GitCachedJob(IPlugin* parent, VcsJob::JobType type, const QVariant& results)
+    : VcsJob(parent, OutputJob::Silent)
+    , m_plugin(parent)
+    , m_results(results)
+    , m_status(JobNotStarted)
+{
+    setType(type);
+}
+
+QVariant GitCachedJob::fetchResults()
+{
+    return m_results;
+}
+
+void GitCachedJob::start()
+{
+    m_status = JobRunning;
+    // the results are only looked at after the job is started
+    QMetaObject::invokeMethod(this, "finish", Qt::QueuedConnection);
+}
+
+VcsJob::JobStatus GitCachedJob::status() const
+{
+    return m_status;
+}
+
+IPlugin* GitCachedJob::vcsPlugin() const
+{
+    return m_plugin;
+}
+
+void GitCachedJob::finish()
+{
+    m_status = JobSucceeded;
+    emitResult();
+    emit resultsReady(this);
+}
+
+GitCache::GitCache(QObject* parent)
+    : QObject(parent)
+    , m_watcher(new KDirWatch(this))
+    , m_annotations(maxAnnotationLines)
+{
+    connect(m_watcher, &KDirWatch::dirty, this, &GitCache::gitFileChanged);
+    connect(m_watcher, &KDirWatch::created, this, &GitCache::gitFileChanged);
+    connect(m_watcher, &KDirWatch::deleted, this, &GitCache::gitFileChanged);
+    connect(ICore::self()->documentController(), &IDocumentController::documentSaved,
+            this, &GitCache::documentSaved);
+}
+
+GitCache::~GitCache() = default;
+
+void GitCache::watchRepository(const QDir& repository)
+{
+    const QString root = repository.absolutePath();
+    if (m_repositories.contains(root)) {
+        return;
+    }
+    // worktrees and submodules keep their git directory somewhere else, whatever is not watched can't be cached
+    if (!QFileInfo(repository.filePath(QStringLiteral(".git"))).isDir()) {
+        return;
+    }
+
+    m_repositories.insert(root, Repository());
+    m_watcher->addFile(repository.filePath(QStringLiteral(".git/index")));
+    m_watcher->addFile(repository.filePath(QStringLiteral(".git/HEAD")));
+    m_watcher->addFile(repository.filePath(QStringLiteral(".git/packed-refs")));
+    m_watcher->addDir(repository.filePath(QStringLiteral(".git/refs")), KDirWatch::WatchSubDirs | KDirWatch::WatchFiles);
+}
+
+GitCache::Repository* GitCache::repository(const QDir& dir)
+{
+    auto it = m_repositories.find(dir.absolutePath());
+    if (it == m_repositories.end()) {
+        return nullptr;
+    }
+
+    // The notifications of the watcher arrive late, e.g. a status right after a commit finished would be
+    // answered before them. So check the files that change most often before every use.
+    const QFileInfo index(dir.filePath(QStringLiteral(".git/index")));
+    const QFileInfo head(dir.filePath(QStringLiteral(".git/HEAD")));
+    if (index.lastModified() != it->indexModified || index.size() != it->indexSize
+        || head.lastModified() != it->headModified)
+    {
+        clear(&*it);
+        it->indexModified = index.lastModified();
+        it->indexSize = index.size();
+        it->headModified = head.lastModified();
+    }
+    return &*it;
+}
+
+void GitCache::clear(Repository* repository)
+{
+    ++repository->generation;
+    repository->states.clear();
+    repository->folders.clear();
+    repository->savedFiles.clear();
+    repository->stashesKnown = false;
+}
+
+int GitCache::generation(const QDir& repository)
+{
+    Repository* repo = this->repository(repository);
+    return repo ? repo->generation : -1;
+}
+
+bool GitCache::isCovered(const Repository& repository, const QString& path) const
+{
+    // look up the path and each folder above it
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    for (int size = path.size(); size > 0; size = path.lastIndexOf(QLatin1Char('/'), size - 1)) {
+        auto it = repository.folders.constFind(path.left(size));
+        if (it != repository.folders.constEnd() && it.value().msecsTo(now) < statusLifetime) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool GitCache::status(const QDir& repository, const QList<QUrl>& locations,
+                      IBasicVersionControl::RecursionMode recursion, QVariantList* results, QList<QUrl>* savedFiles)
+{
+    Repository* repo = this->repository(repository);
+    if (!repo) {
+        return false;
+    }
+
+    const QString root = repository.absolutePath();
+    QVariantList statuses;
+    QSet<QString> saved;
+    auto appendStatus = [&statuses, repo](const QString& file, VcsStatusInfo::State state) {
+        if (repo->savedFiles.contains(file)) {
+            return;
+        }
+        VcsStatusInfo status;
+        status.setUrl(QUrl::fromLocalFile(file));
+        status.setState(state);
+        statuses.append(qVariantFromValue<VcsStatusInfo>(status));
+    };
+
+    foreach (const QUrl& location, locations) {
+        const QString path = localPath(location);
+        if (!isCovered(*repo, path)) {
+            return false;
+        }
+        // git only reports untracked folders, not the files in them
+        if (repo->states.contains(path + QLatin1Char('/'))) {
+            return false;
+        }
+        for (int i = path.indexOf(QLatin1Char('/'), root.size() + 1); i != -1; i = path.indexOf(QLatin1Char('/'), i + 1)) {
+            if (repo->states.contains(path.left(i + 1))) {
+                return false;
+            }
+        }
+
+        if (QFileInfo(path).isDir()) {
+            const QString prefix = path + QLatin1Char('/');
+            const bool recursive = recursion == IBasicVersionControl::Recursive;
+            for (auto it = repo->states.lowerBound(prefix), end = repo->states.end(); it != end && it.key().startsWith(prefix); ++it) {
+                if (!recursive && it.key().indexOf(QLatin1Char('/'), prefix.size()) != -1) {
+                    continue;
+                }
+                appendStatus(it.key(), it.value());
+            }
+            foreach (const QString& file, repo->savedFiles) {
+                if (isInFolder(file, path) && (recursive || file.indexOf(QLatin1Char('/'), prefix.size()) == -1)) {
+                    saved.insert(file);
+                }
+            }
+        } else if (repo->savedFiles.contains(path)) {
+            saved.insert(path);
+        } else {
+            auto it = repo->states.constFind(path);
+            if (it != repo->states.constEnd()) {
+                appendStatus(path, *it);
+            }
+        }
+    }
+
+    *results = statuses;
+    savedFiles->clear();
+    foreach (const QString& file, saved) {
+        savedFiles->append(QUrl::fromLocalFile(file));
+    }
+    return true;
+}
+
+void GitCache::trackStatus(DVcsJob* job, const QDir& repository, const QList<QUrl>& locations,
+                           IBasicVersionControl::RecursionMode recursion)
+{
+    Repository* repo = this->repository(repository);
+    if (!repo) {
+        return;
+    }
+
+    // don't let git status refresh the index, that would drop what it finds right away
+    job->process()->setEnv(QStringLiteral("GIT_OPTIONAL_LOCKS"), QStringLiteral("0"));
+
+    const QString root = repository.absolutePath();
+    const int generation = repo->generation;
+    connect(job, &VcsJob::resultsReady, this, [this, root, generation, locations, recursion](VcsJob* job) {
+        if (job->status() == VcsJob::JobSucceeded) {
+            addStatus(root, generation, locations, recursion, job->fetchResults().toList());
+        }
+    });
+}
+
+void GitCache::addStatus(const QString& root, int generation, const QList<QUrl>& locations,
+                         IBasicVersionControl::RecursionMode recursion, const QVariantList& results)
+{
+    Repository* repo = repository(QDir(root));
+    if (!repo || repo->generation != generation) {
+        return;
+    }
+
+    QMap<QString, VcsStatusInfo::State> states;
+    foreach (const QVariant& result, results) {
+        const VcsStatusInfo status = result.value<VcsStatusInfo>();
+        states.insert(status.url().toLocalFile(), status.state());
+    }
+
+    foreach (const QUrl& location, locations) {
+        const QString path = localPath(location);
+        if (QFileInfo(path).isDir()) {
+            // only a recursive status has all files of a folder
+            if (recursion != IBasicVersionControl::Recursive) {
+                continue;
+            }
+
+            const QString prefix = path + QLatin1Char('/');
+            auto old = repo->states.lowerBound(prefix);
+            while (old != repo->states.end() && old.key().startsWith(prefix)) {
+                old = repo->states.erase(old);
+            }
+            for (auto it = states.lowerBound(prefix), end = states.end(); it != end && it.key().startsWith(prefix); ++it) {
+                repo->states.insert(it.key(), it.value());
+            }
+
+            auto folder = repo->folders.lowerBound(prefix);
+            while (folder != repo->folders.end() && folder.key().startsWith(prefix)) {
+                folder = repo->folders.erase(folder);
+            }
+            repo->folders.insert(path, QDateTime::currentDateTimeUtc());
+
+            for (auto it = repo->savedFiles.begin(); it != repo->savedFiles.end();) {
+                if (isInFolder(*it, path)) {
+                    it = repo->savedFiles.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        } else if (isCovered(*repo, path)) {
+            repo->states.remove(path);
+            auto it = states.constFind(path);
+            if (it != states.constEnd()) {
+                repo->states.insert(path, *it);
+            }
+            repo->savedFiles.remove(path);
+        }
+    }
+}
+
+bool GitCache::isTracked(const QDir& repository, const QUrl& file, bool* tracked)
+{
+    Repository* repo = this->repository(repository);
+    const QString path = localPath(file);
+    if (!repo || !isCovered(*repo, path)) {
+        return false;
+    }
+
+    // saving a file does not change whether it is tracked
+    auto it = repo->states.constFind(path);
+    *tracked = it != repo->states.constEnd() && *it != VcsStatusInfo::ItemUnknown;
+    return true;
+}
+
+bool GitCache::annotation(const QDir& repository, const QUrl& file, QVariantList* results)
+{
+    Repository* repo = this->repository(repository);
+    const QString path = localPath(file);
+    const Annotation* annotation = m_annotations.object(path);
+    if (!repo || !annotation || annotation->repository != repository.absolutePath()
+        || annotation->generation != repo->generation)
+    {
+        return false;
+    }
+
+    const QFileInfo info(path);
+    if (info.lastModified() != annotation->modified || info.size() != annotation->size) {
+        return false;
+    }
+
+    *results = annotation->lines;
+    return true;
+}
+
+void GitCache::trackAnnotation(DVcsJob* job, const QDir& repository, const QUrl& file)
+{
+    Repository* repo = this->repository(repository);
+    if (!repo) {
+        return;
+    }
+
+    const QString root = repository.absolutePath();
+    const int generation = repo->generation;
+    const QString path = localPath(file);
+    // blame annotates the file as it is when it starts
+    const QFileInfo info(path);
+    const QDateTime modified = info.lastModified();
+    const qint64 size = info.size();
+    // the lines arrive in parts, keep them once all are there
+    connect(job, &KJob::result, this, [this, job, root, generation, path, modified, size]() {
+        Repository* repo = this->repository(QDir(root));
+        if (!repo || repo->generation != generation || job->status() != VcsJob::JobSucceeded) {
+            return;
+        }
+        const QVariantList lines = job->allResults().toList();
+        m_annotations.insert(path, new Annotation{root, generation, modified, size, lines}, lines.size());
+    });
+}
+
+bool GitCache::hasStashes(const QDir& repository, bool* hasStashes)
+{
+    Repository* repo = this->repository(repository);
+    if (!repo || !repo->stashesKnown) {
+        return false;
+    }
+    *hasStashes = repo->hasStashes;
+    return true;
+}
+
+void GitCache::setHasStashes(const QDir& repository, int generation, bool hasStashes)
+{
+    Repository* repo = this->repository(repository);
+    if (!repo || repo->generation != generation) {
+        return;
+    }
+    repo->stashesKnown = true;
+    repo->hasStashes = hasStashes;
+}
+
+void GitCache::gitFileChanged(const QString& path)
+{
+    for (auto it = m_repositories.begin(), end = m_repositories.end(); it != end; ++it) {
+        if (isInFolder(path, it.key() + QLatin1String("/.git"))) {
+            clear(&*it);
+            return;
+        }
+    }
+}
+
+void GitCache::documentSaved(IDocument* document)
+{
+    const QString path = localPath(document->url());
+    for (auto it = m_repositories.begin(), end = m_repositories.end(); it != end; ++it) {
+        if (isInFolder(path, it.key()) && isCovered(*it, path)) {
+            it->savedFiles.insert(path);
+        }
+    }
+}
@@ -0,0 +1,157 @@
+/*
+ * This file is part of KDevelop
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KDEVPLATFORM_PLUGIN_GITCACHE_H
+#define KDEVPLATFORM_PLUGIN_GITCACHE_H
+
+#include <vcs/interfaces/ibasicversioncontrol.h>
+#include <vcs/vcsjob.h>
+#include <vcs/vcsstatusinfo.h>
+
+#include <QCache>
+#include <QDateTime>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+
+class KDirWatch;
+class QDir;
+
+namespace KDevelop
+{
+    class DVcsJob;
+    class IDocument;
+}
+
+/**
+ * A job that finishes with results that are known already, e.g. from the GitCache.
+ */
+class GitCachedJob : public KDevelop::VcsJob
+{
+    Q_OBJECT
+    public:
+        GitCachedJob(KDevelop::IPlugin* parent, KDevelop::VcsJob::JobType type, const QVariant& results);
+
+        QVariant fetchResults() override;
+        void start() override;
+        JobStatus status() const override;
+        KDevelop::IPlugin* vcsPlugin() const override;
+
+    private Q_SLOTS:
+        void finish();
+
+    private:
+        KDevelop::IPlugin* m_plugin;
+        QVariant m_results;
+        JobStatus m_status;
+};
+
+/**
+ * Remembers what git reported about the repositories whose changes are watched.
+ *
+ * Everything known about a repository is dropped when its index, HEAD or refs change.
+ * Only the files saved in KDevelop are asked for again the next time their status is needed,
+ * other changes of the work tree show up once the cached status is older than a minute.
+ */
+class GitCache : public QObject
+{
+    Q_OBJECT
+    public:
+        explicit GitCache(QObject* parent = nullptr);
+        ~GitCache() override;
+
+        /// Keeps results for the work tree @p repository from now on
+        void watchRepository(const QDir& repository);
+
+        /**
+         * @return a number that changes whenever the results for @p repository are dropped,
+         *         -1 if the repository is not watched
+         */
+        int generation(const QDir& repository);
+
+        /**
+         * Looks up the status of @p locations in @p repository, as GitPlugin::status() reports it.
+         * The files in @p savedFiles were saved since their status was looked up, they are not in @p results
+         * and have to be asked for again.
+         * @return whether all of it is known, apart from @p savedFiles
+         */
+        bool status(const QDir& repository, const QList<QUrl>& locations,
+                    KDevelop::IBasicVersionControl::RecursionMode recursion, QVariantList* results, QList<QUrl>* savedFiles);
+        /// Keeps the results of the status @p job for @p locations in @p repository once it succeeded
+        void trackStatus(KDevelop::DVcsJob* job, const QDir& repository, const QList<QUrl>& locations,
+                         KDevelop::IBasicVersionControl::RecursionMode recursion);
+
+        /// @return whether it is known if @p file is tracked by git, @p tracked is set then
+        bool isTracked(const QDir& repository, const QUrl& file, bool* tracked);
+
+        /// @return whether the annotation of the current contents of @p file is known, @p results is set then
+        bool annotation(const QDir& repository, const QUrl& file, QVariantList* results);
+        /// Keeps the results of the annotation @p job for @p file once it succeeded
+        void trackAnnotation(KDevelop::DVcsJob* job, const QDir& repository, const QUrl& file);
+
+        /// @return whether it is known if @p repository has stashes, @p hasStashes is set then
+        bool hasStashes(const QDir& repository, bool* hasStashes);
+        /// Keeps whether @p repository has stashes, as found out while it was at @p generation
+        void setHasStashes(const QDir& repository, int generation, bool hasStashes);
+
+    private:
+        struct Repository
+        {
+            int generation = 0;
+            /// When .git/index and .git/HEAD were written last, as seen by the cached results
+            QDateTime indexModified;
+            qint64 indexSize = -1;
+            QDateTime headModified;
+            /// The state of the files and of untracked folders (with a trailing slash) by path
+            QMap<QString, KDevelop::VcsStatusInfo::State> states;
+            /// Folders of which all files are in states, with the time they were looked up
+            QMap<QString, QDateTime> folders;
+            /// Files in the folders that were saved since
+            QSet<QString> savedFiles;
+            bool stashesKnown = false;
+            bool hasStashes = false;
+        };
+
+        struct Annotation
+        {
+            QString repository;
+            int generation;
+            QDateTime modified;
+            qint64 size;
+            QVariantList lines;
+        };
+
+        /// @return the watched repository @p dir with up to date contents, or nullptr
+        Repository* repository(const QDir& dir);
+        void clear(Repository* repository);
+        bool isCovered(const Repository& repository, const QString& path) const;
+        void addStatus(const QString& root, int generation, const QList<QUrl>& locations,
+                       KDevelop::IBasicVersionControl::RecursionMode recursion, const QVariantList& results);
+
+        void gitFileChanged(const QString& path);
+        void documentSaved(KDevelop::IDocument* document);
+
+        KDirWatch* m_watcher;
+        /// By the path of the work tree
+        QHash<QString, Repository> m_repositories;
+        /// By the path of the file, the cost is the number of lines
+        QCache<QString, Annotation> m_annotations;
+};
+
+#endif // KDEVPLATFORM_PLUGIN_GITCACHE_H
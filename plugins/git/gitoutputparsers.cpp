@@ -0,0 +1,205 @@
+/*
+ * This file is part of KDevelop
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "gitoutputparsers.h"
+
+#include <QDateTime>
+
+using namespace KDevelop;
+
+namespace
+{
+
+VcsItemEvent::Actions actionsFromString(char c)
+{
+    switch(c) {
+        case 'A': return VcsItemEvent::Added;
+        case 'D': return VcsItemEvent::Deleted;
+        case 'R': return VcsItemEvent::Replaced;
+        case 'M': return VcsItemEvent::Modified;
+    }
+    return VcsItemEvent::Modified;
+}
+
+/// @return the length of the key of a "Key: value" line, 0 if it is none
+int infoKeyLength(const QString& line)
+{
+    int i = 0;
+    while (i < line.size() && (line[i].isLetterOrNumber() || line[i] == QLatin1Char('_'))) {
+        ++i;
+    }
+    return (i > 0 && i < line.size() && line[i] == QLatin1Char(':')) ? i : 0;
+}
+
+}
+
+bool isCommitLine(const QString& line)
+{
+    static const QString commit = QStringLiteral("commit ");
+    if (line.size() < commit.size() + 40 || !line.startsWith(commit)) {
+        return false;
+    }
+    for (int i = commit.size(); i < commit.size() + 40; ++i) {
+        if (!line[i].isLetterOrNumber()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QVariantList GitLogParser::parse(const QStringList& lines)
+{
+    QVariantList commits;
+    foreach (QString line, lines) {
+        if (line.endsWith(QLatin1Char('\r'))) {
+            line.chop(1);
+        }
+
+        int colon;
+        if (line.size() == 47 && isCommitLine(line)) {
+            if (m_pushCommit) {
+                commits.append(takeCommit());
+            } else {
+                m_pushCommit = true;
+            }
+            VcsRevision rev;
+            rev.setRevisionValue(line.mid(7, 8), KDevelop::VcsRevision::GlobalNumber);
+            m_item.setRevision(rev);
+        } else if ((colon = infoKeyLength(line)) > 0) {
+            const QStringRef key = line.leftRef(colon);
+            if (key == QLatin1String("Author")) {
+                m_item.setAuthor(line.mid(colon + 1).trimmed());
+            } else if (key == QLatin1String("Date")) {
+                m_item.setDate(QDateTime::fromTime_t(line.midRef(colon + 1).trimmed().split(' ')[0].toUInt()));
+            }
+        } else if (addModification(line)) {
+            // a file changed by the current commit
+        } else if (line.startsWith(QLatin1String("    "))) {
+            m_message += line.midRef(4);
+            m_message += '\n';
+        }
+    }
+    return commits;
+}
+
+QVariantList GitLogParser::finish()
+{
+    QVariantList commits;
+    if (m_pushCommit) {
+        commits.append(takeCommit());
+        m_pushCommit = false;
+    }
+    return commits;
+}
+
+QVariant GitLogParser::takeCommit()
+{
+    m_item.setMessage(m_message.trimmed());
+    const QVariant commit = QVariant::fromValue(m_item);
+    m_item.setItems(QList<VcsItemEvent>());
+    m_message.clear();
+    return commit;
+}
+
+bool GitLogParser::addModification(const QString& line)
+{
+    //R099    plugins/git/kdevgit.desktop     plugins/git/kdevgit.desktop.cmake
+    //M       plugins/grepview/CMakeLists.txt
+    if (line.isEmpty() || line[0] < QLatin1Char('A') || line[0] > QLatin1Char('Z')) {
+        return false;
+    }
+    int tab = 1;
+    while (tab < line.size() && line[tab].isDigit()) {
+        ++tab;
+    }
+    if (tab == line.size() || line[tab] != QLatin1Char('\t')) {
+        return false;
+    }
+    int secondTab = line.indexOf(QLatin1Char('\t'), tab + 1);
+    const QString filenameA = line.mid(tab + 1, secondTab == -1 ? -1 : secondTab - tab - 1);
+    if (filenameA.isEmpty()) {
+        return false;
+    }
+
+    VcsItemEvent::Actions a = actionsFromString(line[0].toLatin1());
+    VcsItemEvent itemEvent;
+    itemEvent.setActions(a);
+    itemEvent.setRepositoryLocation(filenameA);
+    if(a==VcsItemEvent::Replaced) {
+        itemEvent.setRepositoryCopySourceLocation(secondTab == -1 ? QString() : line.mid(secondTab + 1));
+    }
+    m_item.addItem(itemEvent);
+    return true;
+}
+
+QVariantList GitBlameParser::parse(const QStringList& lines)
+{
+    QVariantList results;
+    foreach (const QString& line, lines) {
+        if(m_skipNext) {
+            m_skipNext=false;
+            results += qVariantFromValue(*m_annotation);
+
+            continue;
+        }
+
+        if(line.isEmpty())
+            continue;
+
+        QStringRef name = line.leftRef(line.indexOf(' '));
+        QStringRef value = line.rightRef(line.size()-name.size()-1);
+
+        if(name==QLatin1String("author"))
+            m_annotation->setAuthor(value.toString());
+        else if(name==QLatin1String("author-mail")) {} //TODO: do smth with the e-mail?
+        else if(name==QLatin1String("author-tz")) {} //TODO: does it really matter?
+        else if(name==QLatin1String("author-time"))
+            m_annotation->setDate(QDateTime::fromTime_t(value.toUInt()));
+        else if(name==QLatin1String("summary"))
+            m_annotation->setCommitMessage(value.toString());
+        else if(name.startsWith(QStringLiteral("committer"))) {} //We will just store the authors
+        else if(name==QLatin1String("previous")) {} //We don't need that either
+        else if(name==QLatin1String("filename")) { m_skipNext=true; }
+        else if(name==QLatin1String("boundary")) {
+            m_definedRevisions.insert(QStringLiteral("boundary"), VcsAnnotationLine());
+        }
+        else
+        {
+            const auto values = value.split(' ');
+
+            VcsRevision rev;
+            rev.setRevisionValue(name.left(8).toString(), KDevelop::VcsRevision::GlobalNumber);
+
+            m_skipNext = m_definedRevisions.contains(name.toString());
+
+            if(!m_skipNext)
+                m_definedRevisions.insert(name.toString(), VcsAnnotationLine());
+
+            m_annotation = &m_definedRevisions[name.toString()];
+            m_annotation->setLineNumber(values[1].toInt() - 1);
+            m_annotation->setRevision(rev);
+        }
+    }
+    return results;
+}
+
+QVariantList GitBlameParser::finish()
+{
+    return QVariantList();
+}
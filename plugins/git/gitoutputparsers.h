@@ -0,0 +1,92 @@
+/*
+ * This file is part of KDevelop
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KDEVPLATFORM_PLUGIN_GITOUTPUTPARSERS_H
+#define KDEVPLATFORM_PLUGIN_GITOUTPUTPARSERS_H
+
+#include <vcs/dvcs/dvcsjob.h>
+#include <vcs/vcsannotation.h>
+#include <vcs/vcsevent.h>
+
+#include <QMap>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVariantList>
+
+/// @return whether @p line starts with "commit " and a full sha1
+bool isCommitLine(const QString& line);
+
+/**
+ * Parses the output of git log --name-status into VcsEvents, a part at a time.
+ *
+ * The parts have to consist of whole lines, a commit may be split between parts.
+ */
+class GitLogParser
+{
+public:
+    /// @return the commits that are complete after @p lines
+    QVariantList parse(const QStringList& lines);
+    /// @return the last commit, once all lines were parsed
+    QVariantList finish();
+
+private:
+    QVariant takeCommit();
+    /// Adds a line like "M\tpath" or "R099\told path\tnew path" to the current commit
+    bool addModification(const QString& line);
+
+    KDevelop::VcsEvent m_item;
+    QString m_message;
+    bool m_pushCommit = false;
+};
+
+/**
+ * Parses the output of git blame --porcelain into VcsAnnotationLines, a part at a time.
+ *
+ * The parts have to consist of whole lines, the lines of one annotation may be split between parts.
+ */
+class GitBlameParser
+{
+public:
+    /// @return the annotation lines that are complete after @p lines
+    QVariantList parse(const QStringList& lines);
+    QVariantList finish();
+
+private:
+    QMap<QString, KDevelop::VcsAnnotationLine> m_definedRevisions;
+    KDevelop::VcsAnnotationLine* m_annotation = nullptr;
+    bool m_skipNext = false;
+};
+
+/**
+ * Feeds the output of @p job to a Parser while the command runs, so the results
+ * can be shown before git is done, e.g. for files with a long history.
+ */
+template<typename Parser>
+void parseIncrementally(KDevelop::DVcsJob* job)
+{
+    QSharedPointer<Parser> parser(new Parser);
+    QObject::connect(job, &KDevelop::DVcsJob::outputLinesReceived, job, [parser](KDevelop::DVcsJob* job, const QStringList& lines) {
+        job->appendResults(parser->parse(lines));
+    });
+    QObject::connect(job, &KDevelop::DVcsJob::readyForParsing, job, [parser](KDevelop::DVcsJob* job) {
+        job->appendResults(parser->finish());
+    });
+}
+
+#endif // KDEVPLATFORM_PLUGIN_GITOUTPUTPARSERS_H
@@ -54,6 +54,8 @@
 #include <KTextEdit>
 #include <KTextEditor/Document>
 
+#include "gitcache.h"
+#include "gitoutputparsers.h"
 #include "gitjob.h"
 #include "gitmessagehighlighter.h"
 #include "gitplugincheckinrepositoryjob.h"
@@ -193,6 +195,8 @@ GitPlugin::GitPlugin( QObject *parent, const QVariantList & )
     m_watcher = new KDirWatch(this);
     connect(m_watcher, &KDirWatch::dirty, this, &GitPlugin::fileChanged);
     connect(m_watcher, &KDirWatch::created, this, &GitPlugin::fileChanged);
+
+    m_cache = new GitCache(this);
 }
 
 GitPlugin::~GitPlugin()
@@ -209,7 +213,15 @@ bool emptyOutput(DVcsJob* job)
 
 bool GitPlugin::hasStashes(const QDir& repository)
 {
-    return !emptyOutput(gitStash(repository, QStringList(QStringLiteral("list")), KDevelop::OutputJob::Silent));
+    bool ret;
+    if (m_cache->hasStashes(repository, &ret)) {
+        return ret;
+    }
+
+    const int generation = m_cache->generation(repository);
+    ret = !emptyOutput(gitStash(repository, QStringList(QStringLiteral("list")), KDevelop::OutputJob::Silent));
+    m_cache->setHasStashes(repository, generation, ret);
+    return ret;
 }
 
 bool GitPlugin::hasModifications(const QDir& d)
@@ -331,6 +343,11 @@ bool GitPlugin::isVersionControlled(const QUrl &path)
         return isValidDirectory(path);
     }
 
+    bool tracked;
+    if (m_cache->isTracked(dotGitDirectory(path), path, &tracked)) {
+        return tracked;
+    }
+
     QString filename = fsObject.fileName();
 
     QStringList otherFiles = getLsFiles(fsObject.dir(), QStringList(QStringLiteral("--")) << filename, KDevelop::OutputJob::Silent);
@@ -369,6 +386,27 @@ KDevelop::VcsJob* GitPlugin::status(const QList<QUrl>& localLocations, KDevelop:
     if (localLocations.empty())
         return errorsFound(i18n("Did not specify the list of files"), OutputJob::Verbose);
 
+    const QDir repository = dotGitDirectory(localLocations.first());
+    QVariantList statuses;
+    QList<QUrl> savedFiles;
+    if (!m_oldVersion && m_cache->status(repository, localLocations, recursion, &statuses, &savedFiles)) {
+        if (savedFiles.isEmpty()) {
+            return new GitCachedJob(this, VcsJob::Status, statuses);
+        }
+
+        // only ask git about the files saved since, and add the cached status of the others
+        DVcsJob* job = new GitJob(repository, this, OutputJob::Silent);
+        job->setType(VcsJob::Status);
+        *job << "git" << "status" << "--porcelain" << "--" << savedFiles;
+        job->setIgnoreError(true);
+        connect(job, &DVcsJob::readyForParsing, this, &GitPlugin::parseGitStatusOutput);
+        connect(job, &DVcsJob::readyForParsing, this, [statuses](DVcsJob* job) {
+            job->setResults(job->fetchResults().toList() + statuses);
+        });
+        m_cache->trackStatus(job, repository, savedFiles, IBasicVersionControl::NonRecursive);
+        return job;
+    }
+
     DVcsJob* job = new GitJob(urlDir(localLocations), this, OutputJob::Silent);
     job->setType(VcsJob::Status);
 
@@ -379,6 +417,7 @@ KDevelop::VcsJob* GitPlugin::status(const QList<QUrl>& localLocations, KDevelop:
         *job << "git" << "status" << "--porcelain";
         job->setIgnoreError(true);
         connect(job, &DVcsJob::readyForParsing, this, &GitPlugin::parseGitStatusOutput);
+        m_cache->trackStatus(job, repository, localLocations, recursion);
     }
     *job << "--" << (recursion == IBasicVersionControl::Recursive ? localLocations : preventRecursion(localLocations));
 
@@ -597,7 +636,7 @@ VcsJob* GitPlugin::log(const QUrl& localLocation,
     if(!rev.isEmpty())
         *job << rev;
     *job << "--" << localLocation;
-    connect(job, &DVcsJob::readyForParsing, this, &GitPlugin::parseGitLogOutput);
+    parseIncrementally<GitLogParser>(job);
     return job;
 }
 
@@ -614,79 +653,27 @@ VcsJob* GitPlugin::log(const QUrl& localLocation, const KDevelop::VcsRevision& r
         *job << QStringLiteral("-%1").arg(limit);
 
     *job << "--" << localLocation;
-    connect(job, &DVcsJob::readyForParsing, this, &GitPlugin::parseGitLogOutput);
+    parseIncrementally<GitLogParser>(job);
     return job;
 }
 
 KDevelop::VcsJob* GitPlugin::annotate(const QUrl &localLocation, const KDevelop::VcsRevision&)
 {
-    DVcsJob* job = new GitJob(dotGitDirectory(localLocation), this, KDevelop::OutputJob::Silent);
+    const QDir repository = dotGitDirectory(localLocation);
+    QVariantList annotation;
+    if (m_cache->annotation(repository, localLocation, &annotation)) {
+        return new GitCachedJob(this, VcsJob::Annotate, annotation);
+    }
+
+    DVcsJob* job = new GitJob(repository, this, KDevelop::OutputJob::Silent);
     job->setType(VcsJob::Annotate);
     *job << "git" << "blame" << "--porcelain" << "-w";
     *job << "--" << localLocation;
-    connect(job, &DVcsJob::readyForParsing, this, &GitPlugin::parseGitBlameOutput);
+    parseIncrementally<GitBlameParser>(job);
+    m_cache->trackAnnotation(job, repository, localLocation);
     return job;
 }
 
-void GitPlugin::parseGitBlameOutput(DVcsJob *job)
-{
-    QVariantList results;
-    VcsAnnotationLine* annotation = nullptr;
-    const auto output = job->output();
-    const auto lines = output.splitRef('\n');
-
-    bool skipNext=false;
-    QMap<QString, VcsAnnotationLine> definedRevisions;
-    for(QVector<QStringRef>::const_iterator it=lines.constBegin(), itEnd=lines.constEnd();
-        it!=itEnd; ++it)
-    {
-        if(skipNext) {
-            skipNext=false;
-            results += qVariantFromValue(*annotation);
-
-            continue;
-        }
-
-        if(it->isEmpty())
-            continue;
-
-        QStringRef name = it->left(it->indexOf(' '));
-        QStringRef value = it->right(it->size()-name.size()-1);
-
-        if(name==QLatin1String("author"))
-            annotation->setAuthor(value.toString());
-        else if(name==QLatin1String("author-mail")) {} //TODO: do smth with the e-mail?
-        else if(name==QLatin1String("author-tz")) {} //TODO: does it really matter?
-        else if(name==QLatin1String("author-time"))
-            annotation->setDate(QDateTime::fromTime_t(value.toUInt()));
-        else if(name==QLatin1String("summary"))
-            annotation->setCommitMessage(value.toString());
-        else if(name.startsWith(QStringLiteral("committer"))) {} //We will just store the authors
-        else if(name==QLatin1String("previous")) {} //We don't need that either
-        else if(name==QLatin1String("filename")) { skipNext=true; }
-        else if(name==QLatin1String("boundary")) {
-            definedRevisions.insert(QStringLiteral("boundary"), VcsAnnotationLine());
-        }
-        else
-        {
-            const auto values = value.split(' ');
-
-            VcsRevision rev;
-            rev.setRevisionValue(name.left(8).toString(), KDevelop::VcsRevision::GlobalNumber);
-
-            skipNext = definedRevisions.contains(name.toString());
-
-            if(!skipNext)
-                definedRevisions.insert(name.toString(), VcsAnnotationLine());
-
-            annotation = &definedRevisions[name.toString()];
-            annotation->setLineNumber(values[1].toInt() - 1);
-            annotation->setRevision(rev);
-        }
-    }
-    job->setResults(results);
-}
-
 
 DVcsJob* GitPlugin::lsFiles(const QDir &repository, const QStringList &args,
                             OutputJob::OutputJobVerbosity verbosity)
@@ -848,8 +835,6 @@ QList<DVcsEvent> GitPlugin::getAllCommits(const QString &repo)
     Q_UNUSED(ret);
     QStringList commits = job->output().split('\n', QString::SkipEmptyParts);
 
-    static QRegExp rx_com("commit \\w{40,40}");
-
     QList<DVcsEvent>commitList;
     DVcsEvent item;
 
@@ -861,7 +846,7 @@ QList<DVcsEvent> GitPlugin::getAllCommits(const QString &repo)
     //parse output
     for(int i = 0; i < commits.count(); ++i)
     {
-        if (commits[i].contains(rx_com))
+        if (isCommitLine(commits[i]))
         {
             qCDebug(PLUGIN_GIT) << "commit found in " << commits[i];
             item.setCommit(commits[i].section(' ', 1, 1).trimmed());
@@ -891,7 +876,7 @@ QList<DVcsEvent> GitPlugin::getAllCommits(const QString &repo)
 
             QString log;
             i++; //next line!
-            while (i < commits.count() && !commits[i].contains(rx_com))
+            while (i < commits.count() && !isCommitLine(commits[i]))
                 log += commits[i++];
             --i; //while took commit line
             item.setLog(log.trimmed());
@@ -1072,87 +1057,6 @@ void GitPlugin::parseLogOutput(const DVcsJob * job, QList<DVcsEvent>& commits) c
     }
 }
 
-VcsItemEvent::Actions actionsFromString(char c)
-{
-    switch(c) {
-        case 'A': return VcsItemEvent::Added;
-        case 'D': return VcsItemEvent::Deleted;
-        case 'R': return VcsItemEvent::Replaced;
-        case 'M': return VcsItemEvent::Modified;
-    }
-    return VcsItemEvent::Modified;
-}
-
-void GitPlugin::parseGitLogOutput(DVcsJob * job)
-{
-    static QRegExp commitRegex( "^commit (\\w{8})\\w{32}" );
-    static QRegExp infoRegex( "^(\\w+):(.*)" );
-    static QRegExp modificationsRegex("^([A-Z])[0-9]*\t([^\t]+)\t?(.*)", Qt::CaseSensitive, QRegExp::RegExp2);
-    //R099    plugins/git/kdevgit.desktop     plugins/git/kdevgit.desktop.cmake
-    //M       plugins/grepview/CMakeLists.txt
-
-    QList<QVariant> commits;
-
-    QString contents = job->output();
-    // check if git-log returned anything
-    if (contents.isEmpty()) {
-        job->setResults(commits); // empty list
-        return;
-    }
-
-    // start parsing the output
-    QTextStream s(&contents);
-
-    VcsEvent item;
-    QString message;
-    bool pushCommit = false;
-
-    while (!s.atEnd()) {
-        QString line = s.readLine();
-
-        if (commitRegex.exactMatch(line)) {
-            if (pushCommit) {
-                item.setMessage(message.trimmed());
-                commits.append(QVariant::fromValue(item));
-                item.setItems(QList<VcsItemEvent>());
-            } else {
-                pushCommit = true;
-            }
-            VcsRevision rev;
-            rev.setRevisionValue(commitRegex.cap(1), KDevelop::VcsRevision::GlobalNumber);
-            item.setRevision(rev);
-            message.clear();
-        } else if (infoRegex.exactMatch(line)) {
-            QString cap1 = infoRegex.cap(1);
-            if (cap1 == QLatin1String("Author")) {
-                item.setAuthor(infoRegex.cap(2).trimmed());
-            } else if (cap1 == QLatin1String("Date")) {
-                item.setDate(QDateTime::fromTime_t(infoRegex.cap(2).trimmed().split(' ')[0].toUInt()));
-            }
-        } else if (modificationsRegex.exactMatch(line)) {
-            VcsItemEvent::Actions a = actionsFromString(modificationsRegex.cap(1).at(0).toLatin1());
-            QString filenameA = modificationsRegex.cap(2);
-
-            VcsItemEvent itemEvent;
-            itemEvent.setActions(a);
-            itemEvent.setRepositoryLocation(filenameA);
-            if(a==VcsItemEvent::Replaced) {
-                QString filenameB = modificationsRegex.cap(3);
-                itemEvent.setRepositoryCopySourceLocation(filenameB);
-            }
-
-            item.addItem(itemEvent);
-        } else if (line.startsWith(QLatin1String("    "))) {
-            message += line.remove(0, 4);
-            message += '\n';
-        }
-    }
-
-    item.setMessage(message.trimmed());
-    commits.append(QVariant::fromValue(item));
-    job->setResults(commits);
-}
-
 void GitPlugin::parseGitDiffOutput(DVcsJob* job)
 {
     VcsDiff diff;
@@ -1509,6 +1413,7 @@ void GitPlugin::registerRepositoryForCurrentBranchChanges(const QUrl& repository
     QDir dir = dotGitDirectory(repository);
     QString headFile = dir.absoluteFilePath(QStringLiteral(".git/HEAD"));
     m_watcher->addFile(headFile);
+    m_cache->watchRepository(dir);
 }
 
 void GitPlugin::fileChanged(const QString& file)
@@ -29,6 +29,7 @@
 #include <outputview/outputjob.h>
 #include <vcs/vcsjob.h>
 
+class GitCache;
 class KDirWatch;
 class QDir;
 
@@ -174,8 +175,6 @@ protected:
                          KDevelop::OutputJob::OutputJobVerbosity verbosity = KDevelop::OutputJob::Silent);
 
 private Q_SLOTS:
-    void parseGitBlameOutput(KDevelop::DVcsJob *job);
-    void parseGitLogOutput(KDevelop::DVcsJob *job);
     void parseGitDiffOutput(KDevelop::DVcsJob* job);
     void parseGitRepoLocationOutput(KDevelop::DVcsJob* job);
     void parseGitStatusOutput(KDevelop::DVcsJob* job);
@@ -215,6 +214,7 @@ private:
 
     KDirWatch* m_watcher;
     QList<QUrl> m_branchesChange;
+    GitCache* m_cache;
     bool m_usePrefix;
 };
 
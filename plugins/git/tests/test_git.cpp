@@ -30,9 +30,16 @@
 #include <QUrl>
 #include <QDebug>
 
+#include <KTextEditor/Document>
+
+#include <interfaces/icore.h>
+#include <interfaces/idocument.h>
+#include <interfaces/idocumentcontroller.h>
 #include <vcs/dvcs/dvcsjob.h>
 #include <vcs/vcsannotation.h>
+#include <vcs/vcsstatusinfo.h>
 #include "../gitplugin.h"
+#include "../gitoutputparsers.h"
 
 #define VERIFYJOB(j) \
 do { QVERIFY(j); QVERIFY(j->exec()); QVERIFY((j)->status() == KDevelop::VcsJob::JobSucceeded); } while(0)
@@ -583,6 +590,262 @@ void GitInitTest::testDiff()
     QVERIFY(QDir().exists(path+"/.git"));
 }
 
+void GitInitTest::testStatusCache()
+{
+    repoInit();
+    addFiles();
+    commitFiles();
+
+    m_plugin->registerRepositoryForCurrentBranchChanges(QUrl::fromLocalFile(gitTest_BaseDir()));
+
+    const QList<QUrl> locations{QUrl::fromLocalFile(gitTest_BaseDir())};
+    VcsJob* j = m_plugin->status(locations);
+    VERIFYJOB(j);
+    const int statusCount = j->fetchResults().toList().size();
+    QVERIFY(statusCount > 0);
+
+    // nothing changed, git does not have to be asked again
+    j = m_plugin->status(locations);
+    QVERIFY(!qobject_cast<DVcsJob*>(j));
+    VERIFYJOB(j);
+    QCOMPARE(j->fetchResults().toList().size(), statusCount);
+
+    // adding a file changes the index
+    const QUrl newFile = QUrl::fromLocalFile(gitTest_BaseDir() + "new");
+    QVERIFY(writeFile(newFile.toLocalFile(), QStringLiteral("new")));
+    j = m_plugin->add(QList<QUrl>() << newFile);
+    VERIFYJOB(j);
+
+    j = m_plugin->status(locations);
+    QVERIFY(qobject_cast<DVcsJob*>(j));
+    VERIFYJOB(j);
+    QVariantList results = j->fetchResults().toList();
+    bool found = false;
+    foreach(const QVariant& result, results) {
+        const VcsStatusInfo status = result.value<VcsStatusInfo>();
+        if (status.url() == newFile) {
+            QCOMPARE(status.state(), VcsStatusInfo::ItemAdded);
+            found = true;
+        }
+    }
+    QVERIFY(found);
+    const int addedCount = results.size();
+
+    // saving a file only asks git about that file
+    const QUrl savedFile = QUrl::fromLocalFile(gitTest_BaseDir() + gitTest_FileName());
+    IDocument* document = ICore::self()->documentController()->openDocument(savedFile);
+    QVERIFY(document);
+    QVERIFY(document->textDocument());
+    document->textDocument()->setText(QStringLiteral("changed"));
+    QVERIFY(document->save(IDocument::Silent));
+
+    j = m_plugin->status(locations);
+    DVcsJob* statusJob = qobject_cast<DVcsJob*>(j);
+    QVERIFY(statusJob);
+    QCOMPARE(statusJob->dvcsCommand().last(), savedFile.toLocalFile());
+    VERIFYJOB(j);
+    results = j->fetchResults().toList();
+    QCOMPARE(results.size(), addedCount + 1);
+    found = false;
+    foreach(const QVariant& result, results) {
+        const VcsStatusInfo status = result.value<VcsStatusInfo>();
+        if (status.url() == savedFile) {
+            QCOMPARE(status.state(), VcsStatusInfo::ItemModified);
+            found = true;
+        }
+    }
+    QVERIFY(found);
+
+    // the saved file is known again
+    j = m_plugin->status(locations);
+    QVERIFY(!qobject_cast<DVcsJob*>(j));
+    VERIFYJOB(j);
+    QCOMPARE(j->fetchResults().toList().size(), addedCount + 1);
+
+    document->close(IDocument::Discard);
+}
+
+static QStringList sampleLog()
+{
+    return QStringList()
+        << QStringLiteral("commit 1111111111111111111111111111111111111111")
+        << QStringLiteral("Author: Jane Doe <jane@example.com>")
+        << QStringLiteral("Date:   1400000000 +0200")
+        << QString()
+        << QStringLiteral("    Second commit")
+        << QStringLiteral("    with a longer message")
+        << QString()
+        << QStringLiteral("M\tfoo")
+        << QStringLiteral("R099\told\tnew")
+        << QString()
+        << QStringLiteral("commit 2222222222222222222222222222222222222222")
+        << QStringLiteral("Author: John Doe <john@example.com>")
+        << QStringLiteral("Date:   1300000000 +0000")
+        << QString()
+        << QStringLiteral("    Initial commit")
+        << QString()
+        << QStringLiteral("A\tfoo")
+        << QStringLiteral("A\told");
+}
+
+static QStringList sampleBlame()
+{
+    return QStringList()
+        << QStringLiteral("1111111111111111111111111111111111111111 1 1 2")
+        << QStringLiteral("author Jane Doe")
+        << QStringLiteral("author-mail <jane@example.com>")
+        << QStringLiteral("author-time 1400000000")
+        << QStringLiteral("author-tz +0200")
+        << QStringLiteral("committer Jane Doe")
+        << QStringLiteral("committer-mail <jane@example.com>")
+        << QStringLiteral("committer-time 1400000000")
+        << QStringLiteral("committer-tz +0200")
+        << QStringLiteral("summary Second commit")
+        << QStringLiteral("previous 2222222222222222222222222222222222222222 foo")
+        << QStringLiteral("filename foo")
+        << QStringLiteral("\tfirst line")
+        << QStringLiteral("1111111111111111111111111111111111111111 2 2")
+        << QStringLiteral("\tsecond line")
+        << QStringLiteral("2222222222222222222222222222222222222222 3 3 1")
+        << QStringLiteral("author John Doe")
+        << QStringLiteral("author-mail <john@example.com>")
+        << QStringLiteral("author-time 1300000000")
+        << QStringLiteral("author-tz +0000")
+        << QStringLiteral("committer John Doe")
+        << QStringLiteral("committer-mail <john@example.com>")
+        << QStringLiteral("committer-time 1300000000")
+        << QStringLiteral("committer-tz +0000")
+        << QStringLiteral("summary Initial commit")
+        << QStringLiteral("boundary")
+        << QStringLiteral("filename foo")
+        << QStringLiteral("\tthird line");
+}
+
+template<typename Parser>
+static QVariantList parseInChunks(const QList<QStringList>& chunks)
+{
+    Parser parser;
+    QVariantList results;
+    foreach (const QStringList& chunk, chunks) {
+        results += parser.parse(chunk);
+    }
+    results += parser.finish();
+    return results;
+}
+
+static QList<QStringList> lineByLine(const QStringList& lines)
+{
+    QList<QStringList> chunks;
+    foreach (const QString& line, lines) {
+        chunks << QStringList(line);
+    }
+    return chunks;
+}
+
+static QStringList describeLog(const QVariantList& results)
+{
+    QStringList description;
+    foreach (const QVariant& result, results) {
+        const VcsEvent event = result.value<VcsEvent>();
+        QStringList fields;
+        fields << event.revision().revisionValue().toString() << event.author()
+               << event.date().toString(Qt::ISODate) << event.message();
+        foreach (const VcsItemEvent& item, event.items()) {
+            fields << QStringLiteral("%1 %2 %3").arg(int(item.actions()))
+                          .arg(item.repositoryLocation(), item.repositoryCopySourceLocation());
+        }
+        description << fields.join(QLatin1Char('|'));
+    }
+    return description;
+}
+
+static QStringList describeBlame(const QVariantList& results)
+{
+    QStringList description;
+    foreach (const QVariant& result, results) {
+        const VcsAnnotationLine line = result.value<VcsAnnotationLine>();
+        description << QStringLiteral("%1|%2|%3|%4|%5").arg(line.lineNumber())
+                           .arg(line.revision().revisionValue().toString(), line.author(),
+                                line.date().toString(Qt::ISODate), line.commitMessage());
+    }
+    return description;
+}
+
+/// Runs a command printing @p parts with pauses in between, so they arrive separately
+static DVcsJob* printInParts(const QStringList& parts, IPlugin* plugin)
+{
+    QStringList script;
+    for (int i = 1; i <= parts.size(); ++i) {
+        script << QStringLiteral("printf '%s' \"$%1\"").arg(i);
+    }
+    DVcsJob* job = new DVcsJob(QDir::temp(), plugin);
+    *job << "sh" << "-c" << script.join(QStringLiteral("; sleep 0.2; ")) << "sh" << parts;
+    return job;
+}
+
+void GitInitTest::testLogParserChunks()
+{
+    const QStringList lines = sampleLog();
+    const QVariantList oneShot = parseInChunks<GitLogParser>(QList<QStringList>() << lines);
+    QCOMPARE(oneShot.size(), 2);
+    const VcsEvent first = oneShot.first().value<VcsEvent>();
+    QCOMPARE(first.revision().revisionValue().toString(), QStringLiteral("11111111"));
+    QCOMPARE(first.author(), QStringLiteral("Jane Doe <jane@example.com>"));
+    QCOMPARE(first.message(), QStringLiteral("Second commit\nwith a longer message"));
+    QCOMPARE(first.items().size(), 2);
+    QCOMPARE(first.items().last().repositoryCopySourceLocation(), QStringLiteral("new"));
+    QCOMPARE(oneShot.last().value<VcsEvent>().message(), QStringLiteral("Initial commit"));
+
+    const QStringList expected = describeLog(oneShot);
+    for (int i = 0; i <= lines.size(); ++i) {
+        QCOMPARE(describeLog(parseInChunks<GitLogParser>(QList<QStringList>() << lines.mid(0, i) << lines.mid(i))), expected);
+    }
+    QCOMPARE(describeLog(parseInChunks<GitLogParser>(lineByLine(lines))), expected);
+}
+
+void GitInitTest::testBlameParserChunks()
+{
+    const QStringList lines = sampleBlame();
+    const QVariantList oneShot = parseInChunks<GitBlameParser>(QList<QStringList>() << lines);
+    QCOMPARE(oneShot.size(), 3);
+    for (int i = 0; i < oneShot.size(); ++i) {
+        QCOMPARE(oneShot.at(i).value<VcsAnnotationLine>().lineNumber(), i);
+    }
+    QCOMPARE(oneShot.at(1).value<VcsAnnotationLine>().commitMessage(), QStringLiteral("Second commit"));
+    QCOMPARE(oneShot.at(2).value<VcsAnnotationLine>().author(), QStringLiteral("John Doe"));
+
+    const QStringList expected = describeBlame(oneShot);
+    for (int i = 0; i <= lines.size(); ++i) {
+        QCOMPARE(describeBlame(parseInChunks<GitBlameParser>(QList<QStringList>() << lines.mid(0, i) << lines.mid(i))), expected);
+    }
+    QCOMPARE(describeBlame(parseInChunks<GitBlameParser>(lineByLine(lines))), expected);
+}
+
+void GitInitTest::testIncrementalParsing()
+{
+    // the output is split in the middle of lines and of records
+    const QString log = sampleLog().join(QLatin1Char('\n')) + QLatin1Char('\n');
+    const int secondAuthor = log.indexOf(QLatin1String("Author"), log.indexOf(QLatin1String("commit 2222")));
+    DVcsJob* job = printInParts(QStringList() << log.left(20) << log.mid(20, secondAuthor - 17) << log.mid(secondAuthor + 3), m_plugin);
+    QStringList received;
+    connect(job, &DVcsJob::outputLinesReceived, this, [&received](DVcsJob*, const QStringList& lines) {
+        received += lines;
+    });
+    parseIncrementally<GitLogParser>(job);
+    VERIFYJOB(job);
+    QCOMPARE(received, sampleLog());
+    QCOMPARE(describeLog(job->allResults().toList()),
+             describeLog(parseInChunks<GitLogParser>(QList<QStringList>() << sampleLog())));
+
+    const QString blame = sampleBlame().join(QLatin1Char('\n')) + QLatin1Char('\n');
+    const int secondHeader = blame.indexOf(QLatin1String("1111111111111111111111111111111111111111 2 2"));
+    job = printInParts(QStringList() << blame.left(secondHeader + 10) << blame.mid(secondHeader + 10), m_plugin);
+    parseIncrementally<GitBlameParser>(job);
+    VERIFYJOB(job);
+    QCOMPARE(describeBlame(job->allResults().toList()),
+             describeBlame(parseInChunks<GitBlameParser>(QList<QStringList>() << sampleBlame())));
+}
+
 QTEST_MAIN(GitInitTest)
 
 // #include "gittest.moc"
@@ -63,6 +63,10 @@ private Q_SLOTS:
     void testRemoveUnindexedFile();
     void testRemoveFolderContainingUnversionedFiles();
     void testDiff();
+    void testStatusCache();
+    void testLogParserChunks();
+    void testBlameParserChunks();
+    void testIncrementalParsing();
 
 private:
     GitPlugin* m_plugin;
@@ -0,0 +1,134 @@
+/***************************************************************************
+ *   This file is part of KDevelop                                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "grepfileindex.h"
+
+#include <QMutexLocker>
+
+#include <interfaces/icore.h>
+#include <interfaces/iproject.h>
+#include <interfaces/iprojectcontroller.h>
+#include <project/projectmodel.h>
+#include <serialization/indexedstring.h>
+
+#include <algorithm>
+
+using namespace KDevelop;
+
+GrepFileIndex::GrepFileIndex(QObject* parent)
+    : QObject(parent)
+{
+    IProjectController* projectController = ICore::self()->projectController();
+    connect(projectController, &IProjectController::projectOpened, this, &GrepFileIndex::addProject);
+    connect(projectController, &IProjectController::projectClosing, this, &GrepFileIndex::removeProject);
+
+    foreach(IProject* project, projectController->projects()) {
+        addProject(project);
+    }
+}
+
+GrepFileIndex::~GrepFileIndex() = default;
+
+QVector<QString> GrepFileIndex::projectFiles(IProject* project)
+{
+    const QSet<IndexedString> fileSet = project->fileSet();
+    QVector<QString> files;
+    files.reserve(fileSet.size());
+    foreach(const IndexedString& file, fileSet) {
+        files << file.str();
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+QVector<QString> GrepFileIndex::files(IProject* project) const
+{
+    QMutexLocker lock(&m_mutex);
+
+    auto it = m_projects.find(project);
+    if (it == m_projects.end()) {
+        return {};
+    }
+
+    ProjectFiles& files = *it;
+    if (!files.removed.isEmpty()) {
+        const QSet<QString>& removed = files.removed;
+        files.sorted.erase(std::remove_if(files.sorted.begin(), files.sorted.end(),
+                                          [&removed](const QString& file) { return removed.contains(file); }),
+                           files.sorted.end());
+        files.removed.clear();
+    }
+    if (!files.added.isEmpty()) {
+        QVector<QString> added;
+        added.reserve(files.added.size());
+        foreach(const QString& file, files.added) {
+            added << file;
+        }
+        std::sort(added.begin(), added.end());
+
+        const int oldSize = files.sorted.size();
+        files.sorted += added;
+        std::inplace_merge(files.sorted.begin(), files.sorted.begin() + oldSize, files.sorted.end());
+        files.sorted.erase(std::unique(files.sorted.begin(), files.sorted.end()), files.sorted.end());
+        files.added.clear();
+    }
+    return files.sorted;
+}
+
+void GrepFileIndex::addProject(IProject* project)
+{
+    connect(project, &IProject::fileAddedToSet, this, [this, project](ProjectFileItem* item) {
+        fileAdded(project, item);
+    });
+    connect(project, &IProject::fileRemovedFromSet, this, [this, project](ProjectFileItem* item) {
+        fileRemoved(project, item);
+    });
+
+    const QVector<QString> files = projectFiles(project);
+
+    QMutexLocker lock(&m_mutex);
+    m_projects[project] = {files, {}, {}};
+}
+
+void GrepFileIndex::removeProject(IProject* project)
+{
+    disconnect(project, nullptr, this, nullptr);
+
+    QMutexLocker lock(&m_mutex);
+    m_projects.remove(project);
+}
+
+void GrepFileIndex::fileAdded(IProject* project, ProjectFileItem* item)
+{
+    const QString file = item->indexedPath().str();
+
+    QMutexLocker lock(&m_mutex);
+    auto it = m_projects.find(project);
+    if (it == m_projects.end()) {
+        return;
+    }
+    if (!it->removed.remove(file)) {
+        it->added.insert(file);
+    }
+}
+
+void GrepFileIndex::fileRemoved(IProject* project, ProjectFileItem* item)
+{
+    const QString file = item->indexedPath().str();
+
+    QMutexLocker lock(&m_mutex);
+    auto it = m_projects.find(project);
+    if (it == m_projects.end()) {
+        return;
+    }
+    if (!it->added.remove(file)) {
+        it->removed.insert(file);
+    }
+}
@@ -0,0 +1,69 @@
+/***************************************************************************
+ *   This file is part of KDevelop                                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef KDEVPLATFORM_PLUGIN_GREPFILEINDEX_H
+#define KDEVPLATFORM_PLUGIN_GREPFILEINDEX_H
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QVector>
+
+namespace KDevelop
+{
+    class IProject;
+    class ProjectFileItem;
+}
+
+/**
+ * Keeps the files of all open projects as lists of local paths, sorted by path.
+ *
+ * The lists follow the files that are added to or removed from a project, which includes
+ * the changes on disk that the project managers pick up. Changes are collected and merged
+ * into the sorted list the next time it is requested, so loading a project stays cheap.
+ */
+class GrepFileIndex : public QObject
+{
+    Q_OBJECT
+public:
+    explicit GrepFileIndex(QObject* parent = nullptr);
+    ~GrepFileIndex() override;
+
+    /**
+     * @return The files of @p project sorted by path, empty if the project is not known.
+     * @note Thread safe.
+     */
+    QVector<QString> files(KDevelop::IProject* project) const;
+
+    /**
+     * @return The files of @p project sorted by path, collected from scratch
+     */
+    static QVector<QString> projectFiles(KDevelop::IProject* project);
+
+private:
+    void addProject(KDevelop::IProject* project);
+    void removeProject(KDevelop::IProject* project);
+    void fileAdded(KDevelop::IProject* project, KDevelop::ProjectFileItem* item);
+    void fileRemoved(KDevelop::IProject* project, KDevelop::ProjectFileItem* item);
+
+    struct ProjectFiles
+    {
+        QVector<QString> sorted;
+        /// changes that are not merged into sorted yet
+        QSet<QString> added;
+        QSet<QString> removed;
+    };
+
+    mutable QMutex m_mutex;
+    mutable QHash<KDevelop::IProject*, ProjectFiles> m_projects;
+};
+
+#endif
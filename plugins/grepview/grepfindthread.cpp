@@ -1,81 +1,123 @@
 #include "grepfindthread.h"
+#include "grepfileindex.h"
 #include "debug.h"
 
 #include <QDir>
-#include <QSet>
+#include <QRegExp>
 
-#include <project/projectmodel.h>
 #include <interfaces/iproject.h>
 #include <interfaces/iprojectcontroller.h>
 #include <interfaces/icore.h>
 
-#include <serialization/indexedstring.h>
+#include <algorithm>
 
-
-using KDevelop::IndexedString;
+namespace {
 
 /**
- * @return Return true in case @p url is in @p dir within a maximum depth of @p maxDepth
+ * Matches names against a list of wildcard patterns like QDir::match(), but compiles the patterns once.
+ *
+ * Patterns like "*.cpp" and "*foo*" are checked as plain suffix and substring comparisons,
+ * everything else with a QRegExp.
  */
-static bool isInDirectory(const QUrl& url, const QUrl& dir, int maxDepth)
+class GlobMatcher
 {
-    QUrl folderUrl = url.adjusted(QUrl::RemoveFilename);
+public:
+    explicit GlobMatcher(const QStringList& patterns)
+    {
+        foreach(const QString& pattern, patterns)
+        {
+            if(pattern.startsWith(QLatin1Char('*')) && !hasWildcard(pattern.midRef(1)))
+                m_suffixes << pattern.mid(1);
+            else if(pattern.size() > 1 && pattern.startsWith(QLatin1Char('*')) && pattern.endsWith(QLatin1Char('*'))
+                    && !hasWildcard(pattern.midRef(1, pattern.size() - 2)))
+                m_substrings << pattern.mid(1, pattern.size() - 2);
+            else
+                m_regExps << QRegExp(pattern, Qt::CaseInsensitive, QRegExp::Wildcard);
+        }
+    }
 
-    int currentLevel = maxDepth;
-    while(currentLevel > 0) {
-        folderUrl = folderUrl.adjusted(QUrl::RemoveFilename | QUrl::StripTrailingSlash);
-        if ( folderUrl == dir.adjusted(QUrl::StripTrailingSlash) ) {
-            return true;
+    bool matches(const QString& name) const
+    {
+        foreach(const QString& suffix, m_suffixes)
+        {
+            if(name.endsWith(suffix, Qt::CaseInsensitive))
+                return true;
         }
-        currentLevel--;
+        foreach(const QString& substring, m_substrings)
+        {
+            if(name.contains(substring, Qt::CaseInsensitive))
+                return true;
+        }
+        foreach(const QRegExp& regExp, m_regExps)
+        {
+            if(regExp.exactMatch(name))
+                return true;
+        }
+        return false;
+    }
+
+private:
+    static bool hasWildcard(const QStringRef& pattern)
+    {
+        return pattern.contains(QLatin1Char('*')) || pattern.contains(QLatin1Char('?')) || pattern.contains(QLatin1Char('['));
     }
-    return false;
+
+    QStringList m_suffixes;
+    QStringList m_substrings;
+    QList<QRegExp> m_regExps;
+};
+
 }
 
 // the abort parameter must be volatile so that it
 // is evaluated every time - optimization might prevent that
 
-static QList<QUrl> thread_getProjectFiles(const QUrl dir, int depth, const QStringList include,
-                                         const QStringList exlude, volatile bool &abort)
+/**
+ * @param files all files of the project, sorted by path
+ */
+static QList<QUrl> thread_getProjectFiles(const QVector<QString>& files, const QUrl& dir, int depth,
+                                          const GlobMatcher& include, const GlobMatcher& exclude,
+                                          volatile bool &abort)
 {
-    ///@todo This is not thread-safe!
-    KDevelop::IProject *project = KDevelop::ICore::self()->projectController()->findProjectForUrl( dir );
     QList<QUrl> res;
-    if(!project)
-        return res;
+    const QString dirPath = dir.adjusted(QUrl::StripTrailingSlash).toLocalFile();
 
-    const QSet<IndexedString> fileSet = project->fileSet();
-    foreach( const IndexedString &item, fileSet )
+    auto accept = [&](const QString& file) {
+        const QString fileName = file.mid(file.lastIndexOf(QLatin1Char('/')) + 1);
+        if( include.matches(fileName) && !exclude.matches(file) )
+            res << QUrl::fromLocalFile(file);
+    };
+
+    // dir may be a file of the project itself
+    if(std::binary_search(files.begin(), files.end(), dirPath))
+        accept(dirPath);
+
+    // the files in dir are a contiguous range of the sorted list
+    const QString prefix = dirPath + QLatin1Char('/');
+    for(auto it = std::lower_bound(files.begin(), files.end(), prefix); it != files.end(); ++it)
     {
         if(abort)
             break;
-        QUrl url = item.toUrl();
-        if( url != dir )
-        {
-            if ( depth == 0 ) {
-                if ( url.adjusted(QUrl::RemoveFilename | QUrl::StripTrailingSlash) != dir.adjusted(QUrl::StripTrailingSlash) ) {
-                    continue;
-                }
-            } else if ( !dir.isParentOf(url) ) {
+        const QString& file = *it;
+        if(!file.startsWith(prefix))
+            break;
+
+        if ( depth >= 0 ) {
+            // Number of folders between dir and the file. Depth 0 and 1 allow files directly in dir,
+            // any greater depth allows depth - 1 levels of folders below dir.
+            const int levels = file.midRef(prefix.size()).count(QLatin1Char('/'));
+            if ( levels > qMax(0, depth - 1) ) {
                 continue;
-            } else if ( depth > 0 ) {
-                // To ensure the current file is within the defined depth limit, navigate up the tree for as many levels
-                // as the depth value, trying to find "dir", which is the project folder. If after all the loops there
-                // is no match, it means the current file is deeper down the project tree than the limit depth, and so
-                // it must be skipped.
-                if(!isInDirectory(url, dir, depth))
-                    continue;
             }
         }
-        if( QDir::match(include, url.fileName()) && !QDir::match(exlude, url.toLocalFile()) )
-            res << url;
+        accept(file);
     }
 
     return res;
 }
 
 static QList<QUrl> thread_findFiles(const QDir& dir, int depth, const QStringList& include,
-                                   const QStringList& exclude, volatile bool &abort)
+                                   const GlobMatcher& exclude, volatile bool &abort)
 {
     QFileInfoList infos = dir.entryInfoList(include, QDir::NoDotAndDotDot|QDir::Files|QDir::Readable);
 
@@ -86,7 +128,7 @@ static QList<QUrl> thread_findFiles(const QDir& dir, int depth, const QStringLis
     foreach(const QFileInfo &currFile, infos)
     {
         QString currName = currFile.canonicalFilePath();
-        if(!QDir::match(exclude, currName))
+        if(!exclude.matches(currName))
             dirFiles << QUrl::fromLocalFile(currName);
     }
     if(depth != 0)
@@ -114,7 +156,8 @@ GrepFindFilesThread::GrepFindFilesThread(QObject* parent,
                                          const QList<QUrl>& startDirs,
                                          int depth, const QString& pats,
                                          const QString& excl,
-                                         bool onlyProject)
+                                         bool onlyProject,
+                                         const GrepFileIndex* fileIndex)
 : QThread(parent)
 , m_startDirs(startDirs)
 , m_patString(pats)
@@ -124,6 +167,21 @@ GrepFindFilesThread::GrepFindFilesThread(QObject* parent,
 , m_tryAbort(false)
 {
     setTerminationEnabled(false);
+
+    if(m_project)
+    {
+        // the project controller can only be used from the main thread
+        foreach(const QUrl& directory, m_startDirs)
+        {
+            KDevelop::IProject *project = KDevelop::ICore::self()->projectController()->findProjectForUrl( directory );
+            if(!project)
+                m_projectFiles << QVector<QString>();
+            else if(fileIndex)
+                m_projectFiles << fileIndex->files(project);
+            else
+                m_projectFiles << GrepFileIndex::projectFiles(project);
+        }
+    }
 }
 
 void GrepFindFilesThread::tryAbort()
@@ -139,14 +197,16 @@ bool GrepFindFilesThread::triesToAbort() const
 void GrepFindFilesThread::run()
 {
     QStringList include = GrepFindFilesThread::parseInclude(m_patString);
-    QStringList exclude = GrepFindFilesThread::parseExclude(m_exclString);
+    const GlobMatcher includeMatcher(include);
+    const GlobMatcher exclude(GrepFindFilesThread::parseExclude(m_exclString));
 
     qCDebug(PLUGIN_GREPVIEW) << "running with start dir" << m_startDirs;
 
-    foreach(const QUrl& directory, m_startDirs)
+    for(int i = 0; i < m_startDirs.size(); ++i)
     {
+        const QUrl& directory = m_startDirs[i];
         if(m_project)
-            m_files += thread_getProjectFiles(directory, m_depth, include, exclude, m_tryAbort);
+            m_files += thread_getProjectFiles(m_projectFiles[i], directory, m_depth, includeMatcher, exclude, m_tryAbort);
         else
         {
             m_files += thread_findFiles(directory.toLocalFile(), m_depth, include, exclude, m_tryAbort);
@@ -155,8 +215,11 @@ void GrepFindFilesThread::run()
 }
 
 QList<QUrl> GrepFindFilesThread::files() const {
-    auto tmpList = QList<QUrl>::fromSet(m_files.toSet());
-    std::sort(tmpList.begin(), tmpList.end());
+    auto tmpList = m_files;
+    // the files of a single project folder are sorted already
+    if(!std::is_sorted(tmpList.begin(), tmpList.end()))
+        std::sort(tmpList.begin(), tmpList.end());
+    tmpList.erase(std::unique(tmpList.begin(), tmpList.end()), tmpList.end());
     return tmpList;
 }
 
@@ -3,6 +3,9 @@
 
 #include <QThread>
 #include <QUrl>
+#include <QVector>
+
+class GrepFileIndex;
 
 class GrepFindFilesThread : public QThread
 {
@@ -17,10 +20,11 @@ public:
      * @param[in] patterns Space-separated list of wildcard patterns to search for
      * @param[in] exclusions Space-separated list of wildcard patterns to exclude. Matches the whole path.
      * @param[in] onlyProject Whether the search should only consider project files.
+     * @param[in] fileIndex Index of the project files, if not given the files of the projects are collected.
      */
     GrepFindFilesThread(QObject *parent, const QList<QUrl> &startDirs, int depth,
                     const QString &patterns, const QString &exclusions,
-                    bool onlyProject);
+                    bool onlyProject, const GrepFileIndex *fileIndex = nullptr);
     /**
      * @brief Returns the list of found files
      * @return List of found files
@@ -56,6 +60,8 @@ private:
     QString m_exclString;
     int m_depth;
     bool m_project;
+    /// For project searches, the sorted files of the project of each start directory
+    QList<QVector<QString>> m_projectFiles;
     QList<QUrl> m_files;
     volatile bool m_tryAbort;
     // creating with no parameters would be bad
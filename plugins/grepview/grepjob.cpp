@@ -15,13 +15,18 @@
 ***************************************************************************/
 
 #include "grepjob.h"
+#include "grepfileindex.h"
 #include "grepoutputmodel.h"
 #include "greputil.h"
 
 #include <QFile>
 #include <QList>
 #include <QRegExp>
-#include <QTextStream>
+#include <QTextCodec>
+#include <QThread>
+#include <QtConcurrentRun>
+
+#include <cstring>
 
 #include <KEncodingProber>
 #include <KLocalizedString>
@@ -33,7 +38,27 @@
 using namespace KDevelop;
 
 
-GrepOutputItem::List grepFile(const QString &filename, const QRegExp &re)
+namespace {
+
+/// Number of files that are searched in one go by a thread of the pool
+const int GREP_CHUNK_SIZE = 64;
+
+/// Results of a chunk of files, one list per file
+typedef QVector<GrepOutputItem::List> ChunkMatches;
+
+ChunkMatches grepFiles(const QList<QUrl>& files, const QRegExp& re, const GrepPrefilter& prefilter)
+{
+    ChunkMatches matches;
+    matches.reserve(files.size());
+    foreach(const QUrl& file, files) {
+        matches << grepFile(file.toLocalFile(), re, prefilter);
+    }
+    return matches;
+}
+
+}
+
+GrepOutputItem::List grepFile(const QString &filename, const QRegExp &re, const GrepPrefilter &prefilter)
 {
     GrepOutputItem::List res;
     QFile file(filename);
@@ -42,26 +67,59 @@ GrepOutputItem::List grepFile(const QString &filename, const QRegExp &re)
         return res;
     int lineno = 0;
 
+    // map the file, most files do not contain the literal and are never decoded
+    qint64 size = file.size();
+    const char* contents = size > 0 ? reinterpret_cast<const char*>(file.map(0, size)) : nullptr;
+    QByteArray buffer;
+    if(!contents) {
+        // e.g. files that do not know their size
+        buffer = file.readAll();
+        contents = buffer.constData();
+        size = buffer.size();
+    }
+
+    // Without the literal in the raw contents, only encodings that do not store ASCII as single bytes can
+    // still contain a match, and those (UTF-16, UTF-32) always have NUL bytes in text.
+    const bool mayMatch = prefilter.mayMatch(contents, size);
+    if(!mayMatch && !std::memchr(contents, 0, size))
+        return res;
 
     // detect encoding (unicode files can be feed forever, stops when confidence reachs 99%
     KEncodingProber prober;
-    while(!file.atEnd() && prober.state() == KEncodingProber::Probing && prober.confidence() < 0.99) {
-        prober.feed(file.read(0xFF));
+    for(qint64 pos = 0; pos < size && prober.state() == KEncodingProber::Probing && prober.confidence() < 0.99; pos += 0xFF) {
+        prober.feed(contents + pos, qMin<qint64>(0xFF, size - pos));
     }
 
-    // reads file with detected encoding
-    file.seek(0);
-    QTextStream stream(&file);
+    QTextCodec* codec = nullptr;
     if(prober.confidence()>0.7)
-        stream.setCodec(prober.encoding());
-    while( !stream.atEnd() )
+        codec = QTextCodec::codecForName(prober.encoding());
+    if(!codec)
+        codec = QTextCodec::codecForLocale();
+    // like QTextStream, prefer what a byte order mark says
+    codec = QTextCodec::codecForUtfText(QByteArray::fromRawData(contents, qMin<qint64>(4, size)), codec);
+
+    if(!mayMatch && prefilter.isCompatible(codec))
+        return res;
+
+    // reads file with detected encoding
+    const QString text = codec->toUnicode(contents, size);
+    for(int lineStart = 0; lineStart < text.size(); )
     {
-        QString data = stream.readLine();
+        int lineEnd = text.indexOf(QLatin1Char('\n'), lineStart);
+        if(lineEnd == -1)
+            lineEnd = text.size();
+        const int next = lineEnd + 1;
 
         // remove line terminators (in order to not match them)
-        for(int pos = data.length()-1; pos >= 0 && (data[pos] == '\r' || data[pos] == '\n'); pos--)
+        while(lineEnd > lineStart && text[lineEnd - 1] == QLatin1Char('\r'))
+            --lineEnd;
+        const QString data = text.mid(lineStart, lineEnd - lineStart);
+        lineStart = next;
+
+        if(!prefilter.mayMatch(data))
         {
-            data.chop(1);
+            lineno++;
+            continue;
         }
 
         int offset = 0;
@@ -89,6 +147,7 @@ GrepJob::GrepJob( QObject* parent )
     : KJob( parent )
     , m_workState(WorkIdle)
     , m_fileIndex(0)
+    , m_scheduledFiles(0)
     , m_findSomething(false)
 {
     qRegisterMetaType<GrepOutputItem::List>();
@@ -159,6 +218,7 @@ void GrepJob::slotFindFinished()
         m_regExp.setPatternSyntax(QRegExp::Wildcard);
     }
 
+    m_prefilter = GrepPrefilter(m_regExp);
     m_outputModel->setRegExp(m_regExp);
     m_outputModel->setReplacementTemplate(m_settings.replacementTemplate);
 
@@ -183,7 +243,7 @@ void GrepJob::slotWork()
             QMetaObject::invokeMethod(this, "slotWork", Qt::QueuedConnection);
             break;
         case WorkCollectFiles:
-            m_findThread = new GrepFindFilesThread(this, m_directoryChoice, m_settings.depth, m_settings.files, m_settings.exclude, m_settings.projectFilesOnly);
+            m_findThread = new GrepFindFilesThread(this, m_directoryChoice, m_settings.depth, m_settings.files, m_settings.exclude, m_settings.projectFilesOnly, m_projectFileIndex);
             emit showMessage(this, i18n("Collecting files..."));
             connect(m_findThread.data(), &GrepFindFilesThread::finished, this, &GrepJob::slotFindFinished);
             m_findThread->start();
@@ -192,19 +252,7 @@ void GrepJob::slotWork()
             if(m_fileIndex < m_fileList.length())
             {
                 emit showProgress(this, 0, m_fileList.length(), m_fileIndex);
-                if(m_fileIndex < m_fileList.length()) {
-                    QString file = m_fileList[m_fileIndex].toLocalFile();
-                    GrepOutputItem::List items = grepFile(file, m_regExp);
-
-                    if(!items.isEmpty())
-                    {
-                        m_findSomething = true;
-                        emit foundMatches(file, items);
-                    }
-
-                    m_fileIndex++;
-                }
-                QMetaObject::invokeMethod(this, "slotWork", Qt::QueuedConnection);
+                startChunks();
             }
             else
             {
@@ -224,6 +272,53 @@ void GrepJob::slotWork()
     }
 }
 
+void GrepJob::startChunks()
+{
+    const int maxChunks = 2 * QThread::idealThreadCount();
+    while(m_chunks.size() < maxChunks && m_scheduledFiles < m_fileList.length())
+    {
+        auto* chunk = new QFutureWatcher<ChunkMatches>(this);
+        connect(chunk, &QFutureWatcher<ChunkMatches>::finished, this, &GrepJob::slotChunkFinished);
+        chunk->setFuture(QtConcurrent::run(&grepFiles, m_fileList.mid(m_scheduledFiles, GREP_CHUNK_SIZE),
+                                           m_regExp, m_prefilter));
+        m_chunks << chunk;
+        m_scheduledFiles += GREP_CHUNK_SIZE;
+    }
+}
+
+void GrepJob::slotChunkFinished()
+{
+    if(m_workState != WorkGrep)
+        return;
+
+    // chunks finish in any order, but their results are passed on in the order of the files
+    while(!m_chunks.isEmpty() && m_chunks.first()->isFinished())
+    {
+        QFutureWatcher<ChunkMatches>* chunk = m_chunks.takeFirst();
+        foreach(const GrepOutputItem::List& items, chunk->result())
+        {
+            if(!items.isEmpty())
+            {
+                m_findSomething = true;
+                emit foundMatches(m_fileList[m_fileIndex].toLocalFile(), items);
+            }
+            m_fileIndex++;
+        }
+        chunk->deleteLater();
+    }
+
+    if(m_fileIndex < m_fileList.length())
+    {
+        emit showProgress(this, 0, m_fileList.length(), m_fileIndex);
+        startChunks();
+    }
+    else
+    {
+        // finish after the model received the matches
+        QMetaObject::invokeMethod(this, "slotWork", Qt::QueuedConnection);
+    }
+}
+
 void GrepJob::start()
 {
     if(m_workState!=WorkIdle)
@@ -232,6 +327,7 @@ void GrepJob::start()
     m_fileList.clear();
     m_workState = WorkIdle;
     m_fileIndex = 0;
+    m_scheduledFiles = 0;
 
     m_findSomething = false;
     m_outputModel->clear();
@@ -252,6 +348,13 @@ bool GrepJob::doKill()
     }
     else
     {
+        if(m_workState == WorkGrep)
+        {
+            // the results of the pending chunks are dropped
+            qDeleteAll(m_chunks);
+            m_chunks.clear();
+            QMetaObject::invokeMethod(this, "slotWork", Qt::QueuedConnection);
+        }
         m_workState = WorkCancelled;
     }
     return true;
@@ -275,6 +378,11 @@ void GrepJob::setOutputModel(GrepOutputModel* model)
     m_outputModel = model;
 }
 
+void GrepJob::setFileIndex(GrepFileIndex* index)
+{
+    m_projectFileIndex = index;
+}
+
 void GrepJob::setDirectoryChoice(const QList<QUrl>& choice)
 {
     m_directoryChoice = choice;
@@ -17,7 +17,9 @@
 #define KDEVPLATFORM_PLUGIN_GREPJOB_H
 
 #include <QPointer>
+#include <QFutureWatcher>
 #include <QUrl>
+#include <QVector>
 
 #include <KJob>
 
@@ -25,6 +27,7 @@
 
 #include "grepfindthread.h"
 #include "grepoutputmodel.h"
+#include "grepprefilter.h"
 
 namespace KDevelop
 {
@@ -32,6 +35,7 @@ namespace KDevelop
 }
 
 class QRegExp;
+class GrepFileIndex;
 class GrepViewPlugin;
 class FindReplaceTest; //FIXME: this is useful only for tests
 
@@ -68,6 +72,8 @@ public:
     GrepJobSettings settings() const;
 
     void setOutputModel(GrepOutputModel * model);
+    /// Use @p index for the files of projects instead of collecting them for every search
+    void setFileIndex(GrepFileIndex* index);
     void setDirectoryChoice(const QList<QUrl> &choice);
 
     void start() override;
@@ -80,6 +86,7 @@ protected:
 
 private Q_SLOTS:
     void slotFindFinished();
+    void slotChunkFinished();
     void testFinishState(KJob *job);
 
 Q_SIGNALS:
@@ -92,11 +99,14 @@ Q_SIGNALS:
 
 private:
     Q_INVOKABLE void slotWork();
+    /// Starts searching more files on the thread pool, as long as few enough chunks are pending
+    void startChunks();
 
     QList<QUrl> m_directoryChoice;
     QString m_errorMessage;
 
     QRegExp m_regExp;
+    GrepPrefilter m_prefilter;
     QString m_regExpSimple;
     GrepOutputModel *m_outputModel;
 
@@ -108,8 +118,14 @@ private:
     } m_workState;
 
     QList<QUrl> m_fileList;
+    /// Number of files of which the results were passed on
     int m_fileIndex;
+    /// Number of files that were handed to the thread pool
+    int m_scheduledFiles;
+    /// Chunks of files being searched, in the order of m_fileList
+    QVector<QFutureWatcher<QVector<GrepOutputItem::List>>*> m_chunks;
     QPointer<GrepFindFilesThread> m_findThread;
+    QPointer<GrepFileIndex> m_projectFileIndex;
 
     GrepJobSettings m_settings;
 
@@ -118,6 +134,7 @@ private:
 
 //FIXME: this function is used externally only for tests, find a way to keep it
 //       static for a regular compilation
-GrepOutputItem::List grepFile(const QString &filename, const QRegExp &re);
+GrepOutputItem::List grepFile(const QString &filename, const QRegExp &re,
+                              const GrepPrefilter &prefilter = GrepPrefilter());
 
 #endif
@@ -0,0 +1,271 @@
+/***************************************************************************
+ *   This file is part of KDevelop                                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "grepprefilter.h"
+
+#include <QRegExp>
+#include <QTextCodec>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+inline uchar toLowerAscii(uchar c)
+{
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+/**
+ * Collects runs of characters that have to occur in every match and keeps the longest one.
+ */
+class LiteralCollector
+{
+public:
+    explicit LiteralCollector(Qt::CaseSensitivity cs)
+        : m_caseSensitivity(cs)
+    {
+    }
+
+    void append(QChar ch)
+    {
+        // Only ASCII can be found in the raw bytes of a file. Without case sensitivity, QRegExp compares
+        // lower case characters, and the Kelvin sign and the dotted capital I become an ASCII 'k' and 'i'.
+        if (ch.unicode() >= 0x80 || (m_caseSensitivity == Qt::CaseInsensitive
+                                     && (ch.toLower() == QLatin1Char('i') || ch.toLower() == QLatin1Char('k')))) {
+            end();
+            return;
+        }
+        m_run += ch;
+    }
+
+    void end()
+    {
+        if (m_run.size() > m_best.size()) {
+            m_best = m_run;
+        }
+        m_run.clear();
+    }
+
+    QString result()
+    {
+        end();
+        return m_best;
+    }
+
+private:
+    Qt::CaseSensitivity m_caseSensitivity;
+    QString m_run;
+    QString m_best;
+};
+
+/// Returns the position of the closing bracket of the character class that starts at @p pos
+int skipCharacterClass(const QString& pattern, int pos)
+{
+    ++pos;
+    if (pos < pattern.size() && pattern[pos] == QLatin1Char('^')) {
+        ++pos;
+    }
+    // a closing bracket at the start is part of the class
+    if (pos < pattern.size() && pattern[pos] == QLatin1Char(']')) {
+        ++pos;
+    }
+    for (; pos < pattern.size() && pattern[pos] != QLatin1Char(']'); ++pos) {
+        if (pattern[pos] == QLatin1Char('\\')) {
+            ++pos;
+        }
+    }
+    return pos;
+}
+
+/**
+ * Finds the longest literal in the top level of a QRegExp::RegExp(2) pattern, ignoring everything in groups.
+ */
+QString regExpLiteral(const QString& pattern, Qt::CaseSensitivity cs)
+{
+    LiteralCollector literal(cs);
+
+    // adds a literal character, unless a quantifier makes it optional
+    auto appendAtom = [&](QChar ch, int next) {
+        const QChar quantifier = next < pattern.size() ? pattern[next] : QChar();
+        if (quantifier == QLatin1Char('?') || quantifier == QLatin1Char('*') || quantifier == QLatin1Char('{')) {
+            literal.end();
+        } else if (quantifier == QLatin1Char('+')) {
+            literal.append(ch);
+            literal.end();
+        } else {
+            literal.append(ch);
+        }
+    };
+
+    int depth = 0;
+    for (int pos = 0; pos < pattern.size(); ++pos) {
+        const QChar ch = pattern[pos];
+        if (ch == QLatin1Char('\\')) {
+            ++pos;
+            if (pos == pattern.size()) {
+                break;
+            }
+            const QChar escaped = pattern[pos];
+            if (depth == 0) {
+                if (escaped.isLetterOrNumber()) {
+                    // character classes, assertions, back references and control characters
+                    literal.end();
+                } else {
+                    appendAtom(escaped, pos + 1);
+                }
+            }
+        } else if (ch == QLatin1Char('[')) {
+            pos = skipCharacterClass(pattern, pos);
+            literal.end();
+        } else if (ch == QLatin1Char('(')) {
+            ++depth;
+            literal.end();
+        } else if (ch == QLatin1Char(')')) {
+            depth = qMax(0, depth - 1);
+        } else if (depth > 0) {
+            continue;
+        } else if (ch == QLatin1Char('|')) {
+            // each alternative can match on its own
+            return QString();
+        } else if (ch == QLatin1Char('{')) {
+            const int end = pattern.indexOf(QLatin1Char('}'), pos);
+            pos = end == -1 ? pattern.size() : end;
+            literal.end();
+        } else if (ch == QLatin1Char('.') || ch == QLatin1Char('^') || ch == QLatin1Char('$')
+                   || ch == QLatin1Char('*') || ch == QLatin1Char('+') || ch == QLatin1Char('?')) {
+            literal.end();
+        } else {
+            appendAtom(ch, pos + 1);
+        }
+    }
+    return literal.result();
+}
+
+/**
+ * Finds the longest literal in a QRegExp::Wildcard(Unix) pattern
+ */
+QString wildcardLiteral(const QString& pattern, Qt::CaseSensitivity cs)
+{
+    LiteralCollector literal(cs);
+    for (int pos = 0; pos < pattern.size(); ++pos) {
+        const QChar ch = pattern[pos];
+        if (ch == QLatin1Char('[')) {
+            pos = skipCharacterClass(pattern, pos);
+            literal.end();
+        } else if (ch == QLatin1Char('*') || ch == QLatin1Char('?') || ch == QLatin1Char('\\')) {
+            literal.end();
+        } else {
+            literal.append(ch);
+        }
+    }
+    return literal.result();
+}
+
+}
+
+GrepPrefilter::GrepPrefilter()
+    : m_caseSensitivity(Qt::CaseSensitive)
+{
+}
+
+GrepPrefilter::GrepPrefilter(const QRegExp& re)
+    : m_caseSensitivity(re.caseSensitivity())
+{
+    switch (re.patternSyntax()) {
+        case QRegExp::RegExp:
+        case QRegExp::RegExp2:
+            m_literal = regExpLiteral(re.pattern(), m_caseSensitivity);
+            break;
+        case QRegExp::Wildcard:
+        case QRegExp::WildcardUnix:
+            m_literal = wildcardLiteral(re.pattern(), m_caseSensitivity);
+            break;
+        case QRegExp::FixedString: {
+            LiteralCollector literal(m_caseSensitivity);
+            for (const QChar ch : re.pattern()) {
+                literal.append(ch);
+            }
+            m_literal = literal.result();
+            break;
+        }
+        case QRegExp::W3CXmlSchema11:
+            break;
+    }
+
+    m_bytes = m_literal.toLatin1();
+    if (m_caseSensitivity == Qt::CaseInsensitive) {
+        m_bytes = m_bytes.toLower();
+    }
+
+    // Boyer-Moore-Horspool shifts, for both cases of a letter if the case does not matter
+    const int last = m_bytes.size() - 1;
+    std::fill(m_shift, m_shift + 256, qMax(1, m_bytes.size()));
+    for (int i = 0; i < last; ++i) {
+        const uchar c = m_bytes[i];
+        m_shift[c] = last - i;
+        if (m_caseSensitivity == Qt::CaseInsensitive && c >= 'a' && c <= 'z') {
+            m_shift[c - ('a' - 'A')] = last - i;
+        }
+    }
+}
+
+QString GrepPrefilter::literal() const
+{
+    return m_literal;
+}
+
+bool GrepPrefilter::mayMatch(const char* data, qint64 size) const
+{
+    const int length = m_bytes.size();
+    if (length == 0) {
+        return true;
+    }
+
+    const uchar* text = reinterpret_cast<const uchar*>(data);
+    const uchar* literal = reinterpret_cast<const uchar*>(m_bytes.constData());
+    const int last = length - 1;
+    const bool caseSensitive = m_caseSensitivity == Qt::CaseSensitive;
+
+    for (qint64 pos = 0; pos + last < size; pos += m_shift[text[pos + last]]) {
+        if (caseSensitive) {
+            if (text[pos + last] == literal[last] && std::memcmp(text + pos, literal, last) == 0) {
+                return true;
+            }
+            continue;
+        }
+
+        int i = last;
+        while (i >= 0 && toLowerAscii(text[pos + i]) == literal[i]) {
+            --i;
+        }
+        if (i < 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool GrepPrefilter::mayMatch(const QString& line) const
+{
+    return m_literal.isEmpty() || line.contains(m_literal, m_caseSensitivity);
+}
+
+bool GrepPrefilter::isCompatible(QTextCodec* codec) const
+{
+    if (m_literal.isEmpty()) {
+        return true;
+    }
+    if (m_caseSensitivity == Qt::CaseSensitive) {
+        return codec->fromUnicode(m_literal) == m_bytes;
+    }
+    return codec->fromUnicode(m_literal.toLower()) == m_bytes
+        && codec->fromUnicode(m_literal.toUpper()) == m_bytes.toUpper();
+}
@@ -0,0 +1,58 @@
+/***************************************************************************
+ *   This file is part of KDevelop                                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef KDEVPLATFORM_PLUGIN_GREPPREFILTER_H
+#define KDEVPLATFORM_PLUGIN_GREPPREFILTER_H
+
+#include <QByteArray>
+#include <QString>
+
+class QRegExp;
+class QTextCodec;
+
+/**
+ * Cheap test whether a file or line can contain a match of a regular expression.
+ *
+ * The prefilter looks for the longest piece of plain ASCII text that every match of the expression contains.
+ * Files that do not contain it in their raw bytes never need to be decoded, and lines that do not contain it
+ * never need to be matched against the expression.
+ */
+class GrepPrefilter
+{
+public:
+    /// A prefilter that lets everything pass
+    GrepPrefilter();
+    explicit GrepPrefilter(const QRegExp& re);
+
+    /// The text that every match contains, empty if none was found
+    QString literal() const;
+
+    /**
+     * @return false if @p data, in an encoding that is compatible with ASCII (see isCompatible()),
+     *         cannot contain a match
+     */
+    bool mayMatch(const char* data, qint64 size) const;
+
+    /// @return false if @p line cannot contain a match
+    bool mayMatch(const QString& line) const;
+
+    /// @return whether @p codec encodes the literal just like ASCII, so mayMatch() can be used on raw data
+    bool isCompatible(QTextCodec* codec) const;
+
+private:
+    QString m_literal;
+    Qt::CaseSensitivity m_caseSensitivity;
+    /// The literal as ASCII, lower case if the search is case insensitive
+    QByteArray m_bytes;
+    /// How far the search can move on when a byte is found at the last position of the literal
+    int m_shift[256];
+};
+
+#endif
@@ -13,6 +13,7 @@
 
 #include "grepviewplugin.h"
 #include "grepdialog.h"
+#include "grepfileindex.h"
 #include "grepoutputmodel.h"
 #include "grepoutputdelegate.h"
 #include "grepjob.h"
@@ -93,6 +94,8 @@ GrepViewPlugin::GrepViewPlugin( QObject *parent, const QVariantList & )
     new GrepOutputDelegate(this);
     m_factory = new GrepOutputViewFactory(this);
     core()->uiController()->addToolView(i18n("Find/Replace in Files"), m_factory);
+
+    m_fileIndex = new GrepFileIndex(this);
 }
 
 GrepOutputViewFactory* GrepViewPlugin::toolViewFactory() const
@@ -224,6 +227,7 @@ GrepJob* GrepViewPlugin::newGrepJob()
         m_currentJob->kill();
     }
     m_currentJob = new GrepJob();
+    m_currentJob->setFileIndex(m_fileIndex);
     connect(m_currentJob, &GrepJob::finished, this, &GrepViewPlugin::jobFinished);
     return m_currentJob;
 }
@@ -22,6 +22,7 @@
 
 class KJob;
 class GrepDialog;
+class GrepFileIndex;
 class GrepJob;
 class GrepOutputViewFactory;
 
@@ -68,6 +69,7 @@ private:
     QString m_directory;
     QString m_contextMenuDirectory;
     GrepOutputViewFactory* m_factory;
+    GrepFileIndex* m_fileIndex;
 };
 
 #endif
@@ -24,11 +24,9 @@
 
 
 // This file only exists so that the tests can be built:
-// test_grepview builds grepview.cpp again but in a different directory.
-// This means that the kdevgrepview.json file is no longer found.
-// Since the JSON metadata is not needed in the test, we simply move
-// the K_PLUGIN_FACTORY_WITH_JSON to a separate file.
-// TODO: use object or static library?
+// the rest of the plugin is a static library that the tests link to,
+// and they do not need the JSON metadata, so the
+// K_PLUGIN_FACTORY_WITH_JSON lives in this separate file.
 
 K_PLUGIN_FACTORY_WITH_JSON(KDevGrepviewFactory, "kdevgrepview.json", registerPlugin<GrepViewPlugin>();)
 
@@ -0,0 +1,147 @@
+/***************************************************************************
+ *   This file is part of KDevelop                                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "bench_grep.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QRegExp>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QTextStream>
+
+#include <tests/testcore.h>
+#include <tests/autotestshell.h>
+
+#include "../grepjob.h"
+#include "../grepoutputmodel.h"
+#include "../grepprefilter.h"
+
+namespace {
+
+const int CORPUS_DIRECTORIES = 50;
+const int FILES_PER_DIRECTORY = 40;
+const int LINES_PER_FILE = 300;
+
+/**
+ * Writes a source tree that resembles a C++ code base to @p path. Only every 100th file
+ * contains "rareIdentifier", while "return" is in every file.
+ */
+void writeCorpus(const QString& path)
+{
+    QDir root(path);
+    int fileNumber = 0;
+    for (int dir = 0; dir < CORPUS_DIRECTORIES; ++dir) {
+        const QString dirName = QStringLiteral("module%1").arg(dir);
+        root.mkdir(dirName);
+        for (int i = 0; i < FILES_PER_DIRECTORY; ++i, ++fileNumber) {
+            QFile file(root.filePath(QStringLiteral("%1/file%2.cpp").arg(dirName).arg(i)));
+            QVERIFY(file.open(QIODevice::WriteOnly));
+            QTextStream stream(&file);
+            stream << "#include \"file" << i << ".h\"\n\nnamespace Module" << dir << " {\n\n";
+            for (int line = 0; line < LINES_PER_FILE; line += 6) {
+                stream << "int Class" << i << "::function" << line << "(int argument) const\n{\n"
+                       << "    const int value = m_member" << line << " * argument;\n"
+                       << "    return value + " << line << ";\n}\n\n";
+            }
+            if (fileNumber % 100 == 0) {
+                stream << "static void rareIdentifier() {}\n";
+            }
+            stream << "}\n";
+        }
+    }
+}
+
+}
+
+BenchGrep::BenchGrep() = default;
+
+BenchGrep::~BenchGrep() = default;
+
+void BenchGrep::initTestCase()
+{
+    KDevelop::AutoTestShell::init();
+    KDevelop::TestCore::initialize(KDevelop::Core::NoUi);
+
+    m_corpus.reset(new QTemporaryDir);
+    QVERIFY(m_corpus->isValid());
+    writeCorpus(m_corpus->path());
+}
+
+void BenchGrep::cleanupTestCase()
+{
+    m_corpus.reset();
+    KDevelop::TestCore::shutdown();
+}
+
+void BenchGrep::benchGrepFile_data()
+{
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<bool>("usePrefilter");
+
+    QTest::newRow("rare") << "rareIdentifier" << false;
+    QTest::newRow("rare-prefiltered") << "rareIdentifier" << true;
+    QTest::newRow("common") << "return" << false;
+    QTest::newRow("common-prefiltered") << "return" << true;
+    QTest::newRow("regexp-prefiltered") << "m_member[0-9]+ \\* arg" << true;
+}
+
+void BenchGrep::benchGrepFile()
+{
+    QFETCH(QString, pattern);
+    QFETCH(bool, usePrefilter);
+
+    QStringList files;
+    QDirIterator it(m_corpus->path(), QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        files << it.next();
+    }
+
+    const QRegExp re(pattern, Qt::CaseSensitive, QRegExp::RegExp2);
+    const GrepPrefilter prefilter = usePrefilter ? GrepPrefilter(re) : GrepPrefilter();
+
+    QBENCHMARK {
+        int matches = 0;
+        foreach (const QString& file, files) {
+            matches += grepFile(file, re, prefilter).size();
+        }
+        QVERIFY(matches > 0);
+    }
+}
+
+void BenchGrep::benchGrepJob_data()
+{
+    QTest::addColumn<QString>("pattern");
+
+    QTest::newRow("rare") << "rareIdentifier";
+    QTest::newRow("common") << "return";
+}
+
+void BenchGrep::benchGrepJob()
+{
+    QFETCH(QString, pattern);
+
+    GrepJobSettings settings;
+    settings.pattern = pattern;
+    settings.searchTemplate = QStringLiteral("%s");
+    settings.files = QStringLiteral("*");
+
+    QBENCHMARK {
+        auto* job = new GrepJob(this);
+        GrepOutputModel model;
+        job->setOutputModel(&model);
+        job->setDirectoryChoice({QUrl::fromLocalFile(m_corpus->path())});
+        job->setSettings(settings);
+        QVERIFY(job->exec());
+        QVERIFY(model.hasResults());
+    }
+}
+
+QTEST_MAIN(BenchGrep)
@@ -0,0 +1,39 @@
+/***************************************************************************
+ *   This file is part of KDevelop                                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef KDEVPLATFORM_PLUGIN_BENCH_GREP_H
+#define KDEVPLATFORM_PLUGIN_BENCH_GREP_H
+
+#include <QObject>
+#include <QScopedPointer>
+
+class QTemporaryDir;
+
+class BenchGrep : public QObject
+{
+    Q_OBJECT
+public:
+    BenchGrep();
+    ~BenchGrep() override;
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void benchGrepFile();
+    void benchGrepFile_data();
+    void benchGrepJob();
+    void benchGrepJob_data();
+
+private:
+    QScopedPointer<QTemporaryDir> m_corpus;
+};
+
+#endif
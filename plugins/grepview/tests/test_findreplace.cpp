@@ -23,6 +23,7 @@
 #include "../grepjob.h"
 #include "../grepviewplugin.h"
 #include "../grepoutputmodel.h"
+#include "../grepprefilter.h"
 
 void FindReplaceTest::initTestCase()
 {
@@ -64,6 +65,12 @@ void FindReplaceTest::testFind_data()
                            << (MatchList() << Match(0, 0, 6));
     QTest::newRow("Matching empty string anywhere") << "foobar\n" << QRegExp("")
                            << (MatchList());
+    QTest::newRow("Case insensitive") << "foobar\nbar\nFOO FoO" << QRegExp("foo", Qt::CaseInsensitive)
+                           << (MatchList() << Match(0, 0, 3) << Match(2, 0, 3) << Match(2, 4, 7));
+    QTest::newRow("Optional literal") << "foobar\nfobar" << QRegExp("foo?bar")
+                           << (MatchList() << Match(0, 0, 6) << Match(1, 0, 5));
+    QTest::newRow("Alternatives") << "foo\nbar" << QRegExp("foo|bar")
+                           << (MatchList() << Match(0, 0, 3) << Match(1, 0, 3));
 }
 
 void FindReplaceTest::testFind()
@@ -77,15 +84,19 @@ void FindReplaceTest::testFind()
     file.write(subject.toUtf8());
     file.close();
 
-    GrepOutputItem::List actualMatches = grepFile(file.fileName(), search);
+    // the prefilter must not change the results
+    foreach(const GrepPrefilter& prefilter, QList<GrepPrefilter>() << GrepPrefilter() << GrepPrefilter(search))
+    {
+        GrepOutputItem::List actualMatches = grepFile(file.fileName(), search, prefilter);
 
-    QCOMPARE(actualMatches.length(), matches.length());
+        QCOMPARE(actualMatches.length(), matches.length());
 
-    for(int i=0; i<matches.length(); i++)
-    {
-        QCOMPARE(actualMatches[i].change()->m_range.start().line(),   matches[i].line);
-        QCOMPARE(actualMatches[i].change()->m_range.start().column(), matches[i].start);
-        QCOMPARE(actualMatches[i].change()->m_range.end().column(),   matches[i].end);
+        for(int i=0; i<matches.length(); i++)
+        {
+            QCOMPARE(actualMatches[i].change()->m_range.start().line(),   matches[i].line);
+            QCOMPARE(actualMatches[i].change()->m_range.start().column(), matches[i].start);
+            QCOMPARE(actualMatches[i].change()->m_range.end().column(),   matches[i].end);
+        }
     }
 
     // check that file has not been altered by grepFile
@@ -93,6 +104,37 @@ void FindReplaceTest::testFind()
     QCOMPARE(QString(file.readAll()), subject);
 }
 
+void FindReplaceTest::testPrefilter_data()
+{
+    QTest::addColumn<QRegExp>("search");
+    QTest::addColumn<QString>("literal");
+
+    QTest::newRow("Plain") << QRegExp("foobar") << "foobar";
+    QTest::newRow("Escaped") << QRegExp("foo\\.bar\\(") << "foo.bar(";
+    QTest::newRow("Longest") << QRegExp("ab.foobar[a-z]+x") << "foobar";
+    QTest::newRow("Optional") << QRegExp("foobarx?yz") << "foobar";
+    QTest::newRow("Repeated") << QRegExp("abc+d") << "abc";
+    QTest::newRow("Template") << QRegExp("\\->\\s*\\bsetFoo\\b\\s*\\(") << "setFoo";
+    QTest::newRow("Groups") << QRegExp("(abcdef)?xy") << "xy";
+    QTest::newRow("Alternatives") << QRegExp("foo|bar") << "";
+    QTest::newRow("Wildcard") << QRegExp("foo", Qt::CaseSensitive, QRegExp::Wildcard) << "foo";
+    QTest::newRow("Case insensitive") << QRegExp("linking.Foo", Qt::CaseInsensitive) << "Foo";
+    QTest::newRow("Non-ASCII") << QRegExp(QStringLiteral("f\u00e4higkeit")) << "higkeit";
+}
+
+void FindReplaceTest::testPrefilter()
+{
+    QFETCH(QRegExp, search);
+    QFETCH(QString, literal);
+
+    const GrepPrefilter prefilter(search);
+    QCOMPARE(prefilter.literal(), literal);
+
+    const QByteArray text = "some text with " + literal.toUpper().toLatin1() + " in upper case";
+    QCOMPARE(prefilter.mayMatch(text.constData(), text.size()),
+             literal.isEmpty() || search.caseSensitivity() == Qt::CaseInsensitive);
+    QVERIFY(prefilter.mayMatch(literal.toLatin1().constData(), literal.size()));
+}
 
 void FindReplaceTest::testReplace_data()
 {
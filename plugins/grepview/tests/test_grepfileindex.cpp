@@ -0,0 +1,194 @@
+/***************************************************************************
+ *   This file is part of KDevelop                                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "test_grepfileindex.h"
+
+#include <QTest>
+
+#include <tests/autotestshell.h>
+#include <tests/testcore.h>
+#include <tests/testproject.h>
+#include <project/projectmodel.h>
+
+#include "../grepfileindex.h"
+#include "../grepfindthread.h"
+
+QTEST_MAIN(TestGrepFileIndex)
+
+using namespace KDevelop;
+
+namespace {
+
+const QString root = QStringLiteral("/tmp/kdev-grepfileindex");
+
+QString file(const QString& relativePath)
+{
+    return root + QLatin1Char('/') + relativePath;
+}
+
+QStringList files(const QStringList& relativePaths)
+{
+    QStringList ret;
+    foreach(const QString& relativePath, relativePaths) {
+        ret << file(relativePath);
+    }
+    return ret;
+}
+
+QStringList toStringList(const QVector<QString>& files)
+{
+    QStringList ret;
+    foreach(const QString& file, files) {
+        ret << file;
+    }
+    return ret;
+}
+
+}
+
+void TestGrepFileIndex::initTestCase()
+{
+    AutoTestShell::init();
+    TestCore* core = new TestCore;
+    TestCore::initialize(Core::NoUi);
+    m_projectController = new TestProjectController(core);
+    delete core->projectController();
+    core->setProjectController(m_projectController);
+}
+
+void TestGrepFileIndex::cleanupTestCase()
+{
+    TestCore::shutdown();
+}
+
+void TestGrepFileIndex::init()
+{
+    // "src.old" and "src-x" sort before "src/", "srcx.cpp" after it
+    m_project = new TestProject(Path(root));
+    ProjectFolderItem* top = m_project->projectItem();
+    new ProjectFileItem(QStringLiteral("b.cpp"), top);
+    new ProjectFileItem(QStringLiteral("srcx.cpp"), top);
+    ProjectFolderItem* old = new ProjectFolderItem(QStringLiteral("src.old"), top);
+    new ProjectFileItem(QStringLiteral("a.cpp"), old);
+    ProjectFolderItem* dashed = new ProjectFolderItem(QStringLiteral("src-x"), top);
+    new ProjectFileItem(QStringLiteral("a.cpp"), dashed);
+    ProjectFolderItem* src = new ProjectFolderItem(QStringLiteral("src"), top);
+    new ProjectFileItem(QStringLiteral("a.cpp"), src);
+    ProjectFolderItem* sub = new ProjectFolderItem(QStringLiteral("sub"), src);
+    new ProjectFileItem(QStringLiteral("c.h"), sub);
+    ProjectFolderItem* deeper = new ProjectFolderItem(QStringLiteral("deeper"), sub);
+    new ProjectFileItem(QStringLiteral("e.cpp"), deeper);
+
+    m_projectController->addProject(m_project);
+}
+
+void TestGrepFileIndex::cleanup()
+{
+    m_projectController->closeAllProjects();
+    m_project = nullptr;
+}
+
+void TestGrepFileIndex::testFiles()
+{
+    GrepFileIndex index;
+
+    const QStringList original = files({
+        QStringLiteral("b.cpp"), QStringLiteral("src-x/a.cpp"), QStringLiteral("src.old/a.cpp"),
+        QStringLiteral("src/a.cpp"), QStringLiteral("src/sub/c.h"), QStringLiteral("src/sub/deeper/e.cpp"),
+        QStringLiteral("srcx.cpp")
+    });
+    QCOMPARE(toStringList(index.files(m_project)), original);
+
+    // changes of the project are merged into the sorted list
+    ProjectFolderItem* src = m_project->projectItem()->folderList().last();
+    QCOMPARE(src->text(), QStringLiteral("src"));
+    ProjectFileItem* added = new ProjectFileItem(QStringLiteral("b.cpp"), src);
+    new ProjectFileItem(QStringLiteral("a.h"), m_project->projectItem());
+    delete m_project->projectItem()->fileList().first();
+
+    const QStringList changed = files({
+        QStringLiteral("a.h"), QStringLiteral("src-x/a.cpp"), QStringLiteral("src.old/a.cpp"),
+        QStringLiteral("src/a.cpp"), QStringLiteral("src/b.cpp"), QStringLiteral("src/sub/c.h"),
+        QStringLiteral("src/sub/deeper/e.cpp"), QStringLiteral("srcx.cpp")
+    });
+    QCOMPARE(toStringList(index.files(m_project)), changed);
+
+    // a file that is added and removed again before the next lookup is not listed
+    ProjectFileItem* transient = new ProjectFileItem(QStringLiteral("transient.cpp"), src);
+    delete transient;
+    delete added;
+    QStringList expected = changed;
+    expected.removeOne(file(QStringLiteral("src/b.cpp")));
+    QCOMPARE(toStringList(index.files(m_project)), expected);
+    QCOMPARE(index.files(m_project), GrepFileIndex::projectFiles(m_project));
+
+    // closed projects are forgotten
+    m_projectController->closeAllProjects();
+    QVERIFY(index.files(m_project).isEmpty());
+}
+
+void TestGrepFileIndex::testProjectFiles()
+{
+    // projects that were open before the index was created are known as well
+    GrepFileIndex index;
+    QCOMPARE(index.files(m_project), GrepFileIndex::projectFiles(m_project));
+    QCOMPARE(index.files(m_project).size(), 7);
+}
+
+void TestGrepFileIndex::testFindProjectFiles_data()
+{
+    QTest::addColumn<QString>("directory");
+    QTest::addColumn<int>("depth");
+    QTest::addColumn<QString>("patterns");
+    QTest::addColumn<QString>("exclusions");
+    QTest::addColumn<QStringList>("expected");
+
+    QTest::newRow("recursive") << QStringLiteral("src") << -1 << QStringLiteral("*") << QString()
+        << files({QStringLiteral("src/a.cpp"), QStringLiteral("src/sub/c.h"), QStringLiteral("src/sub/deeper/e.cpp")});
+    QTest::newRow("depth 0") << QStringLiteral("src") << 0 << QStringLiteral("*") << QString()
+        << files({QStringLiteral("src/a.cpp")});
+    QTest::newRow("depth 1") << QStringLiteral("src") << 1 << QStringLiteral("*") << QString()
+        << files({QStringLiteral("src/a.cpp")});
+    QTest::newRow("depth 2") << QStringLiteral("src") << 2 << QStringLiteral("*") << QString()
+        << files({QStringLiteral("src/a.cpp"), QStringLiteral("src/sub/c.h")});
+    QTest::newRow("patterns") << QStringLiteral("src") << -1 << QStringLiteral("*.cpp") << QString()
+        << files({QStringLiteral("src/a.cpp"), QStringLiteral("src/sub/deeper/e.cpp")});
+    QTest::newRow("exclusions") << QStringLiteral("src") << -1 << QStringLiteral("*") << QStringLiteral("deeper")
+        << files({QStringLiteral("src/a.cpp"), QStringLiteral("src/sub/c.h")});
+    QTest::newRow("subfolder") << QStringLiteral("src/sub") << -1 << QStringLiteral("*") << QString()
+        << files({QStringLiteral("src/sub/c.h"), QStringLiteral("src/sub/deeper/e.cpp")});
+    QTest::newRow("file") << QStringLiteral("srcx.cpp") << -1 << QStringLiteral("*") << QString()
+        << files({QStringLiteral("srcx.cpp")});
+}
+
+void TestGrepFileIndex::testFindProjectFiles()
+{
+    QFETCH(QString, directory);
+    QFETCH(int, depth);
+    QFETCH(QString, patterns);
+    QFETCH(QString, exclusions);
+    QFETCH(QStringList, expected);
+
+    GrepFileIndex index;
+    const QList<QUrl> startDirs = {QUrl::fromLocalFile(file(directory))};
+
+    // with and without the index, the files are picked from the sorted list of the project
+    for (const GrepFileIndex* fileIndex : {&index, static_cast<GrepFileIndex*>(nullptr)}) {
+        GrepFindFilesThread thread(nullptr, startDirs, depth, patterns, exclusions, true, fileIndex);
+        thread.start();
+        QVERIFY(thread.wait(10000));
+
+        QStringList found;
+        foreach(const QUrl& url, thread.files()) {
+            found << url.toLocalFile();
+        }
+        QCOMPARE(found, expected);
+    }
+}
@@ -0,0 +1,42 @@
+/***************************************************************************
+ *   This file is part of KDevelop                                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef KDEVPLATFORM_PLUGIN_TEST_GREPFILEINDEX_H
+#define KDEVPLATFORM_PLUGIN_TEST_GREPFILEINDEX_H
+
+#include <QObject>
+
+namespace KDevelop
+{
+    class TestProject;
+    class TestProjectController;
+}
+
+class TestGrepFileIndex : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+    void testFiles();
+    void testProjectFiles();
+    void testFindProjectFiles();
+    void testFindProjectFiles_data();
+
+private:
+    KDevelop::TestProjectController* m_projectController = nullptr;
+    KDevelop::TestProject* m_project = nullptr;
+};
+
+#endif // KDEVPLATFORM_PLUGIN_TEST_GREPFILEINDEX_H
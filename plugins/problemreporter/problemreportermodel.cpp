@@ -61,7 +61,11 @@ ProblemReporterModel::ProblemReporterModel(QObject* parent)
     connect(m_maxTimer, &QTimer::timeout, this, &ProblemReporterModel::timerExpired);
     connect(store(), &FilteredProblemStore::changed, this, &ProblemReporterModel::onProblemsChanged);
     connect(ICore::self()->languageController()->staticAssistantsManager(), &StaticAssistantsManager::problemsChanged,
-            this, &ProblemReporterModel::onProblemsChanged);
+            this, [this](const IndexedString& url) {
+                if (isWatched(url)) {
+                    updateProblems({url});
+                }
+            });
 }
 
 ProblemReporterModel::~ProblemReporterModel()
@@ -120,7 +124,10 @@ void ProblemReporterModel::timerExpired()
 {
     m_minTimer->stop();
     m_maxTimer->stop();
-    rebuildProblemList();
+
+    const QSet<IndexedString> documents = m_pendingDocuments;
+    m_pendingDocuments.clear();
+    updateProblems(documents);
 }
 
 void ProblemReporterModel::setCurrentDocument(KDevelop::IDocument* doc)
@@ -139,10 +146,11 @@ void ProblemReporterModel::problemsUpdated(const KDevelop::IndexedString& url)
     Q_ASSERT(thread() == QThread::currentThread());
 
     // skip update for urls outside current scope
-    if (!store()->documents()->get().contains(url) &&
-        !(showImports() && store()->documents()->getImports().contains(url)))
+    if (!isWatched(url))
         return;
 
+    m_pendingDocuments.insert(url);
+
     /// m_minTimer will expire in MinTimeout unless some other parsing job finishes in this period.
     m_minTimer->start();
     /// m_maxTimer will expire unconditionally in MaxTimeout
@@ -151,17 +159,66 @@ void ProblemReporterModel::problemsUpdated(const KDevelop::IndexedString& url)
     }
 }
 
+bool ProblemReporterModel::isWatched(const KDevelop::IndexedString& document) const
+{
+    return store()->documents()->get().contains(document) ||
+           (store()->showImports() && store()->documents()->getImports().contains(document));
+}
+
+void ProblemReporterModel::updateProblems(const QSet<KDevelop::IndexedString>& documents)
+{
+    /// Only the rows of these documents change, views keep their state for the others
+    const QHash<IndexedString, QVector<IProblem::Ptr>> problems = documentProblems(documents);
+    for (auto it = problems.constBegin(); it != problems.constEnd(); ++it) {
+        store()->setProblems(it.key(), it.value());
+    }
+}
+
+QHash<KDevelop::IndexedString, QVector<KDevelop::IProblem::Ptr>> ProblemReporterModel::documentProblems(const QSet<KDevelop::IndexedString>& documents) const
+{
+    QHash<IndexedString, QVector<IProblem::Ptr>> result;
+    DUChainReadLocker lock;
+
+    foreach (const IndexedString& document, documents) {
+        if (document.isEmpty())
+            continue;
+
+        QVector<IProblem::Ptr>& problems = result[document];
+        TopDUContext* ctx = DUChain::self()->chainForDocument(document);
+        if (!ctx)
+            continue;
+
+        foreach (const ProblemPointer& p, DUChainUtils::allProblemsForContext(ctx)) {
+            problems.append(p);
+        }
+    }
+
+    return result;
+}
+
 void ProblemReporterModel::rebuildProblemList()
 {
     /// No locking here, because it may be called from an already locked context
-    beginResetModel();
-
-    QVector<IProblem::Ptr> allProblems = problems(store()->documents()->get());
+    m_pendingDocuments.clear();
 
+    QSet<IndexedString> documents = store()->documents()->get();
     if (showImports())
-        allProblems += problems(store()->documents()->getImports());
+        documents += store()->documents()->getImports();
 
-    store()->setProblems(allProblems);
+    const QHash<IndexedString, QVector<IProblem::Ptr>> problems = documentProblems(documents);
+
+    beginResetModel();
+
+    /// The problems are stored by the document that reported them, as the updates of single documents do
+    {
+        QSignalBlocker blocker(store());
+        store()->clear();
+        for (auto it = problems.constBegin(); it != problems.constEnd(); ++it) {
+            store()->setProblems(it.key(), it.value());
+        }
+    }
 
     endResetModel();
+
+    emit problemsChanged();
 }
@@ -23,6 +23,8 @@
 
 #include <shell/problemmodel.h>
 
+#include <QSet>
+
 namespace KDevelop
 {
 class IndexedString;
@@ -67,7 +69,15 @@ private Q_SLOTS:
 
 private:
     void rebuildProblemList();
+    /// Replaces the stored problems of @p documents with the ones in the DUChain
+    void updateProblems(const QSet<KDevelop::IndexedString>& documents);
+    /// @return the problems in the DUChain for each of @p documents
+    QHash<KDevelop::IndexedString, QVector<KDevelop::IProblem::Ptr>> documentProblems(const QSet<KDevelop::IndexedString>& documents) const;
+    /// @return whether the problems of @p document are shown in the current scope
+    bool isWatched(const KDevelop::IndexedString& document) const;
 
+    /// Documents of which the problems were updated since the timers started
+    QSet<KDevelop::IndexedString> m_pendingDocuments;
     QTimer* m_minTimer;
     QTimer* m_maxTimer;
     const static int MinTimeout;
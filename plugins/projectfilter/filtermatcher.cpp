@@ -0,0 +1,236 @@
+/*
+ * This file is part of KDevelop
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "filtermatcher.h"
+
+#include <algorithm>
+
+using namespace KDevelop;
+
+namespace {
+// the accepting state needs a bit as well
+const int maxTokens = 63;
+}
+
+bool FilterMatcher::Token::matches(QChar c) const
+{
+    switch (kind) {
+        case Character:
+            return c == character;
+        case AnyCharacter:
+            return true;
+        case AnySequence:
+            // handled by the anySequenceMask
+            return false;
+        case CharacterSet:
+            for (int i = 0; i < ranges.size(); i += 2) {
+                if (c >= ranges[i] && c <= ranges[i + 1]) {
+                    return !negated;
+                }
+            }
+            return negated;
+    }
+    return false;
+}
+
+FilterMatcher::FilterMatcher(const Filters& filters)
+    : m_needsPath(false)
+{
+    m_globs.reserve(filters.size());
+    m_initialState.reserve(filters.size());
+    foreach(const Filter& filter, filters) {
+        Glob glob;
+        glob.targets = filter.targets;
+        glob.type = filter.type;
+        glob.compiled = filter.pattern.patternSyntax() == QRegExp::WildcardUnix
+                     && filter.pattern.caseSensitivity() == Qt::CaseSensitive
+                     && compile(filter.pattern.pattern(), &glob.tokens);
+        glob.anySequenceMask = 0;
+        glob.acceptMask = 0;
+        std::fill(glob.asciiMasks, glob.asciiMasks + 128, 0);
+
+        if (glob.compiled) {
+            for (int i = 0; i < glob.tokens.size(); ++i) {
+                const Token& token = glob.tokens[i];
+                if (token.kind == Token::AnySequence) {
+                    glob.anySequenceMask |= quint64(1) << i;
+                    continue;
+                }
+                for (ushort c = 0; c < 128; ++c) {
+                    if (token.matches(QChar(c))) {
+                        glob.asciiMasks[c] |= quint64(1) << i;
+                    }
+                }
+            }
+            glob.acceptMask = quint64(1) << glob.tokens.size();
+        } else {
+            glob.pattern = filter.pattern;
+            m_needsPath = true;
+        }
+
+        m_globs << glob;
+        m_initialState << (glob.compiled ? closure(glob, 1) : 0);
+    }
+}
+
+bool FilterMatcher::compile(const QString& pattern, QVector<Token>* tokens)
+{
+    // follows how QRegExp translates QRegExp::WildcardUnix patterns into regular expressions
+    for (int i = 0; i < pattern.size();) {
+        const QChar c = pattern[i++];
+        Token token;
+        token.kind = Token::Character;
+        token.character = c;
+        token.negated = false;
+
+        if (c == QLatin1Char('\\')) {
+            if (i == pattern.size()) {
+                // a trailing backslash is dropped
+                break;
+            }
+            token.character = pattern[i++];
+            if (token.character.isLetterOrNumber()) {
+                // this becomes a character class or a back reference in the regular expression
+                return false;
+            }
+        } else if (c == QLatin1Char('*')) {
+            if (!tokens->isEmpty() && tokens->last().kind == Token::AnySequence) {
+                continue;
+            }
+            token.kind = Token::AnySequence;
+        } else if (c == QLatin1Char('?')) {
+            token.kind = Token::AnyCharacter;
+        } else if (c == QLatin1Char('[')) {
+            token.kind = Token::CharacterSet;
+            if (i < pattern.size() && pattern[i] == QLatin1Char('^')) {
+                token.negated = true;
+                ++i;
+            }
+            const int first = i;
+            // a closing bracket right at the start is part of the set
+            if (i < pattern.size() && pattern[i] == QLatin1Char(']')) {
+                ++i;
+            }
+            while (i < pattern.size() && pattern[i] != QLatin1Char(']')) {
+                ++i;
+            }
+            if (i == pattern.size()) {
+                // the regular expression would be invalid
+                return false;
+            }
+            const int end = i++;
+            for (int j = first; j < end; ++j) {
+                const QChar from = pattern[j];
+                QChar to = from;
+                if (j + 2 < end && pattern[j + 1] == QLatin1Char('-')) {
+                    to = pattern[j + 2];
+                    j += 2;
+                    if (to < from) {
+                        return false;
+                    }
+                }
+                token.ranges << from << to;
+            }
+        }
+
+        *tokens << token;
+        if (tokens->size() > maxTokens) {
+            return false;
+        }
+    }
+    return true;
+}
+
+quint64 FilterMatcher::characterMask(const Glob& glob, QChar c) const
+{
+    if (c.unicode() < 128) {
+        return glob.asciiMasks[c.unicode()];
+    }
+    quint64 mask = 0;
+    for (int i = 0; i < glob.tokens.size(); ++i) {
+        if (glob.tokens[i].kind != Token::AnySequence && glob.tokens[i].matches(c)) {
+            mask |= quint64(1) << i;
+        }
+    }
+    return mask;
+}
+
+quint64 FilterMatcher::closure(const Glob& glob, quint64 mask) const
+{
+    // a sequence of any characters may also be empty
+    forever {
+        const quint64 next = mask | ((mask & glob.anySequenceMask) << 1);
+        if (next == mask) {
+            return mask;
+        }
+        mask = next;
+    }
+}
+
+FilterMatcher::State FilterMatcher::initialState() const
+{
+    return m_initialState;
+}
+
+void FilterMatcher::advance(State* state, const QString& text) const
+{
+    for (int i = 0; i < m_globs.size(); ++i) {
+        quint64 mask = (*state)[i];
+        if (!mask) {
+            // the pattern cannot match anymore
+            continue;
+        }
+        const Glob& glob = m_globs[i];
+        for (const QChar c : text) {
+            mask = closure(glob, ((mask & characterMask(glob, c)) << 1) | (mask & glob.anySequenceMask));
+            if (!mask) {
+                break;
+            }
+        }
+        (*state)[i] = mask;
+    }
+}
+
+bool FilterMatcher::isValid(const State& state, bool isFolder, const QString& path) const
+{
+    bool isValid = true;
+    for (int i = 0; i < m_globs.size(); ++i) {
+        const Glob& glob = m_globs[i];
+        if (isFolder && !(glob.targets & Filter::Folders)) {
+            continue;
+        } else if (!isFolder && !(glob.targets & Filter::Files)) {
+            continue;
+        }
+        if ((!isValid && glob.type == Filter::Inclusive) || (isValid && glob.type == Filter::Exclusive)) {
+            const bool match = glob.compiled ? (state[i] & glob.acceptMask) : glob.pattern.exactMatch(path);
+            if (glob.type == Filter::Inclusive) {
+                isValid = match;
+            } else {
+                isValid = !match;
+            }
+        }
+    }
+    return isValid;
+}
+
+bool FilterMatcher::needsPath() const
+{
+    return m_needsPath;
+}
@@ -0,0 +1,107 @@
+/*
+ * This file is part of KDevelop
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FILTERMATCHER_H
+#define FILTERMATCHER_H
+
+#include "filter.h"
+
+namespace KDevelop {
+
+/**
+ * The FilterMatcher applies an ordered list of filters to paths that are read piece by piece.
+ *
+ * The wildcard pattern of each filter is compiled into a bit-parallel automaton, and the State
+ * holds where all of them are after reading some text. The state after the path of a folder
+ * can be kept and continued with the last segment of each path in the folder, so the common
+ * part of these paths is only read once.
+ *
+ * Patterns that cannot be compiled, which only happens for unusual escapes, invalid character
+ * sets or very long patterns, are matched against the whole path with their QRegExp.
+ */
+class FilterMatcher
+{
+public:
+    /// One bit mask per filter, bit i is set while the first i tokens of its pattern match the text read so far.
+    typedef QVector<quint64> State;
+
+    explicit FilterMatcher(const Filters& filters = Filters());
+
+    /// @return the state before any text was read
+    State initialState() const;
+
+    /// Reads @p text, continuing from @p state
+    void advance(State* state, const QString& text) const;
+
+    /**
+     * @return whether a path is valid according to the filters, given the @p state after reading it.
+     * @p path is the text that was read, it is only looked at if needsPath() returns true.
+     */
+    bool isValid(const State& state, bool isFolder, const QString& path) const;
+
+    /// @return whether some patterns could not be compiled and isValid() needs the path
+    bool needsPath() const;
+
+private:
+    struct Token
+    {
+        enum Kind {
+            Character,
+            AnyCharacter,
+            AnySequence,
+            CharacterSet
+        };
+
+        bool matches(QChar c) const;
+
+        Kind kind;
+        QChar character;
+        /// pairs of the first and last character of the ranges in a set
+        QVector<QChar> ranges;
+        bool negated;
+    };
+
+    struct Glob
+    {
+        Filter::Targets targets;
+        Filter::Type type;
+        bool compiled;
+        /// used instead of the tokens if the pattern could not be compiled
+        QRegExp pattern;
+        QVector<Token> tokens;
+        /// bit i is set if token i matches the character, for each ASCII character
+        quint64 asciiMasks[128];
+        /// bit i is set if token i matches any sequence of characters
+        quint64 anySequenceMask;
+        quint64 acceptMask;
+    };
+
+    static bool compile(const QString& pattern, QVector<Token>* tokens);
+    quint64 characterMask(const Glob& glob, QChar c) const;
+    quint64 closure(const Glob& glob, quint64 mask) const;
+
+    QVector<Glob> m_globs;
+    State m_initialState;
+    bool m_needsPath;
+};
+
+}
+
+#endif // FILTERMATCHER_H
@@ -23,12 +23,13 @@
 
 #include <interfaces/iproject.h>
 
-#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
 
 using namespace KDevelop;
 
 ProjectFilter::ProjectFilter( const IProject* const project, const QVector<Filter>& filters )
-    : m_filters( filters )
+    : m_matcher( filters )
     , m_projectFile( project->projectFile() )
     , m_project( project->path() )
 {
@@ -51,38 +52,58 @@ bool ProjectFilter::isValid( const Path &path, const bool isFolder ) const
         return true;
     }
 
-    if (isFolder && path.isLocalFile() && QFile::exists(path.toLocalFile() + "/.kdev_ignore")) {
+    // from here on the user can configure what he wants to see or not.
+
+    if (isFolder && path.lastPathSegment() == QLatin1String(".kdev4")) {
         return false;
     }
 
-    // from here on the user can configure what he wants to see or not.
-
     // we operate on the path relative to the project base
     // by prepending a slash we can filter hidden files with the pattern "*/.*"
 
-    const QString relativePath = makeRelative(path);
+    const QString name = QLatin1Char('/') + path.lastPathSegment();
+    FilterMatcher::State state;
+    if (m_project.isParentOf(path)) {
+        // the paths in a folder only differ in their last segment
+        state = folderState(path.parent());
+        m_matcher.advance(&state, name);
+        if (isFolder) {
+            QMutexLocker lock(&m_mutex);
+            m_folderStates.insert(path, state);
+        }
+    } else {
+        state = m_matcher.initialState();
+        m_matcher.advance(&state, makeRelative(path));
+    }
 
-    if (isFolder && relativePath.endsWith(QLatin1String("/.kdev4"))) {
+    if (!m_matcher.isValid(state, isFolder, m_matcher.needsPath() ? makeRelative(path) : QString())) {
         return false;
     }
 
-    bool isValid = true;
-    foreach( const Filter& filter, m_filters ) {
-        if (isFolder && !(filter.targets & Filter::Folders)) {
-            continue;
-        } else if (!isFolder && !(filter.targets & Filter::Files)) {
-            continue;
-        }
-        if ((!isValid && filter.type == Filter::Inclusive) || (isValid && filter.type == Filter::Exclusive)) {
-            const bool match = filter.pattern.exactMatch( relativePath );
-            if (filter.type == Filter::Inclusive) {
-                isValid = match;
-            } else {
-                isValid = !match;
-            }
+    // only folders that are shown otherwise have to be looked up on disk
+    return !isFolder || !path.isLocalFile() || !QFileInfo::exists(path.toLocalFile() + QLatin1String("/.kdev_ignore"));
+}
+
+FilterMatcher::State ProjectFilter::folderState(const Path& folder) const
+{
+    if (folder == m_project) {
+        return m_matcher.initialState();
+    }
+
+    {
+        QMutexLocker lock(&m_mutex);
+        auto it = m_folderStates.constFind(folder);
+        if (it != m_folderStates.constEnd()) {
+            return *it;
         }
     }
-    return isValid;
+
+    FilterMatcher::State state = folderState(folder.parent());
+    m_matcher.advance(&state, QLatin1Char('/') + folder.lastPathSegment());
+
+    QMutexLocker lock(&m_mutex);
+    m_folderStates.insert(folder, state);
+    return state;
 }
 
 QString ProjectFilter::makeRelative(const Path& path) const
@@ -25,7 +25,11 @@
 #include <project/interfaces/iprojectfilter.h>
 #include <util/path.h>
 
+#include <QHash>
+#include <QMutex>
+
 #include "filter.h"
+#include "filtermatcher.h"
 
 namespace KDevelop {
 
@@ -41,10 +45,16 @@ public:
 
 private:
     QString makeRelative(const Path& path) const;
+    /// @return the state of the matcher after the path of @p folder relative to the project base
+    FilterMatcher::State folderState(const Path& folder) const;
 
-    Filters m_filters;
+    FilterMatcher m_matcher;
     Path m_projectFile;
     Path m_project;
+
+    mutable QMutex m_mutex;
+    /// The matcher states of the folders in the project that were looked at, so the paths in them only need their last segment matched
+    mutable QHash<Path, FilterMatcher::State> m_folderStates;
 };
 
 }
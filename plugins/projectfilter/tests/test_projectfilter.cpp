@@ -29,6 +29,7 @@
 #include <tests/testproject.h>
 
 #include "../projectfilter.h"
+#include "../filtermatcher.h"
 
 QTEST_GUILESS_MAIN(TestProjectFilter);
 
@@ -90,6 +91,7 @@ struct BenchData
 }
 
 Q_DECLARE_METATYPE(QVector<BenchData>)
+Q_DECLARE_METATYPE(KDevelop::Filters)
 
 void TestProjectFilter::initTestCase()
 {
@@ -98,6 +100,7 @@ void TestProjectFilter::initTestCase()
     qRegisterMetaType<TestFilter>();
     qRegisterMetaType<Path>();
     qRegisterMetaType<QVector<BenchData> >();
+    qRegisterMetaType<Filters>();
 }
 
 void TestProjectFilter::cleanupTestCase()
@@ -338,6 +341,52 @@ void TestProjectFilter::match_data()
     }
 }
 
+void TestProjectFilter::matchPattern()
+{
+    QFETCH(QString, pattern);
+    QFETCH(QString, path);
+
+    Filter filter;
+    filter.pattern = QRegExp(pattern, Qt::CaseSensitive, QRegExp::WildcardUnix);
+    const FilterMatcher matcher(Filters() << filter);
+
+    // the matcher has to agree with QRegExp, whether it reads the path at once or segment by segment
+    FilterMatcher::State state = matcher.initialState();
+    matcher.advance(&state, path);
+    QCOMPARE(!matcher.isValid(state, false, path), filter.pattern.exactMatch(path));
+
+    state = matcher.initialState();
+    foreach(const QString& segment, path.split(QLatin1Char('/'), QString::SkipEmptyParts)) {
+        matcher.advance(&state, QLatin1Char('/') + segment);
+    }
+    QCOMPARE(!matcher.isValid(state, false, path), filter.pattern.exactMatch(path));
+}
+
+void TestProjectFilter::matchPattern_data()
+{
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<QString>("path");
+
+    const QStringList patterns = {
+        QStringLiteral("*/.*"), QStringLiteral("*/.gitignore"), QStringLiteral("*.so.*"), QStringLiteral("*/moc_*.cpp"),
+        QStringLiteral("*~"), QStringLiteral("/foo/*bar"), QStringLiteral("*/foo\\*bar"), QStringLiteral("*/file?.h"),
+        QStringLiteral("*/[a-c]*"), QStringLiteral("*/[^a-c]*"), QStringLiteral("*/[]]*"), QStringLiteral("*/[ab-]"),
+        QStringLiteral("*/\\d"), QStringLiteral("*/[a"), QStringLiteral("**/b**"), QStringLiteral("*/\u00e4*")
+    };
+    const QStringList paths = {
+        QStringLiteral("/.git"), QStringLiteral("/folder/.gitignore"), QStringLiteral("/lib/libfoo.so.1"),
+        QStringLiteral("/src/moc_foo.cpp"), QStringLiteral("/foo.cpp~"), QStringLiteral("/foo/asdf/bar"),
+        QStringLiteral("/foo*bar"), QStringLiteral("/fooasdfbar"), QStringLiteral("/file1.h"), QStringLiteral("/file12.h"),
+        QStringLiteral("/a"), QStringLiteral("/d"), QStringLiteral("/]"), QStringLiteral("/-"), QStringLiteral("/\\d"),
+        QStringLiteral("/1"), QStringLiteral("/[a"), QStringLiteral("/b/b"), QStringLiteral("/\u00e4\u00f6"), QStringLiteral("/a/b/c")
+    };
+    foreach(const QString& pattern, patterns) {
+        foreach(const QString& path, paths) {
+            QTest::newRow(qstrdup(qPrintable(pattern + QLatin1String(" : ") + path))) << pattern << path;
+        }
+    }
+}
+
 static QVector<BenchData> createBenchData(const Path& base, int folderDepth, int foldersPerFolder, int filesPerFolder)
 {
     QVector<BenchData> data;
@@ -368,6 +417,40 @@ void TestProjectFilter::bench()
     }
 }
 
+void TestProjectFilter::benchNewFilter()
+{
+    QFETCH(Filters, filters);
+    QFETCH(QVector<BenchData>, data);
+
+    // like importing a project, none of the folders is known to the filter yet
+    const TestProject project;
+    QBENCHMARK {
+        ProjectFilter filter(&project, filters);
+        foreach(const BenchData& bench, data) {
+            filter.isValid(bench.path, bench.isFolder);
+        }
+    }
+}
+
+void TestProjectFilter::benchNewFilter_data()
+{
+    QTest::addColumn<Filters>("filters");
+    QTest::addColumn<QVector<BenchData> >("data");
+
+    const TestProject project;
+    const QVector<BenchData> data = createBenchData(project.path(), 4, 6, 30);
+
+    QTest::newRow("defaults") << deserialize(defaultFilters()) << data;
+
+    // what excluding many items from the context menu leaves behind
+    SerializedFilters filters = defaultFilters();
+    for (int i = 0; i < 50; ++i) {
+        filters << SerializedFilter(QStringLiteral("/folder%1/folder%2").arg(i % 6).arg(i), Filter::Folders)
+                << SerializedFilter(QStringLiteral("/folder%1/file%2.cpp").arg(i % 6).arg(i), Filter::Files);
+    }
+    QTest::newRow("many-rules") << deserialize(filters) << data;
+}
+
 void TestProjectFilter::bench_data()
 {
     QTest::addColumn<TestFilter>("filter");
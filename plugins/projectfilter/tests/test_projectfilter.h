@@ -33,9 +33,13 @@ private Q_SLOTS:
 
     void match();
     void match_data();
+    void matchPattern();
+    void matchPattern_data();
 
     void bench();
     void bench_data();
+    void benchNewFilter();
+    void benchNewFilter_data();
 };
 
 #endif // TESTPROJECTFILTER_H
@@ -29,6 +29,7 @@
 #include <language/duchain/codemodel.h>
 #include <language/interfaces/iquickopen.h>
 #include <language/interfaces/abbreviations.h>
+#include <language/interfaces/quickopenfilter.h>
 
 #include <interfaces/iproject.h>
 #include <interfaces/iprojectcontroller.h>
@@ -135,6 +136,10 @@ ProjectItemDataProvider::ProjectItemDataProvider(KDevelop::IQuickOpen* quickopen
     , m_quickopen(quickopen)
     , m_addedItemsCountCache([this]() { return addedItems(m_addedItems); })
 {
+    // the code model of a file only changes when it is parsed
+    connect(DUChain::self(), &DUChain::updateReady, this, [this](const IndexedString& url) {
+        m_fileItems.remove(url);
+    });
 }
 
 void ProjectItemDataProvider::setFilterText(const QString& text)
@@ -158,53 +163,75 @@ void ProjectItemDataProvider::setFilterText(const QString& text)
         return;
     }
 
-    KDevVarLengthArray<SubstringCache, 5> cache;
-    foreach (const QString& searchPart, search) {
-        cache.append(SubstringCache(searchPart));
-    }
-
     if (!text.startsWith(m_currentFilter)) {
         m_filteredItems = m_currentItems;
     }
 
     m_currentFilter = text;
 
-    QVector<CodeModelViewItem> oldFiltered = m_filteredItems;
-    QHash<int, int> heights;
+    const QVector<CodeModelViewItem> oldFiltered = m_filteredItems;
+    const quint64 searchMask = typedCharacterMask(search.join(QString()));
 
-    m_filteredItems.clear();
+    // the items are matched on several threads, each with its own caches
+    struct Matches
+    {
+        QVector<CodeModelViewItem> items;
+        QHash<int, int> heights;
+    };
+    QVector<Matches> chunkMatches(filterChunkCount(oldFiltered.size()));
+    forEachFilterChunk(oldFiltered.size(), [&](int chunk, int begin, int end) {
+        KDevVarLengthArray<SubstringCache, 5> cache;
+        foreach (const QString& searchPart, search) {
+            cache.append(SubstringCache(searchPart));
+        }
+        Matches& matches = chunkMatches[chunk];
 
-    foreach (const CodeModelViewItem& item, oldFiltered) {
-        const QualifiedIdentifier& currentId = item.m_id;
-
-        int last_pos = currentId.count() - 1;
-        int current_height = 0;
-        int distance = 0;
-
-        //iter over each search item from last to first
-        //this makes easier to calculate the distance based on where we hit the result or nothing
-        //Iterating from the last item to the first is more efficient, as we want to match the
-        //class/function name, which is the last item on the search fields and on the identifier.
-        for (int b = search.count() - 1; b >= 0; --b) {
-            //iter over each id for the current identifier, from last to first
-            for (; last_pos >= 0; --last_pos, distance++) {
-                // the more distant we are from the class definition, the less priority it will have
-                current_height += distance * 10000;
-                int result;
-                //if the current search item is contained on the current identifier
-                if ((result = cache[b].containedIn(currentId.at(last_pos))) >= 0) {
-                    //when we find a hit, whe add the distance to the searched word.
-                    //so the closest item will be displayed first
-                    current_height += result;
-
-                    if (b == 0) {
-                        heights[currentId.index()] = current_height;
-                        m_filteredItems << item;
+        for (int index = begin; index < end; ++index) {
+            const CodeModelViewItem& item = oldFiltered.at(index);
+            if ((item.m_characterMask & searchMask) != searchMask) {
+                // some typed character is not in the identifier
+                continue;
+            }
+            const QualifiedIdentifier& currentId = item.m_id;
+
+            int last_pos = currentId.count() - 1;
+            int current_height = 0;
+            int distance = 0;
+
+            //iter over each search item from last to first
+            //this makes easier to calculate the distance based on where we hit the result or nothing
+            //Iterating from the last item to the first is more efficient, as we want to match the
+            //class/function name, which is the last item on the search fields and on the identifier.
+            for (int b = search.count() - 1; b >= 0; --b) {
+                //iter over each id for the current identifier, from last to first
+                for (; last_pos >= 0; --last_pos, distance++) {
+                    // the more distant we are from the class definition, the less priority it will have
+                    current_height += distance * 10000;
+                    int result;
+                    //if the current search item is contained on the current identifier
+                    if ((result = cache[b].containedIn(currentId.at(last_pos))) >= 0) {
+                        //when we find a hit, whe add the distance to the searched word.
+                        //so the closest item will be displayed first
+                        current_height += result;
+
+                        if (b == 0) {
+                            matches.heights[currentId.index()] = current_height;
+                            matches.items << item;
+                        }
+                        break;
                     }
-                    break;
                 }
             }
         }
+    });
+
+    QHash<int, int> heights;
+    m_filteredItems.clear();
+    foreach (const Matches& matches, chunkMatches) {
+        m_filteredItems += matches.items;
+        for (auto it = matches.heights.constBegin(); it != matches.heights.constEnd(); ++it) {
+            heights.insert(it.key(), it.value());
+        }
     }
 
     //then, for the last part, we use the already built cache to sort the items according with their distance
@@ -300,6 +327,45 @@ KDevelop::QuickOpenDataPointer ProjectItemDataProvider::data(uint pos) const
     }
 }
 
+ProjectItemDataProvider::FileItems ProjectItemDataProvider::codeModelItems(const IndexedString& file)
+{
+    FileItems fileItems;
+
+    uint count;
+    const KDevelop::CodeModelItem* items;
+    CodeModel::self().items(file, count, items);
+
+    for (uint a = 0; a < count; ++a) {
+        if (!items[a].id.isValid() || items[a].kind & CodeModelItem::ForwardDeclaration) {
+            continue;
+        }
+        if (!(items[a].kind & (CodeModelItem::Class | CodeModelItem::Function))) {
+            continue;
+        }
+        QualifiedIdentifier id = items[a].id.identifier();
+
+        if (id.isEmpty() || id.at(0).identifier().isEmpty()) {
+            // id.isEmpty() not always hit when .toString() is actually empty...
+            // anyhow, this makes sure that we don't show duchain items without
+            // any name that could be searched for. This happens e.g. in the c++
+            // plugin for anonymous structs or sometimes for declarations in macro
+            // expressions
+            continue;
+        }
+
+        CodeModelViewItem item(file, id);
+        for (int i = 0; i < id.count(); ++i) {
+            item.m_characterMask |= wordCharacterMask(id.at(i).identifier().str());
+        }
+        if (items[a].kind & CodeModelItem::Class) {
+            fileItems.classes << item;
+        } else {
+            fileItems.functions << item;
+        }
+    }
+    return fileItems;
+}
+
 void ProjectItemDataProvider::reset()
 {
     m_files = m_quickopen->fileSet();
@@ -307,30 +373,36 @@ void ProjectItemDataProvider::reset()
     m_addedItems.clear();
     m_addedItemsCountCache.markDirty();
 
-    KDevelop::DUChainReadLocker lock(DUChain::lock());
+    // forget about files that are gone
+    for (auto it = m_fileItems.begin(); it != m_fileItems.end();) {
+        if (m_files.contains(it.key())) {
+            ++it;
+        } else {
+            it = m_fileItems.erase(it);
+        }
+    }
+
+    // only files that were parsed since they were looked at last are read from the code model
+    QVector<IndexedString> missingFiles;
     foreach (const IndexedString& u, m_files) {
-        uint count;
-        const KDevelop::CodeModelItem* items;
-        CodeModel::self().items(u, count, items);
+        if (!m_fileItems.contains(u)) {
+            missingFiles << u;
+        }
+    }
+    if (!missingFiles.isEmpty()) {
+        KDevelop::DUChainReadLocker lock(DUChain::lock());
+        foreach (const IndexedString& u, missingFiles) {
+            m_fileItems.insert(u, codeModelItems(u));
+        }
+    }
 
-        for (uint a = 0; a < count; ++a) {
-            if (!items[a].id.isValid() || items[a].kind & CodeModelItem::ForwardDeclaration) {
-                continue;
-            }
-            if (((m_itemTypes & Classes) && (items[a].kind & CodeModelItem::Class)) ||
-                ((m_itemTypes & Functions) && (items[a].kind & CodeModelItem::Function))) {
-                QualifiedIdentifier id = items[a].id.identifier();
-
-                if (id.isEmpty() || id.at(0).identifier().isEmpty()) {
-                    // id.isEmpty() not always hit when .toString() is actually empty...
-                    // anyhow, this makes sure that we don't show duchain items without
-                    // any name that could be searched for. This happens e.g. in the c++
-                    // plugin for anonymous structs or sometimes for declarations in macro
-                    // expressions
-                    continue;
-                }
-                m_currentItems << CodeModelViewItem(u, id);
-            }
+    foreach (const IndexedString& u, m_files) {
+        const FileItems& fileItems = m_fileItems[u];
+        if (m_itemTypes & Classes) {
+            m_currentItems += fileItems.classes;
+        }
+        if (m_itemTypes & Functions) {
+            m_currentItems += fileItems.functions;
         }
     }
 
@@ -23,6 +23,8 @@
 #include <serialization/indexedstring.h>
 #include <language/duchain/identifier.h>
 
+#include <QHash>
+
 #include <functional>
 #include <type_traits>
 
@@ -73,6 +75,8 @@ struct CodeModelViewItem
     }
     KDevelop::IndexedString m_file;
     KDevelop::QualifiedIdentifier m_id;
+    /// The wordCharacterMask() of all parts of m_id
+    quint64 m_characterMask = 0;
 };
 
 Q_DECLARE_TYPEINFO(CodeModelViewItem, Q_MOVABLE_TYPE);
@@ -106,6 +110,14 @@ public:
 private:
     KDevelop::QuickOpenDataPointer data(uint pos) const override;
 
+    /// The classes and functions of a file in the code model
+    struct FileItems
+    {
+        QVector<CodeModelViewItem> classes;
+        QVector<CodeModelViewItem> functions;
+    };
+    static FileItems codeModelItems(const KDevelop::IndexedString& file);
+
     ItemTypes m_itemTypes;
     KDevelop::IQuickOpen* m_quickopen;
     QSet<KDevelop::IndexedString> m_files;
@@ -113,6 +125,9 @@ private:
     QString m_currentFilter;
     QVector<CodeModelViewItem> m_filteredItems;
 
+    /// The items of the files that were looked at since they were parsed last, by file
+    QHash<KDevelop::IndexedString, FileItems> m_fileItems;
+
     //Maps positions to the additional items behind those positions
     //Here additional inserted items are stored, that are not represented in m_filteredItems.
     //This is needed at least to also show overloaded function declarations
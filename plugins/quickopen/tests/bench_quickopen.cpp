@@ -159,3 +159,41 @@ void BenchQuickOpen::benchProjectFileFilter_providerDataIcon_data()
 {
     getData();
 }
+
+void BenchQuickOpen::benchPathFilter_setFilter()
+{
+    QFETCH(int, files);
+    QFETCH(QString, filter);
+
+    QStringList paths;
+    paths.reserve(files);
+    for (int i = 0; i < files; ++i) {
+        paths << QStringLiteral("/home/user/projects/project%1/src/module%2/SomeClass%3Impl.cpp").arg(i % 10).arg(i % 1000).arg(i);
+    }
+    PathTestFilter pathFilter;
+    pathFilter.setItems(paths);
+    // the first filtering also sets up the filter
+    pathFilter.setFilter(QStringList() << QStringLiteral("x"));
+
+    // typing one character after another, as a user would
+    QBENCHMARK {
+        QStringList typed;
+        for (int i = 1; i <= filter.size(); ++i) {
+            typed = filter.left(i).split(QLatin1Char('/'), QString::SkipEmptyParts);
+            pathFilter.setFilter(typed);
+        }
+        pathFilter.clearFilter();
+    }
+}
+
+void BenchQuickOpen::benchPathFilter_setFilter_data()
+{
+    QTest::addColumn<int>("files");
+    QTest::addColumn<QString>("filter");
+
+    QTest::newRow("010000-sci") << 10000 << "sci";
+    QTest::newRow("100000-sci") << 100000 << "sci";
+    QTest::newRow("100000-m12/some") << 100000 << "m12/some";
+    QTest::newRow("100000-impl.cpp") << 100000 << "impl.cpp";
+    QTest::newRow("100000-qxz") << 100000 << "qxz";
+}
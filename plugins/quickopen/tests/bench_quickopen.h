@@ -42,6 +42,8 @@ private Q_SLOTS:
     void benchProjectFileFilter_providerData_data();
     void benchProjectFileFilter_providerDataIcon();
     void benchProjectFileFilter_providerDataIcon_data();
+    void benchPathFilter_setFilter();
+    void benchPathFilter_setFilter_data();
 };
 
 #endif // KDEVPLATFORM_PLUGIN_BENCH_QUICKOPEN_H
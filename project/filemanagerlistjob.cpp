@@ -16,7 +16,6 @@
     the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
     Boston, MA 02110-1301, USA.
 */
-
 #include "filemanagerlistjob.h"
 
 #include <interfaces/iproject.h>
@@ -27,16 +26,114 @@
 
 #include <QtConcurrentRun>
 #include <QDir>
+#include <QThread>
+
+#if defined(Q_OS_LINUX) || defined(Q_OS_BSD4)
+#define HAVE_DIRENT_TYPE
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
 
 using namespace KDevelop;
 
+namespace {
+
+/**
+ * Lists the local folder @p path like QDir::entryInfoList() with
+ * QDir::NoDotAndDotDot | QDir::AllEntries | QDir::Hidden would.
+ *
+ * Where readdir() reports the type of the entries, only symbolic links
+ * and entries of an unknown type are looked up on their own.
+ */
+KIO::UDSEntryList listLocalFolder(const QString& path)
+{
+    KIO::UDSEntryList results;
+#ifdef HAVE_DIRENT_TYPE
+    DIR* dir = opendir(QFile::encodeName(path).constData());
+    if (!dir) {
+        return results;
+    }
+    const int fd = dirfd(dir);
+    while (const dirent* entry = readdir(dir)) {
+        const char* name = entry->d_name;
+        if (name[0] == '.' && (!name[1] || (name[1] == '.' && !name[2]))) {
+            continue;
+        }
+
+        unsigned char type = entry->d_type;
+        struct stat info;
+        if (type == DT_UNKNOWN) {
+            if (fstatat(fd, name, &info, AT_SYMLINK_NOFOLLOW) != 0) {
+                continue;
+            }
+            type = S_ISDIR(info.st_mode) ? DT_DIR : S_ISREG(info.st_mode) ? DT_REG
+                 : S_ISLNK(info.st_mode) ? DT_LNK : DT_UNKNOWN;
+        }
+        const bool isLink = type == DT_LNK;
+        if (isLink) {
+            // links count as what they point to, broken links are left out like QDir does
+            if (fstatat(fd, name, &info, 0) != 0) {
+                continue;
+            }
+            type = S_ISDIR(info.st_mode) ? DT_DIR : S_ISREG(info.st_mode) ? DT_REG : DT_UNKNOWN;
+        }
+        if (type != DT_DIR && type != DT_REG) {
+            // fifos, sockets and devices are only listed with QDir::System
+            continue;
+        }
+
+        const QString fileName = QFile::decodeName(name);
+        KIO::UDSEntry result;
+        result.insert(KIO::UDSEntry::UDS_NAME, fileName);
+        if (type == DT_DIR) {
+            result.insert(KIO::UDSEntry::UDS_FILE_TYPE, QT_STAT_DIR);
+        }
+        if (isLink) {
+            result.insert(KIO::UDSEntry::UDS_LINK_DEST, QFileInfo(path + QLatin1Char('/') + fileName).symLinkTarget());
+        }
+        results << result;
+    }
+    closedir(dir);
+#else
+    QDir dir(path);
+    const auto entries = dir.entryInfoList(QDir::NoDotAndDotDot | QDir::AllEntries | QDir::Hidden);
+    std::transform(entries.begin(), entries.end(), std::back_inserter(results), [] (const QFileInfo& info) -> KIO::UDSEntry {
+        KIO::UDSEntry entry;
+        entry.insert(KIO::UDSEntry::UDS_NAME, info.fileName());
+        if (info.isDir()) {
+            entry.insert(KIO::UDSEntry::UDS_FILE_TYPE, QT_STAT_DIR);
+        }
+        if (info.isSymLink()) {
+            entry.insert(KIO::UDSEntry::UDS_LINK_DEST, info.symLinkTarget());
+        }
+        return entry;
+    });
+#endif
+    return results;
+}
+
+bool isInFolder(ProjectBaseItem* item, ProjectBaseItem* folder)
+{
+    for (; item; item = item->parent()) {
+        if (item == folder) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
 FileManagerListJob::FileManagerListJob(ProjectFolderItem* item)
-    : KIO::Job(), m_item(item), m_aborted(false)
+    : KIO::Job(), m_item(item), m_results(new Results), m_remoteItem(nullptr), m_aborted(false)
 {
     qRegisterMetaType<KIO::UDSEntryList>("KIO::UDSEntryList");
     qRegisterMetaType<KIO::Job*>();
     qRegisterMetaType<KJob*>();
 
+    m_results->job = this;
+
     /* the following line is not an error in judgment, apparently starting a
      * listJob while the previous one hasn't self-destructed takes a lot of time,
      * so we give the job a chance to selfdestruct first */
@@ -49,6 +146,13 @@ FileManagerListJob::FileManagerListJob(ProjectFolderItem* item)
 #endif
 }
 
+FileManagerListJob::~FileManagerListJob()
+{
+    // folders that are still being listed must not be reported to us anymore
+    QMutexLocker lock(&m_results->mutex);
+    m_results->job = nullptr;
+}
+
 ProjectFolderItem* FileManagerListJob::item() const
 {
     return m_item;
@@ -57,14 +161,29 @@ ProjectFolderItem* FileManagerListJob::item() const
 void FileManagerListJob::addSubDir( ProjectFolderItem* item )
 {
     Q_ASSERT(!m_listQueue.contains(item));
-    Q_ASSERT(!m_item || m_item == item || m_item->path().isDirectParentOf(item->path()));
+    Q_ASSERT(m_item == item || m_item->path().isParentOf(item->path()));
 
     m_listQueue.enqueue(item);
 }
 
 void FileManagerListJob::removeSubDir(ProjectFolderItem* item)
 {
-    m_listQueue.removeAll(item);
+    // the sub folders go away with the folder
+    for (auto it = m_listQueue.begin(); it != m_listQueue.end();) {
+        if (isInFolder(*it, item)) {
+            it = m_listQueue.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    // the entries of folders that are being listed are dropped once they arrive
+    for (auto it = m_listing.begin(); it != m_listing.end();) {
+        if (isInFolder(*it, item)) {
+            it = m_listing.erase(it);
+        } else {
+            ++it;
+        }
+    }
 }
 
 void FileManagerListJob::slotEntries(KIO::Job* job, const KIO::UDSEntryList& entriesIn)
@@ -75,50 +194,66 @@ void FileManagerListJob::slotEntries(KIO::Job* job, const KIO::UDSEntryList& ent
 
 void FileManagerListJob::startNextJob()
 {
-    if ( m_listQueue.isEmpty() || m_aborted ) {
+    if ( m_aborted ) {
         return;
     }
 
-#ifdef TIME_IMPORT_JOB
-    m_subTimer.start();
-#endif
-
-    m_item = m_listQueue.dequeue();
-    if (m_item->path().isLocalFile()) {
-        // optimized version for local projects using QDir directly
-        QtConcurrent::run([this] (const Path& path) {
-            if (m_aborted) {
-                return;
+    // local folders are mostly waited for, so list a few more than there are threads
+    const int maxLocalListings = qMax(1, QThread::idealThreadCount()) * 2;
+    while ( !m_listQueue.isEmpty() ) {
+        if (m_listQueue.head()->path().isLocalFile()) {
+            if (m_listing.size() >= maxLocalListings) {
+                break;
             }
-            QDir dir(path.toLocalFile());
-            const auto entries = dir.entryInfoList(QDir::NoDotAndDotDot | QDir::AllEntries | QDir::Hidden);
-            if (m_aborted) {
-                return;
+            listLocal(m_listQueue.dequeue());
+        } else {
+            if (m_remoteItem) {
+                break;
             }
-            KIO::UDSEntryList results;
-            std::transform(entries.begin(), entries.end(), std::back_inserter(results), [] (const QFileInfo& info) -> KIO::UDSEntry {
-                KIO::UDSEntry entry;
-                entry.insert(KIO::UDSEntry::UDS_NAME, info.fileName());
-                if (info.isDir()) {
-                    entry.insert(KIO::UDSEntry::UDS_FILE_TYPE, QT_STAT_DIR);
-                }
-                if (info.isSymLink()) {
-                    entry.insert(KIO::UDSEntry::UDS_LINK_DEST, info.symLinkTarget());
-                }
-                return entry;
-            });
-            QMetaObject::invokeMethod(this, "handleResults", Q_ARG(KIO::UDSEntryList, results));
-        }, m_item->path());
-    } else {
-        KIO::ListJob* job = KIO::listDir( m_item->path().toUrl(), KIO::HideProgressInfo );
-        job->addMetaData(QStringLiteral("details"), QStringLiteral("0"));
-        job->setParentJob( this );
-        connect( job, &KIO::ListJob::entries,
-                this, &FileManagerListJob::slotEntries );
-        connect( job, &KIO::ListJob::result, this, &FileManagerListJob::slotResult );
+            listRemote(m_listQueue.dequeue());
+        }
     }
 }
 
+void FileManagerListJob::listLocal(ProjectFolderItem* item)
+{
+    m_listing.insert(item);
+
+    const QSharedPointer<Results> results = m_results;
+    QtConcurrent::run([results, item] (const QString& path) {
+        {
+            QMutexLocker lock(&results->mutex);
+            if (!results->job) {
+                return;
+            }
+        }
+        ListedFolder folder = {item, listLocalFolder(path)};
+
+        QMutexLocker lock(&results->mutex);
+        if (!results->job) {
+            return;
+        }
+        results->folders << folder;
+        if (results->folders.size() == 1) {
+            // the job takes all folders that were listed until it gets to handle them
+            QMetaObject::invokeMethod(results->job, "handleResults", Qt::QueuedConnection);
+        }
+    }, item->path().toLocalFile());
+}
+
+void FileManagerListJob::listRemote(ProjectFolderItem* item)
+{
+    m_listing.insert(item);
+    m_remoteItem = item;
+
+    KIO::ListJob* job = KIO::listDir( item->path().toUrl(), KIO::HideProgressInfo );
+    job->addMetaData(QStringLiteral("details"), QStringLiteral("0"));
+    job->setParentJob( this );
+    connect( job, &KIO::ListJob::entries,
+            this, &FileManagerListJob::slotEntries );
+    connect( job, &KIO::ListJob::result, this, &FileManagerListJob::slotResult );
+}
+
 void FileManagerListJob::slotResult(KJob* job)
 {
     if (m_aborted) {
@@ -129,28 +264,40 @@ void FileManagerListJob::slotResult(KJob* job)
         qCDebug(FILEMANAGER) << "error in list job:" << job->error() << job->errorString();
     }
 
-    handleResults(entryList);
+    {
+        QMutexLocker lock(&m_results->mutex);
+        m_results->folders << ListedFolder{m_remoteItem, entryList};
+    }
+    m_remoteItem = nullptr;
     entryList.clear();
-}
 
+    handleResults();
+}
 
-void FileManagerListJob::handleResults(const KIO::UDSEntryList& entriesIn)
+void FileManagerListJob::handleResults()
 {
     if (m_aborted) {
         return;
     }
 
-#ifdef TIME_IMPORT_JOB
+    QVector<ListedFolder> folders;
     {
-        auto waited = m_subTimer.elapsed();
-        m_subWaited += waited;
-        qCDebug(PROJECT) << "TIME FOR SUB JOB:" << waited << m_subWaited;
+        QMutexLocker lock(&m_results->mutex);
+        folders.swap(m_results->folders);
     }
-#endif
 
-    emit entries(this, m_item, entriesIn);
+    foreach (const ListedFolder& folder, folders) {
+        if (!m_listing.remove(folder.item)) {
+            // the folder was removed while it was listed
+            continue;
+        }
+        emit entries(this, folder.item, folder.entries);
+        if (m_aborted) {
+            return;
+        }
+    }
 
-    if( m_listQueue.isEmpty() ) {
+    if( m_listQueue.isEmpty() && m_listing.isEmpty() ) {
         emitResult();
 
 #ifdef TIME_IMPORT_JOB
@@ -164,6 +311,10 @@ void FileManagerListJob::handleResults(const KIO::UDSEntryList& entriesIn)
 void FileManagerListJob::abort()
 {
     m_aborted = true;
+    {
+        QMutexLocker lock(&m_results->mutex);
+        m_results->job = nullptr;
+    }
 
     bool killed = kill();
     Q_ASSERT(killed);
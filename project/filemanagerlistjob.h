@@ -21,7 +21,11 @@
 #define KDEVPLATFORM_FILEMANAGERLISTJOB_H
 
 #include <KIO/Job>
+#include <QMutex>
 #include <QQueue>
+#include <QSet>
+#include <QSharedPointer>
+#include <QVector>
 
 // uncomment to time imort jobs
 // #define TIME_IMPORT_JOB
@@ -34,12 +38,22 @@ namespace KDevelop
 {
     class ProjectFolderItem;
 
+/**
+ * Lists @p item and the sub folders that are added to the job while it runs.
+ *
+ * Local folders are listed on the global thread pool, several at a time. The entries of
+ * all folders that were listed meanwhile are emitted together whenever the job gets back
+ * to the event loop, so the items for them are created in one go.
+ */
 class FileManagerListJob : public KIO::Job
 {
     Q_OBJECT
 
 public:
     explicit FileManagerListJob(ProjectFolderItem* item);
+    ~FileManagerListJob() override;
+
+    /// @return the folder the job was started for
     ProjectFolderItem* item() const;
 
     void addSubDir(ProjectFolderItem* item);
@@ -56,22 +70,42 @@ Q_SIGNALS:
 private Q_SLOTS:
     void slotEntries(KIO::Job* job, const KIO::UDSEntryList& entriesIn );
     void slotResult(KJob* job) override;
-    void handleResults(const KIO::UDSEntryList& entries);
+    void handleResults();
     void startNextJob();
 
 private:
+    struct ListedFolder
+    {
+        ProjectFolderItem* item;
+        KIO::UDSEntryList entries;
+    };
+
+    /// Shared with the threads that list local folders, which may outlive the job
+    struct Results
+    {
+        QMutex mutex;
+        /// reset once the job is aborted or deleted
+        FileManagerListJob* job;
+        QVector<ListedFolder> folders;
+    };
+
+    void listLocal(ProjectFolderItem* item);
+    void listRemote(ProjectFolderItem* item);
 
     QQueue<ProjectFolderItem*> m_listQueue;
-    /// current base dir
+    /// the folder the job was started for
     ProjectFolderItem* m_item;
+    /// folders that are being listed right now
+    QSet<ProjectFolderItem*> m_listing;
+    const QSharedPointer<Results> m_results;
+    /// the remote folder that is being listed, they are listed one at a time
+    ProjectFolderItem* m_remoteItem;
     KIO::UDSEntryList entryList;
     // kill does not delete the job instantaniously
     QAtomicInt m_aborted;
 
 #ifdef TIME_IMPORT_JOB
     QElapsedTimer m_timer;
-    QElapsedTimer m_subTimer;
-    qint64 m_subWaited = 0;
 #endif
 };
 
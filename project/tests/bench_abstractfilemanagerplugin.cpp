@@ -0,0 +1,135 @@
+/*
+ * This file is part of KDevelop
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "bench_abstractfilemanagerplugin.h"
+
+#include <project/abstractfilemanagerplugin.h>
+#include <project/projectmodel.h>
+
+#include <tests/autotestshell.h>
+#include <tests/testcore.h>
+#include <tests/testproject.h>
+
+#include <KIO/UDSEntry>
+#include <KJob>
+
+#include <QDir>
+#include <QQueue>
+#include <QTest>
+
+using namespace KDevelop;
+
+namespace {
+const int topFolders = 20;
+const int subFolders = 10;
+const int filesPerFolder = 50;
+}
+
+void BenchAbstractFileManagerPlugin::initTestCase()
+{
+    AutoTestShell::init();
+    TestCore::initialize(Core::NoUi);
+
+    m_plugin = new AbstractFileManagerPlugin({}, ICore::self());
+
+    QVERIFY(m_dir.isValid());
+    QDir root(m_dir.path());
+    for (int i = 0; i < topFolders; ++i) {
+        for (int j = 0; j < subFolders; ++j) {
+            const QString folder = QStringLiteral("folder%1/sub%2").arg(i).arg(j);
+            QVERIFY(root.mkpath(folder));
+            for (int k = 0; k < filesPerFolder; ++k) {
+                QFile file(root.filePath(folder + QStringLiteral("/file%1.cpp").arg(k)));
+                QVERIFY(file.open(QIODevice::WriteOnly));
+                ++m_fileCount;
+            }
+        }
+    }
+#ifdef Q_OS_UNIX
+    // links to files are files, broken links are left out
+    QVERIFY(QFile::link(root.filePath(QStringLiteral("folder0/sub0/file0.cpp")), root.filePath(QStringLiteral("link.cpp"))));
+    ++m_fileCount;
+    QVERIFY(QFile::link(root.filePath(QStringLiteral("missing.cpp")), root.filePath(QStringLiteral("broken.cpp"))));
+#endif
+}
+
+void BenchAbstractFileManagerPlugin::cleanupTestCase()
+{
+    TestCore::shutdown();
+}
+
+int BenchAbstractFileManagerPlugin::import()
+{
+    TestProject project(Path(m_dir.path()));
+    ProjectFolderItem* root = m_plugin->import(&project);
+    KJob* job = m_plugin->createImportJob(root);
+    job->exec();
+    const int files = project.fileSet().size();
+    delete root;
+    return files;
+}
+
+void BenchAbstractFileManagerPlugin::testImport()
+{
+    QCOMPARE(import(), m_fileCount);
+}
+
+void BenchAbstractFileManagerPlugin::benchImport()
+{
+    QBENCHMARK {
+        import();
+    }
+}
+
+void BenchAbstractFileManagerPlugin::benchSequentialListing()
+{
+    // how local folders were listed before, one after another with a QFileInfo for each entry;
+    // this does not create any items, which benchImport() includes
+    QBENCHMARK {
+        int files = 0;
+        QQueue<QString> folders;
+        folders.enqueue(m_dir.path());
+        while (!folders.isEmpty()) {
+            const QString folder = folders.dequeue();
+            const auto infos = QDir(folder).entryInfoList(QDir::NoDotAndDotDot | QDir::AllEntries | QDir::Hidden);
+            KIO::UDSEntryList entries;
+            for (const QFileInfo& info : infos) {
+                KIO::UDSEntry entry;
+                entry.insert(KIO::UDSEntry::UDS_NAME, info.fileName());
+                if (info.isDir()) {
+                    entry.insert(KIO::UDSEntry::UDS_FILE_TYPE, QT_STAT_DIR);
+                }
+                if (info.isSymLink()) {
+                    entry.insert(KIO::UDSEntry::UDS_LINK_DEST, info.symLinkTarget());
+                }
+                entries << entry;
+            }
+            for (const KIO::UDSEntry& entry : entries) {
+                if (entry.isDir()) {
+                    folders.enqueue(folder + QLatin1Char('/') + entry.stringValue(KIO::UDSEntry::UDS_NAME));
+                } else {
+                    ++files;
+                }
+            }
+        }
+        QCOMPARE(files, m_fileCount);
+    }
+}
+
+QTEST_MAIN(BenchAbstractFileManagerPlugin)
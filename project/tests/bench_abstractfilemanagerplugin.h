@@ -0,0 +1,49 @@
+/*
+ * This file is part of KDevelop
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Library General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KDEVPLATFORM_BENCH_ABSTRACTFILEMANAGERPLUGIN_H
+#define KDEVPLATFORM_BENCH_ABSTRACTFILEMANAGERPLUGIN_H
+
+#include <QObject>
+#include <QTemporaryDir>
+
+namespace KDevelop {
+class AbstractFileManagerPlugin;
+}
+
+class BenchAbstractFileManagerPlugin : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+    void testImport();
+    void benchImport();
+    void benchSequentialListing();
+
+private:
+    /// @return the number of files in the imported project
+    int import();
+
+    KDevelop::AbstractFileManagerPlugin* m_plugin = nullptr;
+    QTemporaryDir m_dir;
+    int m_fileCount = 0;
+};
+
+#endif
@@ -20,6 +20,14 @@
 
 #include "config-kdevplatform.h"
 
+#include <QFileDevice>
+
+#if defined(Q_OS_WIN)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
 namespace KDevelop {
 
 uint staticItemRepositoryVersion()
@@ -27,6 +35,22 @@ uint staticItemRepositoryVersion()
   return KDEV_ITEMREPOSITORY_VERSION;
 }
 
+bool syncToDisk(QFileDevice* file)
+{
+  if(!file->flush())
+    return false;
+  const int handle = file->handle();
+  if(handle == -1)
+    return false;
+#if defined(Q_OS_WIN)
+  return _commit(handle) == 0;
+#elif defined(Q_OS_LINUX)
+  return fdatasync(handle) == 0;
+#else
+  return fsync(handle) == 0;
+#endif
+}
+
 AbstractItemRepository::~AbstractItemRepository()
 {
 }
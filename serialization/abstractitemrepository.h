@@ -24,12 +24,16 @@
 #include "serializationexport.h"
 
 class QString;
+class QFileDevice;
 
 namespace KDevelop {
 
 /// Returns a version-number that is used to reset the item-repository after incompatible layout changes.
 KDEVPLATFORMSERIALIZATION_EXPORT uint staticItemRepositoryVersion();
 
+/// Flushes @p file and waits until its data is on the disk. Returns false if that failed.
+KDEVPLATFORMSERIALIZATION_EXPORT bool syncToDisk(QFileDevice* file);
+
 /// The interface class for an item-repository object.
 class KDEVPLATFORMSERIALIZATION_EXPORT AbstractItemRepository
 {
@@ -40,7 +44,18 @@ class KDEVPLATFORMSERIALIZATION_EXPORT AbstractItemRepository
     virtual bool open(const QString& path) = 0;
     virtual void close(bool doStore = false) = 0;
     /// Stores the repository contents to disk, eventually unloading unused data to save memory.
+    /// Equivalent to storeJournal(), syncFiles(), commitJournal(), applyJournal(), syncFiles() and finishJournal().
     virtual void store() = 0;
+    /// Writes all changes since the last store into a pending journal, without touching the repository itself.
+    virtual void storeJournal() = 0;
+    /// Waits until the files written by storeJournal() or applyJournal() are on the disk.
+    virtual void syncFiles() = 0;
+    /// Commits the pending journal. From now on it is replayed when the repository is opened after a crash.
+    virtual void commitJournal() = 0;
+    /// Applies the committed journal to the repository files.
+    virtual void applyJournal() = 0;
+    /// Removes the applied journal, and eventually unloads unused data.
+    virtual void finishJournal() = 0;
     /// Does a big cleanup, removing all non-persistent items in the repositories.
     /// @returns Count of bytes of data that have been removed.
     virtual int finalCleanup() = 0;
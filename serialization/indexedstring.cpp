@@ -22,14 +22,199 @@
 
 #include "referencecounting.h"
 
+#include <cstring>
+
+// The vectorized hash functions assume that char is signed, like the scalar RunningHash on these platforms
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__) && defined(__GNUC__) && !defined(__CHAR_UNSIGNED__)
+#define KDEV_VECTORIZED_STRING_HASH 1
+#include <immintrin.h>
+#endif
+
 using namespace KDevelop;
 
 namespace {
 
+/**
+ * The string hash is the classic "hash * 33 + c" of RunningHash, which is stored in the on-disk repositories,
+ * so all implementations below must return exactly the same values.
+ *
+ * For a block of N characters the hash develops as
+ *   hash' = hash * 33^N + c_0 * 33^(N-1) + ... + c_(N-1) * 33^0
+ * which allows computing the characters of a block in independent vector lanes: Each lane accumulates
+ * the characters at its position of all blocks using Horner's scheme with the factor 33^N, and the lanes
+ * are weighted and summed up at the end. All arithmetic is modulo 2^32, like in the scalar version.
+ */
+uint hashStringScalar(uint hash, const char* str, uint length)
+{
+    for (uint a = 0; a < length; ++a) {
+        hash = ((hash << 5) + hash) + str[a];
+    }
+    return hash;
+}
+
+#ifdef KDEV_VECTORIZED_STRING_HASH
+
+constexpr uint powerOf33(uint exponent)
+{
+    return exponent ? 33u * powerOf33(exponent - 1) : 1u;
+}
+
+///The weight of each position in a block of 32 characters, which is 33^(31 - position).
+///The last 16 entries are the weights for blocks of 16 characters.
+struct BlockWeights
+{
+    BlockWeights()
+    {
+        uint power = 1;
+        for (int position = 31; position >= 0; --position) {
+            weights[position] = power;
+            power *= 33;
+        }
+    }
+
+    alignas(32) uint weights[32];
+};
+
+const uint* blockWeights()
+{
+    static const BlockWeights blockWeights;
+    return blockWeights.weights;
+}
+
+///Emulates _mm_mullo_epi32, which is only available since SSE4.1
+inline __m128i multiplySse2(__m128i a, __m128i b)
+{
+    const __m128i even = _mm_mul_epu32(a, b);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+inline uint horizontalSumSse2(__m128i sum)
+{
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return static_cast<uint>(_mm_cvtsi128_si32(sum));
+}
+
+///Processes blocks of 16 characters in four vectors with four lanes each
+uint hashStringSse2(uint hash, const char* str, uint length)
+{
+    const uint blocks = length / 16;
+    if (!blocks) {
+        return hashStringScalar(hash, str, length);
+    }
+
+    constexpr uint Factor = powerOf33(16);
+    const __m128i factor = _mm_set1_epi32(Factor);
+    __m128i acc[4] = {_mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128()};
+    //The previous hash gets the weight 33^0 at the end, so it ends up multiplied by 33^(16 * blocks)
+    acc[3] = _mm_set_epi32(static_cast<int>(hash), 0, 0, 0);
+
+    for (uint block = 0; block < blocks; ++block, str += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str));
+        //Sign-extend the characters to 32 bits
+        const __m128i low16 = _mm_srai_epi16(_mm_unpacklo_epi8(bytes, bytes), 8);
+        const __m128i high16 = _mm_srai_epi16(_mm_unpackhi_epi8(bytes, bytes), 8);
+        const __m128i chars[4] = {
+            _mm_srai_epi32(_mm_unpacklo_epi16(low16, low16), 16),
+            _mm_srai_epi32(_mm_unpackhi_epi16(low16, low16), 16),
+            _mm_srai_epi32(_mm_unpacklo_epi16(high16, high16), 16),
+            _mm_srai_epi32(_mm_unpackhi_epi16(high16, high16), 16)
+        };
+        for (int i = 0; i < 4; ++i) {
+            acc[i] = _mm_add_epi32(multiplySse2(acc[i], factor), chars[i]);
+        }
+    }
+
+    const uint* weights = blockWeights() + 16;
+    __m128i sum = _mm_setzero_si128();
+    for (int i = 0; i < 4; ++i) {
+        sum = _mm_add_epi32(sum, multiplySse2(acc[i], _mm_load_si128(reinterpret_cast<const __m128i*>(weights + 4 * i))));
+    }
+
+    return hashStringScalar(horizontalSumSse2(sum), str, length % 16);
+}
+
+///Processes blocks of 32 characters in four vectors with eight lanes each
+__attribute__((target("avx2")))
+uint hashStringAvx2(uint hash, const char* str, uint length)
+{
+    const uint blocks = length / 32;
+    if (!blocks) {
+        return hashStringSse2(hash, str, length);
+    }
+
+    constexpr uint Factor = powerOf33(32);
+    const __m256i factor = _mm256_set1_epi32(Factor);
+    __m256i acc[4] = {_mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256()};
+    acc[3] = _mm256_set_epi32(static_cast<int>(hash), 0, 0, 0, 0, 0, 0, 0);
+
+    for (uint block = 0; block < blocks; ++block, str += 32) {
+        for (int i = 0; i < 4; ++i) {
+            const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(str + 8 * i));
+            acc[i] = _mm256_add_epi32(_mm256_mullo_epi32(acc[i], factor), _mm256_cvtepi8_epi32(bytes));
+        }
+    }
+
+    const uint* weights = blockWeights();
+    __m256i sum = _mm256_setzero_si256();
+    for (int i = 0; i < 4; ++i) {
+        sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(acc[i], _mm256_load_si256(reinterpret_cast<const __m256i*>(weights + 8 * i))));
+    }
+    const __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+
+    return hashStringSse2(horizontalSumSse2(half), str, length % 32);
+}
+
+#endif
+
+using HashFunction = uint (*)(uint hash, const char* str, uint length);
+
+HashFunction selectHashFunction()
+{
+#ifdef KDEV_VECTORIZED_STRING_HASH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return hashStringAvx2;
+    }
+    return hashStringSse2;
+#else
+    return hashStringScalar;
+#endif
+}
+
+///Strings shorter than this are hashed with the scalar loop, the vector setup does not pay off for them
+const uint MinimumVectorHashLength = 16;
+
+inline uint hashText(const char* str, uint length)
+{
+    if (length < MinimumVectorHashLength) {
+        return hashStringScalar(IndexedString::RunningHash::HashInitialValue, str, length);
+    }
+    static const HashFunction function = selectHashFunction();
+    return function(IndexedString::RunningHash::HashInitialValue, str, length);
+}
+
+///Compares the texts of two strings of the same length.
+///Strings that collide in the repository are mostly paths with a common prefix, so the end is checked first.
+inline bool equalText(const char* a, const char* b, uint length)
+{
+    if (length >= sizeof(quint64)) {
+        quint64 tailA;
+        quint64 tailB;
+        memcpy(&tailA, a + length - sizeof(quint64), sizeof(quint64));
+        memcpy(&tailB, b + length - sizeof(quint64), sizeof(quint64));
+        if (tailA != tailB) {
+            return false;
+        }
+    }
+    return memcmp(a, b, length) == 0;
+}
+
 struct IndexedStringData
 {
     unsigned short length;
-    uint refCount;
+    QAtomicInteger<uint> refCount;
 
     uint itemSize() const
     {
@@ -38,24 +223,20 @@ struct IndexedStringData
 
     uint hash() const
     {
-        IndexedString::RunningHash running;
         const char* str = ((const char*)this) + sizeof(IndexedStringData);
-        for (int a = length - 1; a >= 0; --a) {
-            running.append(*str);
-            ++str;
-        }
-        return running.hash;
+        return hashText(str, length);
     }
 };
 
-inline void increase(uint& val)
+inline void increase(QAtomicInteger<uint>& val)
 {
-    ++val;
+    val.ref();
 }
 
-inline void decrease(uint& val)
+inline void decrease(QAtomicInteger<uint>& val)
 {
-    --val;
+    Q_ASSERT(val.load());
+    val.deref();
 }
 
 struct IndexedStringRepositoryItemRequest
@@ -91,7 +272,7 @@ struct IndexedStringRepositoryItemRequest
     void createItem(IndexedStringData* item) const
     {
         item->length = m_length;
-        item->refCount = 0;
+        item->refCount.store(0);
         ++item;
         memcpy(item, m_text, m_length);
     }
@@ -104,13 +285,13 @@ struct IndexedStringRepositoryItemRequest
 
     static bool persistent(const IndexedStringData* item)
     {
-        return (bool)item->refCount;
+        return (bool)item->refCount.load();
     }
 
     //Should return whether the here requested item equals the given item
     bool equals(const IndexedStringData* item) const
     {
-        return item->length == m_length && (memcmp(++item, m_text, m_length) == 0);
+        return item->length == m_length && equalText(reinterpret_cast<const char*>(item + 1), m_text, m_length);
     }
 
     uint m_hash;
@@ -193,8 +374,8 @@ inline void ref(IndexedString* string)
     const uint index = string->index();
     if (index && !isSingleCharIndex(index)) {
         if (shouldDoDUChainReferenceCounting(string)) {
-            editRepo([index] (IndexedStringRepository* repo) {
-                increase(repo->dynamicItemFromIndexSimple(index)->refCount);
+            globalIndexedStringRepository()->changeItemLockFree(index, [] (IndexedStringData* item) {
+                increase(item->refCount);
             });
         }
     }
@@ -205,8 +386,8 @@ inline void deref(IndexedString* string)
     const uint index = string->index();
     if (index && !isSingleCharIndex(index)) {
         if (shouldDoDUChainReferenceCounting(string)) {
-            editRepo([index] (IndexedStringRepository* repo) {
-                decrease(repo->dynamicItemFromIndexSimple(index)->refCount);
+            globalIndexedStringRepository()->changeItemLockFree(index, [] (IndexedStringData* item) {
+                decrease(item->refCount);
             });
         }
     }
@@ -372,12 +553,7 @@ QByteArray IndexedString::byteArray() const
 
 uint IndexedString::hashString(const char* str, unsigned short length)
 {
-    RunningHash running;
-    for (int a = length - 1; a >= 0; --a) {
-        running.append(*str);
-        ++str;
-    }
-    return running.hash;
+    return hashText(str, length);
 }
 
 uint IndexedString::indexForString(const char* str, short unsigned length, uint hash)
@@ -19,9 +19,15 @@
 #ifndef KDEVPLATFORM_ITEMREPOSITORY_H
 #define KDEVPLATFORM_ITEMREPOSITORY_H
 
+#include <QAtomicPointer>
+#include <QReadWriteLock>
+#include <QThread>
 #include <QDebug>
+#include <QBuffer>
 #include <QDir>
 #include <QFile>
+#include <QHash>
+#include <QStringList>
 
 #include <KMessageBox>
 #include <KLocalizedString>
@@ -33,7 +39,6 @@
 
 //#define DEBUG_MONSTERBUCKETS
 
-// #define DEBUG_ITEMREPOSITORY_LOADING
 // #define ifDebugInfiniteRecursion(x) x
 #define ifDebugInfiniteRecursion(x)
 
@@ -138,6 +143,7 @@ class Bucket {
       , m_nextBucketHash(nullptr)
       , m_dirty(false)
       , m_changed(false)
+      , m_journaled(false)
       , m_lastUsed(0)
     {
     }
@@ -164,7 +170,7 @@ class Bucket {
         memset(m_nextBucketHash, 0, NextBucketHashSize * sizeof(short unsigned int));
         m_changed = true;
         m_dirty = false;
-        m_lastUsed = 0;
+        markUsed();
       }
     }
 
@@ -191,76 +197,63 @@ class Bucket {
           m_mappedData = current;
 
           m_changed = false;
-          m_lastUsed = 0;
+          markUsed();
           VERIFY(current - start == (DataSize - ItemRepositoryBucketSize));
       }
     }
 
-    void store(QFile* file, size_t offset) {
-      if(!m_data)
-        return;
-
-      if(static_cast<size_t>(file->size()) < offset + (1+m_monsterBucketExtent)*DataSize)
-        file->resize(offset + (1+m_monsterBucketExtent)*DataSize);
-
-      file->seek(offset);
-
-      file->write((char*)&m_monsterBucketExtent, sizeof(unsigned int));
-      file->write((char*)&m_available, sizeof(unsigned int));
-      file->write((char*)m_objectMap, sizeof(short unsigned int) * ObjectMapSize);
-      file->write((char*)m_nextBucketHash, sizeof(short unsigned int) * NextBucketHashSize);
-      file->write((char*)&m_largestFreeItem, sizeof(short unsigned int));
-      file->write((char*)&m_freeItemCount, sizeof(unsigned int));
-      file->write((char*)&m_dirty, sizeof(bool));
-      file->write(m_data, ItemRepositoryBucketSize + m_monsterBucketExtent * DataSize);
+    ///Reads the bucket stored at the current position of @p file directly into memory owned by this bucket.
+    ///Used when the bucket is not reachable through the memory-map.
+    void initializeFromFile(QFile* file) {
+      if(!m_data) {
+        file->read((char*)&m_monsterBucketExtent, sizeof(unsigned int));
+        file->read((char*)&m_available, sizeof(unsigned int));
+        m_objectMap = new short unsigned int[ObjectMapSize];
+        file->read((char*)m_objectMap, sizeof(short unsigned int) * ObjectMapSize);
+        m_nextBucketHash = new short unsigned int[NextBucketHashSize];
+        file->read((char*)m_nextBucketHash, sizeof(short unsigned int) * NextBucketHashSize);
+        file->read((char*)&m_largestFreeItem, sizeof(short unsigned int));
+        file->read((char*)&m_freeItemCount, sizeof(unsigned int));
+        file->read((char*)&m_dirty, sizeof(bool));
+        m_data = new char[ItemRepositoryBucketSize + m_monsterBucketExtent * DataSize];
+        file->read(m_data, ItemRepositoryBucketSize + m_monsterBucketExtent * DataSize);
 
-      if(static_cast<size_t>(file->pos()) != offset + (1+m_monsterBucketExtent)*DataSize)
-      {
-        KMessageBox::error(nullptr, i18n("Failed writing to %1, probably the disk is full", file->fileName()));
-        abort();
+        m_changed = false;
+        markUsed();
       }
+    }
 
+    ///Writes the bucket in its on-disk format to the current position of @p device, and marks it as unchanged.
+    ///The written size is (1 + monsterBucketExtent()) * DataSize.
+    ///Writes (1 + monsterBucketExtent()) * DataSize bytes into @p device, which only needs a write(const char*, qint64) function
+    template<class Device>
+    void write(Device* device) {
+      writeData(device);
       m_changed = false;
-#ifdef DEBUG_ITEMREPOSITORY_LOADING
-      {
-        file->flush();
-        file->seek(offset);
-
-        uint available, freeItemCount, monsterBucketExtent;
-        short unsigned int largestFree;
-        bool dirty;
-
-        short unsigned int* m = new short unsigned int[ObjectMapSize];
-        short unsigned int* h = new short unsigned int[NextBucketHashSize];
-
-
-        file->read((char*)&monsterBucketExtent, sizeof(unsigned int));
-        char* d = new char[ItemRepositoryBucketSize + monsterBucketExtent * DataSize];
+    }
 
-        file->read((char*)&available, sizeof(unsigned int));
-        file->read((char*)m, sizeof(short unsigned int) * ObjectMapSize);
-        file->read((char*)h, sizeof(short unsigned int) * NextBucketHashSize);
-        file->read((char*)&largestFree, sizeof(short unsigned int));
-        file->read((char*)&freeItemCount, sizeof(unsigned int));
-        file->read((char*)&dirty, sizeof(bool));
-        file->read(d, ItemRepositoryBucketSize);
+    ///Marks that the current state was written into a journal that is not applied yet, see writeJournaled()
+    void markJournaled() {
+      m_journaled = true;
+    }
 
-        Q_ASSERT(monsterBucketExtent == m_monsterBucketExtent);
-        Q_ASSERT(available == m_available);
-        Q_ASSERT(memcmp(d, m_data, ItemRepositoryBucketSize + monsterBucketExtent * DataSize) == 0);
-        Q_ASSERT(memcmp(m, m_objectMap, sizeof(short unsigned int) * ObjectMapSize) == 0);
-        Q_ASSERT(memcmp(h, m_nextBucketHash, sizeof(short unsigned int) * NextBucketHashSize) == 0);
-        Q_ASSERT(m_largestFreeItem == largestFree);
-        Q_ASSERT(m_freeItemCount == freeItemCount);
-        Q_ASSERT(m_dirty == dirty);
+    ///Writes the state that was marked by markJournaled() into @p device, even if the bucket changed meanwhile, and forgets it
+    template<class Device>
+    void writeJournaled(Device* device) {
+      if(m_journalSnapshot.isNull())
+        writeData(device);
+      else
+        device->write(m_journalSnapshot.constData(), m_journalSnapshot.size());
+      discardJournaled();
+    }
 
-        Q_ASSERT(static_cast<size_t>(file->pos()) == offset + DataSize + m_monsterBucketExtent * DataSize);
+    bool journaled() const {
+      return m_journaled || !m_journalSnapshot.isNull();
+    }
 
-        delete[] d;
-        delete[] m;
-        delete[] h;
-      }
-#endif
+    void discardJournaled() {
+      m_journaled = false;
+      m_journalSnapshot = QByteArray();
     }
 
     inline char* data() {
@@ -273,7 +266,7 @@ class Bucket {
 
     //Tries to find the index this item has in this bucket, or returns zero if the item isn't there yet.
     unsigned short findIndex(const ItemRequest& request) const {
-      m_lastUsed = 0;
+      markUsed();
 
       unsigned short localHash = request.hash() % ObjectMapSize;
       unsigned short index = m_objectMap[localHash];
@@ -293,7 +286,7 @@ class Bucket {
     //Tries to get the index within this bucket, or returns zero. Will put the item into the bucket if there is room.
     //Created indices will never begin with 0xffff____, so you can use that index-range for own purposes.
     unsigned short index(const ItemRequest& request, unsigned int itemSize) {
-      m_lastUsed = 0;
+      markUsed();
 
       unsigned short localHash = request.hash() % ObjectMapSize;
       unsigned short index = m_objectMap[localHash];
@@ -471,7 +464,7 @@ class Bucket {
 
       Q_ASSERT(modulo % ObjectMapSize == 0);
 
-      m_lastUsed = 0;
+      markUsed();
 
       uint hashMod = hash % modulo;
       unsigned short localHash = hash % ObjectMapSize;
@@ -534,7 +527,7 @@ class Bucket {
     void deleteItem(unsigned short index, unsigned int hash, Repository& repository) {
       ifDebugLostSpace( Q_ASSERT(!lostSpace()); )
 
-      m_lastUsed = 0;
+      markUsed();
       prepareChange();
 
       unsigned int size = itemFromIndex(index)->itemSize();
@@ -618,7 +611,13 @@ class Bucket {
     ///         If you need to change something, use dynamicItemFromIndex
     ///@warning When using multi-threading, mutex() must be locked as long as you use the returned data
     inline const Item* itemFromIndex(unsigned short index) const {
-      m_lastUsed = 0;
+      markUsed();
+      return reinterpret_cast<Item*>(m_data+index);
+    }
+
+    ///Like itemFromIndex(), but does not mark the bucket as used, so it may be called without holding the mutex.
+    ///Only valid for buckets whose data was made private by prepareChange().
+    inline Item* changedItemFromIndex(unsigned short index) const {
       return reinterpret_cast<Item*>(m_data+index);
     }
 
@@ -644,7 +643,7 @@ class Bucket {
 
     template<class Visitor>
     bool visitAllItems(Visitor& visitor) const {
-      m_lastUsed = 0;
+      markUsed();
       for(uint a = 0; a < ObjectMapSize; ++a) {
         uint currentIndex = m_objectMap[a];
         while(currentIndex) {
@@ -691,12 +690,12 @@ class Bucket {
     }
 
     unsigned short nextBucketForHash(uint hash) const {
-      m_lastUsed = 0;
+      markUsed();
       return m_nextBucketHash[hash % NextBucketHashSize];
     }
 
     void setNextBucketForHash(unsigned int hash, unsigned short bucket) {
-      m_lastUsed = 0;
+      markUsed();
       prepareChange();
       m_nextBucketHash[hash % NextBucketHashSize] = bucket;
     }
@@ -743,12 +742,12 @@ class Bucket {
     }
 
     void tick() const {
-      ++m_lastUsed;
+      m_lastUsed.ref();
     }
 
     //How many ticks ago the item was last used
     int lastUsed() const {
-      return m_lastUsed;
+      return m_lastUsed.load();
     }
 
     //Whether this bucket was changed since it was last stored
@@ -757,6 +756,13 @@ class Bucket {
     }
 
     void prepareChange() {
+      if(m_journaled) {
+        //The journal that is not applied yet contains the current state, so it is kept until writeJournaled()
+        QBuffer buffer(&m_journalSnapshot);
+        buffer.open(QIODevice::WriteOnly);
+        writeData(&buffer);
+        m_journaled = false;
+      }
       m_changed = true;
       m_dirty = true;
       makeDataPrivate();
@@ -798,6 +804,24 @@ class Bucket {
 
   private:
 
+    template<class Device>
+    void writeData(Device* device) const {
+      device->write((char*)&m_monsterBucketExtent, sizeof(unsigned int));
+      device->write((char*)&m_available, sizeof(unsigned int));
+      device->write((char*)m_objectMap, sizeof(short unsigned int) * ObjectMapSize);
+      device->write((char*)m_nextBucketHash, sizeof(short unsigned int) * NextBucketHashSize);
+      device->write((char*)&m_largestFreeItem, sizeof(short unsigned int));
+      device->write((char*)&m_freeItemCount, sizeof(unsigned int));
+      device->write((char*)&m_dirty, sizeof(bool));
+      device->write(m_data, ItemRepositoryBucketSize + m_monsterBucketExtent * DataSize);
+    }
+
+    //Only written when it changes, so concurrent lookups don't keep writing to the same cache line
+    void markUsed() const {
+      if(m_lastUsed.load())
+        m_lastUsed.store(0);
+    }
+
     void makeDataPrivate() {
       if(m_mappedData == m_data) {
         short unsigned int* oldObjectMap = m_objectMap;
@@ -971,7 +995,9 @@ class Bucket {
 
     bool m_dirty; //Whether the data was changed since the last finalCleanup
     bool m_changed; //Whether this bucket was changed since it was last stored to disk
-    mutable int m_lastUsed; //How many ticks ago this bucket was last accessed
+    bool m_journaled; //Whether the current state is in a journal that is not applied yet
+    QByteArray m_journalSnapshot; //The state in the journal that is not applied yet, if the bucket changed since
+    mutable QAtomicInt m_lastUsed; //How many ticks ago this bucket was last accessed. Atomic, as lookups may run concurrently in the striped mode
 };
 
 template<bool lock>
@@ -1038,11 +1064,10 @@ class DynamicItem {
 ///                                that does on-disk reference counting, like IndexedString, IndexedIdentifier, etc.
 ///@tparam threadSafe Whether class access should be thread-safe. Disabling this is dangerous when you do multi-threading.
 ///                  You have to make sure that mutex() is locked whenever the repository is accessed.
+///                  Thread-safe repositories can additionally use the striped mode, see setStripeBits().
 template<class Item, class ItemRequest, bool markForReferenceCounting = true, bool threadSafe = true, uint fixedItemSize = 0, unsigned int targetBucketHashSize = 524288*2>
 class ItemRepository : public AbstractItemRepository {
 
-  typedef Locker<threadSafe> ThisLocker;
-
   typedef Bucket<Item, ItemRequest, markForReferenceCounting, fixedItemSize> MyBucket;
 
   enum {
@@ -1055,6 +1080,10 @@ class ItemRepository : public AbstractItemRepository {
     BucketStartOffset = sizeof(uint) * 7 + sizeof(short unsigned int) * bucketHashSize //Position in the data where the bucket array starts
   };
 
+  enum {
+    FileMapMinimumGrowth = 4 * 1024 * 1024 //The least amount of bucket data that is mapped at once, see extendFileMap()
+  };
+
   public:
   ///@param registry May be zero, then the repository will not be registered at all. Else, the repository will register itself to that registry.
   ///                If this is zero, you have to care about storing the data using store() and/or close() by yourself. It does not happen automatically.
@@ -1066,9 +1095,14 @@ class ItemRepository : public AbstractItemRepository {
     , m_repositoryName(repositoryName)
     , m_registry(registry)
     , m_file(nullptr)
+    , m_fileMapSize(0)
+    , m_fileDataSize(0)
     , m_dynamicFile(nullptr)
     , m_repositoryVersion(repositoryVersion)
     , m_manager(manager)
+    , m_stripes(nullptr)
+    , m_stripeCount(0)
+    , m_stripesLockDepth(0)
   {
     m_unloadingEnabled = true;
     m_metaDataChanged = true;
@@ -1087,6 +1121,9 @@ class ItemRepository : public AbstractItemRepository {
     if(m_registry)
       m_registry->unRegisterRepository(this);
     close();
+    for(auto& chunk : m_changedBuckets)
+      delete[] chunk.loadAcquire();
+    delete[] m_stripes;
   }
 
   ///Unloading of buckets is enabled by default. Use this to disable it. When unloading is enabled, the data
@@ -1095,12 +1132,41 @@ class ItemRepository : public AbstractItemRepository {
       m_unloadingEnabled = enabled;
   }
 
+  ///Enables the striped mode: The bucket-hash is partitioned into 2^@p stripeBits stripes, each with its own read-write lock.
+  ///findIndex(..), itemFromIndex(..), and index(..) of items that exist already only lock the stripe of the hash or bucket
+  ///they look at for reading, so they run concurrently. Everything else, including inserting, deleting, and loading
+  ///buckets, locks the mutex and all stripes for writing. The on-disk format is not affected.
+  ///
+  ///Must be called before the repository is used, and only for thread-safe repositories.
+  ///@warning In the striped mode, locking mutex() does not keep lookups from running, so the repository must not be changed
+  ///         through dynamicItemFromIndex(..) or dynamicItemFromIndexSimple(..). ItemRequest::equals(..) must not use the same repository.
+  void setStripeBits(uint stripeBits) {
+    Q_ASSERT(threadSafe);
+    Q_ASSERT(!m_stripes);
+    Q_ASSERT(stripeBits <= 8);
+    m_stripeCount = 1u << stripeBits;
+    m_stripes = new Stripe[m_stripeCount];
+  }
+
+  ///The count of stripes, or zero if the striped mode is disabled
+  uint stripeCount() const {
+    return m_stripeCount;
+  }
+
   ///Returns the index for the given item. If the item is not in the repository yet, it is inserted.
   ///The index can never be zero. Zero is reserved for your own usage as invalid
   ///@param request Item to retrieve the index from
   unsigned int index(const ItemRequest& request) {
 
-    ThisLocker lock(m_mutex);
+    if(m_stripes) {
+      //Items that exist already are found without blocking other lookups
+      bool complete = false;
+      const uint found = findLoadedIndex(request, &complete);
+      if(found)
+        return found;
+    }
+
+    ExclusiveLocker lock(this);
 
     const uint hash = request.hash();
     const uint size = request.itemSize();
@@ -1177,7 +1243,7 @@ class ItemRepository : public AbstractItemRepository {
           return 0;
         }else{
           //Allocate new buckets
-          m_buckets.resize(m_buckets.size() + 10);
+          m_buckets.resize(qMin(m_buckets.size() + 10, 0xfffe));
         }
       }
       MyBucket* bucketPtr = m_buckets.at(useBucket);
@@ -1235,8 +1301,12 @@ class ItemRepository : public AbstractItemRepository {
           //Create a new monster-bucket at the end of the data
           int needMonsterExtent = (totalSize - ItemRepositoryBucketSize) / MyBucket::DataSize + 1;
           Q_ASSERT(needMonsterExtent);
+          if(m_currentBucket + needMonsterExtent + 1 > 0xfffe) {
+            qWarning() << "Found no room for a monster-bucket in" << m_repositoryName << "size of the item:" << request.itemSize();
+            return 0;
+          }
           if(m_currentBucket + needMonsterExtent + 1 > m_buckets.size()) {
-            m_buckets.resize(m_buckets.size() + 10 + needMonsterExtent + 1);
+            m_buckets.resize(qMin(m_buckets.size() + 10 + needMonsterExtent + 1, 0xfffe));
           }
           useBucket = m_currentBucket;
 
@@ -1347,7 +1417,14 @@ class ItemRepository : public AbstractItemRepository {
   ///Returns zero if the item is not in the repository yet
   unsigned int findIndex(const ItemRequest& request) {
 
-    ThisLocker lock(m_mutex);
+    if(m_stripes) {
+      bool complete = false;
+      const uint found = findLoadedIndex(request, &complete);
+      if(complete)
+        return found;
+    }
+
+    ExclusiveLocker lock(this);
 
     return walkBucketChain(request.hash(), [this, &request](ushort bucketIdx, const MyBucket* bucketPtr) {
         const ushort indexInBucket = bucketPtr->findIndex(request);
@@ -1358,7 +1435,7 @@ class ItemRepository : public AbstractItemRepository {
   ///Deletes the item from the repository.
   void deleteItem(unsigned int index) {
     verifyIndex(index);
-    ThisLocker lock(m_mutex);
+    ExclusiveLocker lock(this);
 
     m_metaDataChanged = true;
 
@@ -1442,7 +1519,7 @@ class ItemRepository : public AbstractItemRepository {
   MyDynamicItem dynamicItemFromIndex(unsigned int index) {
     verifyIndex(index);
 
-    ThisLocker lock(m_mutex);
+    ExclusiveLocker lock(this);
 
     unsigned short bucket = (index >> 16);
 
@@ -1452,6 +1529,7 @@ class ItemRepository : public AbstractItemRepository {
       bucketPtr = m_buckets.at(bucket);
     }
     bucketPtr->prepareChange();
+    publishChangedBucket(bucket, bucketPtr);
     unsigned short indexInBucket = index & 0xffff;
     return MyDynamicItem(const_cast<Item*>(bucketPtr->itemFromIndex(indexInBucket)), bucketPtr->data(), bucketPtr->dataSize());
   }
@@ -1466,7 +1544,7 @@ class ItemRepository : public AbstractItemRepository {
   Item* dynamicItemFromIndexSimple(unsigned int index) {
     verifyIndex(index);
 
-    ThisLocker lock(m_mutex);
+    ExclusiveLocker lock(this);
 
     unsigned short bucket = (index >> 16);
 
@@ -1476,18 +1554,55 @@ class ItemRepository : public AbstractItemRepository {
       bucketPtr = m_buckets.at(bucket);
     }
     bucketPtr->prepareChange();
+    publishChangedBucket(bucket, bucketPtr);
     unsigned short indexInBucket = index & 0xffff;
     return const_cast<Item*>(bucketPtr->itemFromIndex(indexInBucket));
   }
 
+  ///Calls @p change with an editable version of the item. The mutex is only locked if the bucket of the item has not
+  ///been prepared for changes since the repository was last stored, later changes to the bucket don't need it.
+  ///
+  ///This is meant for reference counts, that are changed extremely often by many threads.
   ///@param index The index. It must be valid(match an existing item), and nonzero.
-  const Item* itemFromIndex(unsigned int index) const {
+  ///@param change Is called with an Item*, and must not keep the pointer.
+  ///@warning Other threads may change the item at the same time, so only change members that are atomic.
+  template<class Change>
+  void changeItemLockFree(unsigned int index, const Change& change) {
     verifyIndex(index);
 
-    ThisLocker lock(m_mutex);
+    const unsigned short bucket = (index >> 16);
+
+    //While the count is nonzero, the published buckets are not taken away. If they are being taken away
+    //right now, the change waits for the mutex instead.
+    if(!(m_lockFreeChanges.fetchAndAddOrdered(1) & RetiringChangedBuckets)) {
+      QAtomicPointer<MyBucket>* chunk = m_changedBuckets[bucket / ChangedBucketsChunkSize].loadAcquire();
+      MyBucket* bucketPtr = chunk ? chunk[bucket % ChangedBucketsChunkSize].loadAcquire() : nullptr;
+      if(bucketPtr) {
+        change(bucketPtr->changedItemFromIndex(index & 0xffff));
+        m_lockFreeChanges.fetchAndSubOrdered(1);
+        return;
+      }
+    }
+    m_lockFreeChanges.fetchAndSubOrdered(1);
+
+    ExclusiveLocker lock(this, true);
+    change(dynamicItemFromIndexSimple(index));
+  }
+
+  ///@param index The index. It must be valid(match an existing item), and nonzero.
+  const Item* itemFromIndex(unsigned int index) const {
+    verifyIndex(index);
 
     unsigned short bucket = (index >> 16);
 
+    if(m_stripes) {
+      StripeReadLocker lock(this, bucket);
+      if(const MyBucket* bucketPtr = m_buckets.at(bucket))
+        return bucketPtr->itemFromIndex(index & 0xffff);
+    }
+
+    ExclusiveLocker lock(this);
+
     const MyBucket* bucketPtr = m_buckets.at(bucket);
     if(!bucketPtr) {
       initializeBucket(bucket);
@@ -1668,7 +1783,7 @@ class ItemRepository : public AbstractItemRepository {
   ///@param onlyInMemory If this is true, only items are visited that are currently in memory.
   template<class Visitor>
   void visitAllItems(Visitor& visitor, bool onlyInMemory = false) const {
-    ThisLocker lock(m_mutex);
+    ExclusiveLocker lock(this);
     for(int a = 1; a <= m_currentBucket; ++a) {
       if(!onlyInMemory || m_buckets.at(a)) {
         if(bucketForIndex(a) && !bucketForIndex(a)->visitAllItems(visitor))
@@ -1679,60 +1794,202 @@ class ItemRepository : public AbstractItemRepository {
 
   ///Synchronizes the state on disk to the one in memory, and does some memory-management.
   ///Should be called on a regular basis. Can be called centrally from the global item repository registry.
+  ///The changes are first written to a journal, so a crash while storing never leaves the repository half-written.
   void store() override {
-    QMutexLocker lock(m_mutex);
-    if(m_file) {
+    storeJournal();
+    syncFiles();
+    commitJournal();
+    applyJournal();
+    syncFiles();
+    finishJournal();
+  }
 
-      if(!m_file->open( QFile::ReadWrite ) || !m_dynamicFile->open( QFile::ReadWrite )) {
-        qFatal("cannot re-open repository file for storing");
-        return;
+  ///Writes all buckets that changed since the last store, and the meta-data, into a pending journal next to the repository.
+  ///The repository files are not touched. Each record carries a checksum, and the journal ends with a commit record.
+  ///The buckets are written straight into the journal, and keep the journaled state until applyJournal() writes it.
+  void storeJournal() override {
+    ExclusiveLocker lock(this, true);
+    if(!m_file)
+      return;
+
+    QFile journal(journalFileName(true));
+    if(!journal.open( QFile::WriteOnly | QFile::Truncate )) {
+      qFatal("cannot open repository journal for writing");
+      return;
+    }
+
+    //The buckets must not change while they are written
+    unpublishChangedBuckets([](int) { return true; });
+
+    discardJournal();
+
+    uint commitChecksum = 0;
+    for(int a = 0; a < m_buckets.size(); ++a) {
+      MyBucket* bucketPtr = m_buckets[a];
+      if(bucketPtr && bucketPtr->changed()) {
+        JournalRecordWriter record(journal, MainFileRecord, bucketOffset(a), (1 + bucketPtr->monsterBucketExtent()) * MyBucket::DataSize);
+        bucketPtr->write(&record);
+        bucketPtr->markJournaled();
+        commitChecksum ^= record.finish();
+        m_journaledBuckets << a;
       }
+    }
+    uint recordCount = m_journaledBuckets.size();
 
-      for(int a = 0; a < m_buckets.size(); ++a) {
-        if(m_buckets[a]) {
-          if(m_buckets[a]->changed()) {
-            storeBucket(a);
-          }
-          if(m_unloadingEnabled) {
-            const int unloadAfterTicks = 2;
-            if(m_buckets[a]->lastUsed() > unloadAfterTicks) {
-                delete m_buckets[a];
-                m_buckets[a] = nullptr;
-            }else{
-                m_buckets[a]->tick();
-            }
-          }
-        }
+    if(m_metaDataChanged) {
+      QBuffer metaDataBuffer(&m_journaledMetaData);
+      metaDataBuffer.open(QIODevice::WriteOnly);
+      metaDataBuffer.write((char*)&m_repositoryVersion, sizeof(uint));
+      uint hashSize = bucketHashSize;
+      metaDataBuffer.write((char*)&hashSize, sizeof(uint));
+      uint itemRepositoryVersion  = staticItemRepositoryVersion();
+      metaDataBuffer.write((char*)&itemRepositoryVersion, sizeof(uint));
+      metaDataBuffer.write((char*)&m_statBucketHashClashes, sizeof(uint));
+      metaDataBuffer.write((char*)&m_statItemCount, sizeof(uint));
+      const uint bucketCount = static_cast<uint>(m_buckets.size());
+      metaDataBuffer.write((char*)&bucketCount, sizeof(uint));
+      metaDataBuffer.write((char*)&m_currentBucket, sizeof(uint));
+      metaDataBuffer.write((char*)m_firstBucketForHash, sizeof(short unsigned int) * bucketHashSize);
+      Q_ASSERT(m_journaledMetaData.size() == BucketStartOffset);
+
+      QBuffer dynamicDataBuffer(&m_journaledDynamicData);
+      dynamicDataBuffer.open(QIODevice::WriteOnly);
+      const uint freeSpaceBucketsSize = static_cast<uint>(m_freeSpaceBuckets.size());
+      dynamicDataBuffer.write((char*)&freeSpaceBucketsSize, sizeof(uint));
+      dynamicDataBuffer.write((char*)m_freeSpaceBuckets.data(), sizeof(uint) * freeSpaceBucketsSize);
+
+      commitChecksum ^= writeJournalRecord(journal, MainFileRecord, 0, m_journaledMetaData);
+      commitChecksum ^= writeJournalRecord(journal, DynamicFileRecord, 0, m_journaledDynamicData);
+      recordCount += 2;
+
+      m_metaDataChanged = false;
+    }
+
+    const uint commitMagic = JournalCommitMagic;
+    journal.write((char*)&commitMagic, sizeof(uint));
+    journal.write((char*)&recordCount, sizeof(uint));
+    journal.write((char*)&commitChecksum, sizeof(uint));
+
+    if(!journal.flush() || journal.error() != QFile::NoError) {
+      KMessageBox::error(nullptr, i18n("Failed writing to %1, probably the disk is full", journal.fileName()));
+      abort();
+    }
+    journal.close();
+    //The journal must be on the disk before the registry commits it
+    m_unsyncedFiles << journal.fileName();
+  }
+
+  ///Waits until the files written by storeJournal() or applyJournal() are on the disk.
+  ///The repository is not locked meanwhile, so the registry can write all repositories before waiting for any of them.
+  void syncFiles() override {
+    QStringList fileNames;
+    {
+      ExclusiveLocker lock(this, true);
+      fileNames.swap(m_unsyncedFiles);
+    }
+
+    foreach(const QString& fileName, fileNames) {
+      QFile file(fileName);
+      if(!file.open( QFile::ReadWrite ) || !syncToDisk(&file)) {
+        KMessageBox::error(nullptr, i18n("Failed writing to %1, probably the disk is full", fileName));
+        abort();
       }
+    }
+  }
+
+  ///Turns the pending journal written by storeJournal() into the committed one, that is replayed by open() after a crash.
+  void commitJournal() override {
+    ExclusiveLocker lock(this, true);
+    if(!m_file)
+      return;
+
+    const QString pending = journalFileName(true);
+    if(!QFile::exists(pending))
+      return;
+    const QString committed = journalFileName(false);
+    QFile::remove(committed);
+    if(!QFile::rename(pending, committed))
+      qFatal("cannot commit repository journal");
+  }
 
-      if(m_metaDataChanged) {
-        Q_ASSERT(m_dynamicFile);
+  ///Writes the state journaled by storeJournal() into the repository files, straight from the buckets that are still loaded.
+  ///The files are on the disk after the following syncFiles().
+  void applyJournal() override {
+    ExclusiveLocker lock(this, true);
+    if(!m_file)
+      return;
 
-        m_file->seek(0);
-        m_file->write((char*)&m_repositoryVersion, sizeof(uint));
-        uint hashSize = bucketHashSize;
-        m_file->write((char*)&hashSize, sizeof(uint));
-        uint itemRepositoryVersion  = staticItemRepositoryVersion();
-        m_file->write((char*)&itemRepositoryVersion, sizeof(uint));
-        m_file->write((char*)&m_statBucketHashClashes, sizeof(uint));
-        m_file->write((char*)&m_statItemCount, sizeof(uint));
+    if(!QFile::exists(journalFileName(false)) || (m_journaledBuckets.isEmpty() && m_journaledMetaData.isNull())) {
+      discardJournal();
+      return;
+    }
 
-        const uint bucketCount = static_cast<uint>(m_buckets.size());
-        m_file->write((char*)&bucketCount, sizeof(uint));
-        m_file->write((char*)&m_currentBucket, sizeof(uint));
-        m_file->write((char*)m_firstBucketForHash, sizeof(short unsigned int) * bucketHashSize);
-        Q_ASSERT(m_file->pos() == BucketStartOffset);
+    if(!m_file->open( QFile::ReadWrite ) || !m_dynamicFile->open( QFile::ReadWrite )) {
+      qFatal("cannot re-open repository file for storing");
+      return;
+    }
 
-        m_dynamicFile->seek(0);
-        const uint freeSpaceBucketsSize = static_cast<uint>(m_freeSpaceBuckets.size());
-        m_dynamicFile->write((char*)&freeSpaceBucketsSize, sizeof(uint));
-        m_dynamicFile->write((char*)m_freeSpaceBuckets.data(), sizeof(uint) * freeSpaceBucketsSize);
+    foreach(ushort a, m_journaledBuckets) {
+      //Writing behind the end extends the file
+      m_file->seek(bucketOffset(a));
+      const auto deleted = m_deletedJournaledBuckets.constFind(a);
+      if(deleted != m_deletedJournaledBuckets.constEnd()) {
+        m_file->write(*deleted);
+      }else{
+        Q_ASSERT(m_buckets[a]);
+        m_buckets[a]->writeJournaled(m_file);
+      }
+      m_fileDataSize = qMax(m_fileDataSize, static_cast<uint>(m_file->pos() - BucketStartOffset));
+    }
+    m_journaledBuckets.clear();
+    m_deletedJournaledBuckets.clear();
+
+    if(!m_journaledMetaData.isNull()) {
+      m_file->seek(0);
+      m_file->write(m_journaledMetaData);
+      m_dynamicFile->resize(m_journaledDynamicData.size());
+      m_dynamicFile->seek(0);
+      m_dynamicFile->write(m_journaledDynamicData);
+      m_journaledMetaData = QByteArray();
+      m_journaledDynamicData = QByteArray();
+    }
+
+    for(QFile* file : {m_file, m_dynamicFile}) {
+      if(!file->flush() || file->error() != QFile::NoError) {
+        KMessageBox::error(nullptr, i18n("Failed writing to %1, probably the disk is full", file->fileName()));
+        abort();
+      }
+      file->close();
+      //The journal is removed by finishJournal(), so the files must be on the disk before
+      m_unsyncedFiles << file->fileName();
+    }
+  }
+
+  ///Removes the journal that was applied to the repository files, and unloads buckets that were not used recently.
+  void finishJournal() override {
+    ExclusiveLocker lock(this, true);
+    if(!m_file)
+      return;
+
+    QFile::remove(journalFileName(false));
+
+    if(m_unloadingEnabled) {
+      const int unloadAfterTicks = 2;
+      //Buckets changed since storeJournal() are not on disk yet, so they must stay
+      auto unload = [this](int a) {
+        return m_buckets[a] && !m_buckets[a]->changed() && m_buckets[a]->lastUsed() > unloadAfterTicks;
+      };
+      unpublishChangedBuckets(unload);
+      for(int a = 0; a < m_buckets.size(); ++a) {
+        if(m_buckets[a] && !m_buckets[a]->changed()) {
+          if(unload(a)) {
+            delete m_buckets[a];
+            m_buckets[a] = nullptr;
+          }else{
+            m_buckets[a]->tick();
+          }
+        }
       }
-      //To protect us from inconsistency due to crashes. flush() is not enough. We need to close.
-      m_file->close();
-      m_dynamicFile->close();
-      Q_ASSERT(!m_file->isOpen());
-      Q_ASSERT(!m_dynamicFile->isOpen());
     }
   }
 
@@ -1742,6 +1999,7 @@ class ItemRepository : public AbstractItemRepository {
   ///         you must always make sure that this mutex is locked before you access this repository.
   ///         Else you will get crashes and inconsistencies.
   ///         In KDevelop This means: Make sure you _always_ lock this mutex before accessing the repository.
+  ///@warning In the striped mode, locking this mutex does not keep lookups from running, see setStripeBits().
   QMutex* mutex() const {
     return m_mutex;
   }
@@ -1757,7 +2015,233 @@ class ItemRepository : public AbstractItemRepository {
 
   private:
 
-  uint createIndex(ushort bucketIndex, ushort indexInBucket)
+  enum {
+    JournalRecordMagic = 0x4a524543,
+    JournalCommitMagic = 0x4a454e44
+  };
+
+  enum JournalRecordTarget {
+    MainFileRecord = 0,
+    DynamicFileRecord = 1 //Replaces the whole content of the dynamic file
+  };
+
+  struct JournalRecord {
+    uint target;
+    qint64 offset;
+    QByteArray data;
+  };
+
+  QString journalFileName(bool pending) const {
+    return m_file->fileName() + (pending ? QLatin1String("_journal_pending") : QLatin1String("_journal"));
+  }
+
+  qint64 bucketOffset(int bucketNumber) const {
+    return BucketStartOffset + qint64(bucketNumber-1) * MyBucket::DataSize;
+  }
+
+  //FNV-1a over 64-bit words, only used to detect torn or corrupted journal records.
+  //The data can be added in parts of any size, the checksum is the same.
+  class JournalChecksum {
+  public:
+    JournalChecksum()
+      : m_hash(14695981039346656037ull)
+      , m_pendingSize(0)
+    {
+    }
+
+    void add(const char* data, qint64 size) {
+      if(m_pendingSize) {
+        //Complete the word that was started by the previous part
+        const qint64 take = qMin<qint64>(sizeof(quint64) - m_pendingSize, size);
+        memcpy(m_pending + m_pendingSize, data, take);
+        m_pendingSize += take;
+        data += take;
+        size -= take;
+        if(m_pendingSize < sizeof(quint64))
+          return;
+        addWord(m_pending);
+        m_pendingSize = 0;
+      }
+      for(; size >= qint64(sizeof(quint64)); data += sizeof(quint64), size -= sizeof(quint64))
+        addWord(data);
+      memcpy(m_pending, data, size);
+      m_pendingSize = size;
+    }
+
+    uint result() const {
+      quint64 hash = m_hash;
+      for(uint a = 0; a < m_pendingSize; ++a) {
+        hash ^= static_cast<uchar>(m_pending[a]);
+        hash *= 1099511628211ull;
+      }
+      return static_cast<uint>(hash ^ (hash >> 32));
+    }
+
+  private:
+    void addWord(const char* data) {
+      quint64 word;
+      memcpy(&word, data, sizeof(quint64));
+      m_hash ^= word;
+      m_hash *= 1099511628211ull;
+    }
+
+    quint64 m_hash;
+    char m_pending[sizeof(quint64)];
+    uint m_pendingSize;
+  };
+
+  ///Writes one record into a journal: The header, then the data that is passed to write(), then the checksum.
+  ///So the data can be written straight from where it is, without copying it into a record first.
+  class JournalRecordWriter {
+  public:
+    JournalRecordWriter(QFile& journal, uint target, qint64 offset, uint size)
+      : m_journal(journal)
+      , m_target(target)
+      , m_offset(offset)
+      , m_size(size)
+      , m_written(0)
+    {
+      const uint magic = JournalRecordMagic;
+      m_journal.write((char*)&magic, sizeof(uint));
+      m_journal.write((char*)&target, sizeof(uint));
+      m_journal.write((char*)&offset, sizeof(qint64));
+      m_journal.write((char*)&size, sizeof(uint));
+    }
+
+    qint64 write(const char* data, qint64 size) {
+      m_checksum.add(data, size);
+      m_written += size;
+      return m_journal.write(data, size);
+    }
+
+    ///Appends the checksum. @returns it
+    uint finish() {
+      Q_ASSERT(m_written == m_size);
+      const uint checksum = m_checksum.result() ^ m_target ^ static_cast<uint>(m_offset);
+      m_journal.write((char*)&checksum, sizeof(uint));
+      return checksum;
+    }
+
+  private:
+    QFile& m_journal;
+    uint m_target;
+    qint64 m_offset;
+    qint64 m_size;
+    qint64 m_written;
+    JournalChecksum m_checksum;
+  };
+
+  ///Appends one record to @p journal. @returns the checksum of the record
+  static uint writeJournalRecord(QFile& journal, uint target, qint64 offset, const QByteArray& data) {
+    JournalRecordWriter record(journal, target, offset, data.size());
+    record.write(data.constData(), data.size());
+    return record.finish();
+  }
+
+  ///Reads all records of the committed journal into @p records.
+  ///@returns whether the journal is complete, with verified checksums and a matching commit record
+  static bool readJournal(QFile& journal, QVector<JournalRecord>* records) {
+    uint commitChecksum = 0;
+    while(!journal.atEnd()) {
+      uint magic = 0;
+      if(journal.read((char*)&magic, sizeof(uint)) != sizeof(uint))
+        return false;
+
+      if(magic == JournalCommitMagic) {
+        uint storedCount = 0, storedChecksum = 0;
+        journal.read((char*)&storedCount, sizeof(uint));
+        journal.read((char*)&storedChecksum, sizeof(uint));
+        return storedCount == static_cast<uint>(records->size()) && storedChecksum == commitChecksum;
+      }
+      if(magic != JournalRecordMagic)
+        return false;
+
+      JournalRecord record;
+      uint size = 0, checksum = 0;
+      journal.read((char*)&record.target, sizeof(uint));
+      journal.read((char*)&record.offset, sizeof(qint64));
+      journal.read((char*)&size, sizeof(uint));
+      record.data = journal.read(size);
+      journal.read((char*)&checksum, sizeof(uint));
+
+      JournalChecksum dataChecksum;
+      dataChecksum.add(record.data.constData(), record.data.size());
+      if(static_cast<uint>(record.data.size()) != size || checksum != (dataChecksum.result() ^ record.target ^ static_cast<uint>(record.offset)))
+        return false;
+
+      commitChecksum ^= checksum;
+      *records << record;
+    }
+    return false;
+  }
+
+  ///Forgets the state that storeJournal() journaled, if it was not applied
+  void discardJournal() {
+    foreach(ushort a, m_journaledBuckets) {
+      if(m_buckets[a])
+        m_buckets[a]->discardJournaled();
+    }
+    m_journaledBuckets.clear();
+    m_deletedJournaledBuckets.clear();
+    m_journaledMetaData = QByteArray();
+    m_journaledDynamicData = QByteArray();
+  }
+
+  ///Writes @p records of a journal that was read back after a crash into the repository files,
+  ///and waits until they are on the disk.
+  void applyJournalRecords(const QVector<JournalRecord>& records) const {
+    if(!m_file->open( QFile::ReadWrite ) || !m_dynamicFile->open( QFile::ReadWrite )) {
+      qFatal("cannot re-open repository file for storing");
+      return;
+    }
+
+    foreach(const JournalRecord& record, records) {
+      QFile* file = record.target == DynamicFileRecord ? m_dynamicFile : m_file;
+      if(record.target == DynamicFileRecord)
+        file->resize(record.data.size());
+      else if(file->size() < record.offset + record.data.size())
+        file->resize(record.offset + record.data.size());
+      if(record.target == MainFileRecord && record.offset + record.data.size() > BucketStartOffset + m_fileDataSize)
+        m_fileDataSize = record.offset + record.data.size() - BucketStartOffset;
+      file->seek(record.offset);
+      if(file->write(record.data) != record.data.size()) {
+        KMessageBox::error(nullptr, i18n("Failed writing to %1, probably the disk is full", file->fileName()));
+        abort();
+      }
+    }
+
+    //The journal is removed afterwards, so the files must be on the disk
+    if(!syncToDisk(m_file) || !syncToDisk(m_dynamicFile)) {
+      KMessageBox::error(nullptr, i18n("Failed writing to %1, probably the disk is full", m_file->fileName()));
+      abort();
+    }
+    m_file->close();
+    m_dynamicFile->close();
+  }
+
+  ///Applies the committed journal of an interrupted store, if there is one, to the repository files, and removes it.
+  ///Nothing is written unless the whole journal has been verified.
+  void replayJournal() const {
+    QFile journal(journalFileName(false));
+    if(!journal.exists())
+      return;
+
+    if(!journal.open( QFile::ReadOnly )) {
+      qFatal("cannot open repository journal for reading");
+      return;
+    }
+
+    QVector<JournalRecord> records;
+    if(!readJournal(journal, &records))
+      qWarning() << "discarding incomplete journal" << journal.fileName();
+    else
+      applyJournalRecords(records);
+
+    journal.close();
+    journal.remove();
+  }
+
+  uint createIndex(ushort bucketIndex, ushort indexInBucket) const
   {
     //Combine the index in the bucket, and the bucket number into one index
     const uint index = (bucketIndex << 16) + indexInBucket;
@@ -1765,6 +2249,94 @@ class ItemRepository : public AbstractItemRepository {
     return index;
   }
 
+  ///The stripe of the bucket-hash slot of @p hash, see setStripeBits()
+  QReadWriteLock* stripeLock(uint hash) const {
+    return &m_stripes[(hash % bucketHashSize) % m_stripeCount].lock;
+  }
+
+  ///Locks the mutex if @p lockMutex is true, and in the striped mode all stripes for writing, so no lookup runs meanwhile.
+  ///Used for everything but the lookups of the striped mode.
+  class ExclusiveLocker {
+  public:
+    explicit ExclusiveLocker(const ItemRepository* repository, bool lockMutex = threadSafe)
+      : m_repository(repository)
+      , m_lockMutex(lockMutex)
+    {
+      if(m_lockMutex)
+        m_repository->m_mutex->lock();
+      if(m_repository->m_stripes)
+        m_repository->lockStripes();
+    }
+    ~ExclusiveLocker() {
+      if(m_repository->m_stripes)
+        m_repository->unlockStripes();
+      if(m_lockMutex)
+        m_repository->m_mutex->unlock();
+    }
+  private:
+    const ItemRepository* m_repository;
+    bool m_lockMutex;
+  };
+
+  ///Locks one stripe for a lookup in the striped mode, unless the current thread holds all stripes already
+  class StripeReadLocker {
+  public:
+    StripeReadLocker(const ItemRepository* repository, uint hash)
+      : m_lock(repository->m_stripesOwner.loadAcquire() == QThread::currentThread() ? nullptr : repository->stripeLock(hash))
+    {
+      if(m_lock)
+        m_lock->lockForRead();
+    }
+    ~StripeReadLocker() {
+      if(m_lock)
+        m_lock->unlock();
+    }
+  private:
+    QReadWriteLock* m_lock;
+  };
+
+  ///Locks all stripes for writing. The mutex must be locked, it protects the recursion count.
+  void lockStripes() const {
+    if(m_stripesLockDepth++)
+      return;
+    for(uint a = 0; a < m_stripeCount; ++a)
+      m_stripes[a].lock.lockForWrite();
+    m_stripesOwner.storeRelease(QThread::currentThread());
+  }
+
+  void unlockStripes() const {
+    if(--m_stripesLockDepth)
+      return;
+    m_stripesOwner.storeRelease(nullptr);
+    for(uint a = 0; a < m_stripeCount; ++a)
+      m_stripes[a].lock.unlock();
+  }
+
+  ///The lookup of the striped mode, with only the stripe of the hash locked. Buckets can't be loaded that way,
+  ///so if the chain of the hash leads to a bucket that is not loaded, @p complete is set to false, and the lookup
+  ///has to be repeated with the repository locked exclusively.
+  uint findLoadedIndex(const ItemRequest& request, bool* complete) const {
+    const uint hash = request.hash();
+    StripeReadLocker lock(this, hash);
+
+    unsigned short bucketIndex = m_firstBucketForHash[hash % bucketHashSize];
+    while(bucketIndex) {
+      const MyBucket* bucketPtr = m_buckets.at(bucketIndex);
+      if(!bucketPtr) {
+        *complete = false;
+        return 0;
+      }
+      const ushort indexInBucket = bucketPtr->findIndex(request);
+      if(indexInBucket) {
+        *complete = true;
+        return createIndex(bucketIndex, indexInBucket);
+      }
+      bucketIndex = bucketPtr->nextBucketForHash(hash);
+    }
+    *complete = true;
+    return 0;
+  }
+
   /**
    * Walks through all buckets clashing with @p hash
    *
@@ -1903,13 +2475,19 @@ class ItemRepository : public AbstractItemRepository {
   }
 
   bool open(const QString& path) override {
-    QMutexLocker lock(m_mutex);
+    ExclusiveLocker lock(this, true);
 
     close();
     //qDebug() << "opening repository" << m_repositoryName << "at" << path;
     QDir dir(path);
     m_file = new QFile(dir.absoluteFilePath( m_repositoryName ));
     m_dynamicFile = new QFile(dir.absoluteFilePath( m_repositoryName + QLatin1String("_dynamic") ));
+
+    //A pending journal was never committed, so the repository files are still consistent without it.
+    //A committed journal belongs to a store that was interrupted, so it is completed now.
+    QFile::remove(journalFileName(true));
+    replayJournal();
+
     if(!m_file->open( QFile::ReadWrite ) || !m_dynamicFile->open( QFile::ReadWrite ) ) {
       delete m_file;
       m_file = nullptr;
@@ -1955,7 +2533,7 @@ class ItemRepository : public AbstractItemRepository {
       m_freeSpaceBuckets.clear();
     }else{
       m_file->close();
-      bool res = m_file->open( QFile::ReadOnly ); //Re-open in read-only mode, so we create a read-only m_fileMap
+      bool res = m_file->open( QFile::ReadOnly ); //Re-open in read-only mode, so we create read-only m_fileMaps
       VERIFY(res);
       //Check that the version is correct
       uint storedVersion = 0, hashSize = 0, itemRepositoryVersion = 0;
@@ -1991,20 +2569,12 @@ class ItemRepository : public AbstractItemRepository {
       m_dynamicFile->read((char*)m_freeSpaceBuckets.data(), sizeof(uint) * freeSpaceBucketsSize);
     }
 
+    m_fileMaps.clear();
     m_fileMapSize = 0;
-    m_fileMap = nullptr;
+    m_fileDataSize = qMax(m_file->size() - BucketStartOffset, qint64(0));
 
 #ifdef ITEMREPOSITORY_USE_MMAP_LOADING
-    if(m_file->size() > BucketStartOffset){
-      m_fileMap = m_file->map(BucketStartOffset, m_file->size() - BucketStartOffset);
-      Q_ASSERT(m_file->isOpen());
-      Q_ASSERT(m_file->size() >= BucketStartOffset);
-      if(m_fileMap){
-        m_fileMapSize = m_file->size() - BucketStartOffset;
-      }else{
-        qWarning() << "mapping" << m_file->fileName() << "FAILED!";
-      }
-    }
+    extendFileMap();
 #endif
     //To protect us from inconsistency due to crashes. flush() is not enough.
     m_file->close();
@@ -2021,16 +2591,21 @@ class ItemRepository : public AbstractItemRepository {
 
     if(m_file)
       m_file->close();
+    //Deleting the file also unmaps all mapped ranges
     delete m_file;
     m_file = nullptr;
-    m_fileMap = nullptr;
+    m_fileMaps.clear();
     m_fileMapSize = 0;
+    m_fileDataSize = 0;
 
     if(m_dynamicFile)
       m_dynamicFile->close();
     delete m_dynamicFile;
     m_dynamicFile = nullptr;
 
+    unpublishChangedBuckets([](int) { return true; });
+    discardJournal();
+    m_unsyncedFiles.clear();
     qDeleteAll(m_buckets);
     m_buckets.clear();
 
@@ -2069,7 +2644,7 @@ class ItemRepository : public AbstractItemRepository {
   }
 
   int finalCleanup() override {
-    ThisLocker lock(m_mutex);
+    ExclusiveLocker lock(this);
 
     int changed = 0;
     for(int a = 1; a <= m_currentBucket; ++a) {
@@ -2097,35 +2672,25 @@ class ItemRepository : public AbstractItemRepository {
     if(!m_buckets[bucketNumber]) {
       m_buckets[bucketNumber] = new MyBucket();
 
-      bool doMMapLoading = (bool)m_fileMap;
-
       uint offset = ((bucketNumber-1) * MyBucket::DataSize);
-      if(m_file && offset < m_fileMapSize && doMMapLoading && *reinterpret_cast<uint*>(m_fileMap + offset) == 0) {
+      char* mappedData = nullptr;
+#ifdef ITEMREPOSITORY_USE_MMAP_LOADING
+      if(m_file)
+        mappedData = mappedBucketData(offset);
+#endif
+      if(mappedData) {
 //         qDebug() << "loading bucket mmap:" << bucketNumber;
-        m_buckets[bucketNumber]->initializeFromMap(reinterpret_cast<char*>(m_fileMap + offset));
-      } else if(m_file) {
-        //Either memory-mapping is disabled, or the item is not in the existing memory-map,
-        //so we have to load it the classical way.
+        //The bucket is served straight from the page cache, it is only copied once it is changed(see Bucket::prepareChange)
+        m_buckets[bucketNumber]->initializeFromMap(mappedData);
+      } else if(m_file && offset < m_fileDataSize) {
+        //Either memory-mapping is disabled or failed, or the bucket is not mapped yet, so we have to load it the classical way.
         bool res = m_file->open( QFile::ReadOnly );
-
-        if(offset + BucketStartOffset < m_file->size()) {
-          VERIFY(res);
-          offset += BucketStartOffset;
-          m_file->seek(offset);
-          uint monsterBucketExtent;
-          m_file->read((char*)(&monsterBucketExtent), sizeof(unsigned int));;
-          m_file->seek(offset);
-          ///FIXME: use the data here instead of copying it again in prepareChange
-          QByteArray data = m_file->read((1+monsterBucketExtent) * MyBucket::DataSize);
-          m_buckets[bucketNumber]->initializeFromMap(data.data());
-          m_buckets[bucketNumber]->prepareChange();
-        }else{
-          m_buckets[bucketNumber]->initialize(0);
-        }
-
+        VERIFY(res);
+        m_file->seek(offset + BucketStartOffset);
+        m_buckets[bucketNumber]->initializeFromFile(m_file);
         m_file->close();
-
       }else{
+        //The bucket is not on the disk yet
         m_buckets[bucketNumber]->initialize(0);
       }
     }else{
@@ -2133,21 +2698,73 @@ class ItemRepository : public AbstractItemRepository {
     }
   }
 
+#ifdef ITEMREPOSITORY_USE_MMAP_LOADING
+  ///Returns a pointer to the complete bucket stored at @p offset behind BucketStartOffset within the memory-map, or zero.
+  ///Buckets that were appended to the file since the repository was opened are mapped on demand.
+  char* mappedBucketData(uint offset) const {
+    //Buckets that were never stored can not be mapped, so the file is not touched for them
+    if(offset + sizeof(uint) > m_fileDataSize)
+      return nullptr;
+    if(offset + sizeof(uint) > m_fileMapSize)
+      extendFileMap();
+
+    for(const FileMap& map : m_fileMaps) {
+      if(offset >= map.offset && offset + sizeof(uint) <= map.offset + map.size) {
+        char* data = reinterpret_cast<char*>(map.data + (offset - map.offset));
+        const uint monsterBucketExtent = *reinterpret_cast<uint*>(data);
+        //A monster-bucket may only be used from the map if it is mapped completely
+        if(offset + (1 + monsterBucketExtent) * MyBucket::DataSize <= map.offset + map.size)
+          return data;
+        return nullptr;
+      }
+    }
+    return nullptr;
+  }
+
+  ///Maps the stored bucket data behind the already mapped range. Existing mappings stay valid,
+  ///because loaded buckets may point into them.
+  ///The mapping grows geometrically: It is only extended once the unmapped data is as large as the mapped range,
+  ///or FileMapMinimumGrowth. Until then, the unmapped buckets are loaded from the file.
+  void extendFileMap() const {
+    const uint size = m_fileDataSize - m_fileMapSize;
+    if(!size || (m_fileMapSize && size < qMax(m_fileMapSize, uint(FileMapMinimumGrowth))))
+      return;
+
+    const bool wasOpen = m_file->isOpen();
+    if(!wasOpen && !m_file->open( QFile::ReadOnly ))
+      return;
+
+    uchar* data = m_file->map(BucketStartOffset + m_fileMapSize, size);
+    if(data) {
+      FileMap map;
+      map.offset = m_fileMapSize;
+      map.size = size;
+      map.data = data;
+      m_fileMaps.append(map);
+      m_fileMapSize += size;
+    }else{
+      qWarning() << "mapping" << m_file->fileName() << "FAILED!";
+    }
+
+    if(!wasOpen)
+      m_file->close();
+  }
+#endif
+
   ///Can only be called on empty buckets
   void deleteBucket(int bucketNumber) {
     Q_ASSERT(bucketForIndex(bucketNumber)->isEmpty());
     Q_ASSERT(bucketForIndex(bucketNumber)->noNextBuckets());
+    unpublishChangedBuckets([bucketNumber](int a) { return a == bucketNumber; });
+    if(m_buckets[bucketNumber]->journaled()) {
+      QBuffer buffer(&m_deletedJournaledBuckets[bucketNumber]);
+      buffer.open(QIODevice::WriteOnly);
+      m_buckets[bucketNumber]->writeJournaled(&buffer);
+    }
     delete m_buckets[bucketNumber];
     m_buckets[bucketNumber] = nullptr;
   }
 
-  //m_file must be opened
-  void storeBucket(int bucketNumber) const {
-    if(m_file && m_buckets[bucketNumber]) {
-      m_buckets[bucketNumber]->store(m_file, BucketStartOffset + (bucketNumber-1) * MyBucket::DataSize);
-    }
-  }
-
   /// If mustFindBucket is zero, the whole chain is just walked. This is good for debugging for infinite recursion.
   /// @return whether @p mustFindBucket was found
   bool walkBucketLinks(uint checkBucket, uint hash, uint mustFindBucket = 0) const {
@@ -2206,6 +2823,40 @@ class ItemRepository : public AbstractItemRepository {
 #endif
   }
 
+  ///Makes the items of @p bucketPtr available through changeItemLockFree(..). The mutex must be locked.
+  void publishChangedBucket(unsigned short bucket, MyBucket* bucketPtr) {
+    QAtomicPointer<QAtomicPointer<MyBucket> >& chunkPtr = m_changedBuckets[bucket / ChangedBucketsChunkSize];
+    QAtomicPointer<MyBucket>* chunk = chunkPtr.loadAcquire();
+    if(!chunk) {
+      chunk = new QAtomicPointer<MyBucket>[ChangedBucketsChunkSize];
+      chunkPtr.storeRelease(chunk);
+    }
+    if(chunk[bucket % ChangedBucketsChunkSize].loadAcquire() != bucketPtr)
+      chunk[bucket % ChangedBucketsChunkSize].storeRelease(bucketPtr);
+  }
+
+  ///Takes the buckets for which @p retire returns true out of changeItemLockFree(..), and waits until the
+  ///lock-free changes that may still use them are finished. Must be called with the mutex locked before
+  ///buckets are written to disk or deleted. Lock-free changes that start meanwhile wait for the mutex.
+  template<class Retire>
+  void unpublishChangedBuckets(const Retire& retire) {
+    m_lockFreeChanges.fetchAndOrOrdered(RetiringChangedBuckets);
+    while(m_lockFreeChanges.loadAcquire() != RetiringChangedBuckets)
+      QThread::yieldCurrentThread();
+
+    for(int chunkNumber = 0; chunkNumber < ChangedBucketsChunkCount; ++chunkNumber) {
+      QAtomicPointer<MyBucket>* chunk = m_changedBuckets[chunkNumber].loadAcquire();
+      if(!chunk)
+        continue;
+      for(int a = 0; a < ChangedBucketsChunkSize; ++a) {
+        if(chunk[a].loadAcquire() && retire(chunkNumber * ChangedBucketsChunkSize + a))
+          chunk[a].storeRelease(nullptr);
+      }
+    }
+
+    m_lockFreeChanges.fetchAndAndOrdered(~RetiringChangedBuckets);
+  }
+
   void verifyIndex(uint index) const
   {
     // We don't use zero indices
@@ -2225,6 +2876,15 @@ class ItemRepository : public AbstractItemRepository {
   }
 
   bool m_metaDataChanged;
+  //The buckets written by storeJournal(), until applyJournal() writes them into the repository files
+  QVector<ushort> m_journaledBuckets;
+  //The journaled state of buckets that were deleted before applyJournal()
+  QHash<ushort, QByteArray> m_deletedJournaledBuckets;
+  //The meta-data written by storeJournal(), or null
+  QByteArray m_journaledMetaData;
+  QByteArray m_journaledDynamicData;
+  //The files that syncFiles() waits for
+  QStringList m_unsyncedFiles;
   mutable QMutex m_ownMutex;
   mutable QMutex* m_mutex;
   QString m_repositoryName;
@@ -2232,6 +2892,16 @@ class ItemRepository : public AbstractItemRepository {
   //List of buckets that have free space available that can be assigned. Sorted by size: Smallest space first. Second order sorting: Bucket index
   QVector<uint> m_freeSpaceBuckets;
   mutable QVector<MyBucket* > m_buckets;
+  enum {
+    ChangedBucketsChunkSize = 256,
+    ChangedBucketsChunkCount = 0x10000 / ChangedBucketsChunkSize,
+    RetiringChangedBuckets = 1 << 30
+  };
+  //The buckets that were prepared for changes since they were last stored, for changeItemLockFree(..).
+  //The chunks are allocated on demand and only freed on destruction, so they can be read without locking the mutex.
+  QAtomicPointer<QAtomicPointer<MyBucket> > m_changedBuckets[ChangedBucketsChunkCount];
+  //The count of running lock-free changes, plus RetiringChangedBuckets while buckets are taken out of m_changedBuckets
+  QAtomicInt m_lockFreeChanges;
   uint m_statBucketHashClashes, m_statItemCount;
   //Maps hash-values modulo 1<<bucketHashSizeBits to the first bucket such a hash-value appears in
   short unsigned int m_firstBucketForHash[bucketHashSize];
@@ -2239,13 +2909,34 @@ class ItemRepository : public AbstractItemRepository {
   ItemRepositoryRegistry* m_registry;
   //File that contains the buckets
   QFile* m_file;
-  uchar* m_fileMap;
-  uint m_fileMapSize;
+  //Read-only mapped ranges of m_file, with offsets relative to BucketStartOffset. Sorted and contiguous, starting at zero.
+  struct FileMap {
+    uint offset;
+    uint size;
+    uchar* data;
+  };
+  mutable QVector<FileMap> m_fileMaps;
+  //Total size of the mapped ranges
+  mutable uint m_fileMapSize;
+  //Size of the bucket data stored in m_file behind BucketStartOffset
+  mutable uint m_fileDataSize;
   //File that contains more dynamic data, like the list of buckets with deleted items
   QFile* m_dynamicFile;
   uint m_repositoryVersion;
   bool m_unloadingEnabled;
   AbstractRepositoryManager* m_manager;
+
+  struct Stripe {
+    QReadWriteLock lock;
+    //Keeps the locks of neighbouring stripes on separate cache lines
+    char padding[64 - sizeof(QReadWriteLock)];
+  };
+  //The locks of the striped mode, see setStripeBits(). Zero if the striped mode is disabled
+  Stripe* m_stripes;
+  uint m_stripeCount;
+  //The thread that holds all stripes for writing, and how often it locked them. The count is protected by the mutex
+  mutable QAtomicPointer<QThread> m_stripesOwner;
+  mutable int m_stripesLockDepth;
   friend class ::TestItemRepository;
 };
 
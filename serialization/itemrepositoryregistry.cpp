@@ -25,6 +25,7 @@
 #include <QStandardPaths>
 
 #include <KLocalizedString>
+#include <KMessageBox>
 
 #include <util/shellutils.h>
 
@@ -69,8 +70,14 @@ bool shouldClear(const QString& path)
   }
 
   if (dir.exists(QStringLiteral("is_writing"))) {
-    qCWarning(SERIALIZATION) << "repository" << path << "was write-locked, it probably is inconsistent";
-    return true;
+    if (dir.exists(QStringLiteral("journal_committed"))) {
+      // All data was written consistently into the journals before the crash, the repositories replay them
+      qCWarning(SERIALIZATION) << "repository" << path << "was write-locked while storing, recovering from the journal";
+      dir.remove(QStringLiteral("is_writing"));
+    } else {
+      qCWarning(SERIALIZATION) << "repository" << path << "was write-locked, it probably is inconsistent";
+      return true;
+    }
   }
 
   if (!dir.exists(QStringLiteral("version_%1").arg(staticItemRepositoryVersion()))) {
@@ -138,6 +145,11 @@ public:
   void unlockForWriting();
   void deleteDataDirectory(const QString& path, bool recreate = true);
 
+  /// Finishes or rolls back a store that was interrupted by a crash, see ItemRepositoryRegistry::store().
+  /// If all journals had been written, they are committed so the repositories replay them when opened.
+  /// Otherwise, the pending journals are removed and the repositories stay in the state of the previous store.
+  void recoverJournals(const QString& path);
+
   /// @param path  A shared directory-path that the item-repositories are to be loaded from.
   /// @returns     Whether the repository registry has been opened successfully.
   ///              If @c false, then all registered repositories should have been deleted.
@@ -295,6 +307,8 @@ bool ItemRepositoryRegistryPrivate::open(const QString& path)
 
   QDir().mkpath(path);
 
+  recoverJournals(path);
+
   foreach(AbstractItemRepository* repository, m_repositories.keys()) {
     if(!repository->open(path)) {
       deleteDataDirectory(path);
@@ -322,12 +336,65 @@ bool ItemRepositoryRegistryPrivate::open(const QString& path)
   return true;
 }
 
+void ItemRepositoryRegistryPrivate::recoverJournals(const QString& path)
+{
+  QDir dir(path);
+  const QStringList pendingJournals = dir.entryList({QStringLiteral("*_journal_pending")}, QDir::Files);
+  if (dir.exists(QStringLiteral("journal_committed"))) {
+    qCDebug(SERIALIZATION) << "committing" << pendingJournals.size() << "journals of an interrupted store";
+    foreach (const QString& pending, pendingJournals) {
+      QString committed = pending;
+      committed.chop(QStringLiteral("_pending").size());
+      dir.remove(committed);
+      dir.rename(pending, committed);
+    }
+    dir.remove(QStringLiteral("journal_committed"));
+  } else {
+    foreach (const QString& pending, pendingJournals) {
+      dir.remove(pending);
+    }
+  }
+}
+
 void ItemRepositoryRegistry::store()
 {
   QMutexLocker lock(&d->m_mutex);
-  foreach(AbstractItemRepository* repository, d->m_repositories.keys()) {
-    repository->store();
+  const QList<AbstractItemRepository*> repositories = d->m_repositories.keys();
+
+  // Phase one: all repositories write their changes into pending journals, the repositories stay untouched.
+  // A crash now leaves all repositories in the state of the previous store.
+  // All journals are written before waiting for any of them, so the disk can write them back together.
+  foreach(AbstractItemRepository* repository, repositories) {
+    repository->storeJournal();
+  }
+  foreach(AbstractItemRepository* repository, repositories) {
+    repository->syncFiles();
+  }
+
+  // The marker commits all journals at once. A crash from now on is recovered by replaying them.
+  QFile committedFile(d->m_path + QStringLiteral("/journal_committed"));
+  if(!committedFile.open(QIODevice::WriteOnly) || !syncToDisk(&committedFile)) {
+    KMessageBox::error(nullptr, i18n("Failed writing to %1, probably the disk is full", committedFile.fileName()));
+    abort();
+  }
+  committedFile.close();
+
+  foreach(AbstractItemRepository* repository, repositories) {
+    repository->commitJournal();
+  }
+
+  // Phase two: write the journals into the repositories, and remove them once all repositories are on the disk
+  foreach(AbstractItemRepository* repository, repositories) {
+    repository->applyJournal();
   }
+  foreach(AbstractItemRepository* repository, repositories) {
+    repository->syncFiles();
+  }
+  foreach(AbstractItemRepository* repository, repositories) {
+    repository->finishJournal();
+  }
+
+  committedFile.remove();
 
   QFile versionFile(d->m_path + QStringLiteral("/version_%1").arg(staticItemRepositoryVersion()));
   if(versionFile.open(QIODevice::WriteOnly)) {
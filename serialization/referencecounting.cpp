@@ -27,34 +27,59 @@
 
 namespace KDevelop {
 
-  bool doReferenceCounting = false;
+  QAtomicInt doReferenceCounting(0);
 
   //Protects the reference-counting data through a spin-lock
   QMutex refCountingLock;
 
+  //In most cases only a few reference-counted ranges are active at once, one per thread that stores items.
+  //These are kept in slots that shouldDoDUChainReferenceCounting() reads without locking.
+  RefCountingRange refCountingRangeSlots[RefCountingRangeSlots];
+  QAtomicInt refCountingRangeSlotsUsed(0); //Slots behind this one are free
+
   QMap<void*, QPair<uint, uint> >* refCountingRanges = new QMap<void*, QPair<uint, uint> >(); //ptr, <size, count>, leaked intentionally!
-  bool refCountingHasAdditionalRanges = false; //Whether 'refCountingRanges' is non-empty
+  QAtomicInt refCountingHasAdditionalRanges(0); //Whether 'refCountingRanges' is non-empty
+}
+
+namespace {
+///@return the slot of the range that contains @p start, or nullptr
+KDevelop::RefCountingRange* rangeSlotContaining(void* start)
+{
+  const int slots = KDevelop::refCountingRangeSlotsUsed.load();
+  for(int a = 0; a < slots; ++a) {
+    KDevelop::RefCountingRange& range = KDevelop::refCountingRangeSlots[a];
+    if(range.count && range.contains((char*)start))
+      return &range;
+  }
+  return nullptr;
+}
 
-  //Speedup: In most cases there is only exactly one reference-counted range active,
-  //so the first reference-counting range can be marked here.
-  void* refCountingFirstRangeStart = nullptr;
-  QPair<uint, uint> refCountingFirstRangeExtent = qMakePair(0u, 0u);
+void setRange(KDevelop::RefCountingRange& range, char* start, char* end)
+{
+  range.version.fetchAndAddOrdered(1);
+  range.start.storeRelease(start);
+  range.end.storeRelease(end);
+  range.version.fetchAndAddRelease(1);
+}
 }
 
 void KDevelop::disableDUChainReferenceCounting(void* start)
 {
   QMutexLocker lock(&refCountingLock);
 
-  if(refCountingFirstRangeStart && ((char*)refCountingFirstRangeStart) <= (char*)start && (char*)start < ((char*)refCountingFirstRangeStart) + refCountingFirstRangeExtent.first)
+  if(RefCountingRange* range = rangeSlotContaining(start))
   {
-    Q_ASSERT(refCountingFirstRangeExtent.second > 0);
-    --refCountingFirstRangeExtent.second;
-    if(refCountingFirstRangeExtent.second == 0) {
-      refCountingFirstRangeExtent = qMakePair<uint, uint>(0, 0);
-      refCountingFirstRangeStart = nullptr;
+    Q_ASSERT(range->count > 0);
+    --range->count;
+    if(range->count == 0) {
+      setRange(*range, nullptr, nullptr);
+      int slots = refCountingRangeSlotsUsed.load();
+      while(slots && !refCountingRangeSlots[slots - 1].count)
+        --slots;
+      refCountingRangeSlotsUsed.storeRelease(slots);
     }
   }
-  else if(refCountingHasAdditionalRanges)
+  else if(refCountingHasAdditionalRanges.load())
   {
     QMap< void*, QPair<uint, uint> >::iterator it = refCountingRanges->upperBound(start);
     if(it != refCountingRanges->begin()) {
@@ -70,28 +95,51 @@ void KDevelop::disableDUChainReferenceCounting(void* start)
     --it.value().second;
     if(it.value().second == 0)
       refCountingRanges->erase(it);
-    refCountingHasAdditionalRanges = !refCountingRanges->isEmpty();
+    refCountingHasAdditionalRanges.storeRelease(!refCountingRanges->isEmpty());
   }else{
     Q_ASSERT(0);
   }
 
-  if(!refCountingFirstRangeStart && !refCountingHasAdditionalRanges)
-    doReferenceCounting = false;
+  if(!refCountingRangeSlotsUsed.load() && !refCountingHasAdditionalRanges.load())
+    doReferenceCounting.storeRelease(0);
 }
 
 void KDevelop::enableDUChainReferenceCounting(void* start, unsigned int size)
 {
   QMutexLocker lock(&refCountingLock);
 
-  doReferenceCounting = true;
+  doReferenceCounting.storeRelease(1);
+
+  //The slots never overlap, so disableDUChainReferenceCounting() finds the same slot again
+  RefCountingRange* freeSlot = nullptr;
+  if(!refCountingHasAdditionalRanges.load()) {
+    for(RefCountingRange& range : refCountingRangeSlots) {
+      if(!range.count) {
+        if(!freeSlot)
+          freeSlot = &range;
+      }else if((char*)start < range.start.load() && range.start.load() < ((char*)start) + size) {
+        freeSlot = nullptr;
+        break;
+      }
+    }
+  }
 
-  if(refCountingFirstRangeStart && ((char*)refCountingFirstRangeStart) <= (char*)start && (char*)start < ((char*)refCountingFirstRangeStart) + refCountingFirstRangeExtent.first)
+  if(RefCountingRange* range = rangeSlotContaining(start))
+  {
+    //Increase the count for the containing range
+    ++range->count;
+    if(range->end.load() < ((char*)start) + size)
+      setRange(*range, range->start.load(), ((char*)start) + size);
+  }else if(freeSlot)
   {
-    //Increase the count for the first range
-    ++refCountingFirstRangeExtent.second;
-  }else if(refCountingHasAdditionalRanges || refCountingFirstRangeStart)
+    freeSlot->count = 1;
+    setRange(*freeSlot, (char*)start, ((char*)start) + size);
+    const int slot = freeSlot - refCountingRangeSlots;
+    if(slot >= refCountingRangeSlotsUsed.load())
+      refCountingRangeSlotsUsed.storeRelease(slot + 1);
+  }else
   {
-    //There is additional ranges in the ranges-structure. Add any new ranges there as well.
+    //No slot can be used. Add any new ranges to the ranges-structure as well, until it is empty again.
     QMap< void*, QPair<uint, uint> >::iterator it = refCountingRanges->upperBound(start);
     if(it != refCountingRanges->begin()) {
       --it;
@@ -127,14 +175,10 @@ void KDevelop::enableDUChainReferenceCounting(void* start, unsigned int size)
         it.value().first = size;
     }
 
-    refCountingHasAdditionalRanges = true;
-  }else{
-    refCountingFirstRangeStart = start;
-    refCountingFirstRangeExtent.first = size;
-    refCountingFirstRangeExtent.second = 1;
+    refCountingHasAdditionalRanges.storeRelease(1);
   }
 
-  Q_ASSERT(refCountingHasAdditionalRanges == (refCountingRanges && !refCountingRanges->isEmpty()));
+  Q_ASSERT(refCountingHasAdditionalRanges.load() == (refCountingRanges && !refCountingRanges->isEmpty()));
 #ifdef TEST_REFERENCE_COUNTING
   Q_ASSERT(shouldDoDUChainReferenceCounting(start));
   Q_ASSERT(shouldDoDUChainReferenceCounting(((char*)start + (size-1))));
@@ -226,10 +270,9 @@ ReferenceCountManager& ReferenceCountManager::ReferenceCountManager::operator=(c
 //   return references->findIndex(ReferenceCountItem);
 // }
 
-void ReferenceCountManager::increase(uint& ref, uint targetId) {
+void ReferenceCountManager::addReference(uint targetId) {
   Q_ASSERT(shouldDoDUChainReferenceCounting(this));
   Q_ASSERT(!references->findIndex(ReferenceCountItem(m_id, targetId)));
-  ++ref;
 
   {
     int oldIndex = oldReferences->findIndex(ReferenceCountItem(m_id, targetId));
@@ -240,16 +283,36 @@ void ReferenceCountManager::increase(uint& ref, uint targetId) {
   Q_ASSERT(references->index(ReferenceCountItem(m_id, targetId)));
 }
 
-void ReferenceCountManager::decrease(uint& ref, uint targetId) {
-  Q_ASSERT(ref > 0);
+void ReferenceCountManager::removeReference(uint targetId) {
   Q_ASSERT(shouldDoDUChainReferenceCounting(this));
   Q_ASSERT(!oldReferences->findIndex(ReferenceCountItem(m_id, targetId)));
   uint refIndex = references->findIndex(ReferenceCountItem(m_id, targetId));
   Q_ASSERT(refIndex);
-  --ref;
   references->deleteItem(refIndex);
   oldReferences->index(ReferenceCountItem(m_id, targetId));
 }
+
+void ReferenceCountManager::increase(uint& ref, uint targetId) {
+  addReference(targetId);
+  ++ref;
+}
+
+void ReferenceCountManager::decrease(uint& ref, uint targetId) {
+  Q_ASSERT(ref > 0);
+  removeReference(targetId);
+  --ref;
+}
+
+void ReferenceCountManager::increase(QAtomicInteger<uint>& ref, uint targetId) {
+  addReference(targetId);
+  ref.ref();
+}
+
+void ReferenceCountManager::decrease(QAtomicInteger<uint>& ref, uint targetId) {
+  Q_ASSERT(ref.load() > 0);
+  removeReference(targetId);
+  ref.deref();
+}
 }
 
 #else
@@ -23,6 +23,8 @@
 
 #include "serializationexport.h"
 
+#include <QAtomicInteger>
+#include <QAtomicPointer>
 #include <QMap>
 #include <QPair>
 #include <QMutexLocker>
@@ -40,13 +42,38 @@ namespace KDevelop {
 
   ///Since shouldDoDUChainReferenceCounting is called extremely often, we export some internals into the header here,
   ///so the reference-counting code can be inlined.
-  
-  KDEVPLATFORMSERIALIZATION_EXPORT extern bool doReferenceCounting;
+
+  ///@internal A range for which reference-counting is enabled.
+  ///The range is read without locking. The version is odd while the range is changed, so a reader that
+  ///sees it change retries. Ranges are only changed while refCountingLock is locked.
+  struct RefCountingRange {
+    QAtomicInteger<uint> version;
+    QAtomicPointer<char> start;
+    QAtomicPointer<char> end;
+    uint count = 0; ///< How often the range was enabled, only used with refCountingLock locked
+
+    inline bool contains(const char* item) const
+    {
+      while (true) {
+        const uint before = version.loadAcquire();
+        const char* rangeStart = start.loadAcquire();
+        const char* rangeEnd = end.loadAcquire();
+        if (!(before & 1) && version.loadAcquire() == before)
+          return rangeStart <= item && item < rangeEnd;
+      }
+    }
+  };
+
+  enum {
+    RefCountingRangeSlots = 64 ///< Further ranges go to refCountingRanges, which is only read with refCountingLock locked
+  };
+
+  KDEVPLATFORMSERIALIZATION_EXPORT extern QAtomicInt doReferenceCounting;
   KDEVPLATFORMSERIALIZATION_EXPORT  extern QMutex refCountingLock;
+  KDEVPLATFORMSERIALIZATION_EXPORT  extern RefCountingRange refCountingRangeSlots[RefCountingRangeSlots];
+  KDEVPLATFORMSERIALIZATION_EXPORT  extern QAtomicInt refCountingRangeSlotsUsed;
   KDEVPLATFORMSERIALIZATION_EXPORT  extern QMap<void*, QPair<uint, uint> >* refCountingRanges;
-  KDEVPLATFORMSERIALIZATION_EXPORT  extern bool refCountingHasAdditionalRanges;
-  KDEVPLATFORMSERIALIZATION_EXPORT  extern void* refCountingFirstRangeStart;
-  KDEVPLATFORMSERIALIZATION_EXPORT  extern QPair<uint, uint> refCountingFirstRangeExtent;
+  KDEVPLATFORMSERIALIZATION_EXPORT  extern QAtomicInt refCountingHasAdditionalRanges;
 
   KDEVPLATFORMSERIALIZATION_EXPORT void initReferenceCounting();
 
@@ -63,22 +90,22 @@ namespace KDevelop {
   }
   
   ///This is used by indexed items to decide whether they should do reference-counting
+  ///Only takes refCountingLock when more than RefCountingRangeSlots ranges are enabled at once.
   inline bool shouldDoDUChainReferenceCounting(void* item) 
   {
-    if(!doReferenceCounting) //Fast path, no place has been marked for reference counting, 99% of cases
+    if(!doReferenceCounting.load()) //Fast path, no place has been marked for reference counting, 99% of cases
       return false;
 
-    QMutexLocker lock(&refCountingLock);
-
-    if(refCountingFirstRangeStart &&
-       (((char*)refCountingFirstRangeStart) <= (char*)item) &&
-       ((char*)item < ((char*)refCountingFirstRangeStart) + refCountingFirstRangeExtent.first))
+    const int slots = refCountingRangeSlotsUsed.loadAcquire();
+    for(int a = 0; a < slots; ++a)
+      if(refCountingRangeSlots[a].contains((char*)item))
         return true;
 
-    if(refCountingHasAdditionalRanges)
+    if(refCountingHasAdditionalRanges.loadAcquire()) {
+      QMutexLocker lock(&refCountingLock);
       return shouldDoDUChainReferenceCountingInternal(item);
-    else
-      return false;
+    }
+    return false;
   }
   
   ///Enable reference-counting for the given range
@@ -106,6 +133,14 @@ namespace KDevelop {
       Q_ASSERT(ref);
       --ref;
     }
+    ///Versions for reference counts that are changed without holding the repository mutex
+    inline void increase(QAtomicInteger<uint>& ref, uint /*targetId*/) {
+      ref.ref();
+    }
+    inline void decrease(QAtomicInteger<uint>& ref, uint /*targetId*/) {
+      Q_ASSERT(ref.load());
+      ref.deref();
+    }
     
     #else
     
@@ -117,10 +152,16 @@ namespace KDevelop {
     
     void increase(uint& ref, uint targetId);
     void decrease(uint& ref, uint targetId);
+    void increase(QAtomicInteger<uint>& ref, uint targetId);
+    void decrease(QAtomicInteger<uint>& ref, uint targetId);
 
 //     bool hasReferenceCount() const;
     
     uint m_id;
+
+  private:
+    void addReference(uint targetId);
+    void removeReference(uint targetId);
     #endif
   };
 }
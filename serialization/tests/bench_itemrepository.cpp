@@ -29,6 +29,8 @@
 #include <serialization/indexedstring.h>
 
 #include <algorithm>
+#include <thread>
+#include <QElapsedTimer>
 #include <QTest>
 
 QTEST_GUILESS_MAIN(TestItemRepository);
@@ -221,3 +223,105 @@ void TestItemRepository::lookupValue()
   }
 }
 
+
+static QVector<QByteArray> generateUtf8Data()
+{
+  QVector<QByteArray> data;
+  foreach(const QString& item, generateData()) {
+    data << item.toUtf8();
+  }
+  return data;
+}
+
+/// Runs @p work(threadNumber) on @p threadCount threads and returns the elapsed time in ms
+template<typename Work>
+static qint64 runThreaded(int threadCount, const Work& work)
+{
+  QElapsedTimer timer;
+  timer.start();
+  std::vector<std::thread> threads;
+  threads.reserve(threadCount);
+  for(int i = 0; i < threadCount; ++i) {
+    threads.emplace_back(work, i);
+  }
+  for(auto& thread : threads) {
+    thread.join();
+  }
+  return qMax(timer.elapsed(), qint64(1));
+}
+
+static void addThreadedRows()
+{
+  QTest::addColumn<int>("threads");
+  QTest::addColumn<uint>("stripeBits");
+
+  for(int threads = 1; threads <= 32; threads *= 2) {
+    QTest::newRow(qPrintable(QString::number(threads))) << threads << 0u;
+    QTest::newRow(qPrintable(QStringLiteral("%1 striped").arg(threads))) << threads << 4u;
+  }
+}
+
+static void threadedInsertData(TestDataRepository& repo, const QVector<QByteArray>& data, int threadCount)
+{
+  // Every thread inserts a disjoint slice, so the total work is independent of the thread count
+  const qint64 elapsed = runThreaded(threadCount, [&](int thread) {
+    for(int i = thread; i < data.size(); i += threadCount) {
+      repo.index(TestDataRepositoryItemRequest(data[i].constData(), data[i].length()));
+    }
+  });
+  qDebug() << threadCount << "threads:" << (data.size() / elapsed) << "inserts/ms";
+}
+
+static void threadedLookupData(TestDataRepository& repo, const QVector<QByteArray>& data, int threadCount)
+{
+  // Every thread looks up all items, so this measures the scaling of the throughput
+  const qint64 elapsed = runThreaded(threadCount, [&](int thread) {
+    for(int i = 0; i < data.size(); ++i) {
+      const QByteArray& item = data[(i + thread * 997) % data.size()];
+      const uint index = repo.findIndex(TestDataRepositoryItemRequest(item.constData(), item.length()));
+      Q_ASSERT(index);
+      repo.itemFromIndex(index);
+    }
+  });
+  qDebug() << threadCount << "threads:" << (qint64(data.size()) * threadCount / elapsed) << "lookups/ms";
+}
+
+void TestItemRepository::threadedInsert_data()
+{
+  addThreadedRows();
+}
+
+void TestItemRepository::threadedInsert()
+{
+  QFETCH(int, threads);
+  QFETCH(uint, stripeBits);
+
+  const QVector<QByteArray> data = generateUtf8Data();
+  TestDataRepository repo(QStringLiteral("TestDataRepositoryThreadedInsert%1_%2").arg(threads).arg(stripeBits));
+  if(stripeBits)
+    repo.setStripeBits(stripeBits);
+  QBENCHMARK_ONCE {
+    threadedInsertData(repo, data, threads);
+  }
+  QCOMPARE(repo.statistics().totalItems, uint(data.size()));
+}
+
+void TestItemRepository::threadedLookup_data()
+{
+  addThreadedRows();
+}
+
+void TestItemRepository::threadedLookup()
+{
+  QFETCH(int, threads);
+  QFETCH(uint, stripeBits);
+
+  const QVector<QByteArray> data = generateUtf8Data();
+  TestDataRepository repo(QStringLiteral("TestDataRepositoryThreadedLookup%1_%2").arg(threads).arg(stripeBits));
+  if(stripeBits)
+    repo.setStripeBits(stripeBits);
+  threadedInsertData(repo, data, 1);
+  QBENCHMARK_ONCE {
+    threadedLookupData(repo, data, threads);
+  }
+}
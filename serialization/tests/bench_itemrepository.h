@@ -36,6 +36,10 @@ private Q_SLOTS:
     void removeDisk();
     void lookupKey();
     void lookupValue();
+    void threadedInsert_data();
+    void threadedInsert();
+    void threadedLookup_data();
+    void threadedLookup();
 };
 
 #endif // TESTITEMREPOSITORY_H
@@ -30,6 +30,8 @@
 
 #include <utility>
 
+#include <random>
+
 QTEST_GUILESS_MAIN(TestIndexedString);
 
 using namespace KDevelop;
@@ -249,3 +251,24 @@ void TestIndexedString::testCString()
     QCOMPARE(str.index(), 0u);
     QVERIFY(str.isEmpty());
 }
+
+void TestIndexedString::testHashString()
+{
+  // hashString may use a vectorized implementation, it has to match the RunningHash that is stored on disk
+  std::mt19937 random(42);
+  QByteArray text;
+  for (int length = 0; length < 300; ++length) {
+    for (int offset = 0; offset < 4; ++offset) {
+      text.resize(length + offset);
+      for (int i = 0; i < text.size(); ++i) {
+        text[i] = static_cast<char>(random());
+      }
+
+      IndexedString::RunningHash running;
+      for (int i = offset; i < text.size(); ++i) {
+        running.append(text[i]);
+      }
+      QCOMPARE(IndexedString::hashString(text.constData() + offset, length), running.hash);
+    }
+  }
+}
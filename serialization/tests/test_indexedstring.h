@@ -48,6 +48,7 @@ private Q_SLOTS:
     void test_data();
 
     void testCString();
+    void testHashString();
 };
 
 #endif // TESTINDEXEDSTRING_H
@@ -1,8 +1,11 @@
 #include <QObject>
 #include <QTest>
+#include <QHash>
+#include <QThread>
 #include <serialization/itemrepository.h>
 #include <serialization/indexedstring.h>
 #include <stdlib.h>
+#include <algorithm>
 #include <time.h>
 
 #include <tests/testcore.h>
@@ -93,6 +96,106 @@ TestItem* createItem(uint id, uint size) {
   return ret;
 }
 
+//An item with an atomic reference count, padded so the items are spread over many buckets
+struct CountedItem {
+  unsigned int hash() const {
+    return m_hash;
+  }
+
+  unsigned int itemSize() const {
+    return sizeof(CountedItem);
+  }
+
+  uint m_hash;
+  QAtomicInteger<uint> m_count;
+  char m_padding[3000];
+};
+
+struct CountedItemRequest {
+  uint m_hash;
+
+  explicit CountedItemRequest(uint hash) : m_hash(hash) {
+  }
+  enum {
+    AverageSize = sizeof(CountedItem)
+  };
+
+  uint hash() const {
+    return m_hash;
+  }
+
+  size_t itemSize() const {
+    return sizeof(CountedItem);
+  }
+
+  void createItem(CountedItem* item) const {
+    memset(item, 0, sizeof(CountedItem));
+    item->m_hash = m_hash;
+  }
+
+  static void destroy(CountedItem* /*item*/, KDevelop::AbstractItemRepository&) {
+  }
+
+  static bool persistent(const CountedItem* /*item*/) {
+    return true;
+  }
+
+  bool equals(const CountedItem* item) const {
+    return item->m_hash == m_hash;
+  }
+};
+
+typedef KDevelop::ItemRepository<CountedItem, CountedItemRequest> CountedItemRepository;
+
+//Increases the counts of all items a number of times without locking the repository
+class CountingThread : public QThread {
+  public:
+    CountingThread(CountedItemRepository& repository, const QVector<uint>& indices, int rounds)
+      : m_repository(repository), m_indices(indices), m_rounds(rounds) {
+    }
+
+    void run() override {
+      for(int round = 0; round < m_rounds; ++round) {
+        foreach(uint index, m_indices)
+          m_repository.changeItemLockFree(index, [](CountedItem* item) { item->m_count.ref(); });
+      }
+    }
+
+  private:
+    CountedItemRepository& m_repository;
+    QVector<uint> m_indices;
+    int m_rounds;
+};
+
+//Inserts and looks up the same items as other threads, and records the indices it got
+class StripedLookupThread : public QThread {
+  public:
+    StripedLookupThread(CountedItemRepository& repository, uint itemCount, uint offset)
+      : m_repository(repository), m_itemCount(itemCount), m_offset(offset), m_errors(0) {
+    }
+
+    void run() override {
+      for(uint a = 0; a < m_itemCount; ++a) {
+        const uint hash = (a + m_offset) % m_itemCount + 1;
+        const uint index = m_repository.index(CountedItemRequest(hash));
+        if(!index || m_repository.findIndex(CountedItemRequest(hash)) != index || m_repository.itemFromIndex(index)->m_hash != hash)
+          ++m_errors;
+        m_indices.insert(hash, index);
+      }
+    }
+
+    QHash<uint, uint> m_indices;
+    int errors() const {
+      return m_errors;
+    }
+
+  private:
+    CountedItemRepository& m_repository;
+    uint m_itemCount;
+    uint m_offset;
+    int m_errors;
+};
+
 ///@todo Add a test where the complete content is deleted again, and make sure the result has a nice structure
 ///@todo More consistency and lost-space tests, especially about monster-buckets. Make sure their space is re-claimed
 class TestItemRepository : public QObject {
@@ -254,6 +357,120 @@ class TestItemRepository : public QObject {
       QVERIFY(!repository.findIndex(TestItemRequest(*monsterItem, true)));
       repository.deleteItem(smallIndex);
     }
+    void replayCommittedJournal()
+    {
+      QScopedArrayPointer<TestItem> item(createItem(4711, 100));
+      {
+        KDevelop::ItemRepository<TestItem, TestItemRequest> repository(QStringLiteral("CommittedJournal"));
+        QVERIFY(repository.index(TestItemRequest(*item, true)));
+        // Simulate a crash after the journal was committed, but before it was applied
+        repository.storeJournal();
+        repository.commitJournal();
+      }
+      KDevelop::ItemRepository<TestItem, TestItemRequest> repository(QStringLiteral("CommittedJournal"));
+      QVERIFY(repository.findIndex(TestItemRequest(*item, true)));
+    }
+    void discardPendingJournal()
+    {
+      QScopedArrayPointer<TestItem> item(createItem(4712, 100));
+      {
+        KDevelop::ItemRepository<TestItem, TestItemRequest> repository(QStringLiteral("PendingJournal"));
+        QVERIFY(repository.index(TestItemRequest(*item, true)));
+        // Simulate a crash while the journal was written
+        repository.storeJournal();
+      }
+      KDevelop::ItemRepository<TestItem, TestItemRequest> repository(QStringLiteral("PendingJournal"));
+      QVERIFY(!repository.findIndex(TestItemRequest(*item, true)));
+    }
+    void applyJournaledStateAfterChange()
+    {
+      QScopedArrayPointer<TestItem> journaledItem(createItem(4713, 100));
+      QScopedArrayPointer<TestItem> laterItem(createItem(4714, 100));
+      {
+        KDevelop::ItemRepository<TestItem, TestItemRequest> repository(QStringLiteral("ChangedAfterJournal"));
+        QVERIFY(repository.index(TestItemRequest(*journaledItem, true)));
+        repository.storeJournal();
+        repository.syncFiles();
+        repository.commitJournal();
+        // The bucket changes before the journal is applied, the change belongs to the next store
+        QVERIFY(repository.index(TestItemRequest(*laterItem, true)));
+        repository.applyJournal();
+        repository.syncFiles();
+        repository.finishJournal();
+        // Simulate a crash before the next store
+      }
+      KDevelop::ItemRepository<TestItem, TestItemRequest> repository(QStringLiteral("ChangedAfterJournal"));
+      QVERIFY(repository.findIndex(TestItemRequest(*journaledItem, true)));
+      QVERIFY(!repository.findIndex(TestItemRequest(*laterItem, true)));
+      QCOMPARE(repository.statistics().totalItems, 1u);
+    }
+    void changeLockFreeWhileStoring()
+    {
+      const uint itemCount = 500;
+      const int threadCount = 4;
+      const int rounds = 100;
+
+      QVector<uint> indices;
+      {
+        CountedItemRepository repository(QStringLiteral("LockFreeChanges"));
+        for(uint a = 1; a <= itemCount; ++a)
+          indices << repository.index(CountedItemRequest(a));
+
+        QList<CountingThread*> threads;
+        for(int a = 0; a < threadCount; ++a) {
+          threads << new CountingThread(repository, indices, rounds);
+          threads.last()->start();
+        }
+
+        //Storing writes and unloads buckets while they are changed, no change may get lost
+        int stores = 0;
+        while(std::any_of(threads.begin(), threads.end(), [](CountingThread* thread) { return thread->isRunning(); })) {
+          repository.store();
+          ++stores;
+        }
+        foreach(CountingThread* thread, threads)
+          QVERIFY(thread->wait());
+        qDeleteAll(threads);
+        QVERIFY(stores > 0);
+
+        foreach(uint index, indices)
+          QCOMPARE(repository.itemFromIndex(index)->m_count.load(), uint(threadCount * rounds));
+        repository.store();
+      }
+
+      CountedItemRepository repository(QStringLiteral("LockFreeChanges"));
+      foreach(uint index, indices)
+        QCOMPARE(repository.itemFromIndex(index)->m_count.load(), uint(threadCount * rounds));
+    }
+    void stripedConcurrentAccess()
+    {
+      const uint itemCount = 2000;
+      const int threadCount = 4;
+
+      CountedItemRepository repository(QStringLiteral("StripedRepository"));
+      repository.setStripeBits(3);
+      QCOMPARE(repository.stripeCount(), 8u);
+
+      QList<StripedLookupThread*> threads;
+      for(int a = 0; a < threadCount; ++a) {
+        threads << new StripedLookupThread(repository, itemCount, a * itemCount / threadCount);
+        threads.last()->start();
+      }
+
+      //Storing unloads buckets, so the lookups also have to load buckets while other threads look up items
+      while(std::any_of(threads.begin(), threads.end(), [](StripedLookupThread* thread) { return thread->isRunning(); }))
+        repository.store();
+      foreach(StripedLookupThread* thread, threads)
+        QVERIFY(thread->wait());
+
+      //All threads got the same index for each item
+      foreach(StripedLookupThread* thread, threads) {
+        QCOMPARE(thread->errors(), 0);
+        QCOMPARE(thread->m_indices.size(), int(itemCount));
+        QVERIFY(thread->m_indices == threads.first()->m_indices);
+      }
+      qDeleteAll(threads);
+    }
     void usePermissiveModuloWhenRemovingClashLinks()
     {
       KDevelop::ItemRepository<TestItem, TestItemRequest> repository(QStringLiteral("PermissiveModulo"));
@@ -43,6 +43,14 @@ void addDiagnostics(ProblemStoreNode *node, const QVector<IProblem::Ptr> &diagno
     }
 }
 
+/// Creates the node of a problem with its diagnostics
+ProblemNode* createProblemNode(ProblemStoreNode *parent, const IProblem::Ptr &problem)
+{
+    ProblemNode *node = new ProblemNode(parent, problem);
+    addDiagnostics(node, problem->diagnostics());
+    return node;
+}
+
 /**
  * @brief Base class for grouping strategy classes
  *
@@ -51,8 +59,9 @@ void addDiagnostics(ProblemStoreNode *node, const QVector<IProblem::Ptr> &diagno
 class GroupingStrategy
 {
 public:
-    explicit GroupingStrategy( ProblemStoreNode *root )
-        : m_rootNode(root)
+    GroupingStrategy( ProblemStore *store, ProblemStoreNode *root )
+        : m_store(store)
+        , m_rootNode(root)
         , m_groupedRootNode(new ProblemStoreNode())
     {
     }
@@ -63,6 +72,9 @@ public:
     /// Add a problem to the appropriate group
     virtual void addProblem(const IProblem::Ptr &problem) = 0;
 
+    /// Replaces the nodes of the @p removed problems with nodes for the @p added ones, announcing the changed rows
+    virtual void replaceProblems(const QSet<const IProblem*> &removed, const QVector<IProblem::Ptr> &added) = 0;
+
     /// Find the specified noe
     const ProblemStoreNode* findNode(int row, ProblemStoreNode *parent = nullptr) const
     {
@@ -88,6 +100,7 @@ public:
     }
 
 protected:
+    ProblemStore *m_store;
     ProblemStoreNode *m_rootNode;
     QScopedPointer<ProblemStoreNode> m_groupedRootNode;
 };
@@ -98,17 +111,26 @@ protected:
 class NoGroupingStrategy final : public GroupingStrategy
 {
 public:
-    explicit NoGroupingStrategy(ProblemStoreNode *root)
-        : GroupingStrategy(root)
+    NoGroupingStrategy(ProblemStore *store, ProblemStoreNode *root)
+        : GroupingStrategy(store, root)
     {
     }
 
     void addProblem(const IProblem::Ptr &problem) override
     {
-        ProblemNode *node = new ProblemNode(m_groupedRootNode.data(), problem);
-        addDiagnostics(node, problem->diagnostics());
-        m_groupedRootNode->addChild(node);
+        m_groupedRootNode->addChild(createProblemNode(m_groupedRootNode.data(), problem));
+    }
+
+    void replaceProblems(const QSet<const IProblem*> &removed, const QVector<IProblem::Ptr> &added) override
+    {
+        m_store->removeNodes(m_groupedRootNode.data(), removed);
 
+        QVector<ProblemStoreNode*> nodes;
+        nodes.reserve(added.size());
+        foreach (const IProblem::Ptr &problem, added) {
+            nodes += createProblemNode(m_groupedRootNode.data(), problem);
+        }
+        m_store->insertNodes(m_groupedRootNode.data(), m_groupedRootNode->count(), nodes);
     }
 
 };
@@ -119,35 +141,81 @@ public:
 class PathGroupingStrategy final : public GroupingStrategy
 {
 public:
-    explicit PathGroupingStrategy(ProblemStoreNode *root)
-        : GroupingStrategy(root)
+    PathGroupingStrategy(ProblemStore *store, ProblemStoreNode *root)
+        : GroupingStrategy(store, root)
     {
     }
 
     void addProblem(const IProblem::Ptr &problem) override
     {
-        QString path = problem->finalLocation().document.str();
-
-        /// See if we already have this path
-        ProblemStoreNode *parent = nullptr;
-        foreach (ProblemStoreNode *node, m_groupedRootNode->children()) {
-            if (node->label() == path) {
-                parent = node;
-                break;
-            }
-        }
+        const IndexedString document = problem->finalLocation().document;
 
-        /// If not add it!
+        /// See if we already have this path, if not add it!
+        ProblemStoreNode *&parent = m_labels[document];
         if (parent == nullptr) {
-            parent = new LabelNode(m_groupedRootNode.data(), path);
+            parent = new LabelNode(m_groupedRootNode.data(), document.str());
             m_groupedRootNode->addChild(parent);
         }
 
-        ProblemNode *node = new ProblemNode(parent, problem);
-        addDiagnostics(node, problem->diagnostics());
-        parent->addChild(node);
+        parent->addChild(createProblemNode(parent, problem));
+    }
+
+    void replaceProblems(const QSet<const IProblem*> &removed, const QVector<IProblem::Ptr> &added) override
+    {
+        /// Only the labels of the paths the problems are in change
+        QSet<IndexedString> removedDocuments;
+        foreach (const IProblem *problem, removed) {
+            removedDocuments.insert(problem->finalLocation().document);
+        }
+
+        foreach (const IndexedString &document, removedDocuments) {
+            ProblemStoreNode *parent = m_labels.value(document);
+            if (parent == nullptr)
+                continue;
+
+            m_store->removeNodes(parent, removed);
+            if (parent->count() == 0) {
+                m_labels.remove(document);
+                m_store->removeNodes(m_groupedRootNode.data(), parent->index(), 1);
+            }
+        }
+
+        QVector<IndexedString> addedDocuments;
+        QHash<IndexedString, QVector<ProblemStoreNode*>> addedNodes;
+        foreach (const IProblem::Ptr &problem, added) {
+            const IndexedString document = problem->finalLocation().document;
+            QVector<ProblemStoreNode*> &nodes = addedNodes[document];
+            if (nodes.isEmpty())
+                addedDocuments += document;
+            nodes += createProblemNode(nullptr, problem);
+        }
+
+        QVector<ProblemStoreNode*> newLabels;
+        foreach (const IndexedString &document, addedDocuments) {
+            ProblemStoreNode *parent = m_labels.value(document);
+            if (parent != nullptr) {
+                m_store->insertNodes(parent, parent->count(), addedNodes[document]);
+                continue;
+            }
+
+            /// New labels come with their problems already
+            parent = new LabelNode(m_groupedRootNode.data(), document.str());
+            parent->insertChildren(0, addedNodes[document]);
+            m_labels.insert(document, parent);
+            newLabels += parent;
+        }
+        m_store->insertNodes(m_groupedRootNode.data(), m_groupedRootNode->count(), newLabels);
+    }
+
+    void clear() override
+    {
+        GroupingStrategy::clear();
+        m_labels.clear();
     }
 
+private:
+    /// The label nodes by the path they stand for
+    QHash<IndexedString, ProblemStoreNode*> m_labels;
 };
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -163,8 +231,8 @@ public:
         GroupHint           = 2
     };
 
-    explicit SeverityGroupingStrategy(ProblemStoreNode *root)
-        : GroupingStrategy(root)
+    SeverityGroupingStrategy(ProblemStore *store, ProblemStoreNode *root)
+        : GroupingStrategy(store, root)
     {
         /// Create the groups on construction, so there's no need to search for them on addition
         m_groupedRootNode->addChild(new LabelNode(m_groupedRootNode.data(), i18n("Error")));
@@ -174,18 +242,23 @@ public:
 
     void addProblem(const IProblem::Ptr &problem) override
     {
-        ProblemStoreNode *parent = nullptr;
+        ProblemStoreNode *parent = group(problem);
+        parent->addChild(createProblemNode(parent, problem));
+    }
 
-        switch (problem->severity()) {
-            case IProblem::Error: parent = m_groupedRootNode->child(GroupError); break;
-            case IProblem::Warning: parent = m_groupedRootNode->child(GroupWarning); break;
-            case IProblem::Hint: parent = m_groupedRootNode->child(GroupHint); break;
-            default: break;
+    void replaceProblems(const QSet<const IProblem*> &removed, const QVector<IProblem::Ptr> &added) override
+    {
+        QVector<ProblemStoreNode*> addedNodes[GroupHint + 1];
+        foreach (const IProblem::Ptr &problem, added) {
+            ProblemStoreNode *parent = group(problem);
+            addedNodes[parent->index()] += createProblemNode(parent, problem);
         }
 
-        ProblemNode *node = new ProblemNode(m_groupedRootNode.data(), problem);
-        addDiagnostics(node, problem->diagnostics());
-        parent->addChild(node);
+        for (int row = GroupError; row <= GroupHint; ++row) {
+            ProblemStoreNode *parent = m_groupedRootNode->child(row);
+            m_store->removeNodes(parent, removed);
+            m_store->insertNodes(parent, parent->count(), addedNodes[row]);
+        }
     }
 
     void clear() override
@@ -194,6 +267,17 @@ public:
         m_groupedRootNode->child(GroupWarning)->clear();
         m_groupedRootNode->child(GroupHint)->clear();
     }
+
+private:
+    /// Returns the group node of the problem's severity
+    ProblemStoreNode* group(const IProblem::Ptr &problem) const
+    {
+        switch (problem->severity()) {
+            case IProblem::Error: return m_groupedRootNode->child(GroupError);
+            case IProblem::Warning: return m_groupedRootNode->child(GroupWarning);
+            default: return m_groupedRootNode->child(GroupHint);
+        }
+    }
 };
 
 }
@@ -208,7 +292,7 @@ class FilteredProblemStorePrivate
 public:
     explicit FilteredProblemStorePrivate(FilteredProblemStore* q)
         : q(q)
-        , m_strategy(new NoGroupingStrategy(q->rootNode()))
+        , m_strategy(new NoGroupingStrategy(q, q->rootNode()))
         , m_grouping(NoGrouping)
     {
     }
@@ -239,6 +323,36 @@ void FilteredProblemStore::addProblem(const IProblem::Ptr &problem)
         d->m_strategy->addProblem(problem);
 }
 
+void FilteredProblemStore::setProblems(const IndexedString &document, const QVector<IProblem::Ptr> &problems)
+{
+    // keeps the old problems alive until their nodes are gone
+    const QVector<IProblem::Ptr> oldProblems = reportedProblems(document);
+    if (oldProblems == problems)
+        return;
+
+    // only the grouped nodes are shown, so the unfiltered ones change silently
+    {
+        QSignalBlocker blocker(this);
+        ProblemStore::setProblems(document, problems);
+    }
+
+    QSet<const IProblem*> removed;
+    removed.reserve(oldProblems.size());
+    foreach (const IProblem::Ptr &problem, oldProblems) {
+        removed.insert(problem.data());
+    }
+
+    QVector<IProblem::Ptr> added;
+    foreach (const IProblem::Ptr &problem, problems) {
+        if (d->match(problem))
+            added += problem;
+    }
+
+    d->m_strategy->replaceProblems(removed, added);
+
+    emit problemsChanged();
+}
+
 const ProblemStoreNode* FilteredProblemStore::findNode(int row, ProblemStoreNode *parent) const
 {
     return d->m_strategy->findNode(row, parent);
@@ -280,9 +394,9 @@ void FilteredProblemStore::setGrouping(int grouping)
     d->m_grouping = g;
 
     switch (g) {
-        case NoGrouping: d->m_strategy.reset(new NoGroupingStrategy(rootNode())); break;
-        case PathGrouping: d->m_strategy.reset(new PathGroupingStrategy(rootNode())); break;
-        case SeverityGrouping: d->m_strategy.reset(new SeverityGroupingStrategy(rootNode())); break;
+        case NoGrouping: d->m_strategy.reset(new NoGroupingStrategy(this, rootNode())); break;
+        case PathGrouping: d->m_strategy.reset(new PathGroupingStrategy(this, rootNode())); break;
+        case SeverityGrouping: d->m_strategy.reset(new SeverityGroupingStrategy(this, rootNode())); break;
     }
 
     rebuild();
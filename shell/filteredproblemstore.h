@@ -58,6 +58,9 @@ namespace KDevelop
  * \li endRebuild()
  * \li changed()
  *
+ * Replacing the problems reported by a single document with setProblems(document, problems) only changes the
+ * nodes of that document's old and new problems, which is announced with the beginInsertNodes() and beginRemoveNodes() signals.
+ *
  * Usage example:
  * @code
  * IProblem::Ptr problem(new DetectedProblem);
@@ -82,6 +85,11 @@ public:
     /// Adds a problem, which is then filtered and also added to the filtered problem list if it matches the filters
     void addProblem(const IProblem::Ptr &problem) override;
 
+    using ProblemStore::setProblems;
+
+    /// Replaces the problems of @p document, only the nodes of the old and new problems change
+    void setProblems(const IndexedString &document, const QVector<IProblem::Ptr> &problems) override;
+
     /// Retrieves the specified node
     const ProblemStoreNode* findNode(int row, ProblemStoreNode *parent = nullptr) const override;
 
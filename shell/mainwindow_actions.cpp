@@ -21,10 +21,14 @@ Boston, MA 02110-1301, USA.
 */
 
 #include <QApplication>
+#include <QFile>
+#include <QFileDialog>
 
 #include <KAboutData>
 #include <KAboutApplicationDialog>
 #include <KConfigGroup>
+#include <KLocalizedString>
+#include <KMessageBox>
 #include <KNotifyConfigWidget>
 #include <KToggleFullScreenAction>
 
@@ -38,8 +42,10 @@ Boston, MA 02110-1301, USA.
 
 #include "mainwindow.h"
 #include "loadedpluginsdialog.h"
+#include "debug.h"
 
 #include <interfaces/itoolviewactionlistener.h>
+#include <language/duchain/duchainlockstatistics.h>
 #include <util/scopeddialog.h>
 
 namespace KDevelop {
@@ -217,6 +223,26 @@ void MainWindowPrivate::showLoadedPlugins()
     dlg->exec();
 }
 
+void MainWindowPrivate::toggleDUChainLockStatistics(bool enabled)
+{
+    DUChainLockStatistics::setEnabled(enabled);
+}
+
+void MainWindowPrivate::dumpDUChainLockStatistics()
+{
+    qCDebug(SHELL).noquote() << DUChainLockStatistics::toText();
+
+    const QString fileName = QFileDialog::getSaveFileName(m_mainWindow, i18n("Save DUChain Lock Statistics"),
+                                                          QString(), i18n("JSON Files (*.json)"));
+    if (fileName.isEmpty())
+        return;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(DUChainLockStatistics::toJson()) == -1) {
+        KMessageBox::error(m_mainWindow, i18n("Could not write the statistics to %1: %2", fileName, file.errorString()));
+    }
+}
+
 void MainWindowPrivate::contextMenuFileNew()
 {
     m_mainWindow->activateView(m_tabView);
@@ -55,6 +55,7 @@ Boston, MA 02110-1301, USA.
 #include "colorschemechooser.h"
 
 #include <language/duchain/duchainlock.h>
+#include <language/duchain/duchainlockstatistics.h>
 #include <language/duchain/duchainutils.h>
 #include <language/duchain/topducontext.h>
 #include <sublime/container.h>
@@ -240,6 +241,20 @@ void MainWindowPrivate::setupActions()
     action->setStatusTip( i18n("Show a list of all loaded plugins") );
     action->setWhatsThis( i18nc( "@info:whatsthis", "Shows a dialog with information about all loaded plugins." ) );
 
+    if (DUChainLockStatistics::isAvailable()) {
+        action = actionCollection()->addAction( QStringLiteral("duchain_lock_statistics_record") );
+        action->setText( i18n("Record DUChain Lock Statistics") );
+        action->setCheckable( true );
+        action->setChecked( DUChainLockStatistics::isEnabled() );
+        connect( action, &QAction::toggled, this, &MainWindowPrivate::toggleDUChainLockStatistics );
+        action->setWhatsThis( i18nc( "@info:whatsthis", "Records how long each place in the code waits for and holds the DUChain lock. Only useful for debugging performance problems." ) );
+
+        action = actionCollection()->addAction( QStringLiteral("duchain_lock_statistics_dump") );
+        action->setText( i18n("Dump DUChain Lock Statistics...") );
+        connect( action, &QAction::triggered, this, &MainWindowPrivate::dumpDUChainLockStatistics );
+        action->setWhatsThis( i18nc( "@info:whatsthis", "Prints a summary of the recorded DUChain lock statistics to the debug output, and saves all samples to a JSON file." ) );
+    }
+
     action = actionCollection()->addAction( QStringLiteral("view_next_window") );
     action->setText( i18n( "&Next Window" ) );
     connect( action, &QAction::triggered, this, &MainWindowPrivate::gotoNextWindow );
@@ -117,6 +117,8 @@ public Q_SLOTS:
     void configureNotifications();
     void showAboutPlatform();
     void showLoadedPlugins();
+    void toggleDUChainLockStatistics(bool enabled);
+    void dumpDUChainLockStatistics();
 
     void toggleArea(bool b);
     void showErrorMessage(QString message, int timeout);
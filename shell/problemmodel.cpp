@@ -99,6 +99,10 @@ ProblemModel::ProblemModel(QObject * parent, ProblemStore *store)
 
     connect(d->m_problems.data(), &ProblemStore::beginRebuild, this, &ProblemModel::onBeginRebuild);
     connect(d->m_problems.data(), &ProblemStore::endRebuild, this, &ProblemModel::onEndRebuild);
+    connect(d->m_problems.data(), &ProblemStore::beginInsertNodes, this, &ProblemModel::onBeginInsertNodes);
+    connect(d->m_problems.data(), &ProblemStore::endInsertNodes, this, &ProblemModel::onEndInsertNodes);
+    connect(d->m_problems.data(), &ProblemStore::beginRemoveNodes, this, &ProblemModel::onBeginRemoveNodes);
+    connect(d->m_problems.data(), &ProblemStore::endRemoveNodes, this, &ProblemModel::onEndRemoveNodes);
 
     connect(d->m_problems.data(), &ProblemStore::problemsChanged, this, &ProblemModel::problemsChanged);
 }
@@ -192,13 +196,7 @@ QModelIndex ProblemModel::parent(const QModelIndex& index) const
         return {};
     }
 
-    ProblemStoreNode *parent = node->parent();
-    if (!parent || parent->isRoot()) {
-        return {};
-    }
-
-    int idx = parent->index();
-    return createIndex(idx, 0, parent);
+    return indexForNode(node->parent());
 }
 
 QModelIndex ProblemModel::index(int row, int column, const QModelIndex& parent) const
@@ -268,6 +266,12 @@ void ProblemModel::setProblems(const QVector<IProblem::Ptr> &problems)
     endResetModel();
 }
 
+void ProblemModel::setProblems(const KDevelop::IndexedString& document, const QVector<IProblem::Ptr> &problems)
+{
+    /// Will trigger the node signals for the changed rows
+    d->m_problems->setProblems(document, problems);
+}
+
 void ProblemModel::clearProblems()
 {
     beginResetModel();
@@ -330,6 +334,35 @@ void ProblemModel::onEndRebuild()
     endResetModel();
 }
 
+void ProblemModel::onBeginInsertNodes(ProblemStoreNode *parent, int first, int last)
+{
+    beginInsertRows(indexForNode(parent), first, last);
+}
+
+void ProblemModel::onEndInsertNodes()
+{
+    endInsertRows();
+}
+
+void ProblemModel::onBeginRemoveNodes(ProblemStoreNode *parent, int first, int last)
+{
+    beginRemoveRows(indexForNode(parent), first, last);
+}
+
+void ProblemModel::onEndRemoveNodes()
+{
+    endRemoveRows();
+}
+
+QModelIndex ProblemModel::indexForNode(ProblemStoreNode *node) const
+{
+    if (!node || node->isRoot()) {
+        return {};
+    }
+
+    return createIndex(node->index(), 0, node);
+}
+
 void ProblemModel::setShowImports(bool showImports)
 {
     Q_ASSERT(thread() == QThread::currentThread());
@@ -31,6 +31,7 @@ namespace KDevelop {
     class IDocument;
 class IndexedString;
 class ProblemStore;
+class ProblemStoreNode;
 
 /**
  * @brief Wraps a ProblemStore and adds the QAbstractItemModel interface, so the it can be used in a model/view architecture.
@@ -124,6 +125,9 @@ public:
     /// Clears the problems, then adds a new set of them
     void setProblems(const QVector<IProblem::Ptr> &problems);
 
+    /// Replaces the problems of @p document, only the rows of the old and new problems change
+    void setProblems(const KDevelop::IndexedString& document, const QVector<IProblem::Ptr> &problems);
+
     /// Clears the problems
     void clearProblems();
 
@@ -194,10 +198,25 @@ private Q_SLOTS:
     /// Triggered once the problems have been rebuilt
     void onEndRebuild();
 
+    /// Triggered before nodes are inserted into the problem tree
+    void onBeginInsertNodes(ProblemStoreNode *parent, int first, int last);
+
+    /// Triggered once nodes have been inserted into the problem tree
+    void onEndInsertNodes();
+
+    /// Triggered before nodes are removed from the problem tree
+    void onBeginRemoveNodes(ProblemStoreNode *parent, int first, int last);
+
+    /// Triggered once nodes have been removed from the problem tree
+    void onEndRemoveNodes();
+
 protected:
     ProblemStore *store() const;
 
 private:
+    /// Returns the index of the first column of @p node
+    QModelIndex indexForNode(ProblemStoreNode *node) const;
+
     const QScopedPointer<class ProblemModelPrivate> d;
 };
 
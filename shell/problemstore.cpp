@@ -50,8 +50,12 @@ public:
     /// Path of the currently open document
     KDevelop::IndexedString m_currentDocument;
 
-    /// All stored problems
-    QVector<KDevelop::IProblem::Ptr> m_allProblems;
+    /// All stored problems, by the document they are in
+    QHash<KDevelop::IndexedString, QVector<KDevelop::IProblem::Ptr>> m_documentProblems;
+
+    /// All stored problems, by the document that reported them with setProblems(document, problems),
+    /// or else by the document they are in
+    QHash<KDevelop::IndexedString, QVector<KDevelop::IProblem::Ptr>> m_reportedProblems;
 };
 
 
@@ -75,13 +79,19 @@ void ProblemStore::addProblem(const IProblem::Ptr &problem)
     node->setProblem(problem);
     d->m_rootNode->addChild(node);
 
-    d->m_allProblems += problem;
+    d->m_documentProblems[problem->finalLocation().document] += problem;
+    d->m_reportedProblems[problem->finalLocation().document] += problem;
     emit problemsChanged();
 }
 
 void ProblemStore::setProblems(const QVector<IProblem::Ptr> &problems)
 {
-    int oldSize = d->m_allProblems.size();
+    QHash<IndexedString, QVector<IProblem::Ptr>> documentProblems;
+    foreach (const IProblem::Ptr &problem, problems) {
+        documentProblems[problem->finalLocation().document] += problem;
+    }
+
+    const QHash<IndexedString, QVector<IProblem::Ptr>> oldProblems = d->m_documentProblems;
 
     // set signals block to prevent problemsChanged() emitting during clean
     {
@@ -93,24 +103,73 @@ void ProblemStore::setProblems(const QVector<IProblem::Ptr> &problems)
         d->m_rootNode->addChild(new ProblemNode(d->m_rootNode, problem));
     }
 
+    d->m_documentProblems = documentProblems;
+    d->m_reportedProblems = documentProblems;
+
     rebuild();
 
-    if (d->m_allProblems.size() != oldSize || d->m_allProblems != problems) {
-        d->m_allProblems = problems;
+    if (documentProblems != oldProblems) {
         emit problemsChanged();
     }
 }
 
-QVector<IProblem::Ptr> ProblemStore::problems(const KDevelop::IndexedString& document) const
+void ProblemStore::setProblems(const KDevelop::IndexedString& document, const QVector<IProblem::Ptr> &problems)
 {
-    QVector<IProblem::Ptr> documentProblems;
+    const QVector<IProblem::Ptr> oldProblems = d->m_reportedProblems.value(document);
+    if (oldProblems == problems)
+        return;
 
-    foreach (auto problem, d->m_allProblems) {
-        if (problem->finalLocation().document == document)
-            documentProblems += problem;
+    if (problems.isEmpty())
+        d->m_reportedProblems.remove(document);
+    else
+        d->m_reportedProblems[document] = problems;
+
+    // the problems reported by a document may be located in other documents
+    QSet<const IProblem*> removed;
+    QSet<IndexedString> removedLocations;
+    removed.reserve(oldProblems.size());
+    foreach (const IProblem::Ptr &problem, oldProblems) {
+        removed.insert(problem.data());
+        removedLocations.insert(problem->finalLocation().document);
     }
+    foreach (const IndexedString &location, removedLocations) {
+        auto it = d->m_documentProblems.find(location);
+        if (it == d->m_documentProblems.end())
+            continue;
+        QVector<IProblem::Ptr> kept;
+        foreach (const IProblem::Ptr &problem, *it) {
+            if (!removed.contains(problem.data()))
+                kept += problem;
+        }
+        if (kept.isEmpty())
+            d->m_documentProblems.erase(it);
+        else
+            *it = kept;
+    }
+    foreach (const IProblem::Ptr &problem, problems) {
+        d->m_documentProblems[problem->finalLocation().document] += problem;
+    }
+
+    removeNodes(d->m_rootNode, removed);
+
+    QVector<ProblemStoreNode*> nodes;
+    nodes.reserve(problems.size());
+    foreach (const IProblem::Ptr &problem, problems) {
+        nodes += new ProblemNode(d->m_rootNode, problem);
+    }
+    insertNodes(d->m_rootNode, d->m_rootNode->count(), nodes);
+
+    emit problemsChanged();
+}
 
-    return documentProblems;
+QVector<IProblem::Ptr> ProblemStore::problems(const KDevelop::IndexedString& document) const
+{
+    return d->m_documentProblems.value(document);
+}
+
+QVector<IProblem::Ptr> ProblemStore::reportedProblems(const KDevelop::IndexedString& document) const
+{
+    return d->m_reportedProblems.value(document);
 }
 
 const ProblemStoreNode* ProblemStore::findNode(int row, ProblemStoreNode *parent) const
@@ -130,9 +189,10 @@ int ProblemStore::count(ProblemStoreNode *parent) const
 void ProblemStore::clear()
 {
     d->m_rootNode->clear();
+    d->m_reportedProblems.clear();
 
-    if (!d->m_allProblems.isEmpty()) {
-        d->m_allProblems.clear();
+    if (!d->m_documentProblems.isEmpty()) {
+        d->m_documentProblems.clear();
         emit problemsChanged();
     }
 }
@@ -262,6 +322,48 @@ const KDevelop::IndexedString& ProblemStore::currentDocument() const
     return d->m_currentDocument;
 }
 
+void ProblemStore::insertNodes(ProblemStoreNode *parent, int row, const QVector<ProblemStoreNode*> &nodes)
+{
+    if (nodes.isEmpty())
+        return;
+
+    emit beginInsertNodes(parent, row, row + nodes.size() - 1);
+    parent->insertChildren(row, nodes);
+    emit endInsertNodes();
+}
+
+void ProblemStore::removeNodes(ProblemStoreNode *parent, int row, int count)
+{
+    if (count == 0)
+        return;
+
+    emit beginRemoveNodes(parent, row, row + count - 1);
+    parent->removeChildren(row, count);
+    emit endRemoveNodes();
+}
+
+void ProblemStore::removeNodes(ProblemStoreNode *parent, const QSet<const IProblem*> &problems)
+{
+    if (problems.isEmpty())
+        return;
+
+    // go backwards, so the rows before the removed ones stay valid
+    int end = parent->count();
+    while (end > 0) {
+        if (!problems.contains(parent->child(end - 1)->problem().data())) {
+            --end;
+            continue;
+        }
+
+        int first = end - 1;
+        while (first > 0 && problems.contains(parent->child(first - 1)->problem().data()))
+            --first;
+
+        removeNodes(parent, first, end - first);
+        end = first;
+    }
+}
+
 
 void ProblemStore::onDocumentSetChanged()
 {
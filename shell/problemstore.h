@@ -22,6 +22,7 @@
 #define PROBLEMSTORE_H
 
 #include <QObject>
+#include <QSet>
 #include <shell/shellexport.h>
 #include <serialization/indexedstring.h>
 #include <interfaces/iproblem.h>
@@ -79,9 +80,18 @@ public:
     /// Clears the current problems, and adds new ones from a list
     virtual void setProblems(const QVector<IProblem::Ptr> &problems);
 
-    /// Retrieve problems for selected document
+    /// Replaces the problems reported by @p document, which may be located in other documents.
+    /// The problems reported by other documents are kept.
+    /// The changed nodes are announced with the node signals instead of a rebuild.
+    virtual void setProblems(const KDevelop::IndexedString& document, const QVector<IProblem::Ptr> &problems);
+
+    /// Retrieve problems located in the selected document
     QVector<IProblem::Ptr> problems(const KDevelop::IndexedString& document) const;
 
+    /// Retrieve the problems reported by @p document with setProblems(document, problems).
+    /// Problems given to addProblem() or setProblems(problems) count as reported by the document they are located in.
+    QVector<IProblem::Ptr> reportedProblems(const KDevelop::IndexedString& document) const;
+
     /// Finds the specified node
     virtual const ProblemStoreNode* findNode(int row, ProblemStoreNode *parent = nullptr) const;
 
@@ -128,6 +138,15 @@ public:
     /// Retrives the path of the current document
     const KDevelop::IndexedString& currentDocument() const;
 
+    /// Inserts @p nodes as children of @p parent at @p row, announcing them with the node signals
+    void insertNodes(ProblemStoreNode *parent, int row, const QVector<ProblemStoreNode*> &nodes);
+
+    /// Deletes @p count children of @p parent starting at @p row, announcing them with the node signals
+    void removeNodes(ProblemStoreNode *parent, int row, int count);
+
+    /// Deletes the children of @p parent holding one of @p problems, announcing each run of rows with the node signals
+    void removeNodes(ProblemStoreNode *parent, const QSet<const IProblem*> &problems);
+
 Q_SIGNALS:
     /// Emitted when any store setting (grouping, scope, severity, document) is changed
     void changed();
@@ -143,6 +162,18 @@ Q_SIGNALS:
     /// Emitted once the problemlist has been rebuilt
     void endRebuild();
 
+    /// Emitted before nodes are inserted as the children @p first to @p last of @p parent
+    void beginInsertNodes(ProblemStoreNode *parent, int first, int last);
+
+    /// Emitted once the nodes have been inserted
+    void endInsertNodes();
+
+    /// Emitted before the children @p first to @p last of @p parent are removed
+    void beginRemoveNodes(ProblemStoreNode *parent, int first, int last);
+
+    /// Emitted once the nodes have been removed
+    void endRemoveNodes();
+
 private Q_SLOTS:
     /// Triggered when the watched document set changes. E.g.:document closed, new one added, etc
     virtual void onDocumentSetChanged();
@@ -117,6 +117,25 @@ public:
         child->setParent(this);
     }
 
+    /// Inserts child nodes at @p row, and reparents them
+    void insertChildren(int row, const QVector<ProblemStoreNode*> &children)
+    {
+        m_children.insert(row, children.size(), nullptr);
+        for (int i = 0; i < children.size(); ++i) {
+            m_children[row + i] = children[i];
+            children[i]->setParent(this);
+        }
+    }
+
+    /// Deletes @p count child nodes starting at @p row
+    void removeChildren(int row, int count)
+    {
+        for (int i = row; i < row + count; ++i) {
+            delete m_children[i];
+        }
+        m_children.remove(row, count);
+    }
+
     /// Returns the label of this node, if there's one
     virtual QString label() const{
         return QString();
@@ -58,6 +58,7 @@ private Q_SLOTS:
     void testNoGrouping();
     void testPathGrouping();
     void testSeverityGrouping();
+    void testDocumentProblems();
 
 private:
     // Severity grouping testing
@@ -598,6 +599,59 @@ bool TestFilteredProblemStore::checkNodeLabels()
     return true;
 }
 
+void TestFilteredProblemStore::testDocumentProblems()
+{
+    m_store->clear();
+    m_store->setGrouping(SeverityGrouping);
+    m_store->setSeverities(IProblem::Error | IProblem::Warning);
+    m_store->setProblems(m_problems);
+    QVERIFY(checkCounts(ErrorCount, WarningCount, 0));
+
+    const IndexedString document = m_problems[1]->finalLocation().document;
+    IProblem::Ptr hint(new DetectedProblem());
+    hint->setDescription(QStringLiteral("PROBLEM7"));
+    hint->setSeverity(IProblem::Hint);
+    hint->setFinalLocation(m_problems[1]->finalLocation());
+    IProblem::Ptr warning(new DetectedProblem());
+    warning->setDescription(QStringLiteral("PROBLEM8"));
+    warning->setSeverity(IProblem::Warning);
+    warning->setFinalLocation(m_problems[1]->finalLocation());
+
+    QSignalSpy beginRebuildSpy(m_store.data(), &FilteredProblemStore::beginRebuild);
+    QSignalSpy insertSpy(m_store.data(), &FilteredProblemStore::endInsertNodes);
+    QSignalSpy removeSpy(m_store.data(), &FilteredProblemStore::endRemoveNodes);
+
+    // The filtered hint is stored, but not shown
+    m_store->setProblems(document, {hint, warning});
+    QCOMPARE(beginRebuildSpy.count(), 0);
+    QCOMPARE(insertSpy.count(), 1);
+    QCOMPARE(removeSpy.count(), 1);
+    QCOMPARE(m_store->problems(document).count(), 2);
+    QVERIFY(checkNodeLabels());
+    QVERIFY(checkCounts(ErrorCount, WarningCount, 0));
+    const ProblemStoreNode *warningNode = m_store->findNode(1);
+    QVERIFY(checkNodeDescription(warningNode->child(0), m_problems[2]->description()));
+    QVERIFY(checkNodeDescription(warningNode->child(1), warning->description()));
+
+    m_store->setSeverities(IProblem::Error | IProblem::Warning | IProblem::Hint);
+    QVERIFY(checkCounts(ErrorCount, WarningCount, HintCount + 1));
+
+    // The labels of the path grouping follow the documents
+    m_store->setGrouping(PathGrouping);
+    QCOMPARE(m_store->count(), ProblemsCount);
+    m_store->setProblems(document, {});
+    QCOMPARE(m_store->count(), ProblemsCount - 1);
+    m_store->setProblems(document, {warning});
+    QCOMPARE(m_store->count(), ProblemsCount);
+    const ProblemStoreNode *node = m_store->findNode(ProblemsCount - 1);
+    QVERIFY(checkNodeLabel(node, document.str()));
+    QCOMPARE(node->count(), 1);
+    QVERIFY(checkNodeDescription(node->child(0), warning->description()));
+
+    m_store->setGrouping(NoGrouping);
+    m_store->clear();
+}
+
 // Generate 3 problems, all with different paths, different severity
 // Also generates a problem with diagnostics
 void TestFilteredProblemStore::generateProblems()
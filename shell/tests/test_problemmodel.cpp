@@ -18,6 +18,7 @@
  */
 
 #include <QTest>
+#include <QSignalSpy>
 
 #include <shell/problemmodel.h>
 #include <shell/problem.h>
@@ -49,6 +50,7 @@ private Q_SLOTS:
     void testNoGrouping();
     void testPathGrouping();
     void testSeverityGrouping();
+    void testDocumentProblems();
 
 private:
     void generateProblems();
@@ -362,6 +364,61 @@ void TestProblemModel::testSeverityGrouping()
     m_model->clearProblems();
 }
 
+void TestProblemModel::testDocumentProblems()
+{
+    m_model->clearProblems();
+    m_model->setGrouping(PathGrouping);
+    m_model->setSeverity(IProblem::Hint);
+    m_model->setProblems(m_problems);
+    QCOMPARE(m_model->rowCount(), 3);
+
+    const IndexedString document = m_problems[1]->finalLocation().document;
+    IProblem::Ptr p(new DetectedProblem());
+    p->setDescription(QStringLiteral("PROBLEM4"));
+    p->setSeverity(IProblem::Warning);
+    p->setFinalLocation(m_problems[1]->finalLocation());
+
+    QSignalSpy resetSpy(m_model.data(), &ProblemModel::modelReset);
+    QSignalSpy insertedSpy(m_model.data(), &ProblemModel::rowsInserted);
+    QSignalSpy removedSpy(m_model.data(), &ProblemModel::rowsRemoved);
+
+    // Replacing the problem only changes the rows below the label of the document
+    m_model->setProblems(document, {p});
+    QCOMPARE(resetSpy.count(), 0);
+    QCOMPARE(removedSpy.count(), 1);
+    QCOMPARE(removedSpy.at(0).at(0).value<QModelIndex>(), m_model->index(1, 0));
+    QCOMPARE(insertedSpy.count(), 1);
+    QCOMPARE(insertedSpy.at(0).at(0).value<QModelIndex>(), m_model->index(1, 0));
+    QCOMPARE(m_model->rowCount(), 3);
+    QVERIFY(checkPathGroup(0, m_problems[0]));
+    QVERIFY(checkPathGroup(1, p));
+    QVERIFY(checkPathGroup(2, m_problems[2]));
+    QCOMPARE(m_model->problems(document), QVector<IProblem::Ptr>({p}));
+
+    // Without problems the label goes away
+    m_model->setProblems(document, {});
+    QCOMPARE(resetSpy.count(), 0);
+    QCOMPARE(removedSpy.count(), 3);
+    QCOMPARE(removedSpy.at(2).at(0).value<QModelIndex>(), QModelIndex());
+    QCOMPARE(removedSpy.at(2).at(1).toInt(), 1);
+    QCOMPARE(m_model->rowCount(), 2);
+    QVERIFY(m_model->problems(document).isEmpty());
+
+    // And it comes back at the end
+    m_model->setProblems(document, {p});
+    QCOMPARE(resetSpy.count(), 0);
+    QCOMPARE(insertedSpy.count(), 2);
+    QCOMPARE(insertedSpy.at(1).at(0).value<QModelIndex>(), QModelIndex());
+    QCOMPARE(insertedSpy.at(1).at(1).toInt(), 2);
+    QCOMPARE(m_model->rowCount(), 3);
+    QVERIFY(checkPathGroup(2, p));
+
+    // Setting the same problems again changes nothing
+    m_model->setProblems(document, {p});
+    QCOMPARE(insertedSpy.count(), 2);
+    QCOMPARE(removedSpy.count(), 3);
+}
+
 // Generate 3 problems, all with different paths, different severity
 // Also generates a problem with diagnostics
 void TestProblemModel::generateProblems()
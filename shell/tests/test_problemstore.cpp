@@ -23,6 +23,7 @@
 #include <shell/problem.h>
 #include <shell/problemstorenode.h>
 #include <shell/problemconstants.h>
+#include <language/editor/documentrange.h>
 
 #include <tests/testcore.h>
 #include <tests/autotestshell.h>
@@ -44,6 +45,7 @@ private Q_SLOTS:
     void testSeverity();
     void testSeverities();
     void testScope();
+    void testSetDocumentProblems();
 
 private:
     void generateProblems();
@@ -143,6 +145,64 @@ void TestProblemStore::testScope()
     QCOMPARE(spy.count(), 1);
 }
 
+void TestProblemStore::testSetDocumentProblems()
+{
+    m_store->clear();
+
+    const IndexedString document(QStringLiteral("/just/a/random/path"));
+    const IndexedString otherDocument(QStringLiteral("/just/another/path"));
+
+    auto locatedProblem = [](const QString &description, const IndexedString &location) -> IProblem::Ptr {
+        IProblem::Ptr problem(new DetectedProblem());
+        problem->setDescription(description);
+        DocumentRange range;
+        range.document = location;
+        problem->setFinalLocation(range);
+        return problem;
+    };
+    const IProblem::Ptr inDocument = locatedProblem(QStringLiteral("IN DOCUMENT"), document);
+    // e.g. an error in an included header, reported by the document that includes it
+    const IProblem::Ptr inOtherDocument = locatedProblem(QStringLiteral("IN OTHER DOCUMENT"), otherDocument);
+    const IProblem::Ptr ofOtherDocument = locatedProblem(QStringLiteral("OF OTHER DOCUMENT"), otherDocument);
+    const IProblem::Ptr replacement = locatedProblem(QStringLiteral("REPLACEMENT"), document);
+
+    QSignalSpy changedSpy(m_store.data(), &ProblemStore::problemsChanged);
+    QSignalSpy insertSpy(m_store.data(), &ProblemStore::endInsertNodes);
+    QSignalSpy removeSpy(m_store.data(), &ProblemStore::endRemoveNodes);
+
+    m_store->setProblems(document, {inDocument, inOtherDocument});
+    m_store->setProblems(otherDocument, {ofOtherDocument});
+    QCOMPARE(m_store->count(), 3);
+    QCOMPARE(changedSpy.count(), 2);
+    QCOMPARE(insertSpy.count(), 2);
+    QCOMPARE(m_store->reportedProblems(document), QVector<IProblem::Ptr>({inDocument, inOtherDocument}));
+    QCOMPARE(m_store->reportedProblems(otherDocument), QVector<IProblem::Ptr>({ofOtherDocument}));
+
+    // The problems of a document are the ones located in it, whoever reported them
+    QCOMPARE(m_store->problems(document), QVector<IProblem::Ptr>({inDocument}));
+    QCOMPARE(m_store->problems(otherDocument), QVector<IProblem::Ptr>({inOtherDocument, ofOtherDocument}));
+
+    // Only the nodes of the problems reported by the document are replaced
+    m_store->setProblems(document, {replacement});
+    QCOMPARE(m_store->count(), 2);
+    QCOMPARE(changedSpy.count(), 3);
+    QCOMPARE(removeSpy.count(), 1);
+    QCOMPARE(m_store->findNode(0)->problem(), ofOtherDocument);
+    QCOMPARE(m_store->findNode(1)->problem(), replacement);
+    QCOMPARE(m_store->problems(document), QVector<IProblem::Ptr>({replacement}));
+    QCOMPARE(m_store->problems(otherDocument), QVector<IProblem::Ptr>({ofOtherDocument}));
+
+    // Nothing happens if the problems stay the same
+    m_store->setProblems(document, {replacement});
+    QCOMPARE(changedSpy.count(), 3);
+    QCOMPARE(insertSpy.count(), 3);
+
+    m_store->setProblems(document, {});
+    QCOMPARE(m_store->count(), 1);
+    QVERIFY(m_store->problems(document).isEmpty());
+    QVERIFY(m_store->reportedProblems(document).isEmpty());
+}
+
 void TestProblemStore::generateProblems()
 {
     for (int i = 0; i < 5; i++) {
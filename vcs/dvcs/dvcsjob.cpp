@@ -29,6 +29,7 @@
 
 #include <QFile>
 #include <QList>
+#include <QMetaMethod>
 #include <QStringList>
 #include <QDir>
 #include <QUrl>
@@ -45,6 +46,7 @@ class KDevelop::DVcsJobPrivate
 {
 public:
     DVcsJobPrivate() : childproc(new KProcess), vcsplugin(nullptr), ignoreError(false)
+        , incrementalResults(false), fetchedResults(0), emittedOutput(0)
     {}
 
     ~DVcsJobPrivate() {
@@ -61,6 +63,14 @@ public:
     OutputModel* model;
 
     bool ignoreError;
+
+    /// Whether the results are added with appendResults()
+    bool incrementalResults;
+    QVariantList appendedResults;
+    /// The number of appended results that fetchResults() returned already
+    int fetchedResults;
+    /// The number of bytes of output that were passed to outputLinesReceived()
+    int emittedOutput;
 };
 
 DVcsJob::DVcsJob(const QDir& workingDir, IPlugin* parent, OutputJob::OutputJobVerbosity verbosity)
@@ -146,11 +156,32 @@ void DVcsJob::setResults(const QVariant &res)
     d->results = res;
 }
 
+void DVcsJob::appendResults(const QVariantList& results)
+{
+    d->incrementalResults = true;
+    if (results.isEmpty()) {
+        return;
+    }
+
+    d->appendedResults += results;
+    emit resultsReady(this);
+}
+
 QVariant DVcsJob::fetchResults()
 {
+    if (d->incrementalResults) {
+        const QVariantList results = d->appendedResults.mid(d->fetchedResults);
+        d->fetchedResults = d->appendedResults.size();
+        return results;
+    }
     return d->results;
 }
 
+QVariant DVcsJob::allResults() const
+{
+    return d->incrementalResults ? QVariant(d->appendedResults) : d->results;
+}
+
 void DVcsJob::start()
 {
     Q_ASSERT_X(d->status != JobRunning, "DVCSjob::start", "Another proccess was started using this job class");
@@ -261,8 +292,10 @@ void DVcsJob::slotProcessExited(int exitCode, QProcess::ExitStatus exitStatus)
     else if (exitCode != 0 && !d->ignoreError)
         slotProcessError(QProcess::UnknownError);
 
-    else
+    else {
+        emitOutputLines(true);
         jobIsReady();
+    }
 }
 
 void DVcsJob::displayOutput(const QString& data)
@@ -278,6 +311,28 @@ void DVcsJob::slotReceivedStdout()
     d->output.append(output);
 
     displayOutput(QString::fromLocal8Bit(output));
+    emitOutputLines(false);
+}
+
+void DVcsJob::emitOutputLines(bool finished)
+{
+    static const QMetaMethod signal = QMetaMethod::fromSignal(&DVcsJob::outputLinesReceived);
+    if (!isSignalConnected(signal)) {
+        return;
+    }
+
+    // only pass complete lines on while the command runs, the output may end in the middle of a character
+    const int end = finished ? d->output.size() : d->output.lastIndexOf('\n') + 1;
+    if (end <= d->emittedOutput) {
+        return;
+    }
+
+    QString lines = QString::fromLocal8Bit(d->output.constData() + d->emittedOutput, end - d->emittedOutput);
+    d->emittedOutput = end;
+    if (lines.endsWith(QLatin1Char('\n'))) {
+        lines.chop(1);
+    }
+    emit outputLinesReceived(this, lines.split(QLatin1Char('\n')));
 }
 
 VcsJob::JobStatus DVcsJob::status() const
@@ -177,13 +177,26 @@ public:
      */
     virtual void setResults(const QVariant &res);
 
+    /**
+     * Adds @p results to the results of the job and announces them with resultsReady().
+     * Parsers connected to outputLinesReceived() use it to report results while the command runs.
+     * @note Don't mix it with setResults().
+     */
+    void appendResults(const QVariantList& results);
+
     /**
      * Returns execution results stored in QVariant.
      * Mostly used in vcscommitdialog.
+     * If the results were added with appendResults(), only the ones that were not fetched before are returned.
      * @see setResults(const QVariant &res)
      */
     QVariant fetchResults() override;
 
+    /**
+     * Returns all results of the job, including those that fetchResults() returned already.
+     */
+    QVariant allResults() const;
+
     /**
      * Returns JobStatus
      * @see KDevelop::VcsJob::JobStatus
@@ -209,6 +222,12 @@ public Q_SLOTS:
 Q_SIGNALS:
     void readyForParsing(KDevelop::DVcsJob *job);
 
+    /**
+     * Emitted while the command runs, whenever complete @p lines of its output arrived.
+     * The lines after the last newline follow when the command finished, before readyForParsing().
+     */
+    void outputLinesReceived(KDevelop::DVcsJob *job, const QStringList& lines);
+
 protected Q_SLOTS:
     virtual void slotProcessError( QProcess::ProcessError );
 
@@ -221,6 +240,7 @@ protected:
 
 private:
     void jobIsReady();
+    void emitOutputLines(bool finished);
 
 private:
     const QScopedPointer<class DVcsJobPrivate> d;
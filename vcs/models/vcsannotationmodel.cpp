@@ -31,6 +31,7 @@
 #include <QLocale>
 #include <QUrl>
 #include <QApplication>
+#include <QPointer>
 
 #include <KLocalizedString>
 
@@ -47,7 +48,7 @@ public:
     KDevelop::VcsAnnotation m_annotation;
     QHash<KDevelop::VcsRevision,QBrush> m_brushes;
     VcsAnnotationModel* q;
-    VcsJob* job;
+    QPointer<VcsJob> job;
     QColor foreground;
     QColor background;
 
@@ -93,7 +94,14 @@ VcsAnnotationModel::VcsAnnotationModel(VcsJob *job, const QUrl& url, QObject* pa
     ICore::self()->runController()->registerJob( d->job );
 }
 
-VcsAnnotationModel::~VcsAnnotationModel() = default;
+VcsAnnotationModel::~VcsAnnotationModel()
+{
+    // the lines are reported while the job runs, nobody waits for the rest
+    if( d->job && d->job->status() == VcsJob::JobRunning )
+    {
+        d->job->kill();
+    }
+}
 
 static QString abbreviateLastName(const QString& author) {
     auto parts = author.split(' ');
@@ -134,6 +134,12 @@ public:
     QUrl m_url;
     bool done;
     bool fetching;
+    /// Whether the next event received is the first one of the running job
+    bool firstEvent;
+    /// Whether the first event of the running job is the last one in the model already
+    bool skipFirstEvent;
+    /// The number of events the running job added
+    int addedEvents;
 };
 
 VcsEventLogModel::VcsEventLogModel(KDevelop::IBasicVersionControl* iface, const VcsRevision& rev, const QUrl& url, QObject* parent)
@@ -144,6 +150,9 @@ VcsEventLogModel::VcsEventLogModel(KDevelop::IBasicVersionControl* iface, const
     d->m_url = url;
     d->done = false;
     d->fetching = false;
+    d->firstEvent = false;
+    d->skipFirstEvent = false;
+    d->addedEvents = 0;
 }
 
 VcsEventLogModel::~VcsEventLogModel() = default;
@@ -156,35 +165,52 @@ bool VcsEventLogModel::canFetchMore(const QModelIndex& parent) const
 void VcsEventLogModel::fetchMore(const QModelIndex& parent)
 {
     d->fetching = true;
+    d->firstEvent = true;
+    d->skipFirstEvent = rowCount() > 0;
+    d->addedEvents = 0;
     Q_ASSERT(!parent.isValid());
     Q_UNUSED(parent);
     VcsJob* job = d->m_iface->log(d->m_url, d->m_rev, qMax(rowCount(), 100));
     connect(this, &VcsEventLogModel::destroyed, job, [job] { job->kill(); });
+    // jobs may report their results in parts while they run
+    connect(job, &VcsJob::resultsReady, this, &VcsEventLogModel::addResults);
     connect(job, &VcsJob::finished, this, &VcsEventLogModel::jobReceivedResults);
     ICore::self()->runController()->registerJob( job );
 }
 
-void VcsEventLogModel::jobReceivedResults(KJob* job)
+void VcsEventLogModel::addResults(VcsJob* job)
 {
-    QList<QVariant> l = qobject_cast<KDevelop::VcsJob *>(job)->fetchResults().toList();
-    if(l.isEmpty() || job->error()!=0) {
-        d->done = true;
-        return;
-    }
     QList<KDevelop::VcsEvent> newevents;
-    foreach( const QVariant &v, l )
+    foreach( const QVariant &v, job->fetchResults().toList() )
     {
         if( v.canConvert<KDevelop::VcsEvent>() )
         {
             newevents << v.value<KDevelop::VcsEvent>();
         }
     }
+    if (newevents.isEmpty()) {
+        return;
+    }
+
     d->m_rev = newevents.last().revision();
-    if (rowCount()) {
+    // the log starts at the last event that is known already
+    if (d->firstEvent && d->skipFirstEvent) {
         newevents.removeFirst();
     }
-    d->done = newevents.isEmpty();
+    d->firstEvent = false;
+    d->addedEvents += newevents.count();
     addEvents( newevents );
+}
+
+void VcsEventLogModel::jobReceivedResults(KJob* job)
+{
+    VcsJob* vcsJob = qobject_cast<KDevelop::VcsJob *>(job);
+    // some jobs announce the results only after they finished, they are all taken now
+    disconnect(vcsJob, &VcsJob::resultsReady, this, &VcsEventLogModel::addResults);
+    if (job->error() == 0) {
+        addResults(vcsJob);
+    }
+    d->done = job->error() != 0 || d->addedEvents == 0;
     d->fetching = false;
 }
 
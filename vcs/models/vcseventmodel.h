@@ -34,6 +34,7 @@ namespace KDevelop
 class VcsRevision;
 class IBasicVersionControl;
 class VcsEvent;
+class VcsJob;
 
 /**
  * This is a generic model to store a list of VcsEvents.
@@ -85,6 +86,7 @@ public:
     bool canFetchMore(const QModelIndex& parent) const override;
 
 private Q_SLOTS:
+    void addResults( KDevelop::VcsJob* job );
     void jobReceivedResults( KJob* job );
 
 private: